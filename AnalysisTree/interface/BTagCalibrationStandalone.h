@@ -146,7 +146,8 @@ protected:
 * BTagCalibrationReader
 *
 * Helper class to pull out a specific set of BTagEntry's out of a
-* BTagCalibration. TF1 functions are set up at initialization time.
+* BTagCalibration. Formulas are compiled and the entries are indexed
+* by their eta and pt intervals at initialization time.
 *
 ************************************************************/
 
@@ -2,6 +2,7 @@
 #define BASETREELOOPER_H
 
 #include <vector>
+#include <map>
 #include <string>
 #include <utility>
 #include <algorithm>
@@ -12,6 +13,7 @@
 #include "TriggerHelpersCore.h"
 #include "ParticleDisambiguator.h"
 #include "DileptonHandler.h"
+#include "ProductRecord.h"
 #include <IvyFramework/IvyAutoMELA/interface/IvyMELAHelpers.h>
 
 
@@ -19,6 +21,9 @@ class BaseTreeLooper : public IvyBase{
 public:
   typedef bool(*LooperCoreFunction_t)(BaseTreeLooper*, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const&, SimpleEntry&);
   typedef void(*LooperExtFunction_t)(BaseTreeLooper*, SimpleEntry&);
+  typedef bool(*LooperSetupFunction_t)(BaseTreeLooper*);
+  typedef bool(*LooperPreselectionFunction_t)(BaseTreeLooper*);
+  typedef void(*PreselectionBranchBookingFunction_t)(BaseTree*, TString const&);
 
 protected:
   enum SampleIdStorageType{
@@ -29,9 +34,30 @@ protected:
 
   // Function to determine if event should be included
   LooperCoreFunction_t looperFunction;
+  // Function to bind handlers and HLT menus once per input tree, called after wrapTree
+  LooperSetupFunction_t looperSetupFunction;
+  // Function to reject events using only the preselection branches, which are read individually before the rest of the event
+  LooperPreselectionFunction_t looperPreselectionFunction;
+  std::vector<std::pair<TString, PreselectionBranchBookingFunction_t>> preselectionBranches;
+  // Persisted outcomes of the preselection function, one bit per event, to skip rejected events in later passes
+  TString preselectionIndexDir;
+  TString preselectionIndexId;
+
+  // Output columns declared by the producer. If it is set, products are written through its slots instead of SimpleEntry names.
+  ProductRecord* productRecord;
+  // Whether the producer also writes values outside the product record.
+  // If it does not, the output trees are filled directly through the slots of the record.
+  bool productRecordHasExtraValues;
+  // Whether values outside the record were already reported when they were not declared
+  bool productRecordExtraValuesReported;
+  // Columns of the product record that are not written for specific systematics
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<TString>> productRecordExclusions;
 
   // Systematics type
   SystematicsHelpers::SystematicVariationTypes registeredSyst;
+  // List of systematics to evaluate in a single pass over the input events.
+  // If it is empty, only registeredSyst is evaluated.
+  std::vector<SystematicsHelpers::SystematicVariationTypes> registeredSystList;
 
   // Max. events to process
   int maxNEvents;
@@ -41,6 +67,28 @@ protected:
   int eventIndex_end;
   bool useChunkIndices;
 
+  // Summaries of the measured processing time, used to balance the chunks.
+  // Each line of a summary file lists a key (the sample identifier in simulation, or 'Run_<run number>' in data), the number of events and the time in seconds.
+  std::vector<TString> chunkCostSummaryInputs;
+  TString chunkCostSummaryOutput;
+
+  // Input tree cache size in bytes (negative values keep the ROOT defaults)
+  Long64_t inputTreeCacheSize;
+  // Flag to prepare the next input tree on a separate thread while the current one is processed
+  bool doPrefetchNextTree;
+
+  // Memory in bytes that the baskets of each output tree may hold before they are written into the output file (0 keeps the ROOT default)
+  size_t outputTreeMemoryLimit;
+
+  // Minimum wall time in seconds between two progress reports
+  double progressReportInterval;
+
+  // Checkpoint file, and the number of accumulated events between two checkpoints (0 disables checkpoints)
+  TString checkpointFileName;
+  unsigned int checkpointInterval;
+  // File of the data events tracked by the event filter at the last checkpoint
+  TString checkpointEventsFileName;
+
   // Variables set per tree
   bool isData_currentTree;
   bool isQCD_currentTree;
@@ -55,9 +103,15 @@ protected:
   std::vector<std::string> lheMElist;
   std::vector<std::string> recoMElist;
   IvyMELAHelpers::GMECBlock MEblock;
+  // Flattened MELA inputs of the last ME computation.
+  // The MEs are not recomputed as long as the inputs do not change, e.g., over systematics that only change weights or SFs.
+  bool hasCachedMEInputs;
+  std::vector<double> cachedMEInputs;
+  std::vector<double> currentMEInputs;
 
   // Selection counts
   std::vector<std::pair<TString, unsigned int>> selection_string_count_pairs;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<std::pair<TString, unsigned int>>> syst_selection_string_count_pairs;
 
   // Input trees
   std::vector<BaseTree*> treeList;
@@ -81,6 +135,7 @@ protected:
 
   // Output trees
   std::vector<BaseTree*> productTreeList;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, BaseTree*> systProductTrees;
 
   // Flags for output trees
   std::unordered_map<BaseTree*, bool> firstTreeOutput;
@@ -90,6 +145,11 @@ protected:
   std::vector<SimpleEntry>* productListRef;
   BaseTree* currentProductTree;
   void addProduct(SimpleEntry& product, unsigned int* ev_rec=nullptr);
+  // Record the product record of the current event, together with any additional values in 'product'.
+  // Additional values are written only if the producer declares them through setProductRecord,
+  // and they have to be present from the first recorded product of each output tree on because their branches cannot be added later.
+  void addRecordedProduct(SimpleEntry& product);
+  static bool hasNamedValues(SimpleEntry const& product);
 
   // Set pTG exception range
   void set_pTG_exception_range(float const& vlow, float const& vhigh){ pTG_true_exception_range[0] = vlow; pTG_true_exception_range[1] = vhigh; }
@@ -101,7 +161,47 @@ protected:
 
   void sigint_callback_handler(int snum);
 
-  void resetSelectionCounts(){ selection_string_count_pairs.clear(); }
+  // Set up the TTreeCache of the input tree for the booked branches and the entry range to be read, and read the first entry.
+  // If fillCache=false, only the cache size is set, and the cache learns the branches that are read.
+  // This function is also used to prepare the next tree in the background.
+  void prepareInputTree(BaseTree* tree, Long64_t const& ev_first, Long64_t const& ev_last, bool fillCache) const;
+
+  template<typename T> static void bookPreselectionBranch(BaseTree* tree, TString const& bname){ tree->bookBranch<T>(bname, T()); }
+
+  // Chunk cost summary I/O and the assignment of chunks of equal expected processing time.
+  // The assignment functions return false if no cost information applies, in which case chunks are assigned by number of events or runs.
+  typedef std::map<TString, std::pair<double, double>> ChunkCostSummary_t; // Key -> (number of events, time in seconds)
+  bool readChunkCostSummaries(ChunkCostSummary_t& costs) const;
+  void writeChunkCostSummary(ChunkCostSummary_t const& costs) const;
+  bool assignCostBalancedSimChunk(int const& ichunk, int const& nchunks, ChunkCostSummary_t const& costs);
+  bool assignCostBalancedDataChunk(int const& ichunk, int const& nchunks, ChunkCostSummary_t const& costs);
+
+  // Checkpoint I/O.
+  // Besides the event counters, a checkpoint stores the selection counts of the current tree, the measured processing times,
+  // and the data events tracked by the event filter, so that a resumed loop ends in the same state as an uninterrupted one.
+  // The selection counts are returned separately because they only apply once the skipped events are traversed.
+  typedef std::unordered_map<unsigned int, std::pair<double, double>> RunCostSummary_t; // Run number -> (number of events, time in seconds)
+  typedef std::vector<std::pair<TString, unsigned int>> SelectionCounts_t;
+  void getOutputTrees(std::vector<BaseTree*>& outtrees) const;
+  void writeCheckpoint(
+    int const& nevents_total, unsigned int const& ev_traversed, unsigned int const& ev_acc, unsigned int const& ev_rec,
+    ChunkCostSummary_t const& measuredChunkCosts, RunCostSummary_t const& measuredRunCosts
+  );
+  bool readCheckpoint(
+    int const& nevents_total, unsigned int& ev_traversed, unsigned int& ev_acc, unsigned int& ev_rec,
+    ChunkCostSummary_t& measuredChunkCosts, RunCostSummary_t& measuredRunCosts,
+    SelectionCounts_t& selectionCounts, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, SelectionCounts_t>& systSelectionCounts
+  );
+
+  // Preselection index I/O
+  TString getPreselectionIndexFileName(BaseTree* tree) const;
+  bool readPreselectionIndex(BaseTree* tree, std::vector<unsigned long long>& passBits) const;
+  bool writePreselectionIndex(BaseTree* tree, std::vector<unsigned long long> const& passBits) const;
+
+  void resetSelectionCounts(){ selection_string_count_pairs.clear(); syst_selection_string_count_pairs.clear(); }
+
+  // Collect the handlers whose products depend on the systematic
+  void getSystematicDependentHandlers(std::vector<IvyBase*>& handlers) const;
 
 public:
   // Constructors
@@ -123,7 +223,20 @@ public:
   void addHLTMenu(TString name, std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const& hltmenu);
 
   void setLooperFunction(BaseTreeLooper::LooperCoreFunction_t fcn){ looperFunction = fcn; }
-  void setSystematic(SystematicsHelpers::SystematicVariationTypes const& syst){ registeredSyst = syst; }
+  void setLooperSetupFunction(BaseTreeLooper::LooperSetupFunction_t fcn){ looperSetupFunction = fcn; }
+  void setLooperPreselectionFunction(BaseTreeLooper::LooperPreselectionFunction_t fcn){ looperPreselectionFunction = fcn; }
+  // Write the products through the columns of 'record'. The record is reset before each call to the looper function.
+  // If the looper function writes no values outside the record, hasExtraValues=false lets the output trees be filled directly.
+  void setProductRecord(ProductRecord* record, bool hasExtraValues=true){ productRecord = record; productRecordHasExtraValues = hasExtraValues; }
+  // Skip the columns in 'colnames' in the products of systematic 'syst'. This has to be set before the output trees are filled.
+  void setProductRecordExclusions(SystematicsHelpers::SystematicVariationTypes const& syst, std::vector<TString> const& colnames){ productRecordExclusions[syst] = colnames; }
+  // Add a branch to be read before the rest of the event. Its value can be retrieved in the preselection function through getPreselectionValue.
+  template<typename T> void addPreselectionBranch(TString const& bname);
+  // Store the preselection outcomes under the directory 'indexdir' with the identifier 'id', or read them if they already exist.
+  // The identifier has to change whenever the preselection function or its branches change.
+  void setPreselectionIndex(TString const& indexdir, TString const& id){ preselectionIndexDir = indexdir; preselectionIndexId = id; }
+  void setSystematic(SystematicsHelpers::SystematicVariationTypes const& syst){ registeredSyst = syst; registeredSystList.clear(); }
+  void setSystematics(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs); // Evaluate all systematics over each event read only once
   void setExternalWeight(BaseTree* tree, double const& wgt);
   void setExternalWeights(BaseTree* tree, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& wgts);
   void setMatrixElementList(std::vector<std::string> const& MElist, bool const& isGen);
@@ -132,14 +245,36 @@ public:
   void setExternalProductList(std::vector<SimpleEntry>* extProductListRef=nullptr);
   void setCurrentOutputTree(BaseTree* extTree=nullptr);
   void addOutputTree(BaseTree* extTree);
+  void addOutputTree(SystematicsHelpers::SystematicVariationTypes const& syst, BaseTree* extTree); // Output tree for a specific systematic in setSystematics. The current output tree is not changed.
   void addOutputTrees(std::vector<BaseTree*> trees);
 
   // Max. events
   void setMaximumEvents(int n);
 
+  // Memory in bytes that the baskets of each output tree may hold before they are written into the output file (0 keeps the ROOT default)
+  void setOutputTreeMemoryLimit(size_t const& nbytes){ outputTreeMemoryLimit = nbytes; }
+
+  // Input reading options
+  void setInputTreeCacheSize(Long64_t const& cachesize){ inputTreeCacheSize = cachesize; }
+  // Prefetching requires ROOT::EnableThreadSafety() to be called in the driver before any input is opened.
+  // It is skipped when a preselection function is set because events are not read in order then.
+  void setPrefetchNextTree(bool flag){ doPrefetchNextTree = flag; }
+
+  // Progress reporting
+  void setProgressReportInterval(double const& seconds){ progressReportInterval = seconds; }
+
+  // Checkpoints: Every 'nevents_interval' accumulated events, i.e., events within the requested range, the output trees are flushed and the loop state is recorded in 'fname'.
+  // If the file exists when the loop starts, the events already processed are skipped, so the new products complete the flushed ones.
+  // ROOT's automatic AutoSave is turned off for the output trees in this case, so the output files only change on disk at checkpoints.
+  void setCheckpoint(TString const& fname, unsigned int nevents_interval){ checkpointFileName = fname; checkpointInterval = nevents_interval; }
+  bool hasCheckpoint() const;
+  void clearCheckpoint() const; // Call once the output is finalized
+
   // Event index range
   void setEventIndexRange(int istart, int iend);
   void setEventIndexRangeBySampleChunks(bool flag){ useChunkIndices = flag; } // Set if the function above uses chunk indices instead of actual event ranges
+  void addChunkCostSummary(TString const& fname){ chunkCostSummaryInputs.push_back(fname); } // Balance the chunks using the processing times in this summary
+  void setChunkCostSummaryOutput(TString const& fname){ chunkCostSummaryOutput = fname; } // Record the processing times of this loop into a summary
 
   // Get-functions
   int const& getMaximumEvents() const{ return maxNEvents; }
@@ -148,11 +283,19 @@ public:
   bool const& getCurrentTreeFlag_GJetsHTException() const{ return isGJets_HT_currentTree; }
   bool getPTGExceptionRange(float& vlow, float& vhigh) const{ vlow = pTG_true_exception_range[0]; vhigh = pTG_true_exception_range[1]; return (vlow!=vhigh); }
   SystematicsHelpers::SystematicVariationTypes const& getSystematic() const{ return registeredSyst; }
+  std::vector<SystematicsHelpers::SystematicVariationTypes> const& getSystematics() const{ return registeredSystList; }
   std::vector<IvyBase*> const& getObjectHandlers() const{ return registeredHandlers; }
   std::vector<ScaleFactorHandlerBase*> const& getSFHandlers() const{ return registeredSFHandlers; }
   std::unordered_map<TString, BulkReweightingBuilder*> const& getRegisteredRewgtBuilders() const{ return registeredRewgtBuilders; }
   std::unordered_map<TString, std::vector< std::string > > const& getHLTMenus() const{ return registeredHLTMenus; }
   std::unordered_map<TString, std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > > const& getHLTMenuProperties() const{ return registeredHLTMenuProperties; }
+  // Lookups to be used in the setup function. They return nullptr if the handler or the menu is not registered.
+  template<typename T> T* getObjectHandler() const;
+  template<typename T> T* getSFHandler() const;
+  std::vector< std::string > const* getHLTMenu(TString const& name) const;
+  std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const* getHLTMenuProperties(TString const& name) const;
+  ProductRecord* getProductRecord() const{ return productRecord; }
+  template<typename T> bool getPreselectionValue(TString const& bname, T const*& val){ return this->getConsumed(bname, val); }
   ParticleDisambiguator& getParticleDisambiguator(){ return particleDisambiguator; }
   ParticleDisambiguator const& getParticleDisambiguator() const{ return particleDisambiguator; }
   DileptonHandler& getDileptonHandler(){ return dileptonHandler; }
@@ -167,6 +310,16 @@ public:
   bool hasGenMEs() const{ return !lheMElist.empty(); }
   bool hasRecoMEs() const{ return !recoMElist.empty(); }
 
+  // Compute the MEs of the MEblock for the given MELA inputs and push them to the ME branches.
+  // If daughters==nullptr, the MEs are computed without any input event.
+  // The computation is skipped if the inputs are identical to those of the last computation.
+  void computeMEs(
+    TVar::CandidateDecayMode const& decaymode,
+    SimpleParticleCollection_t* daughters, SimpleParticleCollection_t* associated=nullptr, SimpleParticleCollection_t* mothers=nullptr,
+    bool isGen=false
+  );
+  void resetMECache(){ hasCachedMEInputs=false; cachedMEInputs.clear(); }
+
   // Function to add and increment a selection type to count
   void incrementSelection(TString const& strsel, unsigned int inc=1);
 
@@ -182,5 +335,26 @@ public:
 
 };
 
+template<typename T> void BaseTreeLooper::addPreselectionBranch(TString const& bname){
+  for (auto const& pp:preselectionBranches){ if (pp.first == bname) return; }
+  preselectionBranches.emplace_back(bname, &BaseTreeLooper::bookPreselectionBranch<T>);
+  this->addConsumed<T>(bname);
+  this->defineConsumedSloppy(bname);
+}
+template<typename T> T* BaseTreeLooper::getObjectHandler() const{
+  for (auto const& handler:registeredHandlers){
+    T* res = dynamic_cast<T*>(handler);
+    if (res) return res;
+  }
+  return nullptr;
+}
+template<typename T> T* BaseTreeLooper::getSFHandler() const{
+  for (auto const& handler:registeredSFHandlers){
+    T* res = dynamic_cast<T*>(handler);
+    if (res) return res;
+  }
+  return nullptr;
+}
+
 
 #endif
@@ -2,9 +2,11 @@
 #define BTAGSCALEFACTORHANDLER_H
 
 #include <unordered_map>
+#include <vector>
 #include "ExtendedHistogram_2D.h"
 #include "BTagCalibrationStandalone.h"
 #include "ScaleFactorHandlerBase.h"
+#include "ScaleFactorTable.h"
 #include "AK4JetObject.h"
 #include "SystematicVariations.h"
 #include "BtagHelpers.h"
@@ -12,14 +14,16 @@
 
 class BtagScaleFactorHandler : public ScaleFactorHandlerBase{
 protected:
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::unordered_map< BTagEntry::JetFlavor, std::vector<std::vector<ExtendedHistogram_2D_f>> > > syst_flav_pujetid_WP_mceffhist_map;
+  // All MC efficiency histograms are flattened into the same table, and the map below holds their layer indices.
+  ScaleFactorTable mceff_table;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::unordered_map< BTagEntry::JetFlavor, std::vector<std::vector<size_t>> > > syst_flav_pujetid_WP_mceffhist_map;
 
   std::unordered_map<BtagHelpers::BtagWPType, BTagCalibration*> WP_calib_map;
   std::unordered_map<BtagHelpers::BtagWPType, BTagCalibrationReader*> WP_calibreader_map_nominal;
   std::unordered_map<BtagHelpers::BtagWPType, BTagCalibrationReader*> WP_calibreader_map_dn;
   std::unordered_map<BtagHelpers::BtagWPType, BTagCalibrationReader*> WP_calibreader_map_up;
 
-  void evalEfficiencyFromHistogram(float& val, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const;
+  void evalEfficiencyFromHistogram(float& val, size_t const& ilayer, ScaleFactorTable::BinLocationList_t const& binlocs) const;
 
   static void loadBTagCalibrations(BTagCalibrationReader* const& reader, BTagCalibration* const& calibration);
 
@@ -28,6 +32,12 @@ protected:
     SystematicsHelpers::SystematicVariationTypes const& syst, BTagEntry::JetFlavor const& flav, float const& pt, float const& eta
   ) const;
 
+  // Same as the public function, but with the bins of (pt, eta) already located in the MC efficiency table
+  void getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& eta, unsigned short const& pujetidcat, BTagEntry::JetFlavor const& flav, float const& btagval, float& val, float* effval) const;
+
+  // Returns false if no SF applies to the object
+  static bool getPUJetIdCategory(AK4JetObject const* obj, unsigned short& pujetidcat);
+
 public:
   BtagScaleFactorHandler();
   ~BtagScaleFactorHandler();
@@ -37,6 +47,9 @@ public:
 
   void getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, unsigned short const& pujetidcat, BTagEntry::JetFlavor const& flav, float const& btagval, float& val, float* effval) const;
   void getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, AK4JetObject const* obj, float& val, float* effval) const;
+  // Evaluate the SFs of a whole collection for each systematic in 'systs' with a single bin search per jet.
+  // vals[isyst] is the product of the SFs of all jets, with the SF of each jet bounded from below by 'minval'.
+  void getSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<AK4JetObject*> const& objs, std::vector<float>& vals, float const& minval = 0) const;
 
 };
 
@@ -9,8 +9,26 @@
 
 class Discriminant{
 protected:
+  // Knots and cubic coefficients of a TSpline3, copied into flat arrays in order to avoid the virtual calls and per-knot objects of TSpline3::Eval.
+  // The knot search and the polynomials are the same as those of TSpline3::Eval for splines built from graphs.
+  class SplineTable{
+  protected:
+    std::vector<double> xk;
+    std::vector<double> yk;
+    std::vector<double> bk;
+    std::vector<double> ck;
+    std::vector<double> dk;
+
+  public:
+    SplineTable(TSpline3* spline);
+
+    double eval(const double x) const;
+  };
+
   std::vector<std::pair<TFile*, TSpline3*>> theC;
   std::vector<std::pair<TFile*, TSpline3*>> theG;
+  std::vector<SplineTable> tableC;
+  std::vector<SplineTable> tableG;
 
   float WPCshift;
   float gscale;
@@ -18,9 +36,22 @@ protected:
 
   float val;
 
+  // Inputs bound through bindInputs, and the buffer they are copied into for each evaluation
+  std::vector<float const*> inputrefs;
+  std::vector<float> inputvals;
+
+  // Constant of the last evaluated valReco, since the same valReco is usually evaluated for consecutive systematic variations
+  mutable bool hasCachedCval;
+  mutable float cachedValReco;
+  mutable float cachedCval;
+
   void resetVal();
+  void resetCachedCval(){ hasCachedCval=false; }
   virtual void eval(const std::vector<float>& vars, const float& valReco)=0;
 
+  double evalC(const size_t ic, const float valReco) const{ return tableC[ic].eval(valReco); }
+  double evalG(const size_t ig, const float valReco) const{ return tableG[ig].eval(valReco); }
+
 public:
   Discriminant(
     const TString cfilename="", const TString splinename="sp_gr_varReco_Constant_Smooth",
@@ -42,6 +73,14 @@ public:
 
   virtual float getCval(const float valReco) const;
   float update(const std::vector<float>& vars, const float valReco);
+  // Same as above, but the inputs are copied into a buffer owned by the discriminant instead of a vector built for each event
+  float update(const float* vars, const unsigned int nvars, const float valReco);
+  // Bind the addresses of the inputs once, and evaluate from their current values in update(valReco)
+  void bindInputs(const std::vector<float const*>& inputs);
+  float update(const float valReco);
+  // Evaluate nevents events at once with inputs stored contiguously per event in 'vars',
+  // i.e., vars[iev*nvars + ivar], and write the values into 'res'.
+  void updateBatch(const float* vars, const unsigned int nvars, const size_t nevents, const float* valReco, float* res);
   float applyAdditionalC(const float cval);
 
   void setWP(float inval=0.5);
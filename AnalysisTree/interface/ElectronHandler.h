@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "IvyBase.h"
+#include "ObjectArena.h"
 #include "ElectronObject.h"
 #include "AK4JetObject.h"
 #include "AK8JetObject.h"
@@ -27,8 +28,9 @@ protected:
   OverlapMapHandler<ElectronObject, AK8JetObject>* overlapMap_electrons_ak8jets;
 
   std::vector<ProductType_t*> productList;
+  ObjectArena<ProductType_t> productArena;
 
-  void clear(){ this->resetCache(); for (ProductType_t*& prod:productList) delete prod; productList.clear(); }
+  void clear(){ this->resetCache(); productList.clear(); productArena.reset(); }
 
   bool constructElectronObjects(SystematicsHelpers::SystematicVariationTypes const& syst);
   bool associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const;
@@ -2,7 +2,9 @@
 #define ELECTRONSCALEFACTORHANDLER_H
 
 #include <unordered_map>
+#include <vector>
 #include "ScaleFactorHandlerBase.h"
+#include "ScaleFactorTable.h"
 #include "SystematicVariations.h"
 #include "ElectronObject.h"
 
@@ -20,18 +22,25 @@ public:
   };
 
 protected:
+  // All histograms are flattened into the same table, and the maps below hold their layer indices.
+  ScaleFactorTable sftable;
+
   // The map values are vectors for nongap, gap, nongap_gap (combined) histograms separated and in this order.
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_eff_mc_reco_map;
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_eff_mc_id_map;
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_eff_mc_iso_loose_map;
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_eff_mc_iso_tight_map;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_eff_mc_reco_map;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_eff_mc_id_map;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_eff_mc_iso_loose_map;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_eff_mc_iso_tight_map;
+
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_SF_reco_map;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_SF_id_map;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_SF_iso_loose_map;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_SF_iso_tight_map;
 
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_SF_reco_map;
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_SF_id_map;
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_SF_iso_loose_map;
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_SF_iso_tight_map;
+  // Same as the public function, but with the bins of (etaSC, pt) already located in the SF table
+  void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& etaSC, unsigned short const& idx_gap, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const;
 
-  void evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, float const& pt, float const& etaSC, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const;
+  // Returns false if no SF applies to the object
+  bool getIdIsoFlags(ElectronObject const* obj, bool& passId, bool& passLooseIso, bool& passTightIso) const;
 
 public:
   ElectronScaleFactorHandler();
@@ -43,6 +52,9 @@ public:
   // idx_gap==0: Non-gap, ==1: gap, ==2: combined
   void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& etaSC, unsigned short const& idx_gap, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const;
   void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ElectronObject const* obj, float& val, float* effval) const;
+  // Evaluate the SFs of a whole collection for each systematic in 'systs' with a single bin search per electron.
+  // vals[isyst] is the product of the SFs of all electrons, with the SF of each electron bounded from below by 'minval'.
+  void getIdIsoSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<ElectronObject*> const& objs, std::vector<float>& vals, float const& minval = 0) const;
 
 };
 
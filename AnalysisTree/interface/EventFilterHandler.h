@@ -2,6 +2,7 @@
 #define EVENTFILTERHANDLER_H
 
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include "IvyBase.h"
 #include "SimEventHandler.h"
@@ -14,6 +15,7 @@
 #include "HLTTriggerPathObject.h"
 #include "TriggerObject.h"
 #include "TriggerHelpersCore.h"
+#include "RunLumiEventSet.h"
 #include "SystematicVariations.h"
 
 
@@ -42,9 +44,59 @@ protected:
   std::vector<HLTTriggerPathObject*> product_HLTpaths;
   std::vector<TriggerObject*> product_triggerobjects;
   std::unordered_map<std::string, bool> product_metfilters;
-  std::unordered_map<unsigned int, std::unordered_map<unsigned int, std::vector<unsigned long long>> > era_dataeventblock_map;
+  RunLumiEventSet era_dataeventblock_set;
+
+  // HLT path indices resolved once per HLT menu, i.e., per input file, and also per run in data
+  TTree const* hltmenu_tree;
+  int hltmenu_treenumber;
+  unsigned int hltmenu_run;
+  std::vector<HLTTriggerPathProperties const*> hltmenu_runRangeExcludedProps; // One entry per HLT path, nullptr if the path has no run range exclusions
+  mutable std::unordered_map<HLTTriggerPathProperties const*, std::vector<size_t>> hltmenu_hltprop_pathIndices;
+  mutable std::unordered_map<std::string, std::vector<size_t>> hltmenu_name_pathIndices;
+
+  // Trigger checking inputs and HLT path decisions, reused over the calls to getTriggerWeight within the same event.
+  // Entries are matched by the addresses and momenta of the objects passed, so variations of the same objects are kept separate.
+  struct TriggerPathDecision{
+    bool passCuts;
+    std::vector<ParticleObject const*> particles_TOmatched;
+
+    TriggerPathDecision() : passCuts(false){}
+  };
+  struct TriggerCheckInputs{
+    std::vector< std::pair<ParticleObject const*, ParticleObject::LorentzVector_t> > signature;
+    METObject const* pfmet;
+
+    std::vector<MuonObject const*> muons;
+    std::vector<ElectronObject const*> electrons;
+    std::vector<PhotonObject const*> photons;
+    std::vector<AK4JetObject const*> ak4jets;
+    std::vector<AK8JetObject const*> ak8jets;
+    ParticleObject::LorentzVector_t pfmet_p4;
+    ParticleObject::LorentzVector_t pfmet_nomus_p4;
+    ParticleObject::LorentzVector_t ht_p4;
+    ParticleObject::LorentzVector_t ht_nomus_p4;
+
+    std::map< std::pair<HLTTriggerPathProperties const*, size_t>, TriggerPathDecision > pathDecisions;
+
+    TriggerCheckInputs() : pfmet(nullptr){}
+  };
+  mutable std::vector<TriggerCheckInputs> triggerCheckInputsCache;
 
   void clear();
+  void resetHLTMenu();
+
+  std::vector<size_t> const& getHLTPathIndices(HLTTriggerPathProperties const* hltprop) const;
+  std::vector<size_t> const& getHLTPathIndices(std::string const& name) const;
+
+  TriggerCheckInputs& getTriggerCheckInputs(
+    std::vector<MuonObject*> const* muons,
+    std::vector<ElectronObject*> const* electrons,
+    std::vector<PhotonObject*> const* photons,
+    std::vector<AK4JetObject*> const* ak4jets,
+    std::vector<AK8JetObject*> const* ak8jets,
+    METObject const* pfmet
+  ) const;
+  TriggerPathDecision const& getTriggerPathDecision(TriggerCheckInputs& inputs, HLTTriggerPathProperties const& hltprop, size_t const& ipath) const;
 
   bool constructCommonSkim();
   bool constructHLTPaths(SimEventHandler const* simEventHandler);
@@ -104,6 +156,9 @@ public:
   bool const& passCommonSkim() const{ return product_passCommonSkim; }
   // For data trees. MC is always true
   bool const& isUniqueDataEvent() const{ return product_uniqueEvent; }
+  // Data events seen so far, e.g. to be saved and restored together with the state of an event loop
+  RunLumiEventSet const& getTrackedDataEvents() const{ return era_dataeventblock_set; }
+  RunLumiEventSet& getTrackedDataEvents(){ return era_dataeventblock_set; }
 
   void setTrackDataEvents(bool flag){ this->trackDataEvents=flag; }
   void setCheckUniqueDataEvent(bool flag){ this->checkUniqueDataEvent=flag; }
@@ -115,6 +170,7 @@ public:
   std::vector<TriggerObject*> const& getTriggerObjects() const{ return this->product_triggerobjects; }
   std::unordered_map<std::string, bool> const& getMETFilters() const{ return this->product_metfilters; }
 
+  bool wrapTree(BaseTree* tree);
   void bookBranches(BaseTree* intree);
   static std::vector<std::string> acquireMETFilterFlags(BaseTree* intree, EventFilterHandler::METFilterCutType const& cuttype);
 
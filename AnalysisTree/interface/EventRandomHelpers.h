@@ -0,0 +1,37 @@
+#ifndef EVENTRANDOMHELPERS_H
+#define EVENTRANDOMHELPERS_H
+
+#include <cstdint>
+
+
+// Counter-based random numbers for per-event assignments.
+// The random number of an event is a pure function of its identifiers and the purpose it is drawn for,
+// so there is no generator state to seed per event, and the assignments do not depend on the order events are processed in.
+namespace EventRandomHelpers{
+  // Each purpose gets an independent stream for the same event
+  enum RandomNumberPurpose{
+    kDataPeriod = 0,
+    kGenMETSmear,
+
+    nRandomNumberPurposes
+  };
+
+  // Philox4x32-10 block function of Salmon et al., "Parallel random numbers: as easy as 1, 2, 3" (SC11)
+  void getRandomBits(uint32_t const (&counter)[4], uint32_t const (&key)[2], uint32_t (&res)[4]);
+
+  // Uniform random number in (0, 1) with 53 bits of precision.
+  // The counter is made of the run, lumi and event numbers, and the key of the purpose and 'salt'.
+  // The salt separates events that share the same identifiers, e.g., in different MC samples.
+  double getUniform(
+    RandomNumberPurpose const& purpose,
+    unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber,
+    uint32_t const& salt = 0
+  );
+
+  // Bit pattern of a float, convenient to use as a salt
+  uint32_t getFloatBits(float const& val);
+
+}
+
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "IvyBase.h"
+#include "ObjectArena.h"
 #include "MuonObject.h"
 #include "ElectronObject.h"
 #include "IsotrackObject.h"
@@ -19,8 +20,9 @@ protected:
   friend class ParticleDisambiguator;
 
   std::vector<ProductType_t*> productList;
+  ObjectArena<ProductType_t> productArena;
 
-  void clear(){ this->resetCache(); for (ProductType_t*& prod:productList) delete prod; productList.clear(); }
+  void clear(){ this->resetCache(); productList.clear(); productArena.reset(); }
 
   bool applyCleaning(std::vector<MuonObject*> const* muons, std::vector<ElectronObject*> const* electrons);
 
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "IvyBase.h"
+#include "ObjectArena.h"
 #include "SimEventHandler.h"
 #include "PFCandidateObject.h"
 #include "OverlapMapHandler.h"
@@ -44,6 +45,8 @@ protected:
   std::vector<AK4JetObject*> ak4jets_masked;
   std::vector<AK8JetObject*> ak8jets;
   std::vector<AK8JetObject*> ak8jets_masked;
+  ObjectArena<AK4JetObject> ak4jetArena; // Owns both ak4jets and ak4jets_masked
+  ObjectArena<AK8JetObject> ak8jetArena; // Owns both ak8jets and ak8jets_masked
   METObject* pfmet;
   METObject* pfpuppimet;
 
@@ -1,6 +1,7 @@
 #ifndef METOBJECT_H
 #define METOBJECT_H
 
+#include <array>
 #include "SystematicVariations.h"
 #include "ParticleObject.h"
 
@@ -143,6 +144,17 @@ protected:
   std::vector<ParticleObject::LorentzVector_t> currentMETCorrections;
   std::vector<ParticleObject::LorentzVector_t> currentJetOverlapCorrections;
 
+  // Each (XY, JER, particle shift, p4 preservation) variant is computed on first access and kept until one of its inputs changes.
+  // Variants are indexed in the same way as currentMETCorrections.
+  static constexpr unsigned short nVariants = 16;
+  mutable unsigned int validVariantBits;
+  mutable std::array<float, nVariants> variantPt;
+  mutable std::array<float, nVariants> variantPhi;
+
+  static unsigned short getVariantIndex(bool addXYShifts, bool addJERShifts, bool addParticleShifts, bool preserveP4){ return 8*preserveP4 + 4*addParticleShifts + 2*addJERShifts + 1*addXYShifts; }
+  void invalidateVariants(unsigned int const& variantBits){ validVariantBits &= ~variantBits; }
+  void computePtPhi(float& pt, float& phi, bool addXYShifts, bool addJERShifts, bool addParticleShifts, bool preserveP4) const;
+
   void setMETShifts();
 
 public:
@@ -156,10 +168,10 @@ public:
   void setSystematic(SystematicsHelpers::SystematicVariationTypes const&);
   SystematicsHelpers::SystematicVariationTypes const& getCurrentSystematic() const{ return currentSyst; }
 
-  void setXYShift(ParticleObject::LorentzVector_t const& shift){ currentXYshift=shift; }
+  void setXYShift(ParticleObject::LorentzVector_t const& shift){ currentXYshift=shift; invalidateVariants(0xAAAA); }
   void setXYShift(float const& shift_x, float const& shift_y){ this->setXYShift(ParticleObject::LorentzVector_t(shift_x, shift_y, 0., 0.)); }
 
-  void setParticleShifts(ParticleObject::LorentzVector_t const& shift){ particleMomentumCorrections=shift; }
+  void setParticleShifts(ParticleObject::LorentzVector_t const& shift){ particleMomentumCorrections=shift; invalidateVariants(0xF0F0); }
   void setParticleShifts(float const& shift_x, float const& shift_y){ this->setParticleShifts(ParticleObject::LorentzVector_t(shift_x, shift_y, 0., 0.)); }
 
   void setMETCorrection(ParticleObject::LorentzVector_t const& corr, bool hasXYShifts, bool hasJERShifts, bool addParticleShifts, bool preserveP4);
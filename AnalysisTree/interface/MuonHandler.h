@@ -3,7 +3,9 @@
 
 #include <vector>
 #include "IvyBase.h"
+#include "ObjectArena.h"
 #include "MuonObject.h"
+#include "MuonSelectionHelpers.h"
 #include "AK4JetObject.h"
 #include "AK8JetObject.h"
 #include "PFCandidateObject.h"
@@ -27,8 +29,10 @@ protected:
   OverlapMapHandler<MuonObject, AK8JetObject>* overlapMap_muons_ak8jets;
 
   std::vector<ProductType_t*> productList;
+  ObjectArena<ProductType_t> productArena;
+  MuonSelectionHelpers::SelectionArrays selectionArrays;
 
-  void clear(){ this->resetCache(); for (ProductType_t*& prod:productList) delete prod; productList.clear(); }
+  void clear(){ this->resetCache(); productList.clear(); productArena.reset(); selectionArrays.clear(); }
 
   bool constructMuonObjects(SystematicsHelpers::SystematicVariationTypes const& syst);
   bool associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const;
@@ -46,6 +50,8 @@ public:
   bool constructMuons(SystematicsHelpers::SystematicVariationTypes const& syst, std::vector<PFCandidateObject*> const* pfcandidates);
 
   std::vector<ProductType_t*> const& getProducts() const{ return productList; }
+  // Inputs and bit masks of the selection, in the same order as the products
+  MuonSelectionHelpers::SelectionArrays const& getSelectionArrays() const{ return selectionArrays; }
 
   bool wrapTree(BaseTree* tree);
 
@@ -2,22 +2,31 @@
 #define MUONSCALEFACTORHANDLER_H
 
 #include <unordered_map>
+#include <vector>
 #include "ScaleFactorHandlerBase.h"
+#include "ScaleFactorTable.h"
 #include "SystematicVariations.h"
 #include "MuonObject.h"
 
 
 class MuonScaleFactorHandler : public ScaleFactorHandlerBase{
 protected:
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f> syst_eff_mc_id_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f> syst_eff_mc_iso_loose_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f> syst_eff_mc_iso_tight_map;
+  // All histograms are flattened into the same table, and the maps below hold their layer indices.
+  ScaleFactorTable sftable;
 
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f> syst_SF_id_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f> syst_SF_iso_loose_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f> syst_SF_iso_tight_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_eff_mc_id_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_eff_mc_iso_loose_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_eff_mc_iso_tight_map;
 
-  void evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_SF_id_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_SF_iso_loose_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_SF_iso_tight_map;
+
+  // Same as the public function, but with the bins of (eta, pt) already located in the SF table
+  void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& eta, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const;
+
+  // Returns false if no SF applies to the object
+  bool getIdIsoFlags(MuonObject const* obj, bool& passId, bool& passLooseIso, bool& passTightIso) const;
 
 public:
   MuonScaleFactorHandler();
@@ -28,6 +37,9 @@ public:
 
   void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const;
   void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, MuonObject const* obj, float& val, float* effval) const;
+  // Evaluate the SFs of a whole collection for each systematic in 'systs' with a single bin search per muon.
+  // vals[isyst] is the product of the SFs of all muons, with the SF of each muon bounded from below by 'minval'.
+  void getIdIsoSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<MuonObject*> const& objs, std::vector<float>& vals, float const& minval = 0) const;
 
 };
 
@@ -1,6 +1,7 @@
 #ifndef MUONSELECTIONHELPERS_H
 #define MUONSELECTIONHELPERS_H
 
+#include <vector>
 #include "MuonObject.h"
 #include "PFCandidateObject.h"
 
@@ -121,6 +122,34 @@ namespace MuonSelectionHelpers{
 
   void setSelectionBits(MuonObject& part);
 
+  // Struct-of-arrays copy of the quantities entering the muon selection.
+  // The inputs of a whole collection are copied into contiguous arrays, and one bit mask per muon is evaluated in a single loop.
+  // The cuts are the same function as in setSelectionBits(MuonObject&), so the bits are identical by construction.
+  class SelectionArrays{
+  public:
+    std::vector<float> pt;
+    std::vector<float> abseta;
+    std::vector<float> iso;
+    std::vector<float> trkIso;
+    std::vector<cms3_muon_pogselectorbits_t> POG_selector_bits;
+    std::vector<cms3_muon_cutbasedbits_h4l_t> id_cutBased_H4l_Bits;
+    std::vector<unsigned char> is_probeForTnP;
+    std::vector<unsigned char> is_probeForTnP_STA;
+
+    std::vector<ParticleObject::SelectionBitsType_t> selectionBits;
+
+    void fill(std::vector<MuonObject*> const& parts);
+    void evaluate();
+    void assign(std::vector<MuonObject*>& parts) const;
+    void clear();
+
+    size_t size() const{ return pt.size(); }
+  };
+
+  // Set the selection bits of a full collection through SelectionArrays.
+  // If 'arrays' is passed, its buffers are reused and keep the inputs and bit masks afterward.
+  void setSelectionBits(std::vector<MuonObject*>& parts, SelectionArrays* arrays=nullptr);
+
   // User-configurable T&P and fake rate application options
   void setAllowProbeIdInLooseSelection(bool flag);
   void setAllowFakeableInLooseSelection(bool flag);
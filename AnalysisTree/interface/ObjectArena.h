@@ -0,0 +1,52 @@
+#ifndef OBJECTARENA_H
+#define OBJECTARENA_H
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+
+// Arena of objects owned by a handler and released all at once at each new event.
+// Objects are constructed in place inside blocks of contiguous memory, and the blocks are kept across events,
+// so constructing the products of an event reuses the memory of the previous one instead of going through new/delete per object.
+// Pointers to the objects stay valid until reset() is called.
+template<typename T> class ObjectArena{
+protected:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage_t;
+
+  size_t const blockSize;
+  std::vector<Storage_t*> blocks;
+  size_t nObjects;
+
+  T* getObject(size_t const& i) const{ return reinterpret_cast<T*>(&(blocks.at(i/blockSize)[i%blockSize])); }
+
+public:
+  ObjectArena(size_t blockSize_=32) : blockSize((blockSize_>0 ? blockSize_ : 1)), nObjects(0){}
+  ObjectArena(ObjectArena<T> const&) = delete;
+  ObjectArena<T>& operator=(ObjectArena<T> const&) = delete;
+  ~ObjectArena(){ reset(); for (auto& block:blocks) delete[] block; }
+
+  // Construct a new object in the arena
+  template<typename... Args> T* emplace(Args&&... args){
+    size_t const iblock = nObjects/blockSize;
+    if (iblock==blocks.size()) blocks.push_back(new Storage_t[blockSize]);
+    T* res = new (&(blocks.at(iblock)[nObjects%blockSize])) T(std::forward<Args>(args)...);
+    nObjects++;
+    return res;
+  }
+
+  // Destroy all objects while keeping the memory for the next event
+  void reset(){
+    for (size_t i=0; i<nObjects; i++) getObject(i)->~T();
+    nObjects = 0;
+  }
+
+  size_t size() const{ return nObjects; }
+  size_t capacity() const{ return blocks.size()*blockSize; }
+
+};
+
+
+#endif
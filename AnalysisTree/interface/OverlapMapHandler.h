@@ -2,6 +2,7 @@
 #define OVERLAPMAPHANDLER_H
 
 #include <vector>
+#include <algorithm>
 
 #include "IvyBase.h"
 #include "OverlapMapElement.h"
@@ -15,7 +16,14 @@ public:
 protected:
   std::vector<ProductType_t*> productList;
 
-  void clear(){ this->resetCache(); for (ProductType_t*& prod:productList) delete prod; productList.clear(); }
+  // Flat table of overlap maps indexed by [first index][second index] of the pair of collections
+  size_t nIndices_first;
+  size_t nIndices_second;
+  std::vector<ProductType_t*> productIndexTable;
+
+  void clear(){ this->resetCache(); for (ProductType_t*& prod:productList) delete prod; productList.clear(); productIndexTable.clear(); nIndices_first = nIndices_second = 0; }
+
+  void buildProductIndexTable();
 
 public:
   // Constructors
@@ -34,7 +42,38 @@ public:
 
 };
 
+template<typename T, typename U> void OverlapMapHandler<T, U>::buildProductIndexTable(){
+  nIndices_first = nIndices_second = 0;
+  for (auto const& product:productList){
+    if (!product->isValid()) continue;
+    auto const& index_pair = product->getIndices();
+    nIndices_first = std::max(nIndices_first, static_cast<size_t>(index_pair.first+1));
+    nIndices_second = std::max(nIndices_second, static_cast<size_t>(index_pair.second+1));
+  }
+
+  productIndexTable.assign(nIndices_first*nIndices_second, nullptr);
+  for (auto const& product:productList){
+    if (!product->isValid()) continue;
+    auto const& index_pair = product->getIndices();
+    ProductType_t*& entry = productIndexTable.at(index_pair.first*nIndices_second + index_pair.second);
+    if (!entry) entry = product; // Keep the first one in the list in case of duplicates, as in the linear search
+  }
+}
+
 template<typename T, typename U> typename OverlapMapHandler<T, U>::ProductType_t* OverlapMapHandler<T, U>::getMatchingOverlapMap(T* firstElement, U* secondElement) const{
+  if (!firstElement || !secondElement) return nullptr;
+
+  // Constant-time lookup through the unique identifiers, which are the indices of the objects in their collections
+  ParticleObject::UniqueId_t const idx_first = firstElement->getUniqueIdentifier();
+  ParticleObject::UniqueId_t const idx_second = secondElement->getUniqueIdentifier();
+  if (idx_first<nIndices_first && idx_second<nIndices_second){
+    ProductType_t* const& entry = productIndexTable[idx_first*nIndices_second + idx_second];
+    if (!entry) return nullptr;
+    if (entry->hasIdenticalElements(firstElement, secondElement)) return entry;
+  }
+  else return nullptr;
+
+  // Fall back to the linear search if the indexed map is linked to a different pair of objects
   ProductType_t* res = nullptr;
   for (auto const& product:productList){
     if (product->hasIdenticalElements(firstElement, secondElement)){
@@ -0,0 +1,199 @@
+#ifndef PFCANDIDATEASSOCIATIONHELPERS_H
+#define PFCANDIDATEASSOCIATIONHELPERS_H
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include "PFCandidateObject.h"
+
+
+namespace PFCandidateAssociationHelpers{
+  // Bit mask of PF candidates indexed by their unique identifiers
+  class PFCandidateMask{
+  protected:
+    typedef unsigned long long Word_t;
+    static constexpr size_t nBitsPerWord = 64;
+
+    std::vector<Word_t> words;
+
+  public:
+    void clear(){ words.clear(); }
+
+    void set(size_t const& idx){
+      size_t const iword = idx/nBitsPerWord;
+      if (iword>=words.size()) words.resize(iword+1, 0);
+      words[iword] |= (static_cast<Word_t>(1) << (idx%nBitsPerWord));
+    }
+    bool test(size_t const& idx) const{
+      size_t const iword = idx/nBitsPerWord;
+      return (iword<words.size() && ((words[iword] >> (idx%nBitsPerWord)) & static_cast<Word_t>(1)));
+    }
+    bool intersects(PFCandidateMask const& other) const{
+      size_t const nwords = std::min(words.size(), other.words.size());
+      for (size_t iword=0; iword<nwords; iword++){ if (words[iword] & other.words[iword]) return true; }
+      return false;
+    }
+  };
+
+  // PF candidates among the deep daughters of a particle, kept in the order of the daughters, together with their mask
+  struct PFCandidateFootprint{
+    std::vector<PFCandidateObject*> pfcands;
+    PFCandidateMask mask;
+
+    void build(IvyParticle* part);
+  };
+
+  // Footprints computed once per particle and reused over the event
+  class PFCandidateFootprintCache{
+  protected:
+    std::unordered_map<IvyParticle*, PFCandidateFootprint> footprints;
+
+  public:
+    void clear(){ footprints.clear(); }
+
+    PFCandidateFootprint const& get(IvyParticle* part){
+      auto it = footprints.find(part);
+      if (it==footprints.end()){
+        it = footprints.emplace(part, PFCandidateFootprint()).first;
+        it->second.build(part);
+      }
+      return it->second;
+    }
+  };
+
+  // Mask of the PF candidates among the direct daughters of a particle, e.g. the constituents of a jet
+  void getConstituentMask(IvyParticle* part, PFCandidateMask& mask);
+
+  // Inverse index from the unique identifier of an object (i.e., its index in the ntuple collection)
+  // to the position(s) of the object in a product list.
+  // Positions with the same identifier are chained in increasing order.
+  class ObjectPositionIndex{
+  protected:
+    std::vector<int> firstPosition;
+    std::vector<int> nextPosition;
+
+  public:
+    template<typename T> void build(std::vector<T*> const& objects);
+
+    // Append the positions of the objects with unique identifier 'idx'
+    void appendPositions(size_t const& idx, std::vector<int>& positions) const{
+      if (idx>=firstPosition.size()) return;
+      for (int pos = firstPosition[idx]; pos>=0; pos = nextPosition[pos]) positions.push_back(pos);
+    }
+  };
+
+  // Associate PF candidates to objects using the index list of each PF candidate, stored as the member 'indexList' of PFCandidateVariables.
+  // The work is linear in the number of PF candidates and index list entries.
+  // Daughters are added to each object in the order of the PF candidates,
+  // and mothers are added to each PF candidate in the order of the objects, as in a full scan over objects.
+  template<typename T> void associatePFCandidates(
+    std::vector<PFCandidateObject*> const& pfcandidates, std::vector<T*> const& objects,
+    std::vector<cms3_listIndex_short_t> PFCandidateVariables::* indexList,
+    bool addMothers = true
+  );
+
+  // Same as above for a single signed index per PF candidate, where negative values denote no association
+  template<typename T> void associatePFCandidates(
+    std::vector<PFCandidateObject*> const& pfcandidates, std::vector<T*> const& objects,
+    cms3_listIndex_signed_short_t PFCandidateVariables::* index,
+    bool addMothers = true
+  );
+
+}
+
+inline void PFCandidateAssociationHelpers::PFCandidateFootprint::build(IvyParticle* part){
+  pfcands.clear();
+  mask.clear();
+  if (!part) return;
+
+  std::vector<IvyParticle*> daughters_part;
+  part->getDeepDaughters(daughters_part, false);
+  pfcands.reserve(daughters_part.size());
+  for (auto const& daughter_part:daughters_part){
+    PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter_part);
+    if (pfcand){
+      pfcands.push_back(pfcand);
+      mask.set(pfcand->getUniqueIdentifier());
+    }
+  }
+}
+
+inline void PFCandidateAssociationHelpers::getConstituentMask(IvyParticle* part, PFCandidateMask& mask){
+  mask.clear();
+  if (!part) return;
+
+  for (auto const& daughter:part->getDaughters()){
+    PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter);
+    if (pfcand) mask.set(pfcand->getUniqueIdentifier());
+  }
+}
+
+template<typename T> void PFCandidateAssociationHelpers::ObjectPositionIndex::build(std::vector<T*> const& objects){
+  firstPosition.clear();
+  nextPosition.assign(objects.size(), -1);
+  // Go backward so that the chain of positions for each identifier ends up in increasing order
+  for (int pos = static_cast<int>(objects.size())-1; pos>=0; pos--){
+    size_t const idx = objects[pos]->getUniqueIdentifier();
+    if (idx>=firstPosition.size()) firstPosition.resize(idx+1, -1);
+    nextPosition[pos] = firstPosition[idx];
+    firstPosition[idx] = pos;
+  }
+}
+
+template<typename T> void PFCandidateAssociationHelpers::associatePFCandidates(
+  std::vector<PFCandidateObject*> const& pfcandidates, std::vector<T*> const& objects,
+  std::vector<cms3_listIndex_short_t> PFCandidateVariables::* indexList,
+  bool addMothers
+){
+  if (pfcandidates.empty() || objects.empty()) return;
+
+  ObjectPositionIndex positionIndex;
+  positionIndex.build(objects);
+
+  std::vector<int> positions;
+  for (auto const& pfcand:pfcandidates){
+    auto const& associated_indices = pfcand->extras.*indexList;
+    if (associated_indices.empty()) continue;
+
+    positions.clear();
+    for (auto const& idx:associated_indices) positionIndex.appendPositions(idx, positions);
+    if (positions.size()>1){
+      std::sort(positions.begin(), positions.end());
+      positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    }
+    for (auto const& pos:positions){
+      T* const& part = objects[pos];
+      part->addDaughter(pfcand);
+      if (addMothers) pfcand->addMother(part);
+    }
+  }
+}
+
+template<typename T> void PFCandidateAssociationHelpers::associatePFCandidates(
+  std::vector<PFCandidateObject*> const& pfcandidates, std::vector<T*> const& objects,
+  cms3_listIndex_signed_short_t PFCandidateVariables::* index,
+  bool addMothers
+){
+  if (pfcandidates.empty() || objects.empty()) return;
+
+  ObjectPositionIndex positionIndex;
+  positionIndex.build(objects);
+
+  std::vector<int> positions;
+  for (auto const& pfcand:pfcandidates){
+    auto const& associated_index = pfcand->extras.*index;
+    if (associated_index<0) continue;
+
+    positions.clear();
+    positionIndex.appendPositions(associated_index, positions);
+    for (auto const& pos:positions){
+      T* const& part = objects[pos];
+      part->addDaughter(pfcand);
+      if (addMothers) pfcand->addMother(part);
+    }
+  }
+}
+
+
+#endif
@@ -6,17 +6,25 @@
 #include "ExtendedHistogram_2D.h"
 #include "AK4JetObject.h"
 #include "ScaleFactorHandlerBase.h"
+#include "ScaleFactorTable.h"
 #include "SystematicVariations.h"
 
 
 class PUJetIdScaleFactorHandler : public ScaleFactorHandlerBase{
 protected:
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_pujetidwp_effs_map_mistagged;
-  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_pujetidwp_effs_map_matched;
-  std::vector<ExtendedHistogram_2D_f> pujetidwp_SFs_map_mistagged;
-  std::vector<ExtendedHistogram_2D_f> pujetidwp_SFs_map_matched;
+  // All histograms are flattened into the same table, and the containers below hold their layer indices.
+  ScaleFactorTable sftable;
 
-  void evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_pujetidwp_effs_map_mistagged;
+  std::unordered_map< SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_pujetidwp_effs_map_matched;
+  std::vector<size_t> pujetidwp_SFs_map_mistagged;
+  std::vector<size_t> pujetidwp_SFs_map_matched;
+
+  // Same as the public function, but with the bins of (pt, eta) already located in the SF table
+  void getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& eta, bool const& isMatched, bool const& isLoose, bool const& isMedium, bool const& isTight, float& val, float* effval) const;
+
+  // Returns false if no SF applies to the jet
+  static bool getPUJetIdFlags(AK4JetObject const* obj, bool& isMatched, bool& isLoose, bool& isMedium, bool& isTight);
 
 public:
   PUJetIdScaleFactorHandler();
@@ -27,6 +35,9 @@ public:
 
   void getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, bool const& isMatched, bool const& isLoose, bool const& isMedium, bool const& isTight, float& val, float* effval) const;
   void getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, AK4JetObject const* obj, float& val, float* effval) const;
+  // Evaluate the SFs of a whole collection for each systematic in 'systs' with a single bin search per jet.
+  // vals[isyst] is the product of the SFs of all jets, with the SF of each jet bounded from below by 'minval'.
+  void getSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<AK4JetObject*> const& objs, std::vector<float>& vals, float const& minval = 0) const;
 
 };
 
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "IvyBase.h"
+#include "ObjectArena.h"
 #include "PhotonObject.h"
 #include "AK4JetObject.h"
 #include "AK8JetObject.h"
@@ -26,8 +27,9 @@ protected:
   OverlapMapHandler<PhotonObject, AK8JetObject>* overlapMap_photons_ak8jets;
 
   std::vector<ProductType_t*> productList;
+  ObjectArena<ProductType_t> productArena;
 
-  void clear(){ this->resetCache(); for (ProductType_t*& prod:productList) delete prod; productList.clear(); }
+  void clear(){ this->resetCache(); productList.clear(); productArena.reset(); }
 
   bool constructPhotonObjects(SystematicsHelpers::SystematicVariationTypes const& syst);
   bool associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const;
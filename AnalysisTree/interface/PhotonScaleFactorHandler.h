@@ -1,21 +1,32 @@
 #ifndef PHOTONSCALEFACTORHANDLER_H
 #define PHOTONSCALEFACTORHANDLER_H
 
+#include <vector>
 #include "ExtendedHistogram_2D.h"
 #include "ScaleFactorHandlerBase.h"
+#include "ScaleFactorTable.h"
 #include "PhotonObject.h"
 #include "PhotonSelectionHelpers.h"
 
 
 class PhotonScaleFactorHandler : public ScaleFactorHandlerBase{
 protected:
-  ExtendedHistogram_2D_f h_eff_mc_tampon;
-  ExtendedHistogram_2D_f h_eff_mc_tight;
+  // All histograms are flattened into the same table, and the members below hold their layer indices.
+  ScaleFactorTable sftable;
 
-  ExtendedHistogram_2D_f h_SF_tampon;
-  ExtendedHistogram_2D_f h_SF_tight;
+  size_t ilayer_eff_mc_tampon;
+  size_t ilayer_eff_mc_tight;
 
-  void evalScaleFactorFromHistogram(float& val, float& relerr, float const& pt, float const& etaSC, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const;
+  size_t ilayer_SF_tampon;
+  size_t ilayer_SF_tight;
+
+  void evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, size_t const& ilayer, ScaleFactorTable::BinLocationList_t const& binlocs) const;
+
+  // Same as the public function, but with the bins of (etaSC, pt) already located in the SF table
+  void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, bool const& isTight, bool const& isTampon, float& val, float* effval) const;
+
+  // Returns false if no SF applies to the object
+  bool getIdIsoFlags(PhotonObject const* obj, bool& isTight, bool& isTampon) const;
 
   static TString getScaleFactorFileName(PhotonSelectionHelpers::SelectionBits const& preselectionBit, int const& year);
 
@@ -28,6 +39,9 @@ public:
 
   void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& etaSC, bool const& isTight, bool const& isTampon, float& val, float* effval) const;
   void getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, PhotonObject const* obj, float& val, float* effval) const;
+  // Evaluate the SFs of a whole collection for each systematic in 'systs' with a single bin search per photon.
+  // vals[isyst] is the product of the SFs of all photons, with the SF of each photon bounded from below by 'minval'.
+  void getIdIsoSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<PhotonObject*> const& objs, std::vector<float>& vals, float const& minval = 0) const;
 
 };
 
@@ -0,0 +1,114 @@
+#ifndef PRODUCTRECORD_H
+#define PRODUCTRECORD_H
+
+#include <cassert>
+#include <vector>
+#include <memory>
+#include "TString.h"
+#include "TTree.h"
+#include <IvyFramework/IvyDataTools/interface/SimpleEntry.h>
+#include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
+
+
+// Output columns declared once by a producer.
+// Each column owns a typed slot that the producer fills per event, and the slots are bound directly as branch buffers of the output trees,
+// so recording an event does not need to look any name up.
+class ProductRecord{
+protected:
+  class ColumnBase{
+  public:
+    TString const name;
+
+    ColumnBase(TString const& name_) : name(name_){}
+    virtual ~ColumnBase(){}
+
+    virtual void reset() = 0;
+    virtual void bind(TTree* tree) = 0;
+    virtual void exportTo(SimpleEntry& entry) const = 0;
+  };
+
+  template<typename T> class Column : public ColumnBase{
+  public:
+    T const defval;
+    T value;
+
+    Column(TString const& name_, T const& defval_) : ColumnBase(name_), defval(defval_), value(defval_){}
+
+    void reset(){ value = defval; }
+    void bind(TTree* tree){ tree->Branch(name.Data(), &value); }
+    void exportTo(SimpleEntry& entry) const{ entry.setNamedVal(name, value); }
+  };
+
+  template<typename T> class Column<std::vector<T>> : public ColumnBase{
+  public:
+    std::vector<T> const defval;
+    std::vector<T> value;
+    std::vector<T>* valueptr; // ROOT needs the address of a pointer to bind vectors
+
+    Column(TString const& name_, std::vector<T> const& defval_) : ColumnBase(name_), defval(defval_), value(defval_), valueptr(&value){}
+
+    void reset(){ value = defval; }
+    void bind(TTree* tree){ tree->Branch(name.Data(), &valueptr); }
+    void exportTo(SimpleEntry& entry) const{ entry.setNamedVal(name, value); }
+  };
+
+  std::vector<std::unique_ptr<ColumnBase>> columns;
+  std::vector<TTree*> boundTrees;
+
+public:
+  ProductRecord(){}
+  ProductRecord(ProductRecord const&) = delete;
+  ProductRecord& operator=(ProductRecord const&) = delete;
+
+  // Declare a column, or get the slot of an existing column with the same name and type.
+  // Columns cannot be added once the record is bound to a tree.
+  template<typename T> T& addColumn(TString const& name, T const& defval = T());
+  // Get the slot of an existing column, or nullptr if there is no column with this name and type
+  template<typename T> T* getColumn(TString const& name) const;
+
+  size_t size() const{ return columns.size(); }
+
+  // Set all slots back to their default values
+  void reset(){ for (auto& column:columns) column->reset(); }
+
+  // Bind the slots as the branch buffers of 'tree' if this is not done yet.
+  // Columns listed in 'excludedColumns' get no branch in this tree, e.g. the variations that are only recorded for the nominal systematic.
+  void bind(TTree* tree, std::vector<TString> const* excludedColumns=nullptr);
+
+  // Copy the slot values into a SimpleEntry, e.g. when the products are kept in memory
+  void exportTo(SimpleEntry& entry, std::vector<TString> const* excludedColumns=nullptr) const;
+
+};
+
+template<typename T> T& ProductRecord::addColumn(TString const& name, T const& defval){
+  using namespace std;
+  using namespace IvyStreamHelpers;
+
+  for (auto& column:columns){
+    if (column->name!=name) continue;
+    Column<T>* col = dynamic_cast<Column<T>*>(column.get());
+    if (!col){
+      IVYerr << "ProductRecord::addColumn: Column " << name << " already exists with a different type." << endl;
+      assert(0);
+    }
+    return col->value;
+  }
+  if (!boundTrees.empty()){
+    IVYerr << "ProductRecord::addColumn: Column " << name << " cannot be added after the record is bound to an output tree." << endl;
+    assert(0);
+  }
+  Column<T>* col = new Column<T>(name, defval);
+  columns.emplace_back(col);
+  return col->value;
+}
+template<typename T> T* ProductRecord::getColumn(TString const& name) const{
+  for (auto const& column:columns){
+    if (column->name!=name) continue;
+    Column<T>* col = dynamic_cast<Column<T>*>(column.get());
+    return (col ? &(col->value) : nullptr);
+  }
+  return nullptr;
+}
+
+
+#endif
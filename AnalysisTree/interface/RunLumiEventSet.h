@@ -0,0 +1,52 @@
+#ifndef RUNLUMIEVENTSET_H
+#define RUNLUMIEVENTSET_H
+
+#include <cstddef>
+#include <vector>
+#include <iostream>
+
+
+// Set of (run, lumi. section, event) triplets, stored flat in an open-addressing hash table with linear probing.
+// Each entry takes 16 bytes, and a lookup usually touches a single cache line.
+class RunLumiEventSet{
+protected:
+  struct Entry{
+    unsigned long long EventNumber;
+    unsigned int RunNumber;
+    unsigned int LuminosityBlock;
+
+    bool isEmpty() const{ return (EventNumber==emptyEventNumber && RunNumber==emptyRunNumber && LuminosityBlock==emptyLuminosityBlock); }
+  };
+
+  // Empty slots are marked with this key. If the key itself is inserted, it is tracked with a separate flag.
+  static constexpr unsigned long long emptyEventNumber = static_cast<unsigned long long>(-1);
+  static constexpr unsigned int emptyRunNumber = static_cast<unsigned int>(-1);
+  static constexpr unsigned int emptyLuminosityBlock = static_cast<unsigned int>(-1);
+
+  std::vector<Entry> entries; // Size is always zero or a power of 2
+  size_t nentries;
+  bool hasEmptyKey;
+
+  static size_t getHash(unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber);
+
+  void rehash(size_t const& capacity);
+
+public:
+  RunLumiEventSet() : nentries(0), hasEmptyKey(false){}
+
+  // Insert the triplet, and return true if it was not in the set before
+  bool insert(unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber);
+  bool contains(unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber) const;
+
+  size_t size() const{ return nentries; }
+  void clear(){ entries.clear(); nentries = 0; hasEmptyKey = false; }
+
+  // Binary I/O of the stored triplets, e.g. to restore the set when a job resumes.
+  // read() replaces the contents of the set, and both functions return false if the stream fails.
+  bool write(std::ostream& out) const;
+  bool read(std::istream& in);
+
+};
+
+
+#endif
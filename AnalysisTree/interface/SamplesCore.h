@@ -46,6 +46,9 @@ namespace SampleHelpers{
   std::vector< std::pair<unsigned int, double> > const& getRunNumberLumiPairsForDataPeriod(TString const& period);
   bool isHEM2018Affected(unsigned int run);
   std::vector<TString> getValidDataPeriods();
+  std::vector<TString> getValidDataPeriods(int const& year);
+  // Valid data periods of the current year, paired with their cumulative luminosity fractions
+  std::vector< std::pair<TString, double> > const& getValidDataPeriodCumulativeLumiFractions();
   bool testDataPeriodIsLikeData(TString const& period);
   bool testDataPeriodIsLikeData();
   double getIntegratedLuminosity(TString const& period);
@@ -57,7 +60,9 @@ namespace SampleHelpers{
   bool checkSampleIs80X(TString const& strid);
   bool checkSampleIsFastSim(TString const& strid);
 
-  TString getRandomDataPeriod(unsigned long long const& iseed, double* rndnum_global=nullptr, double* rndnum_local=nullptr);
+  // Pick a data period of the current year according to its luminosity fraction, given a uniform random number.
+  // If theDataPeriod is a specific period instead of a year, it is returned as is, and rndnum_global and rndnum_local are set to -1.
+  TString getRandomDataPeriod(double const& rndnum, double* rndnum_global=nullptr, double* rndnum_local=nullptr);
   int translateRandomNumberToRunNumber(TString const& period, double const& rndnum);
 
   bool checkRunOnCondor();
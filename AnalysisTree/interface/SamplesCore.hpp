@@ -16,15 +16,20 @@ namespace SampleHelpers{
   extern std::vector< std::pair< std::pair<unsigned int, unsigned int>, TString > > const runRange_dataPeriod_pair_list;
   extern std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > const dataPeriod_runNumber_lumi_pairs_map;
   extern std::unordered_map< TString, double > const dataPeriod_lumi_map; // Contains period=year and HEM-affected entries
+  extern std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > const dataPeriod_runNumber_cumulativeLumi_pairs_map; // Same keys as dataPeriod_runNumber_lumi_pairs_map
+  extern std::unordered_map< int, std::vector< std::pair<TString, double> > > const dataYear_dataPeriod_cumulativeLumiFraction_pairs_map;
 
   std::vector< std::pair< std::pair<unsigned int, unsigned int>, TString > > define_runRange_dataPeriod_pair_list();
   std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > define_dataPeriod_runNumber_lumi_pairs_map();
   std::unordered_map< TString, double > define_dataPeriod_lumi_map();
+  std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > define_dataPeriod_runNumber_cumulativeLumi_pairs_map();
+  std::unordered_map< int, std::vector< std::pair<TString, double> > > define_dataYear_dataPeriod_cumulativeLumiFraction_pairs_map();
 
 }
 
 std::vector< std::pair< std::pair<unsigned int, unsigned int>, TString > > SampleHelpers::define_runRange_dataPeriod_pair_list(){
-  // Add more as needed
+  // Add more as needed.
+  // Keep the list ordered and the ranges non-overlapping; getDataPeriodFromRunNumber relies on it for its binary search.
   return std::vector< std::pair< std::pair<unsigned int, unsigned int>, TString > >{
     { { 272007, 275376 }, "2016B" },
     { { 275657, 276283 }, "2016C" },
@@ -1854,5 +1859,42 @@ std::unordered_map< TString, double > SampleHelpers::define_dataPeriod_lumi_map(
   return res;
 }
 
+// The running sums are accumulated in the same order as in define_dataPeriod_lumi_map,
+// so the last entry of each list is exactly the integrated luminosity of the period.
+std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > SampleHelpers::define_dataPeriod_runNumber_cumulativeLumi_pairs_map(){
+  std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > res;
+  for (auto const& dp_rn_lumi_pair:dataPeriod_runNumber_lumi_pairs_map){
+    auto const& rn_lumi_pairs = dp_rn_lumi_pair.second;
+    std::vector< std::pair<unsigned int, double> >& rn_cumlumi_pairs = res[dp_rn_lumi_pair.first];
+    rn_cumlumi_pairs.reserve(rn_lumi_pairs.size());
+    double lumi_total = 0;
+    for (auto const& rn_lumi_pair:rn_lumi_pairs){
+      lumi_total += rn_lumi_pair.second;
+      rn_cumlumi_pairs.emplace_back(rn_lumi_pair.first, lumi_total);
+    }
+  }
+  return res;
+}
+
+std::unordered_map< int, std::vector< std::pair<TString, double> > > SampleHelpers::define_dataYear_dataPeriod_cumulativeLumiFraction_pairs_map(){
+  std::unordered_map< int, std::vector< std::pair<TString, double> > > res;
+  for (auto const& rr_dp_pair:runRange_dataPeriod_pair_list){
+    int const year = getDataYearFromPeriod(rr_dp_pair.second);
+    if (res.find(year)!=res.end()) continue;
+
+    std::vector< std::pair<TString, double> >& dp_cumlumifrac_pairs = res[year];
+    std::vector<TString> const valid_periods = getValidDataPeriods(year);
+    dp_cumlumifrac_pairs.reserve(valid_periods.size());
+    for (TString const& period:valid_periods){
+      double lumi = getIntegratedLuminosity(period);
+      if (!dp_cumlumifrac_pairs.empty()) lumi += dp_cumlumifrac_pairs.back().second;
+      dp_cumlumifrac_pairs.emplace_back(period, lumi);
+    }
+    double const lumi_total = dp_cumlumifrac_pairs.back().second;
+    for (auto& dp_cumlumifrac_pair:dp_cumlumifrac_pairs) dp_cumlumifrac_pair.second /= lumi_total;
+  }
+  return res;
+}
+
 
 #endif
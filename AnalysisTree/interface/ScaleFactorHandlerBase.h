@@ -10,6 +10,7 @@
 #include "VerbosityLevel.h"
 #include "ExtendedHistogram_1D.h"
 #include "ExtendedHistogram_2D.h"
+#include "ScaleFactorTable.h"
 
 
 class ScaleFactorHandlerBase{
@@ -24,6 +25,9 @@ public:
   template<typename T, typename U> static bool getHistogram(U& h, TDirectory* f, TString s);
   template<typename T, typename U> static bool getHistogramWithUncertainy(U& h, TDirectory* f, TString s, TString su);
   static void getAxisBinning(TAxis const* ax, ExtendedBinning& res);
+  // Acquire a 2D histogram as a new layer of 'table', and set 'ilayer' to the index of that layer
+  template<typename T> static bool getHistogramLayer(ScaleFactorTable& table, size_t& ilayer, TDirectory* f, TString s);
+  template<typename T> static bool getHistogramWithUncertainyLayer(ScaleFactorTable& table, size_t& ilayer, TDirectory* f, TString s, TString su);
 
   virtual bool setup() = 0;
   virtual void reset() = 0;
@@ -44,5 +48,18 @@ template<> bool ScaleFactorHandlerBase::getHistogramWithUncertainy<TH1D, Extende
 template<> bool ScaleFactorHandlerBase::getHistogramWithUncertainy<TH2F, ExtendedHistogram_2D_f>(ExtendedHistogram_2D_f& h, TDirectory* f, TString s, TString su);
 template<> bool ScaleFactorHandlerBase::getHistogramWithUncertainy<TH2D, ExtendedHistogram_2D_f>(ExtendedHistogram_2D_f& h, TDirectory* f, TString s, TString su);
 
+template<typename T> bool ScaleFactorHandlerBase::getHistogramLayer(ScaleFactorTable& table, size_t& ilayer, TDirectory* f, TString s){
+  ExtendedHistogram_2D_f h;
+  bool const res = getHistogram<T, ExtendedHistogram_2D_f>(h, f, s);
+  ilayer = table.addLayer(h);
+  return res;
+}
+template<typename T> bool ScaleFactorHandlerBase::getHistogramWithUncertainyLayer(ScaleFactorTable& table, size_t& ilayer, TDirectory* f, TString s, TString su){
+  ExtendedHistogram_2D_f h;
+  bool const res = getHistogramWithUncertainy<T, ExtendedHistogram_2D_f>(h, f, s, su);
+  ilayer = table.addLayer(h);
+  return res;
+}
+
 
 #endif
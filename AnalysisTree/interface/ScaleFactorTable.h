@@ -0,0 +1,80 @@
+#ifndef SCALEFACTORTABLE_H
+#define SCALEFACTORTABLE_H
+
+#include <vector>
+#include "TString.h"
+#include "ExtendedHistogram_2D.h"
+
+
+// Flat copy of a set of 2D efficiency or SF histograms, e.g. all systematic variations of the SFs of a handler.
+// Each histogram becomes a layer of contiguous bin contents and errors, including the under- and overflow bins.
+// Layers with identical binnings share the same bin edges, so locating a point costs one binary search per axis
+// for all of these layers instead of one per histogram.
+class ScaleFactorTable{
+public:
+  // Bin indices follow the ROOT convention, i.e., 0 and nbins+1 are the underflow and overflow bins.
+  struct BinLocation{
+    int ix;
+    int iy;
+  };
+  // One location per distinct binning of the table
+  typedef std::vector<BinLocation> BinLocationList_t;
+
+protected:
+  struct Binning{
+    std::vector<double> xedges;
+    std::vector<double> yedges;
+
+    int getNbinsX() const{ return static_cast<int>(xedges.size())-1; }
+    int getNbinsY() const{ return static_cast<int>(yedges.size())-1; }
+
+    // Same result as TAxis::FindBin for the list of bin edges
+    static int findBin(std::vector<double> const& edges, double const& val);
+  };
+  struct Layer{
+    TString name;
+    int ibinning; // Negative if the histogram was not built
+    size_t offset;
+  };
+
+  std::vector<Binning> binnings;
+  std::vector<Layer> layers;
+  std::vector<float> contents;
+  std::vector<float> errors;
+
+  size_t getGlobalBin(Layer const& layer, int const& ix, int const& iy) const{ return layer.offset + ix + (binnings[layer.ibinning].getNbinsX()+2)*iy; }
+
+public:
+  ScaleFactorTable(){}
+
+  void reset();
+
+  // Copy the bin edges, contents and errors of 'hist' into a new layer, and return the index of the layer.
+  // Layers of histograms that are not built are kept as well in order to preserve the indexing, but they leave the evaluated SFs unchanged.
+  size_t addLayer(ExtendedHistogram_2D_f const& hist);
+
+  size_t getNLayers() const{ return layers.size(); }
+  TString const& getLayerName(size_t const& ilayer) const{ return layers[ilayer].name; }
+  bool isEmptyLayer(size_t const& ilayer) const{ return layers[ilayer].ibinning<0; }
+
+  // Locate (x, y) in each distinct binning.
+  // The list can be reused for all layers, so it only needs to be computed once per object.
+  void findBins(float const& x, float const& y, BinLocationList_t& locs) const;
+
+  // Multiply 'theSF' by the bin content, and add the relative bin error in quadrature to 'theSFRelErr'.
+  // Points outside of the histogram range take the value of the nearest bin, and their relative error is inflated by 50%.
+  void evalScaleFactor(float& theSF, float& theSFRelErr, size_t const& ilayer, BinLocationList_t const& locs) const;
+  // Multiply 'theSF' by the content of the nearest bin within the histogram range
+  void evalScaleFactor(float& theSF, size_t const& ilayer, BinLocationList_t const& locs) const;
+
+  // Raw accessors for other conventions of under- and overflow treatments
+  BinLocation const& getBinLocation(size_t const& ilayer, BinLocationList_t const& locs) const{ return locs[layers[ilayer].ibinning]; }
+  int getNbinsX(size_t const& ilayer) const{ return binnings[layers[ilayer].ibinning].getNbinsX(); }
+  int getNbinsY(size_t const& ilayer) const{ return binnings[layers[ilayer].ibinning].getNbinsY(); }
+  float getBinContent(size_t const& ilayer, int const& ix, int const& iy) const{ return contents[getGlobalBin(layers[ilayer], ix, iy)]; }
+  float getBinError(size_t const& ilayer, int const& ix, int const& iy) const{ return errors[getGlobalBin(layers[ilayer], ix, iy)]; }
+
+};
+
+
+#endif
@@ -29,7 +29,7 @@ protected:
 
   bool hasPUException;
   TString theChosenDataPeriod;
-  // These are the seeds, not the random numbers themselves:
+  // These are the salts passed to EventRandomHelpers::getUniform, not the random numbers themselves:
   std::unordered_map<EventRandomNumberType, unsigned long long> product_rnds;
   // These are in fact the random numbers:
   std::unordered_map<EventRandomNumberType, double> product_rndnums;
@@ -0,0 +1,89 @@
+#ifndef TIMINGHELPERS_H
+#define TIMINGHELPERS_H
+
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include "TString.h"
+
+
+namespace TimingHelpers{
+  typedef std::chrono::steady_clock Clock_t;
+
+  // Registry of named sections with their accumulated time and number of calls.
+  // Sections are registered once and then addressed by index so that timing an event does not involve any string comparison.
+  class TimingRegistry{
+  protected:
+    struct SectionInfo{
+      TString name;
+      Clock_t::duration duration;
+      unsigned long long ncalls;
+
+      SectionInfo(TString const& name_) : name(name_), duration(Clock_t::duration::zero()), ncalls(0){}
+    };
+
+    std::vector<SectionInfo> sections;
+
+  public:
+    TimingRegistry(){}
+
+    size_t getSectionIndex(TString const& name);
+    void addDuration(size_t const& isec, Clock_t::duration const& dur){ SectionInfo& section = sections[isec]; section.duration += dur; section.ncalls++; }
+
+    // Keep the sections registered, but zero their times
+    void reset();
+
+    // Print the time of each section, its share of 'walltime', and the event throughput
+    void print(TString const& title, Clock_t::duration const& walltime, unsigned long long const& nevents) const;
+
+  };
+
+  // Registry shared by the looper and the handlers or looper functions it calls.
+  // Each thread has its own registry, so loopers running on different threads neither race nor reset each other's times.
+  TimingRegistry& getTimingRegistry();
+
+  // Add the time from construction to destruction to a section of the registry of the current thread
+  class ScopedTimer{
+  protected:
+    size_t const isec;
+    Clock_t::time_point const time_begin;
+
+  public:
+    ScopedTimer(size_t const& isec_) : isec(isec_), time_begin(Clock_t::now()){}
+    ~ScopedTimer(){ getTimingRegistry().addDuration(isec, Clock_t::now() - time_begin); }
+
+  };
+
+  // Progress report limited to one message per time interval.
+  // If several meters report at the same time from different threads, they should share an output mutex.
+  class ProgressMeter{
+  protected:
+    Clock_t::duration const interval;
+    Clock_t::time_point time_begin;
+    Clock_t::time_point time_last;
+    std::mutex* outputMutex;
+
+  public:
+    ProgressMeter(double const& interval_seconds, std::mutex* outputMutex_=nullptr);
+
+    void start();
+    void update(TString const& title, long long const& ev, long long const& nevents){
+      Clock_t::time_point const time_now = Clock_t::now();
+      if (time_now - time_last>=interval){
+        time_last = time_now;
+        report(title, ev, nevents, time_now);
+      }
+    }
+    void report(TString const& title, long long const& ev, long long const& nevents, Clock_t::time_point const& time_now) const;
+
+  };
+
+}
+
+// Time the rest of the current scope under the section STRNAME. The section is looked up only once per call site and thread.
+#define TIMINGHELPERS_SCOPED_TIMER(NAME, STRNAME) \
+  static thread_local size_t const NAME##_isec = TimingHelpers::getTimingRegistry().getSectionIndex(STRNAME); \
+  TimingHelpers::ScopedTimer const NAME(NAME##_isec);
+
+
+#endif
@@ -2,7 +2,9 @@
 #define TRIGGERSCALEFACTORHANDLER_H
 
 #include <unordered_map>
+#include <vector>
 #include "ScaleFactorHandlerBase.h"
+#include "ScaleFactorTable.h"
 #include "SystematicVariations.h"
 #include "ParticleObject.h"
 
@@ -17,20 +19,25 @@ public:
   };
 
 protected:
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_eff_mc_Dilepton_SingleLepton_mumu_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_eff_mc_Dilepton_SingleLepton_ee_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_eff_mc_Dilepton_SingleLepton_mue_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f > syst_eff_mc_SingleMuon_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f > syst_eff_mc_SingleElectron_map;
+  // Dilepton histograms are binned in (pT1, pT2), and single lepton histograms in (|eta|, pT),
+  // so they are flattened into two separate tables. The maps below hold their layer indices.
+  ScaleFactorTable sftable_Dilepton;
+  ScaleFactorTable sftable_SingleLepton;
 
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_SF_Dilepton_SingleLepton_mumu_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_SF_Dilepton_SingleLepton_ee_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<ExtendedHistogram_2D_f> > syst_SF_Dilepton_SingleLepton_mue_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f > syst_SF_SingleMuon_map;
-  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, ExtendedHistogram_2D_f > syst_SF_SingleElectron_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_eff_mc_Dilepton_SingleLepton_mumu_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_eff_mc_Dilepton_SingleLepton_ee_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_eff_mc_Dilepton_SingleLepton_mue_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_eff_mc_SingleMuon_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_eff_mc_SingleElectron_map;
 
-  void evalScaleFactorFromHistogram_PtEta(float& theSF, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const;
-  void evalScaleFactorFromHistogram_PtPt(float& theSF, float const& pt1, float const& pt2, ExtendedHistogram_2D_f const& hist) const;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_SF_Dilepton_SingleLepton_mumu_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_SF_Dilepton_SingleLepton_ee_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, std::vector<size_t> > syst_SF_Dilepton_SingleLepton_mue_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_SF_SingleMuon_map;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, size_t> syst_SF_SingleElectron_map;
+
+  // Multiply 'theSF' by the content of a dilepton layer at the (pT1, pT2) bins in 'binlocs'
+  void evalScaleFactorFromHistogram_PtPt(float& theSF, size_t const& ilayer, ScaleFactorTable::BinLocationList_t const& binlocs) const;
 
 public:
   TriggerScaleFactorHandler();
@@ -52,6 +59,20 @@ public:
     bool passTrigger,
     float& val, float* effval
   ) const;
+  // Evaluate the SFs (and efficiencies) for each systematic in 'systs' with a single bin search
+  void getCombinedDileptonSFAndEff(
+    std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+    float pt1, float eta1, cms3_id_t id1,
+    float pt2, float eta2, cms3_id_t id2,
+    bool passTrigger,
+    std::vector<float>& vals, std::vector<float>* effvals
+  ) const;
+  void getCombinedDileptonSFAndEff(
+    std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+    ParticleObject const* obj1, ParticleObject const* obj2,
+    bool passTrigger,
+    std::vector<float>& vals, std::vector<float>* effvals
+  ) const;
 
   void getCombinedSingleLeptonSFAndEff(
     SystematicsHelpers::SystematicVariationTypes const& syst,
@@ -65,6 +86,19 @@ public:
     bool passTrigger,
     float& val, float* effval
   ) const;
+  // Evaluate the SFs (and efficiencies) for each systematic in 'systs' with a single bin search
+  void getCombinedSingleLeptonSFAndEff(
+    std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+    float const& pt, float const& eta, cms3_id_t const& partId,
+    bool passTrigger,
+    std::vector<float>& vals, std::vector<float>* effvals
+  ) const;
+  void getCombinedSingleLeptonSFAndEff(
+    std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+    ParticleObject const* obj,
+    bool passTrigger,
+    std::vector<float>& vals, std::vector<float>* effvals
+  ) const;
 
 };
 
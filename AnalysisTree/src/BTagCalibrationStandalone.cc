@@ -7,6 +7,10 @@
 #include <exception>
 #include <algorithm>
 #include <sstream>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
 
 
 BTagEntry::Parameters::Parameters(
@@ -370,6 +374,369 @@ std::string BTagCalibration::token(const BTagEntry::Parameters &par)
 
 
 
+/**
+* BTagCalibrationFormula
+*
+* Formula of a calibration entry compiled once into an expression tree,
+* so that evaluating it for each jet does not go through TF1::Eval.
+* The parser covers the arithmetic, comparison, logical and ternary operators
+* on x and numbers, together with the usual math functions (also as TMath::).
+* Formulas with any other construct are evaluated through a TF1 instead.
+*
+************************************************************/
+
+
+class BTagCalibrationFormula
+{
+public:
+  BTagCalibrationFormula() : root_(-1) {}
+  BTagCalibrationFormula(const std::string &formula, double xmin, double xmax);
+
+  double eval(double x) const {
+    if (root_ >= 0) {
+      return evalNode(root_, x);
+    }
+    return (fallback_ ? fallback_->Eval(x) : 0.);
+  }
+  bool isCompiled() const { return root_ >= 0; }
+
+protected:
+  enum NodeType {
+    N_CONST, N_X,
+    N_NEG, N_NOT, N_FUNC1,
+    N_ADD, N_SUB, N_MUL, N_DIV, N_POW,
+    N_LT, N_LE, N_GT, N_GE, N_EQ, N_NE,
+    N_AND, N_OR, N_FUNC2,
+    N_COND
+  };
+  typedef double (*Func1_t)(double);
+  typedef double (*Func2_t)(double, double);
+  struct Node {
+    NodeType type;
+    double value;
+    Func1_t func1;
+    Func2_t func2;
+    int args[3];
+  };
+
+  class Parser;
+
+  std::vector<Node> nodes_;
+  int root_;
+  std::shared_ptr<TF1> fallback_;
+
+  double evalNode(int inode, double x) const;
+};
+
+// Recursive descent parser with the operator precedence of C,
+// where '^' is the power operator and binds tighter than the unary operators.
+// Each parse function returns the index of the node it adds, or -1 on failure.
+class BTagCalibrationFormula::Parser
+{
+public:
+  Parser(const std::string &str, std::vector<Node> &nodes) : str_(str), pos_(0), nodes_(nodes) {}
+
+  int parse() {
+    int res = parseCond();
+    skipSpaces();
+    if (pos_ != str_.size()) {
+      return -1;
+    }
+    return res;
+  }
+
+protected:
+  const std::string &str_;
+  size_t pos_;
+  std::vector<Node> &nodes_;
+
+  void skipSpaces() {
+    while (pos_ < str_.size() && std::isspace(static_cast<unsigned char>(str_[pos_]))) {
+      ++pos_;
+    }
+  }
+  bool accept(const char* tok) {
+    skipSpaces();
+    size_t len = strlen(tok);
+    if (str_.compare(pos_, len, tok) != 0) {
+      return false;
+    }
+    pos_ += len;
+    return true;
+  }
+  // Accept a single-character operator that is not the first character of a two-character one
+  bool acceptSingle(char c, char next_excluded) {
+    skipSpaces();
+    if (pos_ >= str_.size() || str_[pos_] != c) {
+      return false;
+    }
+    if (pos_+1 < str_.size() && str_[pos_+1] == next_excluded) {
+      return false;
+    }
+    ++pos_;
+    return true;
+  }
+
+  int addNode(NodeType type, int a0=-1, int a1=-1, int a2=-1) {
+    if ((type >= N_NEG && a0 < 0) || (type >= N_ADD && a1 < 0) || (type == N_COND && a2 < 0)) {
+      return -1;
+    }
+    Node n;
+    n.type = type;
+    n.value = 0.;
+    n.func1 = nullptr;
+    n.func2 = nullptr;
+    n.args[0] = a0;
+    n.args[1] = a1;
+    n.args[2] = a2;
+    nodes_.push_back(n);
+    return nodes_.size()-1;
+  }
+
+  int parseCond() {
+    int res = parseOr();
+    if (res >= 0 && accept("?")) {
+      int a = parseCond();
+      if (a < 0 || !accept(":")) {
+        return -1;
+      }
+      int b = parseCond();
+      res = addNode(N_COND, res, a, b);
+    }
+    return res;
+  }
+  int parseOr() {
+    int res = parseAnd();
+    while (res >= 0 && accept("||")) {
+      res = addNode(N_OR, res, parseAnd());
+    }
+    return res;
+  }
+  int parseAnd() {
+    int res = parseEquality();
+    while (res >= 0 && accept("&&")) {
+      res = addNode(N_AND, res, parseEquality());
+    }
+    return res;
+  }
+  int parseEquality() {
+    int res = parseRelational();
+    while (res >= 0) {
+      if (accept("==")) {
+        res = addNode(N_EQ, res, parseRelational());
+      } else if (accept("!=")) {
+        res = addNode(N_NE, res, parseRelational());
+      } else {
+        break;
+      }
+    }
+    return res;
+  }
+  int parseRelational() {
+    int res = parseAdditive();
+    while (res >= 0) {
+      if (accept("<=")) {
+        res = addNode(N_LE, res, parseAdditive());
+      } else if (accept(">=")) {
+        res = addNode(N_GE, res, parseAdditive());
+      } else if (accept("<")) {
+        res = addNode(N_LT, res, parseAdditive());
+      } else if (accept(">")) {
+        res = addNode(N_GT, res, parseAdditive());
+      } else {
+        break;
+      }
+    }
+    return res;
+  }
+  int parseAdditive() {
+    int res = parseMultiplicative();
+    while (res >= 0) {
+      if (accept("+")) {
+        res = addNode(N_ADD, res, parseMultiplicative());
+      } else if (accept("-")) {
+        res = addNode(N_SUB, res, parseMultiplicative());
+      } else {
+        break;
+      }
+    }
+    return res;
+  }
+  int parseMultiplicative() {
+    int res = parseUnary();
+    while (res >= 0) {
+      if (acceptSingle('*', '*')) {
+        res = addNode(N_MUL, res, parseUnary());
+      } else if (accept("/")) {
+        res = addNode(N_DIV, res, parseUnary());
+      } else {
+        break;
+      }
+    }
+    return res;
+  }
+  int parseUnary() {
+    if (accept("-")) {
+      return addNode(N_NEG, parseUnary());
+    } else if (accept("+")) {
+      return parseUnary();
+    } else if (acceptSingle('!', '=')) {
+      return addNode(N_NOT, parseUnary());
+    }
+    return parsePower();
+  }
+  int parsePower() {
+    int res = parsePrimary();
+    if (res >= 0 && (accept("^") || accept("**"))) {
+      res = addNode(N_POW, res, parseUnary());  // right-associative
+    }
+    return res;
+  }
+  int parsePrimary() {
+    skipSpaces();
+    if (pos_ >= str_.size()) {
+      return -1;
+    }
+
+    char c = str_[pos_];
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      const char* begin = str_.c_str() + pos_;
+      char* end = nullptr;
+      double val = std::strtod(begin, &end);
+      if (end == begin) {
+        return -1;
+      }
+      pos_ += (end - begin);
+      int res = addNode(N_CONST);
+      nodes_[res].value = val;
+      return res;
+    }
+    if (c == '(') {
+      ++pos_;
+      int res = parseCond();
+      if (res < 0 || !accept(")")) {
+        return -1;
+      }
+      return res;
+    }
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      size_t begin = pos_;
+      while (
+        pos_ < str_.size()
+        && (std::isalnum(static_cast<unsigned char>(str_[pos_])) || str_[pos_] == '_' || str_[pos_] == ':')
+      ) {
+        ++pos_;
+      }
+      std::string name = str_.substr(begin, pos_-begin);
+      if (name == "x") {
+        return addNode(N_X);
+      }
+      return parseFunction(name);
+    }
+    return -1;
+  }
+  int parseFunction(std::string name) {
+    if (name.find("TMath::") == 0) {
+      name = name.substr(7);
+    }
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    static const std::map<std::string, Func1_t> funcs1 = {
+      { "log", [] (double a) { return std::log(a); } },
+      { "log10", [] (double a) { return std::log10(a); } },
+      { "exp", [] (double a) { return std::exp(a); } },
+      { "sqrt", [] (double a) { return std::sqrt(a); } },
+      { "abs", [] (double a) { return std::fabs(a); } },
+      { "fabs", [] (double a) { return std::fabs(a); } },
+      { "sin", [] (double a) { return std::sin(a); } },
+      { "cos", [] (double a) { return std::cos(a); } },
+      { "tan", [] (double a) { return std::tan(a); } },
+      { "atan", [] (double a) { return std::atan(a); } },
+      { "sinh", [] (double a) { return std::sinh(a); } },
+      { "cosh", [] (double a) { return std::cosh(a); } },
+      { "tanh", [] (double a) { return std::tanh(a); } },
+      { "erf", [] (double a) { return std::erf(a); } }
+    };
+    static const std::map<std::string, Func2_t> funcs2 = {
+      { "pow", [] (double a, double b) { return std::pow(a, b); } },
+      { "power", [] (double a, double b) { return std::pow(a, b); } },
+      { "min", [] (double a, double b) { return std::min(a, b); } },
+      { "max", [] (double a, double b) { return std::max(a, b); } }
+    };
+
+    if (!accept("(")) {
+      return -1;
+    }
+    int a0 = parseCond();
+    if (a0 < 0) {
+      return -1;
+    }
+
+    if (funcs1.count(name)) {
+      if (!accept(")")) {
+        return -1;
+      }
+      int res = addNode(N_FUNC1, a0);
+      nodes_[res].func1 = funcs1.at(name);
+      return res;
+    } else if (funcs2.count(name)) {
+      if (!accept(",")) {
+        return -1;
+      }
+      int a1 = parseCond();
+      if (a1 < 0 || !accept(")")) {
+        return -1;
+      }
+      int res = addNode(N_FUNC2, a0, a1);
+      nodes_[res].func2 = funcs2.at(name);
+      return res;
+    }
+    return -1;
+  }
+};
+
+BTagCalibrationFormula::BTagCalibrationFormula(const std::string &formula, double xmin, double xmax):
+  root_(-1)
+{
+  Parser parser(formula, nodes_);
+  root_ = parser.parse();
+  if (root_ < 0) {
+    nodes_.clear();
+    fallback_ = std::make_shared<TF1>("", formula.c_str(), xmin, xmax);
+  }
+}
+
+double BTagCalibrationFormula::evalNode(int inode, double x) const
+{
+  const Node &n = nodes_[inode];
+  switch (n.type) {
+  case N_CONST: return n.value;
+  case N_X: return x;
+  case N_NEG: return -evalNode(n.args[0], x);
+  case N_NOT: return (evalNode(n.args[0], x) == 0. ? 1. : 0.);
+  case N_FUNC1: return n.func1(evalNode(n.args[0], x));
+  case N_ADD: return evalNode(n.args[0], x) + evalNode(n.args[1], x);
+  case N_SUB: return evalNode(n.args[0], x) - evalNode(n.args[1], x);
+  case N_MUL: return evalNode(n.args[0], x) * evalNode(n.args[1], x);
+  case N_DIV: return evalNode(n.args[0], x) / evalNode(n.args[1], x);
+  case N_POW: return std::pow(evalNode(n.args[0], x), evalNode(n.args[1], x));
+  case N_LT: return (evalNode(n.args[0], x) < evalNode(n.args[1], x) ? 1. : 0.);
+  case N_LE: return (evalNode(n.args[0], x) <= evalNode(n.args[1], x) ? 1. : 0.);
+  case N_GT: return (evalNode(n.args[0], x) > evalNode(n.args[1], x) ? 1. : 0.);
+  case N_GE: return (evalNode(n.args[0], x) >= evalNode(n.args[1], x) ? 1. : 0.);
+  case N_EQ: return (evalNode(n.args[0], x) == evalNode(n.args[1], x) ? 1. : 0.);
+  case N_NE: return (evalNode(n.args[0], x) != evalNode(n.args[1], x) ? 1. : 0.);
+  case N_AND: return (evalNode(n.args[0], x) != 0. && evalNode(n.args[1], x) != 0. ? 1. : 0.);
+  case N_OR: return (evalNode(n.args[0], x) != 0. || evalNode(n.args[1], x) != 0. ? 1. : 0.);
+  case N_FUNC2: return n.func2(evalNode(n.args[0], x), evalNode(n.args[1], x));
+  case N_COND: return (evalNode(n.args[0], x) != 0. ? evalNode(n.args[1], x) : evalNode(n.args[2], x));
+  }
+  return 0.;
+}
+
+
+
+
 class BTagCalibrationReader::BTagCalibrationReaderImpl
 {
   friend class BTagCalibrationReader;
@@ -382,7 +749,23 @@ public:
     float ptMax;
     float discrMin;
     float discrMax;
-    TF1 func;
+    BTagCalibrationFormula func;
+  };
+
+  // Interval index of the entries of one jet flavor.
+  // The eta and pt bounds of all entries split the (eta, pt) plane into elementary cells,
+  // and each cell lists the entries covering it in their original order,
+  // so the first match of the linear search is the first entry of the cell passing the discriminant requirement.
+  // Eta cells are [etaEdges[i], etaEdges[i+1]) and pt cells are (ptEdges[j], ptEdges[j+1]] in order to follow the entry bounds.
+  struct EntryIndex {
+    std::vector<float> etaEdges;
+    std::vector<float> ptEdges;
+    std::vector<std::vector<unsigned>> etaCells;  // index: eta cell
+    std::vector<std::vector<unsigned>> cells;     // index: eta cell * number of pt cells + pt cell
+
+    void build(const std::vector<TmpEntry> &entries);
+    const std::vector<unsigned>* findEtaCell(float eta) const;
+    const std::vector<unsigned>* findCell(float eta, float pt) const;
   };
 
 private:
@@ -412,11 +795,81 @@ private:
   BTagEntry::OperatingPoint op_;
   std::string sysType_;
   std::vector<std::vector<TmpEntry> > tmpData_;  // first index: jetFlavor
+  std::vector<EntryIndex> index_;                // first index: jetFlavor
   std::vector<bool> useAbsEta_;                  // first index: jetFlavor
   std::map<std::string, std::shared_ptr<BTagCalibrationReaderImpl>> otherSysTypeReaders_;
 };
 
 
+void BTagCalibrationReader::BTagCalibrationReaderImpl::EntryIndex::build(
+                                             const std::vector<TmpEntry> &entries)
+{
+  etaEdges.clear();
+  ptEdges.clear();
+  for (const auto &e : entries) {
+    etaEdges.push_back(e.etaMin);
+    etaEdges.push_back(e.etaMax);
+    ptEdges.push_back(e.ptMin);
+    ptEdges.push_back(e.ptMax);
+  }
+  std::sort(etaEdges.begin(), etaEdges.end());
+  etaEdges.erase(std::unique(etaEdges.begin(), etaEdges.end()), etaEdges.end());
+  std::sort(ptEdges.begin(), ptEdges.end());
+  ptEdges.erase(std::unique(ptEdges.begin(), ptEdges.end()), ptEdges.end());
+
+  // Since all bounds are cell edges, an entry matches every point of a cell iff it covers the cell edges.
+  unsigned nEta = (etaEdges.size() > 1 ? etaEdges.size()-1 : 0);
+  unsigned nPt = (ptEdges.size() > 1 ? ptEdges.size()-1 : 0);
+  etaCells.assign(nEta, std::vector<unsigned>());
+  cells.assign(nEta*nPt, std::vector<unsigned>());
+  for (unsigned i=0; i<entries.size(); ++i) {
+    const auto &e = entries[i];
+    for (unsigned ieta=0; ieta<nEta; ++ieta) {
+      if (!(e.etaMin <= etaEdges[ieta] && etaEdges[ieta+1] <= e.etaMax)) {
+        continue;
+      }
+      etaCells[ieta].push_back(i);
+      for (unsigned ipt=0; ipt<nPt; ++ipt) {
+        if (e.ptMin <= ptEdges[ipt] && ptEdges[ipt+1] <= e.ptMax) {
+          cells[ieta*nPt + ipt].push_back(i);
+        }
+      }
+    }
+  }
+}
+
+const std::vector<unsigned>* BTagCalibrationReader::BTagCalibrationReaderImpl::EntryIndex::findEtaCell(
+                                             float eta) const
+{
+  if (std::isnan(eta)) {
+    return nullptr;
+  }
+  // eta cells are closed on the left: the cell is the last edge <= eta
+  long ieta = std::upper_bound(etaEdges.begin(), etaEdges.end(), eta) - etaEdges.begin() - 1;
+  if (ieta < 0 || ieta >= static_cast<long>(etaCells.size())) {
+    return nullptr;
+  }
+  return &(etaCells[ieta]);
+}
+
+const std::vector<unsigned>* BTagCalibrationReader::BTagCalibrationReaderImpl::EntryIndex::findCell(
+                                             float eta, float pt) const
+{
+  if (std::isnan(eta) || std::isnan(pt)) {
+    return nullptr;
+  }
+  long nEta = etaCells.size();
+  long nPt = (nEta > 0 ? cells.size()/nEta : 0);
+  long ieta = std::upper_bound(etaEdges.begin(), etaEdges.end(), eta) - etaEdges.begin() - 1;
+  // pt cells are closed on the right: the cell ends at the first edge >= pt
+  long ipt = std::lower_bound(ptEdges.begin(), ptEdges.end(), pt) - ptEdges.begin() - 1;
+  if (ieta < 0 || ieta >= nEta || ipt < 0 || ipt >= nPt) {
+    return nullptr;
+  }
+  return &(cells[ieta*nPt + ipt]);
+}
+
+
 BTagCalibrationReader::BTagCalibrationReaderImpl::BTagCalibrationReaderImpl(
                                              BTagEntry::OperatingPoint op,
                                              const std::string & sysType,
@@ -424,6 +877,7 @@ BTagCalibrationReader::BTagCalibrationReaderImpl::BTagCalibrationReaderImpl(
   op_(op),
   sysType_(sysType),
   tmpData_(3),
+  index_(3),
   useAbsEta_(3, true)
 {
   for (const std::string & ost : otherSysTypes) {
@@ -468,11 +922,11 @@ throw std::exception();
     te.discrMax = be.params.discrMax;
 
     if (op_ == BTagEntry::OP_RESHAPING) {
-      te.func = TF1("", be.formula.c_str(),
-                    be.params.discrMin, be.params.discrMax);
+      te.func = BTagCalibrationFormula(be.formula,
+                                       be.params.discrMin, be.params.discrMax);
     } else {
-      te.func = TF1("", be.formula.c_str(),
-                    be.params.ptMin, be.params.ptMax);
+      te.func = BTagCalibrationFormula(be.formula,
+                                       be.params.ptMin, be.params.ptMax);
     }
 
     tmpData_[be.params.jetFlavor].push_back(te);
@@ -480,6 +934,7 @@ throw std::exception();
       useAbsEta_[be.params.jetFlavor] = false;
     }
   }
+  index_[jf].build(tmpData_[jf]);
 
   for (auto & p : otherSysTypeReaders_) {
     p.second->load(c, jf, measurementType);
@@ -497,8 +952,6 @@ double BTagCalibrationReader::BTagCalibrationReaderImpl::eval(
     eta = -eta;
   }
 
-  // search linearly through eta, pt and discr ranges and eval
-  // future: find some clever data structure based on intervals
   const auto &entries = tmpData_.at(jf);
 
   // Added warning not in original BTV code if no entry for the requested jet flavor.
@@ -508,19 +961,19 @@ double BTagCalibrationReader::BTagCalibrationReaderImpl::eval(
     return 1.0;
   }
 
-  for (unsigned i=0; i<entries.size(); ++i) {
-    const auto &e = entries.at(i);
-    if (
-      e.etaMin <= eta && eta < e.etaMax                   // find eta
-      && e.ptMin < pt && pt <= e.ptMax                    // check pt
-    ){
-      if (use_discr) {                                    // discr. reshaping?
-        if (e.discrMin <= discr && discr < e.discrMax) {  // check discr
-          return e.func.Eval(discr);
-        }
-      } else {
-        return e.func.Eval(pt);
+  // look up the entries covering (eta, pt) in the interval index and eval
+  const std::vector<unsigned>* cell = index_[jf].findCell(eta, pt);
+  if (!cell) {
+    return 0.;  // default value
+  }
+  for (unsigned i : *cell) {
+    const auto &e = entries[i];
+    if (use_discr) {                                      // discr. reshaping?
+      if (e.discrMin <= discr && discr < e.discrMax) {    // check discr
+        return e.func.eval(discr);
       }
+    } else {
+      return e.func.eval(pt);
     }
   }
 
@@ -581,25 +1034,26 @@ std::pair<float, float> BTagCalibrationReader::BTagCalibrationReaderImpl::min_ma
 
   const auto &entries = tmpData_.at(jf);
   float min_pt = -1., max_pt = -1.;
-  for (const auto & e: entries) {
-    if (
-      e.etaMin <= eta && eta < e.etaMax                   // find eta
-    ){
-      if (min_pt < 0.) {                                  // init
-        min_pt = e.ptMin;
-        max_pt = e.ptMax;
-        continue;
-      }
+  const std::vector<unsigned>* etaCell = index_.at(jf).findEtaCell(eta);
+  if (!etaCell) {
+    return std::make_pair(min_pt, max_pt);
+  }
+  for (unsigned i : *etaCell) {                           // entries matching eta
+    const auto &e = entries[i];
+    if (min_pt < 0.) {                                    // init
+      min_pt = e.ptMin;
+      max_pt = e.ptMax;
+      continue;
+    }
 
-      if (use_discr) {                                    // discr. reshaping?
-        if (e.discrMin <= discr && discr < e.discrMax) {  // check discr
-          min_pt = min_pt < e.ptMin ? min_pt : e.ptMin;
-          max_pt = max_pt > e.ptMax ? max_pt : e.ptMax;
-        }
-      } else {
+    if (use_discr) {                                      // discr. reshaping?
+      if (e.discrMin <= discr && discr < e.discrMax) {    // check discr
         min_pt = min_pt < e.ptMin ? min_pt : e.ptMin;
         max_pt = max_pt > e.ptMax ? max_pt : e.ptMax;
       }
+    } else {
+      min_pt = min_pt < e.ptMin ? min_pt : e.ptMin;
+      max_pt = max_pt > e.ptMax ? max_pt : e.ptMax;
     }
   }
 
@@ -4,6 +4,19 @@
 #include <utility>
 #include <iterator>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <unordered_set>
+
+#include <TROOT.h>
+#include <TVirtualMutex.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TObjArray.h>
 
 #include "BaseTreeLooper.h"
 #include "SampleHelpersCore.h"
@@ -12,9 +25,11 @@
 #include "SimEventHandler.h"
 #include "GenInfoHandler.h"
 #include "EventFilterHandler.h"
+#include "VertexHandler.h"
 #include "RunLumiEventBlock.h"
 
 #include "HelperFunctions.h"
+#include "TimingHelpers.h"
 #include "HostHelpersCore.h"
 #include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
 
@@ -27,6 +42,11 @@ BaseTreeLooper::BaseTreeLooper() :
   IvyBase(),
 
   looperFunction(nullptr),
+  looperSetupFunction(nullptr),
+  looperPreselectionFunction(nullptr),
+  productRecord(nullptr),
+  productRecordHasExtraValues(true),
+  productRecordExtraValuesReported(false),
   registeredSyst(SystematicsHelpers::nSystematicVariations),
 
   maxNEvents(-1),
@@ -34,9 +54,18 @@ BaseTreeLooper::BaseTreeLooper() :
   eventIndex_end(-1),
   useChunkIndices(false),
 
+  inputTreeCacheSize(32*1024*1024),
+  doPrefetchNextTree(false),
+  outputTreeMemoryLimit(0),
+
+  progressReportInterval(30),
+  checkpointInterval(0),
+
   isData_currentTree(false),
   isQCD_currentTree(false),
-  isGJets_HT_currentTree(false)
+  isGJets_HT_currentTree(false),
+
+  hasCachedMEInputs(false)
 {
   set_pTG_exception_range(-1, -1);
   setExternalProductList();
@@ -46,6 +75,11 @@ BaseTreeLooper::BaseTreeLooper(BaseTree* inTree, double wgt) :
   IvyBase(),
 
   looperFunction(nullptr),
+  looperSetupFunction(nullptr),
+  looperPreselectionFunction(nullptr),
+  productRecord(nullptr),
+  productRecordHasExtraValues(true),
+  productRecordExtraValuesReported(false),
   registeredSyst(SystematicsHelpers::nSystematicVariations),
 
   maxNEvents(-1),
@@ -53,9 +87,18 @@ BaseTreeLooper::BaseTreeLooper(BaseTree* inTree, double wgt) :
   eventIndex_end(-1),
   useChunkIndices(false),
 
+  inputTreeCacheSize(32*1024*1024),
+  doPrefetchNextTree(false),
+  outputTreeMemoryLimit(0),
+
+  progressReportInterval(30),
+  checkpointInterval(0),
+
   isData_currentTree(false),
   isQCD_currentTree(false),
-  isGJets_HT_currentTree(false)
+  isGJets_HT_currentTree(false),
+
+  hasCachedMEInputs(false)
 {
   this->addTree(inTree, wgt);
   set_pTG_exception_range(-1, -1);
@@ -66,6 +109,11 @@ BaseTreeLooper::BaseTreeLooper(std::vector<BaseTree*> const& inTreeList) :
   IvyBase(),
 
   looperFunction(nullptr),
+  looperSetupFunction(nullptr),
+  looperPreselectionFunction(nullptr),
+  productRecord(nullptr),
+  productRecordHasExtraValues(true),
+  productRecordExtraValuesReported(false),
   registeredSyst(SystematicsHelpers::nSystematicVariations),
 
   maxNEvents(-1),
@@ -73,10 +121,19 @@ BaseTreeLooper::BaseTreeLooper(std::vector<BaseTree*> const& inTreeList) :
   eventIndex_end(-1),
   useChunkIndices(false),
 
+  inputTreeCacheSize(32*1024*1024),
+  doPrefetchNextTree(false),
+  outputTreeMemoryLimit(0),
+
+  progressReportInterval(30),
+  checkpointInterval(0),
+
   isData_currentTree(false),
   isQCD_currentTree(false),
   isGJets_HT_currentTree(false),
 
+  hasCachedMEInputs(false),
+
   treeList(inTreeList)
 {
   set_pTG_exception_range(-1, -1);
@@ -128,6 +185,24 @@ void BaseTreeLooper::addHLTMenu(TString name, std::vector< std::pair<TriggerHelp
   registeredHLTMenuProperties[name] = hltmenu;
 }
 
+std::vector< std::string > const* BaseTreeLooper::getHLTMenu(TString const& name) const{
+  auto it = registeredHLTMenus.find(name);
+  return (it!=registeredHLTMenus.cend() ? &(it->second) : nullptr);
+}
+std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const* BaseTreeLooper::getHLTMenuProperties(TString const& name) const{
+  auto it = registeredHLTMenuProperties.find(name);
+  return (it!=registeredHLTMenuProperties.cend() ? &(it->second) : nullptr);
+}
+
+void BaseTreeLooper::setSystematics(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs){
+  registeredSystList.clear();
+  for (auto const& syst:systs){
+    if (!HelperFunctions::checkListVariable(registeredSystList, syst)) registeredSystList.push_back(syst);
+    else IVYerr << "BaseTreeLooper::setSystematics: Systematic " << SystematicsHelpers::getSystName(syst) << " is specified more than once. Duplicates are skipped." << endl;
+  }
+  if (!registeredSystList.empty()) registeredSyst = registeredSystList.front();
+}
+
 void BaseTreeLooper::setMatrixElementList(std::vector<std::string> const& MElist, bool const& isGen){
   IVYout << "BaseTreeLooper::setMatrixElementList: Setting " << (isGen ? "gen." : "reco.") << " matrix elements:" << endl;
   for (auto const& sme:MElist) IVYout << '\t' << sme << endl;
@@ -233,6 +308,14 @@ void BaseTreeLooper::addOutputTree(BaseTree* extTree){
     this->setCurrentOutputTree(extTree);
   }
 }
+void BaseTreeLooper::addOutputTree(SystematicsHelpers::SystematicVariationTypes const& syst, BaseTree* extTree){
+  if (extTree){
+    if (systProductTrees.find(syst)!=systProductTrees.end()) IVYerr << "BaseTreeLooper::addOutputTree: Output tree for systematic " << SystematicsHelpers::getSystName(syst) << " already exists but will override it regardless." << endl;
+    // Only register the tree so that the current output tree stays the one for the systematics without a dedicated tree
+    if (!HelperFunctions::checkListVariable(this->productTreeList, extTree)) this->productTreeList.push_back(extTree);
+    systProductTrees[syst] = extTree;
+  }
+}
 void BaseTreeLooper::addOutputTrees(std::vector<BaseTree*> trees){
   for (auto const& tt:trees) addOutputTree(tt);
 }
@@ -249,6 +332,35 @@ void BaseTreeLooper::addProduct(SimpleEntry& product, unsigned int* ev_rec){
   this->recordProductsToTree();
 }
 
+void BaseTreeLooper::addRecordedProduct(SimpleEntry& product){
+  auto it_exclusions = productRecordExclusions.find(registeredSyst);
+  std::vector<TString> const* excludedColumns = (it_exclusions!=productRecordExclusions.cend() ? &(it_exclusions->second) : nullptr);
+
+  if (!this->currentProductTree){
+    // Products kept in memory are stored as SimpleEntry objects
+    productRecord->exportTo(product, excludedColumns);
+    this->addProduct(product);
+    return;
+  }
+
+  TTree* tree = this->currentProductTree->getSelectedTree();
+  productRecord->bind(tree, excludedColumns);
+
+  if (productRecordHasExtraValues){
+    // Values outside the record still go through SimpleEntry names. The tree is filled once, with the bound slots as well.
+    this->productListRef->push_back(product);
+    this->recordProductsToTree();
+  }
+  else{
+    // The tree has no branches for values outside the record, so they cannot be written.
+    if (!productRecordExtraValuesReported && hasNamedValues(product)){
+      IVYerr << "BaseTreeLooper::addRecordedProduct: Values outside the product record are skipped. Please declare them as columns of the record, or call setProductRecord with hasExtraValues=true." << endl;
+      productRecordExtraValuesReported = true;
+    }
+    tree->Fill();
+  }
+}
+
 void BaseTreeLooper::recordProductsToTree(){
   if (!this->currentProductTree) return;
 
@@ -264,6 +376,18 @@ void BaseTreeLooper::recordProductsToTree(){
   this->clearProducts();
 }
 
+bool BaseTreeLooper::hasNamedValues(SimpleEntry const& product){
+#define SIMPLE_DATA_OUTPUT_DIRECTIVE(name_t, type) if (!product.named##name_t##s.empty()) return true;
+#define VECTOR_DATA_OUTPUT_DIRECTIVE(name_t, type) if (!product.namedV##name_t##s.empty()) return true;
+#define DOUBLEVECTOR_DATA_OUTPUT_DIRECTIVE(name_t, type) if (!product.namedVV##name_t##s.empty()) return true;
+  SIMPLE_DATA_OUTPUT_DIRECTIVES
+  VECTOR_DATA_OUTPUT_DIRECTIVES
+  DOUBLEVECTOR_DATA_OUTPUT_DIRECTIVES
+#undef SIMPLE_DATA_OUTPUT_DIRECTIVE
+#undef VECTOR_DATA_OUTPUT_DIRECTIVE
+#undef DOUBLEVECTOR_DATA_OUTPUT_DIRECTIVE
+  return false;
+}
 bool BaseTreeLooper::wrapTree(BaseTree* tree){
   if (!tree) return false;
   bool res = true;
@@ -281,6 +405,7 @@ bool BaseTreeLooper::wrapTree(BaseTree* tree){
     RUNLUMIEVENT_VARIABLES;
 #undef RUNLUMIEVENT_VARIABLE
   }
+  for (auto const& pp:preselectionBranches) pp.second(tree, pp.first);
 
   for (auto const& handler:registeredHandlers){
     bool isHandlerForSim = (dynamic_cast<GenInfoHandler*>(handler) != nullptr || dynamic_cast<SimEventHandler*>(handler) != nullptr);
@@ -296,6 +421,498 @@ bool BaseTreeLooper::wrapTree(BaseTree* tree){
   return res;
 }
 
+void BaseTreeLooper::getSystematicDependentHandlers(std::vector<IvyBase*>& handlers) const{
+  // Event filters, sim. event weights and vertices do not depend on the systematic.
+  // The event filter handler in particular has to keep its cache because it tracks unique data events.
+  handlers.clear();
+  for (auto const& handler:registeredHandlers){
+    if (
+      dynamic_cast<EventFilterHandler*>(handler) != nullptr
+      ||
+      dynamic_cast<SimEventHandler*>(handler) != nullptr
+      ||
+      dynamic_cast<VertexHandler*>(handler) != nullptr
+      ) continue;
+    handlers.push_back(handler);
+  }
+}
+
+void BaseTreeLooper::prepareInputTree(BaseTree* tree, Long64_t const& ev_first, Long64_t const& ev_last, bool fillCache) const{
+  if (!tree || inputTreeCacheSize<0) return;
+
+  // BaseTree traverses its valid trees one after the other, so map the event range onto each of them.
+  Long64_t offset = 0;
+  for (auto const& intree:tree->getValidTrees()){
+    if (!intree) continue;
+    Long64_t const nentries = intree->GetEntries();
+    Long64_t const entry_first = std::max(ev_first - offset, static_cast<Long64_t>(0));
+    Long64_t const entry_last = std::min(ev_last - offset, nentries);
+    offset += nentries;
+    if (entry_first>=entry_last) continue;
+
+    intree->SetCacheSize(inputTreeCacheSize);
+    if (inputTreeCacheSize==0 || !fillCache) continue;
+
+    // Only the active branches are booked, so the cache can be filled for them right away without a learning phase.
+    TObjArray* branches = intree->GetListOfBranches();
+    for (int ib=0; ib<branches->GetEntriesFast(); ib++){
+      TBranch* br = dynamic_cast<TBranch*>(branches->At(ib));
+      if (br && intree->GetBranchStatus(br->GetName())) intree->AddBranchToCache(br, true);
+    }
+    intree->StopCacheLearningPhase();
+    intree->SetCacheEntryRange(entry_first, entry_last);
+
+    // Read the first entry to open the file and fill the first cluster
+    intree->GetEntry(entry_first);
+  }
+}
+
+namespace{
+  // Range [first, last) of the events with a set bit within [ev_first, ev_last). The range is empty if there are none.
+  std::pair<Long64_t, Long64_t> getPassBitRange(std::vector<unsigned long long> const& passBits, Long64_t const& ev_first, Long64_t const& ev_last){
+    std::pair<Long64_t, Long64_t> res(ev_last, ev_first);
+    for (Long64_t ev=ev_first; ev<ev_last; ev++){
+      unsigned long long const& word = passBits[ev/64];
+      if (word==0){
+        ev = (ev/64+1)*64 - 1;
+        continue;
+      }
+      if (HelperFunctions::test_bit(word, ev%64)){
+        if (res.first==ev_last) res.first = ev;
+        res.second = ev+1;
+      }
+    }
+    return res;
+  }
+}
+
+bool BaseTreeLooper::readChunkCostSummaries(ChunkCostSummary_t& costs) const{
+  costs.clear();
+  for (auto const& fname_orig:chunkCostSummaryInputs){
+    TString fname = fname_orig;
+    HostHelpers::ExpandEnvironmentVariables(fname);
+    if (!HostHelpers::FileReadable(fname.Data())){
+      if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::readChunkCostSummaries: Cost summary " << fname << " is not readable." << endl;
+      continue;
+    }
+    // Summaries from different jobs may contain the same keys, so entries are accumulated.
+    ifstream fin(fname.Data());
+    std::string strline;
+    while (std::getline(fin, strline)){
+      if (strline.empty() || strline.front()=='#') continue;
+      std::stringstream ss(strline);
+      std::string strkey;
+      double nevents=0, seconds=0;
+      if (!(ss >> strkey >> nevents >> seconds) || nevents<=0. || seconds<0.) continue;
+      auto& cost = costs[strkey.data()];
+      cost.first += nevents;
+      cost.second += seconds;
+    }
+  }
+  return !costs.empty();
+}
+void BaseTreeLooper::writeChunkCostSummary(ChunkCostSummary_t const& costs) const{
+  TString fname = chunkCostSummaryOutput;
+  HostHelpers::ExpandEnvironmentVariables(fname);
+  ofstream fout(fname.Data(), std::ios::trunc);
+  fout << "# Key, number of events, time [s]" << endl;
+  for (auto const& it:costs) fout << it.first << " " << static_cast<long long>(it.second.first) << " " << it.second.second << endl;
+  if (!fout.good()){
+    if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::writeChunkCostSummary: Could not write " << fname << "." << endl;
+  }
+  else if (this->verbosity>=MiscUtils::INFO) IVYout << "BaseTreeLooper::writeChunkCostSummary: Processing times are recorded in " << fname << "." << endl;
+}
+bool BaseTreeLooper::assignCostBalancedSimChunk(int const& ichunk, int const& nchunks, ChunkCostSummary_t const& costs){
+  // Per-event cost of each tree. Trees without a measurement are assigned the average cost of the measured ones.
+  std::vector<double> tree_costs; tree_costs.reserve(treeList.size());
+  double nevents_known = 0, time_known = 0;
+  for (auto const& tree:treeList){
+    double tree_cost = -1;
+    auto it_cost = costs.find(tree->sampleIdentifier);
+    if (it_cost!=costs.cend() && it_cost->second.first>0.){
+      tree_cost = it_cost->second.second / it_cost->second.first;
+      nevents_known += it_cost->second.first;
+      time_known += it_cost->second.second;
+    }
+    tree_costs.push_back(tree_cost);
+  }
+  if (nevents_known<=0. || time_known<=0.) return false;
+  double const avg_cost = time_known / nevents_known;
+  for (auto& tree_cost:tree_costs){ if (tree_cost<0.) tree_cost = avg_cost; }
+
+  long long nevents_total = 0;
+  double cost_total = 0;
+  for (size_t itree=0; itree<treeList.size(); itree++){
+    long long const nevents = treeList.at(itree)->getNEvents();
+    nevents_total += nevents;
+    cost_total += tree_costs.at(itree)*static_cast<double>(nevents);
+  }
+  if (cost_total<=0.) return false;
+
+  // Find the global event index at which the cumulative cost reaches 'cost'.
+  // Chunk boundaries are computed by the same function in every job, so consecutive chunks neither overlap nor leave gaps.
+  auto getEventIndexAtCost = [&] (double const& cost){
+    long long ev_offset = 0;
+    double cost_offset = 0;
+    for (size_t itree=0; itree<treeList.size(); itree++){
+      long long const nevents = treeList.at(itree)->getNEvents();
+      double const& tree_cost = tree_costs.at(itree);
+      double const cost_tree = tree_cost*static_cast<double>(nevents);
+      if (cost<cost_offset+cost_tree){
+        long long const ev_inc = (tree_cost>0. ? std::llround((cost - cost_offset)/tree_cost) : 0);
+        return ev_offset + std::min(std::max(ev_inc, 0LL), nevents);
+      }
+      ev_offset += nevents;
+      cost_offset += cost_tree;
+    }
+    return nevents_total;
+  };
+  eventIndex_begin = (ichunk<=0 ? 0 : (int) getEventIndexAtCost(cost_total*static_cast<double>(ichunk)/static_cast<double>(nchunks)));
+  eventIndex_end = (ichunk+1>=nchunks ? (int) nevents_total : (int) getEventIndexAtCost(cost_total*static_cast<double>(ichunk+1)/static_cast<double>(nchunks)));
+  if (eventIndex_end<eventIndex_begin) eventIndex_end = eventIndex_begin;
+
+  IVYout << "BaseTreeLooper::assignCostBalancedSimChunk: Chunk " << ichunk << " / " << nchunks << " is expected to take " << cost_total/static_cast<double>(nchunks) << " s." << endl;
+  return true;
+}
+bool BaseTreeLooper::assignCostBalancedDataChunk(int const& ichunk, int const& nchunks, ChunkCostSummary_t const& costs){
+  auto const& runnumber_lumi_pairs = SampleHelpers::getRunNumberLumiPairsForDataPeriod(SampleHelpers::getDataPeriod());
+  int const nruns_total = runnumber_lumi_pairs.size();
+  if (nruns_total==0) return false;
+
+  // Cost of each run. Runs without a measurement are assigned a cost proportional to their luminosity.
+  std::vector<double> run_costs(nruns_total, -1);
+  double lumi_known = 0, time_known = 0;
+  for (int irun=0; irun<nruns_total; irun++){
+    auto const& runnumber_lumi_pair = runnumber_lumi_pairs.at(irun);
+    auto it_cost = costs.find(Form("Run_%u", static_cast<unsigned int>(runnumber_lumi_pair.first)));
+    if (it_cost==costs.cend()) continue;
+    run_costs.at(irun) = it_cost->second.second;
+    lumi_known += runnumber_lumi_pair.second;
+    time_known += it_cost->second.second;
+  }
+  if (lumi_known<=0. || time_known<=0.) return false;
+  double const cost_per_lumi = time_known / lumi_known;
+  double cost_total = 0;
+  for (int irun=0; irun<nruns_total; irun++){
+    double& run_cost = run_costs.at(irun);
+    if (run_cost<0.) run_cost = runnumber_lumi_pairs.at(irun).second * cost_per_lumi;
+    cost_total += run_cost;
+  }
+  if (cost_total<=0.) return false;
+
+  // Runs cannot be split, so each run goes to the chunk that contains the midpoint of its cumulative cost.
+  int idx_firstRun = -1, idx_lastRun = -1;
+  double cost_offset = 0;
+  for (int irun=0; irun<nruns_total; irun++){
+    double const& run_cost = run_costs.at(irun);
+    int const jchunk = std::min(nchunks-1, static_cast<int>((cost_offset + run_cost/2.)/cost_total*static_cast<double>(nchunks)));
+    if (jchunk==ichunk){
+      if (idx_firstRun<0) idx_firstRun = irun;
+      idx_lastRun = irun;
+    }
+    cost_offset += run_cost;
+  }
+  if (idx_firstRun<0){
+    // Empty chunk: make the run range select nothing
+    eventIndex_begin = 1;
+    eventIndex_end = 0;
+  }
+  else{
+    eventIndex_begin = (int) runnumber_lumi_pairs.at(idx_firstRun).first;
+    eventIndex_end = (int) runnumber_lumi_pairs.at(idx_lastRun).first;
+  }
+
+  IVYout << "BaseTreeLooper::assignCostBalancedDataChunk: Chunk " << ichunk << " / " << nchunks << " is expected to take " << cost_total/static_cast<double>(nchunks) << " s." << endl;
+  return true;
+}
+
+bool BaseTreeLooper::hasCheckpoint() const{
+  if (checkpointFileName=="") return false;
+  TString fname = checkpointFileName;
+  HostHelpers::ExpandEnvironmentVariables(fname);
+  return HostHelpers::FileReadable(fname.Data());
+}
+void BaseTreeLooper::clearCheckpoint() const{
+  if (!hasCheckpoint()) return;
+  TString fname = checkpointFileName;
+  HostHelpers::ExpandEnvironmentVariables(fname);
+  std::remove(fname.Data());
+  if (checkpointEventsFileName!="") std::remove(checkpointEventsFileName.Data());
+}
+void BaseTreeLooper::getOutputTrees(std::vector<BaseTree*>& outtrees) const{
+  outtrees.clear();
+  std::vector<BaseTree*> candidates = productTreeList;
+  for (auto const& it:systProductTrees) candidates.push_back(it.second);
+  candidates.push_back(currentProductTree);
+  for (auto const& outtree:candidates){
+    if (outtree && !HelperFunctions::checkListVariable(outtrees, outtree)) outtrees.push_back(outtree);
+  }
+}
+void BaseTreeLooper::writeCheckpoint(
+  int const& nevents_total, unsigned int const& ev_traversed, unsigned int const& ev_acc, unsigned int const& ev_rec,
+  ChunkCostSummary_t const& measuredChunkCosts, RunCostSummary_t const& measuredRunCosts
+){
+  // The tree headers are saved together with the baskets so that a file recovered after a crash ends at this checkpoint.
+  std::vector<BaseTree*> outtrees;
+  getOutputTrees(outtrees);
+  for (auto const& outtree:outtrees){
+    for (auto const& tree_:outtree->getValidTrees()){
+      if (tree_->GetDirectory() && tree_->GetDirectory()->GetFile()) tree_->AutoSave("SaveSelf FlushBaskets");
+    }
+  }
+
+  TString fname = checkpointFileName;
+  HostHelpers::ExpandEnvironmentVariables(fname);
+
+  // The data events are written into a file specific to this checkpoint, and the checkpoint refers to it.
+  // This way, the checkpoint and the events file are always consistent, even if the job stops in between.
+  TString fname_events = "none";
+  EventFilterHandler const* eventFilter = getObjectHandler<EventFilterHandler>();
+  if (eventFilter){
+    fname_events = fname + Form(".events_%u", ev_traversed);
+    ofstream fout(fname_events.Data(), std::ios::binary | std::ios::trunc);
+    if (!eventFilter->getTrackedDataEvents().write(fout) || !fout.good()){
+      if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::writeCheckpoint: Could not write " << fname_events << "." << endl;
+      return;
+    }
+  }
+
+  TString const fname_tmp = fname + ".tmp";
+  {
+    ofstream fout(fname_tmp.Data(), std::ios::trunc);
+    fout << "# Number of input trees, number of events, event index range" << endl;
+    fout << treeList.size() << " " << nevents_total << " " << eventIndex_begin << " " << eventIndex_end << endl;
+    fout << "# Number of events traversed, accumulated, and recorded" << endl;
+    fout << ev_traversed << " " << ev_acc << " " << ev_rec << endl;
+    fout << "# File of tracked data events" << endl;
+    fout << fname_events << endl;
+    // Selection labels may contain spaces, so they are written last and read until the end of the line.
+    fout << "# selection <systematic index or -1> <count> <label>" << endl;
+    for (auto const& pp:selection_string_count_pairs) fout << "selection -1 " << pp.second << " " << pp.first << endl;
+    for (auto const& it:syst_selection_string_count_pairs){
+      for (auto const& pp:it.second) fout << "selection " << static_cast<int>(it.first) << " " << pp.second << " " << pp.first << endl;
+    }
+    fout << "# cost <key> <number of events> <time [s]>, or runcost <run number> <number of events> <time [s]>" << endl;
+    fout.precision(17);
+    for (auto const& it:measuredChunkCosts) fout << "cost " << it.first << " " << it.second.first << " " << it.second.second << endl;
+    for (auto const& it:measuredRunCosts) fout << "runcost " << it.first << " " << it.second.first << " " << it.second.second << endl;
+    if (!fout.good()){
+      if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::writeCheckpoint: Could not write " << fname_tmp << "." << endl;
+      return;
+    }
+  }
+  if (std::rename(fname_tmp.Data(), fname.Data())!=0){
+    if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::writeCheckpoint: Could not move " << fname_tmp << " to " << fname << "." << endl;
+    return;
+  }
+
+  // The events file of the previous checkpoint is no longer referenced.
+  if (checkpointEventsFileName!="" && checkpointEventsFileName!=fname_events) std::remove(checkpointEventsFileName.Data());
+  checkpointEventsFileName = (eventFilter ? fname_events : TString(""));
+}
+bool BaseTreeLooper::readCheckpoint(
+  int const& nevents_total, unsigned int& ev_traversed, unsigned int& ev_acc, unsigned int& ev_rec,
+  ChunkCostSummary_t& measuredChunkCosts, RunCostSummary_t& measuredRunCosts,
+  SelectionCounts_t& selectionCounts, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, SelectionCounts_t>& systSelectionCounts
+){
+  if (!hasCheckpoint()) return false;
+  TString fname = checkpointFileName;
+  HostHelpers::ExpandEnvironmentVariables(fname);
+
+  size_t ntrees_stored = 0;
+  int nevents_total_stored = -1, eventIndex_begin_stored = -1, eventIndex_end_stored = -1;
+  std::string fname_events;
+  std::vector<std::string> lines;
+  {
+    ifstream fin(fname.Data());
+    std::string strline;
+    while (std::getline(fin, strline)){
+      if (strline.empty() || strline.front()=='#') continue;
+      lines.push_back(strline);
+    }
+  }
+  bool res = (lines.size()>=3);
+  if (res){
+    std::stringstream ss_config(lines.at(0));
+    std::stringstream ss_state(lines.at(1));
+    std::stringstream ss_events(lines.at(2));
+    res = (
+      (ss_config >> ntrees_stored >> nevents_total_stored >> eventIndex_begin_stored >> eventIndex_end_stored)
+      &&
+      (ss_state >> ev_traversed >> ev_acc >> ev_rec)
+      &&
+      (ss_events >> fname_events)
+      );
+  }
+  measuredChunkCosts.clear();
+  measuredRunCosts.clear();
+  selectionCounts.clear();
+  systSelectionCounts.clear();
+  for (size_t iline=3; res && iline<lines.size(); iline++){
+    std::string const& strline = lines.at(iline);
+    std::stringstream ss(strline);
+    std::string strtype;
+    ss >> strtype;
+    if (strtype=="selection"){
+      int isyst = -1;
+      unsigned int count = 0;
+      res = (ss >> isyst >> count) && ss.get()==' ';
+      if (!res) break;
+      std::streampos const pos_label = ss.tellg();
+      TString const label = strline.substr(static_cast<size_t>(pos_label)).data();
+      if (isyst<0) selectionCounts.emplace_back(label, count);
+      else systSelectionCounts[static_cast<SystematicsHelpers::SystematicVariationTypes>(isyst)].emplace_back(label, count);
+    }
+    else if (strtype=="cost"){
+      std::string strkey;
+      double nevents=0, seconds=0;
+      res = static_cast<bool>(ss >> strkey >> nevents >> seconds);
+      if (res) measuredChunkCosts[strkey.data()] = std::pair<double, double>(nevents, seconds);
+    }
+    else if (strtype=="runcost"){
+      unsigned int run=0;
+      double nevents=0, seconds=0;
+      res = static_cast<bool>(ss >> run >> nevents >> seconds);
+      if (res) measuredRunCosts[run] = std::pair<double, double>(nevents, seconds);
+    }
+    else res = false;
+  }
+  if (!res){
+    IVYerr << "BaseTreeLooper::readCheckpoint: Checkpoint " << fname << " could not be read." << endl;
+    assert(0);
+  }
+  // Products in the output already depend on the state, so a mismatch cannot be recovered by starting over.
+  if (
+    ntrees_stored!=treeList.size() || nevents_total_stored!=nevents_total
+    ||
+    eventIndex_begin_stored!=eventIndex_begin || eventIndex_end_stored!=eventIndex_end
+    ){
+    IVYerr << "BaseTreeLooper::readCheckpoint: Checkpoint " << fname << " was recorded for a different configuration. Please remove it together with the partial outputs." << endl;
+    assert(0);
+  }
+
+  // Without the data events seen before the checkpoint, duplicate events would be recorded again.
+  EventFilterHandler* eventFilter = getObjectHandler<EventFilterHandler>();
+  if (eventFilter){
+    ifstream fin(fname_events.data(), std::ios::binary);
+    if (fname_events=="none" || !fin.good() || !eventFilter->getTrackedDataEvents().read(fin)){
+      IVYerr << "BaseTreeLooper::readCheckpoint: The data events tracked at checkpoint " << fname << " could not be read from " << fname_events << "." << endl;
+      assert(0);
+    }
+    checkpointEventsFileName = fname_events.data();
+  }
+  else checkpointEventsFileName = "";
+
+  return true;
+}
+
+TString BaseTreeLooper::getPreselectionIndexFileName(BaseTree* tree) const{
+  // Indices are specific to the sample and to the requested event or run range.
+  TString strsid = tree->sampleIdentifier;
+  HelperFunctions::replaceString<TString, TString const>(strsid, "/", "_");
+  return Form(
+    "%s/PreselectionIndex_%s_%s_%i_%i.bin",
+    preselectionIndexDir.Data(), preselectionIndexId.Data(), strsid.Data(), eventIndex_begin, eventIndex_end
+  );
+}
+bool BaseTreeLooper::readPreselectionIndex(BaseTree* tree, std::vector<unsigned long long>& passBits) const{
+  TString const fname = getPreselectionIndexFileName(tree);
+  if (!HostHelpers::FileReadable(fname.Data())) return false;
+
+  long long const nevents = tree->getNEvents();
+  long long nevents_stored = -1;
+  long long nwords = -1;
+  ifstream fin(fname.Data(), std::ios::binary);
+  fin.read(reinterpret_cast<char*>(&nevents_stored), sizeof(nevents_stored));
+  fin.read(reinterpret_cast<char*>(&nwords), sizeof(nwords));
+  if (!fin.good() || nevents_stored!=nevents || nwords!=(nevents+63)/64){
+    if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::readPreselectionIndex: The index in " << fname << " does not match the " << nevents << " events of " << tree->sampleIdentifier << " and will be ignored." << endl;
+    return false;
+  }
+  passBits.assign(nwords, 0);
+  fin.read(reinterpret_cast<char*>(passBits.data()), nwords*sizeof(unsigned long long));
+  if (!fin.good()){
+    if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::readPreselectionIndex: The index in " << fname << " is incomplete and will be ignored." << endl;
+    passBits.clear();
+    return false;
+  }
+  return true;
+}
+bool BaseTreeLooper::writePreselectionIndex(BaseTree* tree, std::vector<unsigned long long> const& passBits) const{
+  TString const fname = getPreselectionIndexFileName(tree);
+  // Write into a temporary file first so that concurrent readers never see a partial index
+  TString const fname_tmp = fname + ".tmp";
+
+  long long const nevents = tree->getNEvents();
+  long long const nwords = passBits.size();
+  {
+    ofstream fout(fname_tmp.Data(), std::ios::binary | std::ios::trunc);
+    fout.write(reinterpret_cast<char const*>(&nevents), sizeof(nevents));
+    fout.write(reinterpret_cast<char const*>(&nwords), sizeof(nwords));
+    fout.write(reinterpret_cast<char const*>(passBits.data()), nwords*sizeof(unsigned long long));
+    if (!fout.good()){
+      if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::writePreselectionIndex: Could not write " << fname_tmp << "." << endl;
+      return false;
+    }
+  }
+  if (std::rename(fname_tmp.Data(), fname.Data())!=0){
+    if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::writePreselectionIndex: Could not move " << fname_tmp << " to " << fname << "." << endl;
+    return false;
+  }
+  if (this->verbosity>=MiscUtils::INFO) IVYout << "BaseTreeLooper::writePreselectionIndex: Preselection index for " << tree->sampleIdentifier << " is written to " << fname << "." << endl;
+  return true;
+}
+
+void BaseTreeLooper::computeMEs(
+  TVar::CandidateDecayMode const& decaymode,
+  SimpleParticleCollection_t* daughters, SimpleParticleCollection_t* associated, SimpleParticleCollection_t* mothers,
+  bool isGen
+){
+  // Flatten the inputs into ids and momentum components, which define the MEs completely
+  currentMEInputs.clear();
+  currentMEInputs.push_back(daughters!=nullptr);
+  if (daughters){
+    currentMEInputs.push_back(decaymode);
+    currentMEInputs.push_back(isGen);
+    for (SimpleParticleCollection_t const* coll:{ daughters, associated, mothers }){
+      if (!coll){
+        currentMEInputs.push_back(-1);
+        continue;
+      }
+      currentMEInputs.push_back(coll->size());
+      for (auto const& part:*coll){
+        currentMEInputs.push_back(part.first);
+        currentMEInputs.push_back(part.second.X());
+        currentMEInputs.push_back(part.second.Y());
+        currentMEInputs.push_back(part.second.Z());
+        currentMEInputs.push_back(part.second.T());
+      }
+    }
+  }
+
+  // The MEblock keeps the values of its last computation, so only the push is needed if the inputs are unchanged.
+  if (hasCachedMEInputs && currentMEInputs==cachedMEInputs){
+    if (this->verbosity>=MiscUtils::DEBUG) IVYout << "BaseTreeLooper::computeMEs: MELA inputs are unchanged. The MEs of the last computation are reused." << endl;
+    MEblock.pushMELABranches();
+    return;
+  }
+
+  if (daughters){
+    IvyMELAHelpers::melaHandle->setCandidateDecayMode(decaymode);
+    IvyMELAHelpers::melaHandle->setInputEvent(daughters, associated, mothers, isGen);
+    MEblock.computeMELABranches();
+    MEblock.pushMELABranches();
+    IvyMELAHelpers::melaHandle->resetInputEvent();
+  }
+  else{
+    MEblock.computeMELABranches();
+    MEblock.pushMELABranches();
+  }
+
+  std::swap(cachedMEInputs, currentMEInputs);
+  hasCachedMEInputs = true;
+}
+
 void BaseTreeLooper::incrementSelection(TString const& strsel, unsigned int inc){
   bool isFound = false;
   for (auto& pp:selection_string_count_pairs){
@@ -333,26 +950,33 @@ void BaseTreeLooper::loop(bool keepProducts){
   if (this->useChunkIndices && eventIndex_end>0){
     const int ichunk = eventIndex_begin;
     const int nchunks = eventIndex_end;
+    // Use the measured processing times to balance the chunks if they are available
+    ChunkCostSummary_t chunkCosts;
+    bool const hasChunkCosts = readChunkCostSummaries(chunkCosts);
     if (hasSimTrees){
-      // Assign the range over total number of events
-      int ev_inc = static_cast<int>(float(nevents_total)/float(nchunks));
-      int ev_rem = nevents_total - ev_inc*nchunks;
-      eventIndex_begin = ev_inc*ichunk + std::min(ev_rem, ichunk);
-      eventIndex_end = ev_inc*(ichunk+1) + std::min(ev_rem, ichunk+1);
+      if (!hasChunkCosts || !assignCostBalancedSimChunk(ichunk, nchunks, chunkCosts)){
+        // Assign the range over total number of events
+        int ev_inc = static_cast<int>(float(nevents_total)/float(nchunks));
+        int ev_rem = nevents_total - ev_inc*nchunks;
+        eventIndex_begin = ev_inc*ichunk + std::min(ev_rem, ichunk);
+        eventIndex_end = ev_inc*(ichunk+1) + std::min(ev_rem, ichunk+1);
+      }
       IVYout << "BaseTreeLooper::loop: A simulation loop will proceed. The requested event range is [" << eventIndex_begin << ", " << eventIndex_end << ")." << endl;
     }
     else if (hasDataTrees){
       // Assign the range over run numbers
       double const lumi_total = SampleHelpers::getIntegratedLuminosity(SampleHelpers::getDataPeriod());
       auto const& runnumber_lumi_pairs = SampleHelpers::getRunNumberLumiPairsForDataPeriod(SampleHelpers::getDataPeriod());
-      int const nruns_total = runnumber_lumi_pairs.size();
-      int const nruns_inc = static_cast<int>(static_cast<double>(nruns_total) / static_cast<double>(nchunks));
-      int const nruns_rem = nruns_total - nruns_inc*nchunks;
-
-      int const idx_firstRun = nruns_inc*ichunk + std::min(nruns_rem, ichunk);
-      int const idx_firstRun_next = nruns_inc*(ichunk+1) + std::min(nruns_rem, ichunk+1);
-      eventIndex_begin = (idx_firstRun>=nruns_total ? 0 : (int) runnumber_lumi_pairs.at(idx_firstRun).first);
-      eventIndex_end = (idx_firstRun_next-1>=nruns_total || idx_firstRun_next<=idx_firstRun ? 0 : (int) runnumber_lumi_pairs.at(idx_firstRun_next-1).first);
+      if (!hasChunkCosts || !assignCostBalancedDataChunk(ichunk, nchunks, chunkCosts)){
+        int const nruns_total = runnumber_lumi_pairs.size();
+        int const nruns_inc = static_cast<int>(static_cast<double>(nruns_total) / static_cast<double>(nchunks));
+        int const nruns_rem = nruns_total - nruns_inc*nchunks;
+
+        int const idx_firstRun = nruns_inc*ichunk + std::min(nruns_rem, ichunk);
+        int const idx_firstRun_next = nruns_inc*(ichunk+1) + std::min(nruns_rem, ichunk+1);
+        eventIndex_begin = (idx_firstRun>=nruns_total ? 0 : (int) runnumber_lumi_pairs.at(idx_firstRun).first);
+        eventIndex_end = (idx_firstRun_next-1>=nruns_total || idx_firstRun_next<=idx_firstRun ? 0 : (int) runnumber_lumi_pairs.at(idx_firstRun_next-1).first);
+      }
 
       double lumi_acc = 0;
       for (auto const& runnumber_lumi_pair:runnumber_lumi_pairs){
@@ -387,15 +1011,168 @@ void BaseTreeLooper::loop(bool keepProducts){
     if (!lheMElist.empty()) this->MEblock.buildMELABranches(lheMElist, true);
     if (!recoMElist.empty()) this->MEblock.buildMELABranches(recoMElist, false);
   }
+  resetMECache();
+
+  // Systematics to evaluate per event
+  std::vector<SystematicsHelpers::SystematicVariationTypes> systList = registeredSystList;
+  if (systList.empty()) systList.push_back(registeredSyst);
+  SystematicsHelpers::SystematicVariationTypes const registeredSyst_orig = registeredSyst;
+  BaseTree* const currentProductTree_orig = currentProductTree;
+  std::vector<IvyBase*> systDependentHandlers;
+  if (systList.size()>1){
+    this->getSystematicDependentHandlers(systDependentHandlers);
+    IVYout << "BaseTreeLooper::loop: Each event will be evaluated for the following systematics:" << endl;
+    for (auto const& syst:systList) IVYout << "\t- " << SystematicsHelpers::getSystName(syst) << (systProductTrees.find(syst)!=systProductTrees.cend() ? "" : " (no dedicated output tree)") << endl;
+  }
+
+  // Ranges of events to be read from each tree.
+  // For simulation, the ranges are fixed by the event indices. For data, the run ranges are only known after reading.
+  std::vector<std::pair<Long64_t, Long64_t>> treeEventRanges; treeEventRanges.reserve(treeList.size());
+  {
+    Long64_t ev_offset = 0;
+    for (auto const& tree:treeList){
+      Long64_t const nevents = tree->getNEvents();
+      Long64_t ev_first = 0;
+      Long64_t ev_last = nevents;
+      if (hasSimTrees){
+        if (eventIndex_begin>=0) ev_first = std::min(std::max(static_cast<Long64_t>(eventIndex_begin) - ev_offset, static_cast<Long64_t>(0)), nevents);
+        if (eventIndex_end>=0) ev_last = std::min(std::max(static_cast<Long64_t>(eventIndex_end) - ev_offset, static_cast<Long64_t>(0)), nevents);
+      }
+      treeEventRanges.emplace_back(ev_first, ev_last);
+      ev_offset += nevents;
+    }
+  }
+  // Without a preselection, events are read in order, so the cache of a tree can be filled ahead, also on a separate thread for the next tree.
+  // With a preselection, most events are read only partially, so the cache has to learn its branches instead.
+  bool const isSequentialRead = (looperPreselectionFunction==nullptr);
+  bool doPrefetch = (doPrefetchNextTree && inputTreeCacheSize>=0 && treeList.size()>1);
+  if (doPrefetch && !isSequentialRead){
+    if (this->verbosity>=MiscUtils::INFO) IVYout << "BaseTreeLooper::loop: The next input tree will not be prefetched because events are not read in order when there is a preselection." << endl;
+    doPrefetch = false;
+  }
+  if (doPrefetch && !gGlobalMutex){
+    IVYerr << "BaseTreeLooper::loop: ROOT::EnableThreadSafety() needs to be called before any input is opened in order to prefetch the next input tree. Prefetching is disabled." << endl;
+    doPrefetch = false;
+  }
+  std::unordered_set<BaseTree*> preparedTrees;
+  std::thread prefetchThread;
+
+  // Timing of the main stages of the loop. Handlers and looper functions can add their own sections to the same registry.
+  // The registry belongs to the current thread, so resetting it does not affect loopers on other threads.
+  TimingHelpers::TimingRegistry& timingRegistry = TimingHelpers::getTimingRegistry();
+  timingRegistry.reset();
+  size_t const isec_preselection = timingRegistry.getSectionIndex("BaseTreeLooper::preselection");
+  size_t const isec_readEvent = timingRegistry.getSectionIndex("BaseTreeLooper::readEvent");
+  size_t const isec_looperFunction = timingRegistry.getSectionIndex("BaseTreeLooper::looperFunction");
+  size_t const isec_recordProducts = timingRegistry.getSectionIndex("BaseTreeLooper::recordProducts");
+  TimingHelpers::Clock_t::time_point const time_loop_begin = TimingHelpers::Clock_t::now();
+
+  // Columns filled by the looper itself if the products are written through a product record
+#define RUNLUMIEVENT_VARIABLE(TYPE, NAME, DEFVAL) TYPE* NAME##_record = nullptr;
+  RUNLUMIEVENT_VARIABLES;
+#undef RUNLUMIEVENT_VARIABLE
+  float* SampleMHVal_record = nullptr;
+  if (productRecord){
+    if (hasDataTrees){
+#define RUNLUMIEVENT_VARIABLE(TYPE, NAME, DEFVAL) NAME##_record = &(productRecord->addColumn<TYPE>(#NAME, DEFVAL));
+      RUNLUMIEVENT_VARIABLES;
+#undef RUNLUMIEVENT_VARIABLE
+    }
+    else{
+      for (auto const& tree:treeList){
+        if (SampleHelpers::findPoleMass(tree->sampleIdentifier)>0.f){
+          SampleMHVal_record = &(productRecord->addColumn<float>("SampleMHVal", -1));
+          break;
+        }
+      }
+    }
+  }
+
+  // Limit the memory taken by the baskets of the output trees.
+  // The products are still filled one by one, so branches bound outside the looper, e.g. those of the MEblock, stay in sync.
+  if (outputTreeMemoryLimit>0){
+    std::vector<BaseTree*> outtrees;
+    getOutputTrees(outtrees);
+    for (auto const& outtree:outtrees){
+      for (auto const& tree_:outtree->getValidTrees()) tree_->SetAutoFlush(-static_cast<Long64_t>(outputTreeMemoryLimit));
+    }
+  }
+
+  // Processing times to be recorded for the balancing of later chunks
+  bool const doMeasureChunkCosts = (chunkCostSummaryOutput!="");
+  ChunkCostSummary_t measuredChunkCosts;
+  RunCostSummary_t measuredRunCosts;
 
   // Loop over the trees
   unsigned int ev_traversed=0;
   unsigned int ev_acc=0;
   unsigned int ev_rec=0;
-  for (auto& tree:treeList){
+  // Resume from the last checkpoint if there is one
+  bool const doCheckpoints = (checkpointFileName!="" && checkpointInterval>0);
+  unsigned int ev_resume=0;
+  // Checkpoints are counted in accumulated events so that events outside the requested range do not trigger them
+  unsigned int ev_acc_checkpoint=0;
+  SelectionCounts_t selectionCounts_resume;
+  std::unordered_map<SystematicsHelpers::SystematicVariationTypes, SelectionCounts_t> systSelectionCounts_resume;
+  if (doCheckpoints){
+    checkpointEventsFileName = "";
+    if (readCheckpoint(nevents_total, ev_resume, ev_acc, ev_rec, measuredChunkCosts, measuredRunCosts, selectionCounts_resume, systSelectionCounts_resume)){
+      IVYout << "BaseTreeLooper::loop: Resuming after " << ev_resume << " traversed events with " << ev_rec << " / " << ev_acc << " events recorded." << endl;
+      ev_acc_checkpoint = ev_acc;
+    }
+    // Automatic saves would write output trees between checkpoints, i.e., with products the checkpoint does not cover.
+    std::vector<BaseTree*> outtrees;
+    getOutputTrees(outtrees);
+    for (auto const& outtree:outtrees){
+      for (auto const& tree_:outtree->getValidTrees()) tree_->SetAutoSave(0);
+    }
+  }
+  for (size_t itree=0; itree<treeList.size(); itree++){
+    BaseTree* const& tree = treeList.at(itree);
+    std::pair<Long64_t, Long64_t> const& treeEventRange = treeEventRanges.at(itree);
+
+    // Make sure the background preparation of this tree is over before using it
+    if (prefetchThread.joinable()) prefetchThread.join();
+
     // Skip the tree if it cannot be wrapped
     if (!(this->wrapTree(tree))) continue;
 
+    const int nevents = tree->getNEvents();
+
+    // Use the stored preselection outcomes if they exist, or record them for the next passes
+    bool const usePreselectionIndex = (looperPreselectionFunction && preselectionIndexId!="");
+    std::vector<unsigned long long> preselectionPassBits;
+    bool const hasPreselectionIndex = (usePreselectionIndex && readPreselectionIndex(tree, preselectionPassBits));
+    bool recordPreselectionIndex = (usePreselectionIndex && !hasPreselectionIndex);
+    if (recordPreselectionIndex) preselectionPassBits.assign((nevents+63)/64, 0);
+    if (hasPreselectionIndex) IVYout << "BaseTreeLooper::loop: Events failing the preselection " << preselectionIndexId << " will be skipped using the stored index." << endl;
+
+    // Set up the cache of this tree, and prepare the next one while this tree is processed.
+    // With a stored preselection index, only the accepted events are read, and they are read completely,
+    // so the cache can still be filled ahead over the range they span.
+    if (preparedTrees.find(tree)==preparedTrees.cend()){
+      if (isSequentialRead) prepareInputTree(tree, treeEventRange.first, treeEventRange.second, true);
+      else if (hasPreselectionIndex){
+        std::pair<Long64_t, Long64_t> const passEventRange = getPassBitRange(preselectionPassBits, treeEventRange.first, treeEventRange.second);
+        prepareInputTree(tree, passEventRange.first, passEventRange.second, true);
+      }
+      else prepareInputTree(tree, treeEventRange.first, treeEventRange.second, false);
+      preparedTrees.insert(tree);
+    }
+    if (doPrefetch && itree+1<treeList.size()){
+      BaseTree* const nextTree = treeList.at(itree+1);
+      std::pair<Long64_t, Long64_t> const nextTreeEventRange = treeEventRanges.at(itree+1);
+      if (nextTree!=tree && preparedTrees.find(nextTree)==preparedTrees.cend()){
+        preparedTrees.insert(nextTree);
+        prefetchThread = std::thread(&BaseTreeLooper::prepareInputTree, this, nextTree, nextTreeEventRange.first, nextTreeEventRange.second, true);
+      }
+    }
+    // Bind the handlers and menus for this tree
+    if (looperSetupFunction && !looperSetupFunction(this)){
+      if (this->verbosity>=MiscUtils::ERROR) IVYerr << "BaseTreeLooper::loop: The setup function failed for " << tree->sampleIdentifier << ". Skipping the tree..." << endl;
+      continue;
+    }
+
 #define RUNLUMIEVENT_VARIABLE(TYPE, NAME, DEFVAL) TYPE const* NAME = nullptr;
     RUNLUMIEVENT_VARIABLES;
 #undef RUNLUMIEVENT_VARIABLE
@@ -423,14 +1200,45 @@ void BaseTreeLooper::loop(bool keepProducts){
       assert(0);
     }
 
-    const int nevents = tree->getNEvents();
+    // Only nominal is meaningful for data
+    std::vector<SystematicsHelpers::SystematicVariationTypes> systList_currentTree;
+    if (this->isData_currentTree && systList.size()>1){
+      if (HelperFunctions::checkListVariable(systList, SystematicsHelpers::sNominal)) systList_currentTree.push_back(SystematicsHelpers::sNominal);
+    }
+    else systList_currentTree = systList;
+    if (systList_currentTree.empty()){
+      IVYerr << "BaseTreeLooper::loop: No systematic applicable to " << tree->sampleIdentifier << ". Skipping the tree..." << endl;
+      continue;
+    }
+
+    std::pair<double, double>* measuredSampleCost = (doMeasureChunkCosts && !this->isData_currentTree ? &(measuredChunkCosts[tree->sampleIdentifier]) : nullptr);
+
     IVYout << "BaseTreeLooper::loop: Looping over " << nevents << " events in " << tree->sampleIdentifier << "..." << endl;
+    TimingHelpers::ProgressMeter progressMeter(progressReportInterval);
     for (int ev=0; ev<nevents; ev++){
       if (
         SampleHelpers::doSignalInterrupt==1
         ||
         (maxNEvents>=0 && (int) ev_rec==maxNEvents)
-        ) break;
+        ){
+        // The index would be incomplete
+        recordPreselectionIndex = false;
+        break;
+      }
+
+      // Skip the events processed before the checkpoint
+      if (ev_traversed<ev_resume){
+        int const nskip = std::min(nevents - ev, static_cast<int>(ev_resume - ev_traversed));
+        ev += nskip-1;
+        ev_traversed += nskip;
+        recordPreselectionIndex = false;
+        // The recorded selection counts belong to the tree in which the checkpoint was written.
+        if (ev_traversed==ev_resume){
+          selection_string_count_pairs = selectionCounts_resume;
+          syst_selection_string_count_pairs = systSelectionCounts_resume;
+        }
+        continue;
+      }
 
       bool doAccumulate = true;
       if (this->isData_currentTree){
@@ -449,26 +1257,93 @@ void BaseTreeLooper::loop(bool keepProducts){
         );
 
       if (doAccumulate){
-        if (tree->getEvent(ev)){
-          SimpleEntry product;
-          if (sampleIdOpt==kStoreByRunAndEventNumber){
+        TimingHelpers::Clock_t::time_point const time_event_begin = TimingHelpers::Clock_t::now();
+
+        // Read only the preselection branches first so that the rest of the event is not read for rejected events
+        bool passPreselection = true;
+        if (hasPreselectionIndex) passPreselection = HelperFunctions::test_bit(preselectionPassBits[ev/64], ev%64);
+        else if (looperPreselectionFunction){
+          for (auto const& pp:preselectionBranches) passPreselection &= tree->updateBranch(ev, pp.first, false);
+          passPreselection = passPreselection && looperPreselectionFunction(this);
+          if (recordPreselectionIndex && passPreselection) preselectionPassBits[ev/64] |= (1ULL << (ev%64));
+        }
+        if (looperPreselectionFunction) timingRegistry.addDuration(isec_preselection, TimingHelpers::Clock_t::now() - time_event_begin);
+
+        // Read the event only once, and evaluate every systematic over the same input.
+        bool isValidEvent = false;
+        if (passPreselection){
+          TimingHelpers::ScopedTimer const timer_readEvent(isec_readEvent);
+          isValidEvent = (tree->getEvent(ev) && tree->isValidEvent());
+        }
+        if (isValidEvent){
+          bool hasProduct = false;
+          for (size_t isyst=0; isyst<systList_currentTree.size(); isyst++){
+            SystematicsHelpers::SystematicVariationTypes const& syst = systList_currentTree.at(isyst);
+            if (systList.size()>1){
+              // Objects need to be re-reconstructed from scratch for the next systematic
+              if (isyst>0){ for (auto const& handler:systDependentHandlers) handler->resetCache(); }
+              this->registeredSyst = syst;
+              std::swap(selection_string_count_pairs, syst_selection_string_count_pairs[syst]);
+              auto it_systTree = systProductTrees.find(syst);
+              if (it_systTree!=systProductTrees.cend()) this->currentProductTree = it_systTree->second;
+              else this->currentProductTree = currentProductTree_orig;
+            }
+
+            SimpleEntry product;
+            if (productRecord){
+              productRecord->reset();
+              if (sampleIdOpt==kStoreByRunAndEventNumber){
+#define RUNLUMIEVENT_VARIABLE(TYPE, NAME, DEFVAL) *NAME##_record = *NAME;
+                RUNLUMIEVENT_VARIABLES;
+#undef RUNLUMIEVENT_VARIABLE
+              }
+              else if (sampleIdOpt==kStoreByMH) *SampleMHVal_record = MHval;
+            }
+            else if (sampleIdOpt==kStoreByRunAndEventNumber){
 #define RUNLUMIEVENT_VARIABLE(TYPE, NAME, DEFVAL) product.setNamedVal<TYPE>(#NAME, *NAME);
-            RUNLUMIEVENT_VARIABLES;
+              RUNLUMIEVENT_VARIABLES;
 #undef RUNLUMIEVENT_VARIABLE
-          }
-          else if (sampleIdOpt==kStoreByMH) product.setNamedVal("SampleMHVal", MHval);
-          if (tree->isValidEvent()){
-            if (this->looperFunction(this, it_globalWgt->second, product)){
-              if (keepProducts) this->addProduct(product, &ev_rec);
             }
+            else if (sampleIdOpt==kStoreByMH) product.setNamedVal("SampleMHVal", MHval);
+            bool hasSystProduct = false;
+            {
+              TimingHelpers::ScopedTimer const timer_looperFunction(isec_looperFunction);
+              hasSystProduct = this->looperFunction(this, it_globalWgt->second, product);
+            }
+            if (hasSystProduct){
+              hasProduct = true;
+              if (keepProducts){
+                TimingHelpers::ScopedTimer const timer_recordProducts(isec_recordProducts);
+                if (productRecord) this->addRecordedProduct(product);
+                else this->addProduct(product);
+              }
+            }
+
+            if (systList.size()>1) std::swap(selection_string_count_pairs, syst_selection_string_count_pairs[syst]);
+          }
+          if (hasProduct && keepProducts) ev_rec++;
+        }
+
+        if (doMeasureChunkCosts){
+          std::pair<double, double>* measuredCost = measuredSampleCost;
+          // The run number is not read yet if there is no run range and the event failed the preselection.
+          if (this->isData_currentTree && (eventIndex_begin>0 || eventIndex_end>0 || tree->updateBranch(ev, "RunNumber", false))) measuredCost = &(measuredRunCosts[*RunNumber]);
+          if (measuredCost){
+            measuredCost->first += 1;
+            measuredCost->second += std::chrono::duration<double>(TimingHelpers::Clock_t::now() - time_event_begin).count();
           }
         }
         ev_acc++;
       }
 
-      HelperFunctions::progressbar(ev, nevents);
+      progressMeter.update("BaseTreeLooper::loop", ev, nevents);
       ev_traversed++;
+      if (doCheckpoints && ev_acc-ev_acc_checkpoint>=checkpointInterval){
+        writeCheckpoint(nevents_total, ev_traversed, ev_acc, ev_rec, measuredChunkCosts, measuredRunCosts);
+        ev_acc_checkpoint = ev_acc;
+      }
     }
+    if (recordPreselectionIndex) writePreselectionIndex(tree, preselectionPassBits);
 
     if (!selection_string_count_pairs.empty()){
       IVYout << "BaseTreeLooper::loop: Number of events passing each selection type:" << endl;
@@ -476,13 +1351,34 @@ void BaseTreeLooper::loop(bool keepProducts){
         IVYout << (pp.first.BeginsWith("\t") ? "\t" : "\t- ") << pp.first << ": " << pp.second << endl;
       }
     }
+    for (auto const& syst:systList_currentTree){
+      auto it_syst_counts = syst_selection_string_count_pairs.find(syst);
+      if (it_syst_counts==syst_selection_string_count_pairs.cend() || it_syst_counts->second.empty()) continue;
+      IVYout << "BaseTreeLooper::loop: Number of events passing each selection type for systematic " << SystematicsHelpers::getSystName(syst) << ":" << endl;
+      for (auto& pp:it_syst_counts->second){
+        IVYout << (pp.first.BeginsWith("\t") ? "\t" : "\t- ") << pp.first << ": " << pp.second << endl;
+      }
+    }
     resetSelectionCounts();
   } // End loop over the trees
+  if (prefetchThread.joinable()) prefetchThread.join();
   IVYout << "BaseTreeLooper::loop: Total number of products: " << ev_rec << " / " << ev_acc << " / " << ev_traversed << endl;
+  timingRegistry.print("BaseTreeLooper::loop", TimingHelpers::Clock_t::now() - time_loop_begin, ev_acc);
+
+  if (doMeasureChunkCosts){
+    for (auto const& it:measuredRunCosts) measuredChunkCosts[Form("Run_%u", it.first)] = it.second;
+    writeChunkCostSummary(measuredChunkCosts);
+  }
 
   // Restore original event index values
   eventIndex_begin = eventIndex_begin_orig;
   eventIndex_end = eventIndex_end_orig;
+
+  // Restore the original systematic and output tree
+  if (systList.size()>1){
+    registeredSyst = registeredSyst_orig;
+    currentProductTree = currentProductTree_orig;
+  }
 }
 
 std::vector<SimpleEntry> const& BaseTreeLooper::getProducts() const{ return *productListRef; }
@@ -20,34 +20,24 @@ BtagScaleFactorHandler::BtagScaleFactorHandler() : ScaleFactorHandlerBase()
 
 BtagScaleFactorHandler::~BtagScaleFactorHandler(){ this->reset(); }
 
-void BtagScaleFactorHandler::evalEfficiencyFromHistogram(float& theSF, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const{
-  TH2F const* hh = hist.getHistogram();
-  if (!hh){
-    IVYerr << "BtagScaleFactorHandler::evalScaleFactorFromHistogram: Histogram is null." << endl;
+void BtagScaleFactorHandler::evalEfficiencyFromHistogram(float& theSF, size_t const& ilayer, ScaleFactorTable::BinLocationList_t const& binlocs) const{
+  if (mceff_table.isEmptyLayer(ilayer)){
+    IVYerr << "BtagScaleFactorHandler::evalEfficiencyFromHistogram: Histogram " << mceff_table.getLayerName(ilayer) << " is null." << endl;
     return;
   }
 
-  float const abs_eta = std::abs(eta);
-  float const& eta_to_use = (!useAbsEta ? eta : abs_eta);
-
-  int ix, iy;
-  int nbinsx = hh->GetNbinsX();
-  int nbinsy = hh->GetNbinsY();
-  if (!etaOnY){
-    ix = hh->GetXaxis()->FindBin(eta_to_use);
-    iy = hh->GetYaxis()->FindBin(pt);
-  }
-  else{
-    ix = hh->GetXaxis()->FindBin(pt);
-    iy = hh->GetYaxis()->FindBin(eta_to_use);
-  }
+  ScaleFactorTable::BinLocation const& loc = mceff_table.getBinLocation(ilayer, binlocs);
+  int ix = loc.ix;
+  int iy = loc.iy;
+  int nbinsx = mceff_table.getNbinsX(ilayer);
+  int nbinsy = mceff_table.getNbinsY(ilayer);
 
   if (ix==0) ix=1;
   else if (ix>nbinsx+1) ix=nbinsx+1; // Overflows exist
   if (iy==0) iy=1;
   else if (iy==nbinsy+1) iy=nbinsy;
 
-  theSF = hh->GetBinContent(ix, iy);
+  theSF = mceff_table.getBinContent(ilayer, ix, iy);
 }
 
 bool BtagScaleFactorHandler::setup(){
@@ -124,22 +114,23 @@ bool BtagScaleFactorHandler::setup(){
   TFile* finput_eff = TFile::Open(BtagHelpers::getBtagEffFileName(), "read"); uppermostdir->cd();
   if (verbosity>=MiscUtils::INFO) IVYout << "BtagScaleFactorHandler::setup: Reading " << finput_eff->GetName() << " to acquire efficiency histograms..." << endl;
   {
-    ExtendedHistogram_2D_f empty_hist; empty_hist.reset();
+    // Histograms that are not acquired point to an empty layer
+    size_t const ilayer_empty = mceff_table.addLayer(ExtendedHistogram_2D_f());
     TString hname;
     for (auto const& syst:allowedSysts){
       TString systname = SystematicsHelpers::getSystName(syst).data();
-      syst_flav_pujetid_WP_mceffhist_map[syst] = std::unordered_map< BTagEntry::JetFlavor, std::vector<std::vector<ExtendedHistogram_2D_f>> >();
+      syst_flav_pujetid_WP_mceffhist_map[syst] = std::unordered_map< BTagEntry::JetFlavor, std::vector<std::vector<size_t>> >();
       for (auto const& flavpair:flavpairs){
         BTagEntry::JetFlavor jflav = flavpair.first;
         TString const& strflav = flavpair.second;
-        syst_flav_pujetid_WP_mceffhist_map[syst][jflav] = std::vector<std::vector<ExtendedHistogram_2D_f>>(strpujetidcats.size(), std::vector<ExtendedHistogram_2D_f>(nBtagWPTypes, empty_hist));
+        syst_flav_pujetid_WP_mceffhist_map[syst][jflav] = std::vector<std::vector<size_t>>(strpujetidcats.size(), std::vector<size_t>(nBtagWPTypes, ilayer_empty));
         for (unsigned short ipujetidwp=0; ipujetidwp<strpujetidcats.size(); ipujetidwp++){
           TString const& strpujetidcat = strpujetidcats.at(ipujetidwp);
           for (int iwp=0; iwp<(int) nBtagWPTypes; iwp++){
             BtagWPType wptype = (BtagWPType) iwp;
             hname = BtagHelpers::getBtagEffHistName(wptype, strflav.Data()); hname = hname + "_PUJetId_" + strpujetidcat + "_" + systname;
             if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Extracting MC efficiency histogram " << hname << "..." << endl;
-            bool tmpres = getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_flav_pujetid_WP_mceffhist_map[syst][jflav].at(ipujetidwp).at(iwp), finput_eff, hname);
+            bool tmpres = getHistogramLayer<TH2F>(mceff_table, syst_flav_pujetid_WP_mceffhist_map[syst][jflav].at(ipujetidwp).at(iwp), finput_eff, hname);
             if (!tmpres && verbosity>=MiscUtils::DEBUG) IVYerr << "\t\t- FAILED!" << endl;
             res &= tmpres;
           }
@@ -168,6 +159,7 @@ void BtagScaleFactorHandler::reset(){
   WP_calibreader_map_nominal.clear();
   WP_calib_map.clear();
   syst_flav_pujetid_WP_mceffhist_map.clear();
+  mceff_table.reset();
 }
 
 float BtagScaleFactorHandler::getSFFromBTagCalibrationReader(
@@ -199,7 +191,7 @@ float BtagScaleFactorHandler::getSFFromBTagCalibrationReader(
   return SF;
 }
 
-void BtagScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, unsigned short const& pujetidcat, BTagEntry::JetFlavor const& flav, float const& btagval, float& val, float* effval) const{
+void BtagScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& eta, unsigned short const& pujetidcat, BTagEntry::JetFlavor const& flav, float const& btagval, float& val, float* effval) const{
   using namespace SystematicsHelpers;
 
   val = 1;
@@ -234,7 +226,7 @@ void BtagScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariation
   std::vector<BTagCalibrationReader const*> calibReaders;
   std::vector<BTagCalibrationReader const*> calibReaders_Nominal;
   std::vector<float> const btagwps = BtagHelpers::getBtagWPs(false);
-  std::vector<ExtendedHistogram_2D_f> const& effhists = syst_flav_pujetid_WP_mceffhist_map.find(jetsyst)->second.find(flav)->second.at(pujetidcat);
+  std::vector<size_t> const& effhists = syst_flav_pujetid_WP_mceffhist_map.find(jetsyst)->second.find(flav)->second.at(pujetidcat);
   unsigned short idx_offset_effmc = 0;
   switch (BtagHelpers::btagWPType){
   case kDeepCSV_Loose:
@@ -282,7 +274,7 @@ void BtagScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariation
       syst, flav, pt, eta
     );
     if (i>0) SFs.at(i) /= SFs.at(i-1);
-    evalEfficiencyFromHistogram(effs_unscaled.at(i), pt, eta, effhists.at(i+idx_offset_effmc), true, false);
+    evalEfficiencyFromHistogram(effs_unscaled.at(i), effhists.at(i+idx_offset_effmc), binlocs);
     effs_scaled.at(i) = std::max(0.f, std::min(1.f, effs_unscaled.at(i) * SFs.at(i)));
   }
 
@@ -321,17 +313,51 @@ void BtagScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariation
     IVYout << "\t- Final eff: " << eff_scaled << endl;
   }
 }
+void BtagScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, unsigned short const& pujetidcat, BTagEntry::JetFlavor const& flav, float const& btagval, float& val, float* effval) const{
+  ScaleFactorTable::BinLocationList_t binlocs;
+  mceff_table.findBins(pt, eta, binlocs);
+  getSFAndEff(syst, binlocs, pt, eta, pujetidcat, flav, btagval, val, effval);
+}
+bool BtagScaleFactorHandler::getPUJetIdCategory(AK4JetObject const* obj, unsigned short& pujetidcat){
+  if (!obj) return false;
+  if (!ParticleSelectionHelpers::isJetForBtagSF(obj)) return false;
+
+  pujetidcat=0;
+  if (!obj->testSelectionBit(AK4JetSelectionHelpers::kTightPUJetId)) pujetidcat++;
+  if (!obj->testSelectionBit(AK4JetSelectionHelpers::kMediumPUJetId)) pujetidcat++;
+  if (!obj->testSelectionBit(AK4JetSelectionHelpers::kLoosePUJetId)) pujetidcat++;
+
+  return true;
+}
 void BtagScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, AK4JetObject const* obj, float& val, float* effval) const{
   val = 1;
   if (effval) *effval = 1;
 
-  if (!obj) return;
-  if (!ParticleSelectionHelpers::isJetForBtagSF(obj)) return;
-
   unsigned short pujetidcat=0;
-  if (!obj->testSelectionBit(AK4JetSelectionHelpers::kTightPUJetId)) pujetidcat++;
-  if (!obj->testSelectionBit(AK4JetSelectionHelpers::kMediumPUJetId)) pujetidcat++;
-  if (!obj->testSelectionBit(AK4JetSelectionHelpers::kLoosePUJetId)) pujetidcat++;
+  if (!getPUJetIdCategory(obj, pujetidcat)) return;
 
   getSFAndEff(syst, obj->pt(), obj->eta(), pujetidcat, obj->getBTagJetFlavor(), obj->getBtagValue(), val, effval);
 }
+void BtagScaleFactorHandler::getSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<AK4JetObject*> const& objs, std::vector<float>& vals, float const& minval) const{
+  vals.assign(systs.size(), 1);
+
+  ScaleFactorTable::BinLocationList_t binlocs;
+  for (auto const& obj:objs){
+    unsigned short pujetidcat=0;
+    if (!getPUJetIdCategory(obj, pujetidcat)) continue;
+
+    float const pt = obj->pt();
+    float const eta = obj->eta();
+    BTagEntry::JetFlavor const flav = obj->getBTagJetFlavor();
+    float const btagval = obj->getBtagValue();
+    mceff_table.findBins(pt, eta, binlocs);
+
+    auto it_val = vals.begin();
+    for (auto const& syst:systs){
+      float theSF = 1;
+      getSFAndEff(syst, binlocs, pt, eta, pujetidcat, flav, btagval, theSF, nullptr);
+      *it_val *= std::max(minval, theSF);
+      it_val++;
+    }
+  }
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "Discriminant.h"
 #include "HostHelpersCore.h"
 #include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
@@ -8,12 +9,30 @@ using namespace std;
 using namespace IvyStreamHelpers;
 
 
+Discriminant::SplineTable::SplineTable(TSpline3* spline){
+  int const np = spline->GetNp();
+  xk.assign(np, 0); yk.assign(np, 0); bk.assign(np, 0); ck.assign(np, 0); dk.assign(np, 0);
+  for (int ip=0; ip<np; ip++) spline->GetCoeff(ip, xk[ip], yk[ip], bk[ip], ck[ip], dk[ip]);
+}
+double Discriminant::SplineTable::eval(const double x) const{
+  int const np = xk.size();
+  if (np==0) return 0;
+  // Index of the last knot below x such that xk[k]<x<=xk[k+1], with the first and last segments used for extrapolation
+  int k = static_cast<int>(std::lower_bound(xk.cbegin(), xk.cend(), x) - xk.cbegin()) - 1;
+  if (k>np-2) k = np-2;
+  if (k<0) k = 0;
+  double const dx = x - xk[k];
+  return (yk[k] + dx*(bk[k] + dx*(ck[k] + dx*dk[k])));
+}
+
+
 Discriminant::Discriminant(
   const TString cfilename, const TString splinename,
   const TString gfilename, const TString gsplinename,
   const float gscale_
 ) :
-  WPCshift(1), gscale(gscale_), invertG(false), val(-999)
+  WPCshift(1), gscale(gscale_), invertG(false), val(-999),
+  hasCachedCval(false), cachedValReco(0), cachedCval(0)
 {
   if (!addAdditionalC(cfilename, splinename)) IVYout << "Discriminant::Discriminant: No c-constants file is specified, defaulting to c=1." << endl;
   if (!addAdditionalG(gfilename, gsplinename)) IVYout << "Discriminant::Discriminant: No g-constants file is specified, defaulting to g=1." << endl;
@@ -39,24 +58,57 @@ float Discriminant::update(const std::vector<float>& vars, const float valReco){
   this->eval(vars, valReco);
   return val;
 }
+float Discriminant::update(const float* vars, const unsigned int nvars, const float valReco){
+  inputvals.assign(vars, vars+nvars);
+  this->eval(inputvals, valReco);
+  return val;
+}
+void Discriminant::bindInputs(const std::vector<float const*>& inputs){
+  inputrefs = inputs;
+  inputvals.assign(inputrefs.size(), 0);
+}
+float Discriminant::update(const float valReco){
+  inputvals.resize(inputrefs.size());
+  auto it_val = inputvals.begin();
+  for (float const* const& ref:inputrefs){
+    *it_val = *ref;
+    it_val++;
+  }
+  this->eval(inputvals, valReco);
+  return val;
+}
+void Discriminant::updateBatch(const float* vars, const unsigned int nvars, const size_t nevents, const float* valReco, float* res){
+  for (size_t iev=0; iev<nevents; iev++){
+    inputvals.assign(vars+iev*nvars, vars+(iev+1)*nvars);
+    this->eval(inputvals, valReco[iev]);
+    res[iev] = val;
+  }
+}
 float Discriminant::getCval(const float valReco) const{
+  if (hasCachedCval && cachedValReco==valReco) return cachedCval;
+
   float res=WPCshift;
   int gpow=1;
-  if (!theG.empty()){
+  if (!tableG.empty()){
     gpow = (!invertG ? 1 : -1)*2;
     res *= pow(gscale, gpow);
   }
-  for (std::pair<TFile*, TSpline3*> const& fspair:theC) res *= fspair.second->Eval(valReco);
-  for (std::pair<TFile*, TSpline3*> const& fspair:theG) res *= pow(fspair.second->Eval(valReco), gpow);
+  for (SplineTable const& table:tableC) res *= table.eval(valReco);
+  for (SplineTable const& table:tableG) res *= pow(table.eval(valReco), gpow);
+
+  hasCachedCval = true;
+  cachedValReco = valReco;
+  cachedCval = res;
   return res;
 }
 float Discriminant::applyAdditionalC(const float cval){ val = val/(val+(1.-val)*cval); return val; }
 void Discriminant::setWP(float inval){
   if (inval<=0. || inval>=1.) return;
   WPCshift = inval/(1.-inval);
+  resetCachedCval();
 }
-void Discriminant::setGScale(float inval){ gscale=inval; }
-void Discriminant::setInvertG(bool flag){ invertG=flag; }
+void Discriminant::setGScale(float inval){ gscale=inval; resetCachedCval(); }
+void Discriminant::setInvertG(bool flag){ invertG=flag; resetCachedCval(); }
 
 bool Discriminant::addAdditionalC(TString filename, TString splinename){
   bool success=false;
@@ -77,6 +129,8 @@ bool Discriminant::addAdditionalC(TString filename, TString splinename){
         else{
           IVYout << "Discriminant::addAdditionalC: Acquired " << splinename << endl;
           theC.push_back(std::pair<TFile*, TSpline3*>(theFile, theSpline));
+          tableC.emplace_back(theSpline);
+          resetCachedCval();
           success=true;
         }
       }
@@ -109,6 +163,8 @@ bool Discriminant::addAdditionalG(TString filename, TString splinename){
         else{
           IVYout << "Discriminant::addAdditionalG: Acquired " << splinename << endl;
           theG.push_back(std::pair<TFile*, TSpline3*>(theFile, theSpline));
+          tableG.emplace_back(theSpline);
+          resetCachedCval();
           success=true;
         }
       }
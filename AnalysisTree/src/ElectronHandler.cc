@@ -4,6 +4,7 @@
 
 #include "ParticleObjectHelpers.h"
 #include "ElectronHandler.h"
+#include "PFCandidateAssociationHelpers.h"
 #include "SamplesCore.h"
 #include "ElectronSelectionHelpers.h"
 #include "ParticleSelectionHelpers.h"
@@ -54,15 +55,7 @@ bool ElectronHandler::constructElectrons(SystematicsHelpers::SystematicVariation
 bool ElectronHandler::associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const{
   if (!pfcandidates) return true;
 
-  for (auto const& pfcand:(*pfcandidates)){
-    auto const& associated_particle_indices = pfcand->extras.matched_electron_index_list;
-    for (auto const& part:productList){
-      if (HelperFunctions::checkListVariable(associated_particle_indices, part->getUniqueIdentifier())){
-        part->addDaughter(pfcand);
-        pfcand->addMother(part);
-      }
-    }
-  }
+  PFCandidateAssociationHelpers::associatePFCandidates(*pfcandidates, productList, &PFCandidateVariables::matched_electron_index_list);
 
   return true;
 }
@@ -119,7 +112,7 @@ bool ElectronHandler::constructElectronObjects(SystematicsHelpers::SystematicVar
 
       ParticleObject::LorentzVector_t momentum;
       momentum = ParticleObject::PolarLorentzVector_t(*it_pt, *it_eta, *it_phi, *it_mass); // Yes you have to do this on a separate line because CMSSW...
-      productList.push_back(new ProductType_t(-11*(*it_charge>0 ? 1 : -1), momentum));
+      productList.push_back(productArena.emplace(-11*(*it_charge>0 ? 1 : -1), momentum));
       ElectronObject*& obj = productList.back();
 
       // Set extras
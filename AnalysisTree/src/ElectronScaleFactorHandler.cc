@@ -48,9 +48,12 @@ bool ElectronScaleFactorHandler::setup(){
     ePUDn, ePUUp
   };
 
+  // Histograms that are not acquired point to an empty layer
+  size_t const ilayer_empty = sftable.addLayer(ExtendedHistogram_2D_f());
+
   constexpr unsigned int n_non_gap_gap = 3;
   for (auto const& syst:allowedSysts){
-    std::vector<ExtendedHistogram_2D_f> tmpvec(n_non_gap_gap, ExtendedHistogram_2D_f());
+    std::vector<size_t> tmpvec(n_non_gap_gap, ilayer_empty);
 
     if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)){
       syst_eff_mc_reco_map[syst] = tmpvec;
@@ -80,8 +83,8 @@ bool ElectronScaleFactorHandler::setup(){
     }
     TFile* finput = TFile::Open(cinput, "read"); uppermostdir->cd();
     for (unsigned int igap=0; igap<n_non_gap_gap; igap++){
-      res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_SF_reco_map[sNominal].at(igap), finput, "EGamma_SF2D");
-      res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_eff_mc_reco_map[sNominal].at(igap), finput, "EGamma_EffMC2D");
+      res &= getHistogramLayer<TH2F>(sftable, syst_SF_reco_map[sNominal].at(igap), finput, "EGamma_SF2D");
+      res &= getHistogramLayer<TH2F>(sftable, syst_eff_mc_reco_map[sNominal].at(igap), finput, "EGamma_EffMC2D");
     }
     ScaleFactorHandlerBase::closeFile(finput); curdir->cd();
   }
@@ -130,17 +133,17 @@ bool ElectronScaleFactorHandler::setup(){
       TString str_SF_id = Form("SF_%s_passId", systname.Data());
       TString str_SF_iso_loose = Form("SF_%s_passId_passLooseIso", systname.Data());
       TString str_SF_iso_tight = Form("SF_%s_passId_passTightIso", systname.Data());
-      res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_SF_id_map[syst].at(igap), finput, str_SF_id);
-      res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_SF_iso_loose_map[syst].at(igap), finput, str_SF_iso_loose);
-      res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_SF_iso_tight_map[syst].at(igap), finput, str_SF_iso_tight);
+      res &= getHistogramLayer<TH2D>(sftable, syst_SF_id_map[syst].at(igap), finput, str_SF_id);
+      res &= getHistogramLayer<TH2D>(sftable, syst_SF_iso_loose_map[syst].at(igap), finput, str_SF_iso_loose);
+      res &= getHistogramLayer<TH2D>(sftable, syst_SF_iso_tight_map[syst].at(igap), finput, str_SF_iso_tight);
 
       if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)){
         TString str_eff_mc_id = Form("eff_MC_%s_passId", systname.Data());
         TString str_eff_mc_iso_loose = Form("eff_MC_%s_passId_passLooseIso", systname.Data());
         TString str_eff_mc_iso_tight = Form("eff_MC_%s_passId_passTightIso", systname.Data());
-        res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_eff_mc_id_map[syst].at(igap), finput, str_eff_mc_id);
-        res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_eff_mc_iso_loose_map[syst].at(igap), finput, str_eff_mc_iso_loose);
-        res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_eff_mc_iso_tight_map[syst].at(igap), finput, str_eff_mc_iso_tight);
+        res &= getHistogramLayer<TH2D>(sftable, syst_eff_mc_id_map[syst].at(igap), finput, str_eff_mc_id);
+        res &= getHistogramLayer<TH2D>(sftable, syst_eff_mc_iso_loose_map[syst].at(igap), finput, str_eff_mc_iso_loose);
+        res &= getHistogramLayer<TH2D>(sftable, syst_eff_mc_iso_tight_map[syst].at(igap), finput, str_eff_mc_iso_tight);
       }
     }
     ScaleFactorHandlerBase::closeFile(finput); curdir->cd();
@@ -149,6 +152,8 @@ bool ElectronScaleFactorHandler::setup(){
   return res;
 }
 void ElectronScaleFactorHandler::reset(){
+  sftable.reset();
+
   syst_eff_mc_reco_map.clear();
   syst_eff_mc_id_map.clear();
   syst_eff_mc_iso_loose_map.clear();
@@ -160,42 +165,7 @@ void ElectronScaleFactorHandler::reset(){
   syst_SF_iso_tight_map.clear();
 }
 
-void ElectronScaleFactorHandler::evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, float const& pt, float const& etaSC, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const{
-  TH2F const* hh = hist.getHistogram();
-  if (!hh) return;
-
-  float const abs_eta = std::abs(etaSC);
-  float const& eta_to_use = (!useAbsEta ? etaSC : abs_eta);
-
-  int ix, iy;
-  int nbinsx = hh->GetNbinsX();
-  int nbinsy = hh->GetNbinsY();
-  if (!etaOnY){
-    ix = hh->GetXaxis()->FindBin(eta_to_use);
-    iy = hh->GetYaxis()->FindBin(pt);
-  }
-  else{
-    ix = hh->GetXaxis()->FindBin(pt);
-    iy = hh->GetYaxis()->FindBin(eta_to_use);
-  }
-
-  bool out_of_bounds = false;
-  if (ix==0){ ix=1; out_of_bounds=true; }
-  else if (ix==nbinsx+1){ ix=nbinsx; out_of_bounds=true; }
-  if (iy==0){ iy=1; out_of_bounds=true; }
-  else if (iy==nbinsy+1){ iy=nbinsy; out_of_bounds=true; }
-
-  float bc = hh->GetBinContent(ix, iy);
-  float be = hh->GetBinError(ix, iy);
-  if (bc!=0.f) be /= bc;
-  if (be<0.f) be=0;
-
-  if (out_of_bounds) be *= 1.5;
-
-  theSF *= bc; theSFRelErr = sqrt(pow(theSFRelErr, 2)+pow(be, 2));
-}
-
-void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& etaSC, unsigned short const& idx_gap, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const{
+void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& etaSC, unsigned short const& idx_gap, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const{
   using namespace SystematicsHelpers;
 
   if (verbosity>=MiscUtils::DEBUG) IVYout
@@ -234,8 +204,8 @@ void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::Systematic
   else if (HelperFunctions::checkListVariable(allowedSysts, syst)) activeSysts = std::vector<SystematicVariationTypes>{ syst };
   if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Active systematics: " << activeSysts << endl;
 
-  std::vector<ExtendedHistogram_2D_f const*> hlist_eff_mc; hlist_eff_mc.reserve(kAllEffs);
-  std::vector<ExtendedHistogram_2D_f const*> hlist_SF_nominal; hlist_SF_nominal.reserve(kAllEffs);
+  std::vector<size_t const*> hlist_eff_mc; hlist_eff_mc.reserve(kAllEffs);
+  std::vector<size_t const*> hlist_SF_nominal; hlist_SF_nominal.reserve(kAllEffs);
   {
     auto it_syst_eff_mc_reco_map = syst_eff_mc_reco_map.find(sNominal); // FIXME: NEEDS TO BE REVISED IF TRACKING eff_mc IMPLEMENTATION CHANGES.
     auto it_syst_eff_mc_id_map = syst_eff_mc_id_map.find(activeSyst_eff_nominal);
@@ -291,9 +261,9 @@ void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::Systematic
       float SF_val = 1;
       if (*it_SF){
         float SF_err = 0;
-        evalScaleFactorFromHistogram(SF_val, SF_err, pt, etaSC, **it_SF, false, false);
+        sftable.evalScaleFactor(SF_val, SF_err, **it_SF, binlocs);
         float eff_err = 0;
-        evalScaleFactorFromHistogram(eff_nominal_unscaled_list.at(isel), eff_err, pt, etaSC, **it_eff_mc, false, false);
+        sftable.evalScaleFactor(eff_nominal_unscaled_list.at(isel), eff_err, **it_eff_mc, binlocs);
       }
 
       eff_nominal_unscaled_list.at(isel) = std::max(0.f, std::min(1.f, eff_nominal_unscaled_list.at(isel)));
@@ -373,8 +343,8 @@ void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::Systematic
         std::vector<float>& eff_syst_scaled_list = eff_syst_scaled_lists.at(ias);
         std::vector<float>& eff_syst_scaled_complement_list = eff_syst_scaled_complement_lists.at(ias);
 
-        std::vector<ExtendedHistogram_2D_f const*> hlist_SF; hlist_SF.reserve(n_ID_iso_types+1);
-        std::vector<ExtendedHistogram_2D_f const*> hlist_SF_cpl; hlist_SF_cpl.reserve(n_ID_iso_types+1);
+        std::vector<size_t const*> hlist_SF; hlist_SF.reserve(n_ID_iso_types+1);
+        std::vector<size_t const*> hlist_SF_cpl; hlist_SF_cpl.reserve(n_ID_iso_types+1);
         {
           auto it_syst_SF_reco_map = syst_SF_reco_map.find(sNominal);
           auto it_syst_SF_id_map = syst_SF_id_map.find(asyst);
@@ -423,13 +393,13 @@ void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::Systematic
             if (*it_SF){
               float SF_val = 1;
               float val_err = 0;
-              evalScaleFactorFromHistogram(SF_val, val_err, pt, etaSC, **it_SF, false, false);
+              sftable.evalScaleFactor(SF_val, val_err, **it_SF, binlocs);
               if (ihist>0) *it_eff_syst_scaled_val = std::max(0.f, std::min(1.f, SF_val * (*it_eff_nominal_unscaled_val)));
               else *it_eff_syst_scaled_val = std::max(0.f, std::min(1.f, (SF_val + val_err*(1.f*(asyst==eEleEffSystUp)-1.f*(asyst==eEleEffSystDn))) * (*it_eff_nominal_unscaled_val)));
 
               if (verbosity>=MiscUtils::DEBUG) IVYout
                 << "\t\t- Evaluating SF for syst " << asyst << ". SF_syst = " << SF_val << ", eff = " << *it_eff_syst_scaled_val
-                << " from histogram " << (*it_SF)->getName() << endl;
+                << " from histogram " << sftable.getLayerName(**it_SF) << endl;
             }
             else *it_eff_syst_scaled_val = *it_eff_nominal_scaled_val;
 
@@ -437,13 +407,13 @@ void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::Systematic
               if (*it_SF_cpl){
                 float SF_val = 1;
                 float val_err = 0;
-                evalScaleFactorFromHistogram(SF_val, val_err, pt, etaSC, **it_SF_cpl, false, false);
+                sftable.evalScaleFactor(SF_val, val_err, **it_SF_cpl, binlocs);
                 if (ihist>0) *it_eff_syst_scaled_cpl_val = std::max(0.f, std::min(1.f, SF_val * (*it_eff_nominal_unscaled_val)));
                 else *it_eff_syst_scaled_cpl_val = std::max(0.f, std::min(1.f, (SF_val + val_err*(1.f*(asyst==eEleEffSystUp)-1.f*(asyst==eEleEffSystDn))) * (*it_eff_nominal_unscaled_val)));
 
                 if (verbosity>=MiscUtils::DEBUG) IVYout
                   << "\t\t- Evaluating complementary SF for syst " << asyst << ". SF_syst = " << SF_val << ", eff = " << *it_eff_syst_scaled_cpl_val
-                  << " from histogram " << (*it_SF_cpl)->getName() << endl;
+                  << " from histogram " << sftable.getLayerName(**it_SF_cpl) << endl;
               }
               else *it_eff_syst_scaled_cpl_val = *it_eff_nominal_scaled_val;
 
@@ -520,21 +490,54 @@ void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::Systematic
     if (effval) IVYout << "\t- Final eff = " << eff_nominal_unscaled_val << " x " << val << " = " << *effval << endl;
   }
 }
-void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ElectronObject const* obj, float& val, float* effval) const{
-  val = 1;
-  if (effval) *effval = 1;
-
-  if (!obj) return;
-  if (!obj->extras.is_genMatched_prompt) return;
-  if (verbosity>=MiscUtils::DEBUG) IVYout << "ElectronScaleFactorHandler::getIdIsoSFAndEff: Electron gen matching flags: " << obj->extras.is_genMatched << ", " << obj->extras.is_genMatched_prompt << endl;
+void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& etaSC, unsigned short const& idx_gap, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const{
+  ScaleFactorTable::BinLocationList_t binlocs;
+  sftable.findBins(etaSC, pt, binlocs);
+  getIdIsoSFAndEff(syst, binlocs, pt, etaSC, idx_gap, passId, passLooseIso, passTightIso, val, effval);
+}
+bool ElectronScaleFactorHandler::getIdIsoFlags(ElectronObject const* obj, bool& passId, bool& passLooseIso, bool& passTightIso) const{
+  if (!obj) return false;
+  if (!obj->extras.is_genMatched_prompt) return false;
+  if (verbosity>=MiscUtils::DEBUG) IVYout << "ElectronScaleFactorHandler::getIdIsoFlags: Electron gen matching flags: " << obj->extras.is_genMatched << ", " << obj->extras.is_genMatched_prompt << endl;
 
   bool passKin = obj->testSelectionBit(ElectronSelectionHelpers::bit_preselectionTight_kin);
-  if (!passKin) return;
+  if (!passKin) return false;
 
-  bool passId = obj->testSelectionBit(ElectronSelectionHelpers::bit_preselectionTight_id);
-  bool passLooseIso = passId && obj->testSelectionBit(ElectronSelectionHelpers::kFakeableBaseIso);
-  bool passTightIso = passId && obj->testSelectionBit(ElectronSelectionHelpers::bit_preselectionTight_iso);
+  passId = obj->testSelectionBit(ElectronSelectionHelpers::bit_preselectionTight_id);
+  passLooseIso = passId && obj->testSelectionBit(ElectronSelectionHelpers::kFakeableBaseIso);
+  passTightIso = passId && obj->testSelectionBit(ElectronSelectionHelpers::bit_preselectionTight_iso);
   if (passTightIso) assert(passLooseIso);
 
+  return true;
+}
+void ElectronScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ElectronObject const* obj, float& val, float* effval) const{
+  val = 1;
+  if (effval) *effval = 1;
+
+  bool passId = false, passLooseIso = false, passTightIso = false;
+  if (!getIdIsoFlags(obj, passId, passLooseIso, passTightIso)) return;
+
   getIdIsoSFAndEff(syst, obj->pt(), obj->etaSC(), static_cast<unsigned short>(obj->isAnyGap()), passId, passLooseIso, passTightIso, val, effval);
 }
+void ElectronScaleFactorHandler::getIdIsoSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<ElectronObject*> const& objs, std::vector<float>& vals, float const& minval) const{
+  vals.assign(systs.size(), 1);
+
+  ScaleFactorTable::BinLocationList_t binlocs;
+  for (auto const& obj:objs){
+    bool passId = false, passLooseIso = false, passTightIso = false;
+    if (!getIdIsoFlags(obj, passId, passLooseIso, passTightIso)) continue;
+
+    float const pt = obj->pt();
+    float const etaSC = obj->etaSC();
+    unsigned short const idx_gap = static_cast<unsigned short>(obj->isAnyGap());
+    sftable.findBins(etaSC, pt, binlocs);
+
+    auto it_val = vals.begin();
+    for (auto const& syst:systs){
+      float theSF = 1;
+      getIdIsoSFAndEff(syst, binlocs, pt, etaSC, idx_gap, passId, passLooseIso, passTightIso, theSF, nullptr);
+      *it_val *= std::max(minval, theSF);
+      it_val++;
+    }
+  }
+}
@@ -1,5 +1,4 @@
 #include <cassert>
-#include "TRandom3.h"
 
 #include <CMS3/Dictionaries/interface/GlobalCollectionNames.h>
 
@@ -30,7 +29,10 @@ EventFilterHandler::EventFilterHandler() :
   trackTriggerObjects(false),
   checkTriggerObjectsForHLTPaths(false),
   product_passCommonSkim(true),
-  product_uniqueEvent(true)
+  product_uniqueEvent(true),
+  hltmenu_tree(nullptr),
+  hltmenu_treenumber(-1),
+  hltmenu_run(0)
 {
   // Common skim
   this->addConsumed<bool>("passCommonSkim");
@@ -50,6 +52,37 @@ void EventFilterHandler::clear(){
   product_HLTpaths.clear();
   for (auto*& prod:product_triggerobjects) delete prod;
   product_triggerobjects.clear();
+  triggerCheckInputsCache.clear();
+}
+
+void EventFilterHandler::resetHLTMenu(){
+  hltmenu_tree = nullptr;
+  hltmenu_treenumber = -1;
+  hltmenu_run = 0;
+  hltmenu_runRangeExcludedProps.clear();
+  hltmenu_hltprop_pathIndices.clear();
+  hltmenu_name_pathIndices.clear();
+}
+
+std::vector<size_t> const& EventFilterHandler::getHLTPathIndices(HLTTriggerPathProperties const* hltprop) const{
+  auto it = hltmenu_hltprop_pathIndices.find(hltprop);
+  if (it==hltmenu_hltprop_pathIndices.end()){
+    it = hltmenu_hltprop_pathIndices.emplace(hltprop, std::vector<size_t>()).first;
+    for (size_t ipath=0; ipath<product_HLTpaths.size(); ipath++){
+      if (hltprop->isSameTrigger(product_HLTpaths[ipath]->name)) it->second.push_back(ipath);
+    }
+  }
+  return it->second;
+}
+std::vector<size_t> const& EventFilterHandler::getHLTPathIndices(std::string const& name) const{
+  auto it = hltmenu_name_pathIndices.find(name);
+  if (it==hltmenu_name_pathIndices.end()){
+    it = hltmenu_name_pathIndices.emplace(name, std::vector<size_t>()).first;
+    for (size_t ipath=0; ipath<product_HLTpaths.size(); ipath++){
+      if (product_HLTpaths[ipath]->name.find(name)!=std::string::npos) it->second.push_back(ipath);
+    }
+  }
+  return it->second;
 }
 
 bool EventFilterHandler::constructFilters(SimEventHandler const* simEventHandler){
@@ -75,19 +108,19 @@ bool EventFilterHandler::constructFilters(SimEventHandler const* simEventHandler
 }
 
 bool EventFilterHandler::hasMatchingTriggerPath(std::vector<std::string> const& hltpaths_) const{
-  bool res = false;
   for (auto const& str:hltpaths_){
-    for (auto const* prod:product_HLTpaths){ if (prod->name.find(str)!=std::string::npos){ res = true; break; } }
+    if (!getHLTPathIndices(str).empty()) return true;
   }
-  return res;
+  return false;
 }
 float EventFilterHandler::getTriggerWeight(std::vector<std::string> const& hltpaths_) const{
   if (hltpaths_.empty()) return 0;
   float failRate = 1;
   bool foundAtLeastOneTrigger = false;
   for (auto const& str:hltpaths_){
-    for (auto const* prod:product_HLTpaths){
-      if (prod->isValid() && prod->name.find(str)!=std::string::npos && prod->passTrigger){
+    for (auto const& ipath:getHLTPathIndices(str)){
+      HLTTriggerPathObject const* prod = product_HLTpaths[ipath];
+      if (prod->isValid() && prod->passTrigger){
         float wgt = 1.f;
         if (prod->L1prescale>0) wgt *= static_cast<float>(prod->L1prescale);
         if (prod->HLTprescale>0) wgt *= static_cast<float>(prod->HLTprescale);
@@ -123,34 +156,60 @@ float EventFilterHandler::getTriggerWeight(
     firstPassingHLTPath, outparticles_TOmatched
   );
 }
-float EventFilterHandler::getTriggerWeight(
-  std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const& hltpathprops_,
+// Objects passed to getTriggerWeight are identified by their addresses and momenta
+template<typename T> void appendTriggerCheckSignature(std::vector<T*> const* objects, std::vector< std::pair<ParticleObject const*, ParticleObject::LorentzVector_t> >& signature){
+  if (objects){ for (auto const& obj:(*objects)) signature.emplace_back(obj, obj->p4()); }
+  signature.emplace_back(nullptr, ParticleObject::LorentzVector_t()); // Separator between collections
+}
+EventFilterHandler::TriggerCheckInputs& EventFilterHandler::getTriggerCheckInputs(
   std::vector<MuonObject*> const* muons,
   std::vector<ElectronObject*> const* electrons,
   std::vector<PhotonObject*> const* photons,
   std::vector<AK4JetObject*> const* ak4jets,
   std::vector<AK8JetObject*> const* ak8jets,
-  METObject const* pfmet,
-  HLTTriggerPathObject const** firstPassingHLTPath,
-  std::vector<ParticleObject const*>* outparticles_TOmatched
+  METObject const* pfmet
 ) const{
-  if (hltpathprops_.empty()) return 0;
-
-  std::vector<MuonObject const*> muons_trigcheck; if (muons){ muons_trigcheck.reserve(muons->size()); for (auto const& part:(*muons)){ if (ParticleSelectionHelpers::isParticleForTriggerChecking(part)) muons_trigcheck.push_back(part); } }
-  std::vector<ElectronObject const*> electrons_trigcheck; if (electrons){ electrons_trigcheck.reserve(electrons->size()); for (auto const& part:(*electrons)){ if (ParticleSelectionHelpers::isParticleForTriggerChecking(part)) electrons_trigcheck.push_back(part); } }
-  std::vector<PhotonObject const*> photons_trigcheck; if (photons){ photons_trigcheck.reserve(photons->size()); for (auto const& part:(*photons)){ if (ParticleSelectionHelpers::isParticleForTriggerChecking(part)) photons_trigcheck.push_back(part); } }
-  std::vector<AK4JetObject const*> ak4jets_trigcheck; if (ak4jets){ ak4jets_trigcheck.reserve(ak4jets->size()); for (auto const& jet:(*ak4jets)){ if (ParticleSelectionHelpers::isJetForTriggerChecking(jet)) ak4jets_trigcheck.push_back(jet); } }
-  std::vector<AK8JetObject const*> ak8jets_trigcheck; if (ak8jets){ ak8jets_trigcheck.reserve(ak8jets->size()); for (auto const& jet:(*ak8jets)){ if (ParticleSelectionHelpers::isJetForTriggerChecking(jet)) ak8jets_trigcheck.push_back(jet); } }
+  std::vector< std::pair<ParticleObject const*, ParticleObject::LorentzVector_t> > signature;
+  appendTriggerCheckSignature(muons, signature);
+  appendTriggerCheckSignature(electrons, signature);
+  appendTriggerCheckSignature(photons, signature);
+  appendTriggerCheckSignature(ak4jets, signature);
+  appendTriggerCheckSignature(ak8jets, signature);
+  ParticleObject::LorentzVector_t pfmet_p4_signature;
+  if (pfmet) pfmet_p4_signature = pfmet->p4(true, true, true, true);
+
+  for (auto& inputs:triggerCheckInputsCache){
+    if (inputs.pfmet==pfmet && inputs.pfmet_p4==pfmet_p4_signature && inputs.signature==signature) return inputs;
+  }
+
+  triggerCheckInputsCache.emplace_back();
+  TriggerCheckInputs& inputs = triggerCheckInputsCache.back();
+  inputs.signature.swap(signature);
+  inputs.pfmet = pfmet;
+
+  auto& muons_trigcheck = inputs.muons;
+  auto& electrons_trigcheck = inputs.electrons;
+  auto& photons_trigcheck = inputs.photons;
+  auto& ak4jets_trigcheck = inputs.ak4jets;
+  auto& ak8jets_trigcheck = inputs.ak8jets;
+  auto& pfmet_p4 = inputs.pfmet_p4;
+  auto& pfmet_nomus_p4 = inputs.pfmet_nomus_p4;
+  auto& ht_p4 = inputs.ht_p4;
+  auto& ht_nomus_p4 = inputs.ht_nomus_p4;
+
+  if (muons){ muons_trigcheck.reserve(muons->size()); for (auto const& part:(*muons)){ if (ParticleSelectionHelpers::isParticleForTriggerChecking(part)) muons_trigcheck.push_back(part); } }
+  if (electrons){ electrons_trigcheck.reserve(electrons->size()); for (auto const& part:(*electrons)){ if (ParticleSelectionHelpers::isParticleForTriggerChecking(part)) electrons_trigcheck.push_back(part); } }
+  if (photons){ photons_trigcheck.reserve(photons->size()); for (auto const& part:(*photons)){ if (ParticleSelectionHelpers::isParticleForTriggerChecking(part)) photons_trigcheck.push_back(part); } }
+  if (ak4jets){ ak4jets_trigcheck.reserve(ak4jets->size()); for (auto const& jet:(*ak4jets)){ if (ParticleSelectionHelpers::isJetForTriggerChecking(jet)) ak4jets_trigcheck.push_back(jet); } }
+  if (ak8jets){ ak8jets_trigcheck.reserve(ak8jets->size()); for (auto const& jet:(*ak8jets)){ if (ParticleSelectionHelpers::isJetForTriggerChecking(jet)) ak8jets_trigcheck.push_back(jet); } }
 
-  ParticleObject::LorentzVector_t pfmet_p4, pfmet_nomus_p4;
   if (pfmet){
-    pfmet_p4 = pfmet->p4(true, true, true, true);
+    pfmet_p4 = pfmet_p4_signature;
     pfmet_nomus_p4 = pfmet_p4;
     for (auto const& part:muons_trigcheck) pfmet_nomus_p4 += part->p4();
   }
 
   float ht_pt=0, ht_nomus_pt=0;
-  ParticleObject::LorentzVector_t ht_p4, ht_nomus_p4;
   for (auto const& jet:ak4jets_trigcheck){
     auto jet_p4_nomus = jet->p4_nomus_basic();
     auto const& jet_p4 = jet->p4();
@@ -164,172 +223,203 @@ float EventFilterHandler::getTriggerWeight(
   ht_p4 = ParticleObject::PolarLorentzVector_t(ht_pt, 0, 0, ht_p4.Pt());
   ht_nomus_p4 = ParticleObject::PolarLorentzVector_t(ht_nomus_pt, 0, 0, ht_nomus_p4.Pt());
 
+  return inputs;
+}
+EventFilterHandler::TriggerPathDecision const& EventFilterHandler::getTriggerPathDecision(TriggerCheckInputs& inputs, HLTTriggerPathProperties const& hltprop, size_t const& ipath) const{
+  auto const key = std::make_pair(&hltprop, ipath);
+  auto it_decision = inputs.pathDecisions.find(key);
+  if (it_decision!=inputs.pathDecisions.end()) return it_decision->second;
+
+  HLTTriggerPathObject const* prod = product_HLTpaths[ipath];
+  auto const& muons_trigcheck = inputs.muons;
+  auto const& electrons_trigcheck = inputs.electrons;
+  auto const& photons_trigcheck = inputs.photons;
+
+  std::vector<MuonObject const*> muons_trigcheck_TOmatched;
+  std::vector<ElectronObject const*> electrons_trigcheck_TOmatched;
+  std::vector<PhotonObject const*> photons_trigcheck_TOmatched;
+
+  if (checkTriggerObjectsForHLTPaths){
+    HLTTriggerPathProperties::TriggerObjectExceptionType const& TOexception = hltprop.getTOException();
+    auto const& passedTriggerObjects = prod->getPassedTriggerObjects();
+
+    bool hasTORecovery = false;
+    std::vector<TriggerObject const*> passedTriggerObjectsWithRecovery;
+    if (TOexception == HLTTriggerPathProperties::toRecoverObjectsFromFailing){
+      // Determine what to recover
+      unsigned short n_TOmuons = 0;
+      unsigned short n_TOelectrons = 0;
+      unsigned short n_TOphotons = 0;
+      for (auto const& TOobj:passedTriggerObjects){
+        if (TOobj->isTriggerObjectType(trigger::TriggerMuon)) n_TOmuons++;
+        else if (TOobj->isTriggerObjectType(trigger::TriggerElectron)) n_TOelectrons++;
+        else if (TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)){
+          n_TOelectrons++;
+          n_TOphotons++;
+        }
+      }
+      auto const& props_map = hltprop.getObjectProperties();
+      unsigned short n_TOmuons_req = (props_map.find(HLTObjectProperties::kMuon)!=props_map.end() ? props_map.find(HLTObjectProperties::kMuon)->second.size() : 0);
+      unsigned short n_TOelectrons_req = (props_map.find(HLTObjectProperties::kElectron)!=props_map.end() ? props_map.find(HLTObjectProperties::kElectron)->second.size() : 0);
+      unsigned short n_TOphotons_req = (props_map.find(HLTObjectProperties::kPhoton)!=props_map.end() ? props_map.find(HLTObjectProperties::kPhoton)->second.size() : 0);
+      bool needMuonRecovery = (n_TOmuons<n_TOmuons_req);
+      bool needElectronRecovery = (n_TOelectrons<n_TOelectrons_req);
+      bool needPhotonRecovery = (n_TOphotons<n_TOphotons_req);
+      // Add existing passing objects
+      for (auto const& TOobj:passedTriggerObjects) passedTriggerObjectsWithRecovery.push_back(TOobj);
+      // Add from failing objects
+      for (auto const& TOobj:prod->getFailedTriggerObjects()){
+        if (
+          (needMuonRecovery && TOobj->isTriggerObjectType(trigger::TriggerMuon))
+          ||
+          (needElectronRecovery && (TOobj->isTriggerObjectType(trigger::TriggerElectron) || TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)))
+          ||
+          (needPhotonRecovery && (TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)))
+          ) passedTriggerObjectsWithRecovery.push_back(TOobj);
+      }
+      hasTORecovery = true;
+    }
+
+    std::vector<TriggerObject const*> const& passedTriggerObjects_final = (!hasTORecovery ? passedTriggerObjects : passedTriggerObjectsWithRecovery);
+
+    /*
+    // Consistency check
+    unsigned short n_TOmuons = 0;
+    unsigned short n_TOelectrons = 0;
+    unsigned short n_TOphotons = 0;
+    for (auto const& TOobj:passedTriggerObjects_final){
+      if (TOobj->isTriggerObjectType(trigger::TriggerMuon)) n_TOmuons++;
+      else if (TOobj->isTriggerObjectType(trigger::TriggerElectron)) n_TOelectrons++;
+      else if (TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)){
+        n_TOelectrons++;
+        n_TOphotons++;
+      }
+    }
+    auto const& props_map = hltprop.getObjectProperties();
+    unsigned short n_TOmuons_req = (props_map.find(HLTObjectProperties::kMuon)!=props_map.end() ? props_map.find(HLTObjectProperties::kMuon)->second.size() : 0);
+    unsigned short n_TOelectrons_req = (props_map.find(HLTObjectProperties::kElectron)!=props_map.end() ? props_map.find(HLTObjectProperties::kElectron)->second.size() : 0);
+    unsigned short n_TOphotons_req = (props_map.find(HLTObjectProperties::kPhoton)!=props_map.end() ? props_map.find(HLTObjectProperties::kPhoton)->second.size() : 0);
+    if (this->verbosity>=MiscUtils::ERROR){
+      bool hasError = false;
+      if (n_TOmuons<n_TOmuons_req){
+        IVYerr << "EventFilterHandler::getTriggerWeight[" << prod->name << "]: Number of muons " << n_TOmuons << " < number of req. muons " << n_TOmuons_req << endl;
+        hasError = true;
+      }
+      if (n_TOelectrons<n_TOelectrons_req){
+        IVYerr << "EventFilterHandler::getTriggerWeight[" << prod->name << "]: Number of electrons " << n_TOelectrons << " < number of req. electrons " << n_TOelectrons_req << endl;
+        hasError = true;
+      }
+      if (n_TOphotons<n_TOphotons_req){
+        IVYerr << "EventFilterHandler::getTriggerWeight[" << prod->name << "]: Number of photons " << n_TOphotons << " < number of req. photons " << n_TOphotons_req << endl;
+        hasError = true;
+      }
+      if (hasError){
+        IVYout << "\t\t- Passing trigger objects: ";
+        for (auto const& TOobj:passedTriggerObjects){
+          IVYout << "[" << TOobj->getTriggerObjectType() << "] ( " << TOobj->pt() << ", " << TOobj->eta() << ", " << TOobj->phi() << endl;
+        }
+        IVYout << "\t\t- Failing trigger objects: ";
+        for (auto const& TOobj:prod->getFailedTriggerObjects()){
+          IVYout << "[" << TOobj->getTriggerObjectType() << "] ( " << TOobj->pt() << ", " << TOobj->eta() << ", " << TOobj->phi() << endl;
+        }
+        IVYout << "\t\t- Leptons: ";
+        for (auto const& part:muons_trigcheck){
+          IVYout << "[" << part->pdgId() << "] ( " << part->pt() << ", " << part->eta() << ", " << part->phi() << endl;
+        }
+        for (auto const& part:electrons_trigcheck){
+          IVYout << "[" << part->pdgId() << "] ( " << part->pt() << ", " << part->eta() << ", " << part->phi() << endl;
+        }
+        for (auto const& part:photons_trigcheck){
+          IVYout << "[" << part->pdgId() << "] ( " << part->pt() << ", " << part->eta() << ", " << part->phi() << endl;
+        }
+      }
+    }
+    */
+
+    if (this->verbosity>=MiscUtils::DEBUG){
+      IVYout << "EventFilterHandler::getTriggerWeight: Checking " << prod->name << " trigger objects:" << endl;
+      IVYout << "\t- Number of passed trigger objects: " << passedTriggerObjects_final.size() << endl;
+      IVYout << "\t\t- Trigger object types: ";
+      std::vector<trigger::TriggerObjectType> TOtypes;
+      for (auto const& TOobj:passedTriggerObjects_final) TOtypes.push_back(TOobj->getTriggerObjectType());
+      IVYout << TOtypes << endl;
+      IVYout << "\t- Number of muons: " << muons_trigcheck.size() << endl;
+      IVYout << "\t- Number of electrons: " << electrons_trigcheck.size() << endl;
+      IVYout << "\t- Number of photons: " << photons_trigcheck.size() << endl;
+    }
+
+    TriggerObject::getMatchedPhysicsObjects(
+      passedTriggerObjects_final, { trigger::TriggerMuon }, 0.2,
+      muons_trigcheck, muons_trigcheck_TOmatched
+    );
+    TriggerObject::getMatchedPhysicsObjects(
+      passedTriggerObjects_final, { trigger::TriggerElectron, trigger::TriggerPhoton, trigger::TriggerCluster }, 0.2,
+      electrons_trigcheck, electrons_trigcheck_TOmatched
+    );
+    TriggerObject::getMatchedPhysicsObjects(
+      passedTriggerObjects_final, { trigger::TriggerPhoton, trigger::TriggerCluster }, 0.2,
+      photons_trigcheck, photons_trigcheck_TOmatched
+    );
+
+    if (this->verbosity>=MiscUtils::DEBUG){
+      IVYout << "\t- Number of matched muons: " << muons_trigcheck_TOmatched.size() << " / " << muons_trigcheck.size() << endl;
+      IVYout << "\t- Number of matched electrons: " << electrons_trigcheck_TOmatched.size() << " / " << electrons_trigcheck.size() << endl;
+      IVYout << "\t- Number of matched photons: " << photons_trigcheck_TOmatched.size() << " / " << photons_trigcheck.size() << endl;
+    }
+  }
+
+  TriggerPathDecision& decision = inputs.pathDecisions[key];
+  decision.passCuts = hltprop.testCuts(
+    (!checkTriggerObjectsForHLTPaths ? muons_trigcheck : muons_trigcheck_TOmatched),
+    (!checkTriggerObjectsForHLTPaths ? electrons_trigcheck : electrons_trigcheck_TOmatched),
+    (!checkTriggerObjectsForHLTPaths ? photons_trigcheck : photons_trigcheck_TOmatched),
+    inputs.ak4jets,
+    inputs.ak8jets,
+    inputs.pfmet_p4,
+    inputs.pfmet_nomus_p4,
+    inputs.ht_p4,
+    inputs.ht_nomus_p4
+  );
+  if (decision.passCuts && checkTriggerObjectsForHLTPaths){
+    decision.particles_TOmatched.reserve(muons_trigcheck_TOmatched.size() + electrons_trigcheck_TOmatched.size() + photons_trigcheck_TOmatched.size());
+    for (auto const& part:muons_trigcheck_TOmatched) decision.particles_TOmatched.push_back(part);
+    for (auto const& part:electrons_trigcheck_TOmatched) decision.particles_TOmatched.push_back(part);
+    for (auto const& part:photons_trigcheck_TOmatched) decision.particles_TOmatched.push_back(part);
+  }
+  return decision;
+}
+float EventFilterHandler::getTriggerWeight(
+  std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const& hltpathprops_,
+  std::vector<MuonObject*> const* muons,
+  std::vector<ElectronObject*> const* electrons,
+  std::vector<PhotonObject*> const* photons,
+  std::vector<AK4JetObject*> const* ak4jets,
+  std::vector<AK8JetObject*> const* ak8jets,
+  METObject const* pfmet,
+  HLTTriggerPathObject const** firstPassingHLTPath,
+  std::vector<ParticleObject const*>* outparticles_TOmatched
+) const{
+  if (hltpathprops_.empty()) return 0;
+
+  TriggerCheckInputs& inputs = getTriggerCheckInputs(muons, electrons, photons, ak4jets, ak8jets, pfmet);
+
   for (auto const& enumType_props_pair:hltpathprops_){
     assert(enumType_props_pair.second != nullptr);
     auto const& hltprop = *(enumType_props_pair.second);
-    for (auto const& prod:product_HLTpaths){
-      if (prod->isValid() && prod->passTrigger && hltprop.isSameTrigger(prod->name)){
-        std::vector<MuonObject const*> muons_trigcheck_TOmatched;
-        std::vector<ElectronObject const*> electrons_trigcheck_TOmatched;
-        std::vector<PhotonObject const*> photons_trigcheck_TOmatched;
-
-        if (checkTriggerObjectsForHLTPaths){
-          HLTTriggerPathProperties::TriggerObjectExceptionType const& TOexception = hltprop.getTOException();
-          auto const& passedTriggerObjects = prod->getPassedTriggerObjects();
-
-          bool hasTORecovery = false;
-          std::vector<TriggerObject const*> passedTriggerObjectsWithRecovery;
-          if (TOexception == HLTTriggerPathProperties::toRecoverObjectsFromFailing){
-            // Determine what to recover
-            unsigned short n_TOmuons = 0;
-            unsigned short n_TOelectrons = 0;
-            unsigned short n_TOphotons = 0;
-            for (auto const& TOobj:passedTriggerObjects){
-              if (TOobj->isTriggerObjectType(trigger::TriggerMuon)) n_TOmuons++;
-              else if (TOobj->isTriggerObjectType(trigger::TriggerElectron)) n_TOelectrons++;
-              else if (TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)){
-                n_TOelectrons++;
-                n_TOphotons++;
-              }
-            }
-            auto const& props_map = hltprop.getObjectProperties();
-            unsigned short n_TOmuons_req = (props_map.find(HLTObjectProperties::kMuon)!=props_map.end() ? props_map.find(HLTObjectProperties::kMuon)->second.size() : 0);
-            unsigned short n_TOelectrons_req = (props_map.find(HLTObjectProperties::kElectron)!=props_map.end() ? props_map.find(HLTObjectProperties::kElectron)->second.size() : 0);
-            unsigned short n_TOphotons_req = (props_map.find(HLTObjectProperties::kPhoton)!=props_map.end() ? props_map.find(HLTObjectProperties::kPhoton)->second.size() : 0);
-            bool needMuonRecovery = (n_TOmuons<n_TOmuons_req);
-            bool needElectronRecovery = (n_TOelectrons<n_TOelectrons_req);
-            bool needPhotonRecovery = (n_TOphotons<n_TOphotons_req);
-            // Add existing passing objects
-            for (auto const& TOobj:passedTriggerObjects) passedTriggerObjectsWithRecovery.push_back(TOobj);
-            // Add from failing objects
-            for (auto const& TOobj:prod->getFailedTriggerObjects()){
-              if (
-                (needMuonRecovery && TOobj->isTriggerObjectType(trigger::TriggerMuon))
-                ||
-                (needElectronRecovery && (TOobj->isTriggerObjectType(trigger::TriggerElectron) || TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)))
-                ||
-                (needPhotonRecovery && (TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)))
-                ) passedTriggerObjectsWithRecovery.push_back(TOobj);
-            }
-            hasTORecovery = true;
-          }
-
-          std::vector<TriggerObject const*> const& passedTriggerObjects_final = (!hasTORecovery ? passedTriggerObjects : passedTriggerObjectsWithRecovery);
-
-          /*
-          // Consistency check
-          unsigned short n_TOmuons = 0;
-          unsigned short n_TOelectrons = 0;
-          unsigned short n_TOphotons = 0;
-          for (auto const& TOobj:passedTriggerObjects_final){
-            if (TOobj->isTriggerObjectType(trigger::TriggerMuon)) n_TOmuons++;
-            else if (TOobj->isTriggerObjectType(trigger::TriggerElectron)) n_TOelectrons++;
-            else if (TOobj->isTriggerObjectType(trigger::TriggerPhoton) || TOobj->isTriggerObjectType(trigger::TriggerCluster)){
-              n_TOelectrons++;
-              n_TOphotons++;
-            }
-          }
-          auto const& props_map = hltprop.getObjectProperties();
-          unsigned short n_TOmuons_req = (props_map.find(HLTObjectProperties::kMuon)!=props_map.end() ? props_map.find(HLTObjectProperties::kMuon)->second.size() : 0);
-          unsigned short n_TOelectrons_req = (props_map.find(HLTObjectProperties::kElectron)!=props_map.end() ? props_map.find(HLTObjectProperties::kElectron)->second.size() : 0);
-          unsigned short n_TOphotons_req = (props_map.find(HLTObjectProperties::kPhoton)!=props_map.end() ? props_map.find(HLTObjectProperties::kPhoton)->second.size() : 0);
-          if (this->verbosity>=MiscUtils::ERROR){
-            bool hasError = false;
-            if (n_TOmuons<n_TOmuons_req){
-              IVYerr << "EventFilterHandler::getTriggerWeight[" << prod->name << "]: Number of muons " << n_TOmuons << " < number of req. muons " << n_TOmuons_req << endl;
-              hasError = true;
-            }
-            if (n_TOelectrons<n_TOelectrons_req){
-              IVYerr << "EventFilterHandler::getTriggerWeight[" << prod->name << "]: Number of electrons " << n_TOelectrons << " < number of req. electrons " << n_TOelectrons_req << endl;
-              hasError = true;
-            }
-            if (n_TOphotons<n_TOphotons_req){
-              IVYerr << "EventFilterHandler::getTriggerWeight[" << prod->name << "]: Number of photons " << n_TOphotons << " < number of req. photons " << n_TOphotons_req << endl;
-              hasError = true;
-            }
-            if (hasError){
-              IVYout << "\t\t- Passing trigger objects: ";
-              for (auto const& TOobj:passedTriggerObjects){
-                IVYout << "[" << TOobj->getTriggerObjectType() << "] ( " << TOobj->pt() << ", " << TOobj->eta() << ", " << TOobj->phi() << endl;
-              }
-              IVYout << "\t\t- Failing trigger objects: ";
-              for (auto const& TOobj:prod->getFailedTriggerObjects()){
-                IVYout << "[" << TOobj->getTriggerObjectType() << "] ( " << TOobj->pt() << ", " << TOobj->eta() << ", " << TOobj->phi() << endl;
-              }
-              IVYout << "\t\t- Leptons: ";
-              for (auto const& part:muons_trigcheck){
-                IVYout << "[" << part->pdgId() << "] ( " << part->pt() << ", " << part->eta() << ", " << part->phi() << endl;
-              }
-              for (auto const& part:electrons_trigcheck){
-                IVYout << "[" << part->pdgId() << "] ( " << part->pt() << ", " << part->eta() << ", " << part->phi() << endl;
-              }
-              for (auto const& part:photons_trigcheck){
-                IVYout << "[" << part->pdgId() << "] ( " << part->pt() << ", " << part->eta() << ", " << part->phi() << endl;
-              }
-            }
-          }
-          */
-
-          if (this->verbosity>=MiscUtils::DEBUG){
-            IVYout << "EventFilterHandler::getTriggerWeight: Checking " << prod->name << " trigger objects:" << endl;
-            IVYout << "\t- Number of passed trigger objects: " << passedTriggerObjects_final.size() << endl;
-            IVYout << "\t\t- Trigger object types: ";
-            std::vector<trigger::TriggerObjectType> TOtypes;
-            for (auto const& TOobj:passedTriggerObjects_final) TOtypes.push_back(TOobj->getTriggerObjectType());
-            IVYout << TOtypes << endl;
-            IVYout << "\t- Number of muons: " << muons_trigcheck.size() << endl;
-            IVYout << "\t- Number of electrons: " << electrons_trigcheck.size() << endl;
-            IVYout << "\t- Number of photons: " << photons_trigcheck.size() << endl;
-          }
-
-          TriggerObject::getMatchedPhysicsObjects(
-            passedTriggerObjects_final, { trigger::TriggerMuon }, 0.2,
-            muons_trigcheck, muons_trigcheck_TOmatched
-          );
-          TriggerObject::getMatchedPhysicsObjects(
-            passedTriggerObjects_final, { trigger::TriggerElectron, trigger::TriggerPhoton, trigger::TriggerCluster }, 0.2,
-            electrons_trigcheck, electrons_trigcheck_TOmatched
-          );
-          TriggerObject::getMatchedPhysicsObjects(
-            passedTriggerObjects_final, { trigger::TriggerPhoton, trigger::TriggerCluster }, 0.2,
-            photons_trigcheck, photons_trigcheck_TOmatched
-          );
-
-          if (this->verbosity>=MiscUtils::DEBUG){
-            IVYout << "\t- Number of matched muons: " << muons_trigcheck_TOmatched.size() << " / " << muons_trigcheck.size() << endl;
-            IVYout << "\t- Number of matched electrons: " << electrons_trigcheck_TOmatched.size() << " / " << electrons_trigcheck.size() << endl;
-            IVYout << "\t- Number of matched photons: " << photons_trigcheck_TOmatched.size() << " / " << photons_trigcheck.size() << endl;
-          }
-        }
+    for (auto const& ipath:getHLTPathIndices(&hltprop)){
+      HLTTriggerPathObject const* prod = product_HLTpaths[ipath];
+      if (!prod->isValid() || !prod->passTrigger) continue;
 
-        if (
-          hltprop.testCuts(
-            (!checkTriggerObjectsForHLTPaths ? muons_trigcheck : muons_trigcheck_TOmatched),
-            (!checkTriggerObjectsForHLTPaths ? electrons_trigcheck : electrons_trigcheck_TOmatched),
-            (!checkTriggerObjectsForHLTPaths ? photons_trigcheck : photons_trigcheck_TOmatched),
-            ak4jets_trigcheck,
-            ak8jets_trigcheck,
-            pfmet_p4,
-            pfmet_nomus_p4,
-            ht_p4,
-            ht_nomus_p4
-          )
-          ){
-          float wgt = 1.f;
-          if (prod->L1prescale>0) wgt *= static_cast<float>(prod->L1prescale);
-          if (prod->HLTprescale>0) wgt *= static_cast<float>(prod->HLTprescale);
-          if (wgt == 0.f) continue;
-          else{
-            if (firstPassingHLTPath) *firstPassingHLTPath = prod;
-            if (outparticles_TOmatched && checkTriggerObjectsForHLTPaths){
-              outparticles_TOmatched->clear();
-              outparticles_TOmatched->reserve(muons_trigcheck_TOmatched.size() + electrons_trigcheck_TOmatched.size() + photons_trigcheck_TOmatched.size());
-              for (auto const& part:muons_trigcheck_TOmatched) outparticles_TOmatched->push_back(part);
-              for (auto const& part:electrons_trigcheck_TOmatched) outparticles_TOmatched->push_back(part);
-              for (auto const& part:photons_trigcheck_TOmatched) outparticles_TOmatched->push_back(part);
-            }
-            return wgt; // Take the first trigger that passed.
-          }
+      TriggerPathDecision const& decision = getTriggerPathDecision(inputs, hltprop, ipath);
+      if (decision.passCuts){
+        float wgt = 1.f;
+        if (prod->L1prescale>0) wgt *= static_cast<float>(prod->L1prescale);
+        if (prod->HLTprescale>0) wgt *= static_cast<float>(prod->HLTprescale);
+        if (wgt == 0.f) continue;
+        else{
+          if (firstPassingHLTPath) *firstPassingHLTPath = prod;
+          if (outparticles_TOmatched && checkTriggerObjectsForHLTPaths) *outparticles_TOmatched = decision.particles_TOmatched;
+          return wgt; // Take the first trigger that passed.
         }
       }
     }
@@ -529,6 +619,27 @@ bool EventFilterHandler::constructHLTPaths(SimEventHandler const* simEventHandle
 
   size_t n_HLTpaths = (itEnd_HLTpaths_name - itBegin_HLTpaths_name);
   product_HLTpaths.reserve(n_HLTpaths);
+
+  // Resolve the HLT menu only if the input file or the data run changes
+  {
+    TTree const* tree_selected = currentTree->getSelectedTree();
+    int const treenumber = (tree_selected ? tree_selected->GetTreeNumber() : -1);
+    unsigned int const run = (isData ? *RunNumber : 0);
+    if (tree_selected!=hltmenu_tree || treenumber!=hltmenu_treenumber || run!=hltmenu_run || n_HLTpaths!=hltmenu_runRangeExcludedProps.size()){
+      if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::constructHLTPaths: Resolving a new HLT menu with " << n_HLTpaths << " paths..." << endl;
+      resetHLTMenu();
+      hltmenu_tree = tree_selected;
+      hltmenu_treenumber = treenumber;
+      hltmenu_run = run;
+      hltmenu_runRangeExcludedProps.assign(n_HLTpaths, nullptr);
+      size_t ipath = 0;
+      for (auto it_name = itBegin_HLTpaths_name; it_name != itEnd_HLTpaths_name; it_name++){
+        TriggerHelpers::hasRunRangeExclusions(*it_name, &(hltmenu_runRangeExcludedProps.at(ipath)));
+        ipath++;
+      }
+    }
+  }
+
 #define HLTTRIGGERPATH_VARIABLE(TYPE, NAME, DEFVAL) auto it_HLTpaths_##NAME = itBegin_HLTpaths_##NAME;
   HLTTRIGGERPATH_VARIABLES;
 #undef HLTTRIGGERPATH_VARIABLE
@@ -551,10 +662,8 @@ bool EventFilterHandler::constructHLTPaths(SimEventHandler const* simEventHandle
       obj->setTriggerObjects(product_triggerobjects);
 
       bool isValid = true;
-      HLTTriggerPathProperties const* hltprop = nullptr;
-      bool hasRunRangeExclusions = checkHLTPathRunRanges && TriggerHelpers::hasRunRangeExclusions(obj->name, &hltprop);
-      if (hasRunRangeExclusions){
-        assert(hltprop!=nullptr);
+      HLTTriggerPathProperties const* hltprop = (checkHLTPathRunRanges ? hltmenu_runRangeExcludedProps[itrig] : nullptr);
+      if (hltprop){
         if (!isData && !set_RunNumber_sim){
           if (!simEventHandler){
             if (this->verbosity>=MiscUtils::ERROR) IVYerr << "EventFilterHandler::constructHLTPaths: simEventHandler is needed to determine run range exclusions!" << endl;
@@ -666,39 +775,19 @@ bool EventFilterHandler::accumulateRunLumiEventBlock(){
   }
   if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: All variables are set up!" << endl;
 
-  auto it_run = era_dataeventblock_map.find(*RunNumber);
-  if (it_run == era_dataeventblock_map.end()){
-    if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Run " << *RunNumber << " is new." << endl;
-    era_dataeventblock_map[*RunNumber] = std::unordered_map<unsigned int, std::vector<unsigned long long>>();
-    it_run = era_dataeventblock_map.find(*RunNumber);
-  }
-  else if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Run " << *RunNumber << " is already in the tracked list." << endl;
-
-  auto it_lumi = it_run->second.find(*LuminosityBlock);
-  if (it_lumi == it_run->second.end()){
-    if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Lumi. section " << *LuminosityBlock << " is new." << endl;
-    it_run->second[*LuminosityBlock] = std::vector<unsigned long long>();
-    it_lumi = it_run->second.find(*LuminosityBlock);
-  }
-  else if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Lumi. section " << *LuminosityBlock << " is already in the tracked list." << endl;
-
+  bool const isNewEvent = era_dataeventblock_set.insert(*RunNumber, *LuminosityBlock, *EventNumber);
   if (checkUniqueDataEvent){
     if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Checking if the event is unique..." << endl;
-    auto it_event = std::find(it_lumi->second.begin(), it_lumi->second.end(), *EventNumber);
-    if (it_event == it_lumi->second.end()){
-      if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Event " << *EventNumber << " is unique." << endl;
-      it_lumi->second.push_back(*EventNumber);
+    if (isNewEvent){
+      if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Event " << *RunNumber << ":" << *LuminosityBlock << ":" << *EventNumber << " is unique." << endl;
       product_uniqueEvent = true;
     }
     else{
-      if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Event " << *EventNumber << " is already covered." << endl;
+      if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: Event " << *RunNumber << ":" << *LuminosityBlock << ":" << *EventNumber << " is already covered." << endl;
       product_uniqueEvent = false;
     }
   }
-  else{
-    if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: No checking is performed for event uniquenes." << endl;
-    it_lumi->second.push_back(*EventNumber);
-  }
+  else if (this->verbosity>=MiscUtils::DEBUG) IVYout << "EventFilterHandler::accumulateRunLumiEventBlock: No checking is performed for event uniquenes." << endl;
 
   return true;
 }
@@ -773,6 +862,14 @@ std::vector<std::string> EventFilterHandler::acquireMETFilterFlags(BaseTree* int
   return res;
 }
 
+bool EventFilterHandler::wrapTree(BaseTree* tree){
+  if (!tree) return false;
+
+  resetHLTMenu();
+
+  return IvyBase::wrapTree(tree);
+}
+
 void EventFilterHandler::bookBranches(BaseTree* tree){
   if (!tree) return;
 
@@ -0,0 +1,60 @@
+#include <cstring>
+#include "EventRandomHelpers.h"
+
+
+namespace EventRandomHelpers{
+  constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+  constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+  constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+  constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+  constexpr unsigned int PHILOX_NROUNDS = 10;
+}
+
+
+void EventRandomHelpers::getRandomBits(uint32_t const (&counter)[4], uint32_t const (&key)[2], uint32_t (&res)[4]){
+  uint32_t c[4] ={ counter[0], counter[1], counter[2], counter[3] };
+  uint32_t k[2] ={ key[0], key[1] };
+  for (unsigned int iround=0; iround<PHILOX_NROUNDS; iround++){
+    if (iround>0){
+      k[0] += PHILOX_W0;
+      k[1] += PHILOX_W1;
+    }
+    uint64_t const prod0 = static_cast<uint64_t>(PHILOX_M0) * c[0];
+    uint64_t const prod1 = static_cast<uint64_t>(PHILOX_M1) * c[2];
+    uint32_t const hi0 = static_cast<uint32_t>(prod0 >> 32);
+    uint32_t const lo0 = static_cast<uint32_t>(prod0);
+    uint32_t const hi1 = static_cast<uint32_t>(prod1 >> 32);
+    uint32_t const lo1 = static_cast<uint32_t>(prod1);
+    c[0] = hi1 ^ c[1] ^ k[0];
+    c[1] = lo1;
+    c[2] = hi0 ^ c[3] ^ k[1];
+    c[3] = lo0;
+  }
+  for (unsigned int i=0; i<4; i++) res[i] = c[i];
+}
+
+double EventRandomHelpers::getUniform(
+  RandomNumberPurpose const& purpose,
+  unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber,
+  uint32_t const& salt
+){
+  uint32_t const counter[4] ={
+    static_cast<uint32_t>(EventNumber),
+    static_cast<uint32_t>(EventNumber >> 32),
+    LuminosityBlock,
+    RunNumber
+  };
+  uint32_t const key[2] ={ static_cast<uint32_t>(purpose), salt };
+  uint32_t bits[4];
+  getRandomBits(counter, key, bits);
+
+  // Take the upper 53 bits, and shift by half a step to exclude both 0 and 1
+  uint64_t const rnd = ((static_cast<uint64_t>(bits[0]) << 32) | bits[1]) >> 11;
+  return (static_cast<double>(rnd) + 0.5) / static_cast<double>(1ULL << 53);
+}
+
+uint32_t EventRandomHelpers::getFloatBits(float const& val){
+  uint32_t res = 0;
+  std::memcpy(&res, &val, sizeof(res));
+  return res;
+}
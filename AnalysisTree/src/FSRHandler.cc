@@ -6,6 +6,7 @@
 
 #include "ParticleObjectHelpers.h"
 #include "FSRHandler.h"
+#include "PFCandidateAssociationHelpers.h"
 #include "MuonSelectionHelpers.h"
 #include "ElectronSelectionHelpers.h"
 #include "ParticleSelectionHelpers.h"
@@ -142,11 +143,7 @@ bool FSRHandler::constructFSRObjects(){
 bool FSRHandler::associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const{
   if (!pfcandidates) return true;
 
-  for (auto const& pfcand:(*pfcandidates)){
-    for (auto const& part:fsrCandidates){
-      if (pfcand->extras.matched_FSRCandidate_index>=0 && (ParticleObject::UniqueId_t) pfcand->extras.matched_FSRCandidate_index == part->getUniqueIdentifier()) part->addDaughter(pfcand);
-    }
-  }
+  PFCandidateAssociationHelpers::associatePFCandidates(*pfcandidates, fsrCandidates, &PFCandidateVariables::matched_FSRCandidate_index, false);
 
   return true;
 }
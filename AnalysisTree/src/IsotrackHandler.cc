@@ -70,7 +70,7 @@ bool IsotrackHandler::constructIsotracks(std::vector<MuonObject*> const* muons,
 
       ParticleObject::LorentzVector_t momentum;
       momentum = ParticleObject::PolarLorentzVector_t(*it_pt, *it_eta, *it_phi, *it_mass); // Yes you have to do this on a separate line because CMSSW...
-      productList.push_back(new ProductType_t(*it_id, momentum));
+      productList.push_back(productArena.emplace(*it_id, momentum));
       ProductType_t*& obj = productList.back();
 
       // Set extras
@@ -117,8 +117,7 @@ bool IsotrackHandler::applyCleaning(std::vector<MuonObject*> const* muons, std::
         if (product->deltaR(part)<separation_deltaR){ doSkip=true; break; }
       }
     }
-    if (!doSkip) productList_new.push_back(product);
-    else delete product;
+    if (!doSkip) productList_new.push_back(product); // Skipped objects are released with the arena
   }
   productList = productList_new;
 
@@ -8,6 +8,7 @@
 #include "SamplesCore.h"
 #include "FSRObject.h"
 #include "JetMETHandler.h"
+#include "PFCandidateAssociationHelpers.h"
 #include "MuonSelectionHelpers.h"
 #include "ElectronSelectionHelpers.h"
 #include "PhotonSelectionHelpers.h"
@@ -85,14 +86,12 @@ JetMETHandler::JetMETHandler() :
 void JetMETHandler::clear(){
   this->resetCache();
 
-  for (auto*& prod:ak4jets) delete prod;
-  for (auto*& prod:ak4jets_masked) delete prod;
   ak4jets.clear();
   ak4jets_masked.clear();
-  for (auto*& prod:ak8jets) delete prod;
-  for (auto*& prod:ak8jets_masked) delete prod;
+  ak4jetArena.reset();
   ak8jets.clear();
   ak8jets_masked.clear();
+  ak8jetArena.reset();
   delete pfmet; pfmet=nullptr;
   delete pfpuppimet; pfpuppimet=nullptr;
 }
@@ -203,7 +202,7 @@ bool JetMETHandler::constructAK4Jets(SystematicsHelpers::SystematicVariationType
 
       ParticleObject::LorentzVector_t momentum;
       momentum = ParticleObject::PolarLorentzVector_t(*it_pt, *it_eta, *it_phi, *it_mass); // Yes you have to do this on a separate line because CMSSW...
-      ak4jets.push_back(new AK4JetObject(momentum));
+      ak4jets.push_back(ak4jetArena.emplace(momentum));
       AK4JetObject*& obj = ak4jets.back();
 
       // Set extras
@@ -297,7 +296,7 @@ bool JetMETHandler::constructAK8Jets(SystematicsHelpers::SystematicVariationType
 
       ParticleObject::LorentzVector_t momentum;
       momentum = ParticleObject::PolarLorentzVector_t(*it_pt, *it_eta, *it_phi, *it_mass); // Yes you have to do this on a separate line because CMSSW...
-      ak8jets.push_back(new AK8JetObject(momentum));
+      ak8jets.push_back(ak8jetArena.emplace(momentum));
       AK8JetObject*& obj = ak8jets.back();
 
       // Set extras
@@ -333,22 +332,8 @@ bool JetMETHandler::constructAK8Jets(SystematicsHelpers::SystematicVariationType
 bool JetMETHandler::associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const{
   if (!pfcandidates) return true;
 
-  for (auto const& part:(*pfcandidates)){
-    auto const& associated_ak4jet_indices = part->extras.matched_ak4jet_index_list;
-    for (auto const& jet:ak4jets){
-      if (HelperFunctions::checkListVariable(associated_ak4jet_indices, jet->getUniqueIdentifier())){
-        jet->addDaughter(part);
-        part->addMother(jet);
-      }
-    }
-    auto const& associated_ak8jet_indices = part->extras.matched_ak8jet_index_list;
-    for (auto const& jet:ak8jets){
-      if (HelperFunctions::checkListVariable(associated_ak8jet_indices, jet->getUniqueIdentifier())){
-        jet->addDaughter(part);
-        part->addMother(jet);
-      }
-    }
-  }
+  PFCandidateAssociationHelpers::associatePFCandidates(*pfcandidates, ak4jets, &PFCandidateVariables::matched_ak4jet_index_list);
+  PFCandidateAssociationHelpers::associatePFCandidates(*pfcandidates, ak8jets, &PFCandidateVariables::matched_ak8jet_index_list);
 
   return true;
 }
@@ -540,12 +525,17 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
     // No jets are skipped. They are modified instead.
     // Modifications are propagated to MET!
     constexpr bool applyConeVetoToStripping = true;
+    // PF candidate footprints of the particles are computed once and reused for all jets
+    PFCandidateAssociationHelpers::PFCandidateFootprintCache pfcand_footprints;
     ParticleObject::LorentzVector_t sump4_METContribution_old[4];
     ParticleObject::LorentzVector_t sump4_METContribution_new[4];
 
     // ak4 jets
     for (auto*& jet:ak4jets){
       std::vector<PFCandidateObject*> common_pfcands;
+      PFCandidateAssociationHelpers::PFCandidateMask common_pfcands_mask;
+      PFCandidateAssociationHelpers::PFCandidateMask constituents_jet;
+      PFCandidateAssociationHelpers::getConstituentMask(jet, constituents_jet);
       ParticleObject::LorentzVector_t sump4_overlaps;
       ParticleObject::LorentzVector_t sump4_overlaps_mucands;
       bool hasCorrections = false;
@@ -570,18 +560,20 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           // If an overlap element is found, it means the particle overlaps with the jet.
           if (overlapElement){
             hasCorrections = true;
-            if (!oldjet) oldjet = new AK4JetObject(*jet);
+            if (!oldjet) oldjet = ak4jetArena.emplace(*jet);
             oldjet->addDaughter(thePart);
             ParticleObject::LorentzVector_t p4_overlap = overlapElement->p4_common();
             ParticleObject::LorentzVector_t p4_overlap_mucands = overlapElement->p4_commonMuCands_goodMET();
-            std::vector<IvyParticle*> daughters_part;
-            thePart->getDeepDaughters(daughters_part, false);
-            auto const& daughters_jet = jet->getDaughters();
-            for (auto const& daughter_part:daughters_part){
-              PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter_part);
-              if (pfcand){
-                if (HelperFunctions::checkListVariable(daughters_jet, daughter_part)){
-                  if (!HelperFunctions::checkListVariable(common_pfcands, pfcand)) common_pfcands.push_back(pfcand);
+            // Overlapping PF candidates are those in both the particle footprint and the jet constituent masks
+            auto const& footprint_part = pfcand_footprints.get(thePart);
+            if (footprint_part.mask.intersects(constituents_jet)){
+              for (auto const& pfcand:footprint_part.pfcands){
+                size_t const idx_pfcand = pfcand->getUniqueIdentifier();
+                if (constituents_jet.test(idx_pfcand)){
+                  if (!common_pfcands_mask.test(idx_pfcand)){
+                    common_pfcands_mask.set(idx_pfcand);
+                    common_pfcands.push_back(pfcand);
+                  }
                   p4_overlap -= pfcand->p4();
                   if (MuonSelectionHelpers::testGoodMETPFMuon(*pfcand)) p4_overlap_mucands -= pfcand->p4();
                 }
@@ -600,7 +592,7 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           if (theFSR){
             if (HelperFunctions::checkListVariable(theFSR->extras.fsrMatch_ak4jet_index_list, jet->getUniqueIdentifier())){
               hasCorrections = true;
-              if (!oldjet) oldjet = new AK4JetObject(*jet);
+              if (!oldjet) oldjet = ak4jetArena.emplace(*jet);
               oldjet->addDaughter(theFSR);
               sump4_overlaps += theFSR->p4();
               if (this->verbosity>=MiscUtils::DEBUG) IVYout
@@ -631,18 +623,20 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           // If an overlap element is found, it means the particle overlaps with the jet.
           if (overlapElement){
             hasCorrections = true;
-            if (!oldjet) oldjet = new AK4JetObject(*jet);
+            if (!oldjet) oldjet = ak4jetArena.emplace(*jet);
             oldjet->addDaughter(thePart);
             ParticleObject::LorentzVector_t p4_overlap = overlapElement->p4_common();
             ParticleObject::LorentzVector_t p4_overlap_mucands = overlapElement->p4_commonMuCands_goodMET();
-            std::vector<IvyParticle*> daughters_part;
-            thePart->getDeepDaughters(daughters_part, false);
-            auto const& daughters_jet = jet->getDaughters();
-            for (auto const& daughter_part:daughters_part){
-              PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter_part);
-              if (pfcand){
-                if (HelperFunctions::checkListVariable(daughters_jet, daughter_part)){
-                  if (!HelperFunctions::checkListVariable(common_pfcands, pfcand)) common_pfcands.push_back(pfcand);
+            // Overlapping PF candidates are those in both the particle footprint and the jet constituent masks
+            auto const& footprint_part = pfcand_footprints.get(thePart);
+            if (footprint_part.mask.intersects(constituents_jet)){
+              for (auto const& pfcand:footprint_part.pfcands){
+                size_t const idx_pfcand = pfcand->getUniqueIdentifier();
+                if (constituents_jet.test(idx_pfcand)){
+                  if (!common_pfcands_mask.test(idx_pfcand)){
+                    common_pfcands_mask.set(idx_pfcand);
+                    common_pfcands.push_back(pfcand);
+                  }
                   p4_overlap -= pfcand->p4();
                   if (MuonSelectionHelpers::testGoodMETPFMuon(*pfcand)) p4_overlap_mucands -= pfcand->p4();
                 }
@@ -661,7 +655,7 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           if (theFSR){
             if (HelperFunctions::checkListVariable(theFSR->extras.fsrMatch_ak4jet_index_list, jet->getUniqueIdentifier())){
               hasCorrections = true;
-              if (!oldjet) oldjet = new AK4JetObject(*jet);
+              if (!oldjet) oldjet = ak4jetArena.emplace(*jet);
               oldjet->addDaughter(theFSR);
               sump4_overlaps += theFSR->p4();
               if (this->verbosity>=MiscUtils::DEBUG) IVYout
@@ -681,18 +675,20 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           // If an overlap element is found, it means the particle overlaps with the jet.
           if (overlapElement){
             hasCorrections = true;
-            if (!oldjet) oldjet = new AK4JetObject(*jet);
+            if (!oldjet) oldjet = ak4jetArena.emplace(*jet);
             oldjet->addDaughter(part);
             ParticleObject::LorentzVector_t p4_overlap = overlapElement->p4_common();
             ParticleObject::LorentzVector_t p4_overlap_mucands = overlapElement->p4_commonMuCands_goodMET();
-            std::vector<IvyParticle*> daughters_part;
-            part->getDeepDaughters(daughters_part, false);
-            auto const& daughters_jet = jet->getDaughters();
-            for (auto const& daughter_part:daughters_part){
-              PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter_part);
-              if (pfcand){
-                if (HelperFunctions::checkListVariable(daughters_jet, daughter_part)){
-                  if (!HelperFunctions::checkListVariable(common_pfcands, pfcand)) common_pfcands.push_back(pfcand);
+            // Overlapping PF candidates are those in both the particle footprint and the jet constituent masks
+            auto const& footprint_part = pfcand_footprints.get(part);
+            if (footprint_part.mask.intersects(constituents_jet)){
+              for (auto const& pfcand:footprint_part.pfcands){
+                size_t const idx_pfcand = pfcand->getUniqueIdentifier();
+                if (constituents_jet.test(idx_pfcand)){
+                  if (!common_pfcands_mask.test(idx_pfcand)){
+                    common_pfcands_mask.set(idx_pfcand);
+                    common_pfcands.push_back(pfcand);
+                  }
                   p4_overlap -= pfcand->p4();
                   if (MuonSelectionHelpers::testGoodMETPFMuon(*pfcand)) p4_overlap_mucands -= pfcand->p4();
                 }
@@ -791,6 +787,9 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
     // ak8 jets
     for (auto*& jet:ak8jets){
       std::vector<PFCandidateObject*> common_pfcands;
+      PFCandidateAssociationHelpers::PFCandidateMask common_pfcands_mask;
+      PFCandidateAssociationHelpers::PFCandidateMask constituents_jet;
+      PFCandidateAssociationHelpers::getConstituentMask(jet, constituents_jet);
       ParticleObject::LorentzVector_t sump4_overlaps;
       bool hasCorrections = false;
       AK8JetObject* oldjet = nullptr;
@@ -814,17 +813,19 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           // If an overlap element is found, it means the particle overlaps with the jet.
           if (overlapElement){
             hasCorrections = true;
-            if (!oldjet) oldjet = new AK8JetObject(*jet);
+            if (!oldjet) oldjet = ak8jetArena.emplace(*jet);
             oldjet->addDaughter(thePart);
             ParticleObject::LorentzVector_t p4_overlap = overlapElement->p4_common();
-            std::vector<IvyParticle*> daughters_part;
-            thePart->getDeepDaughters(daughters_part, false);
-            auto const& daughters_jet = jet->getDaughters();
-            for (auto const& daughter_part:daughters_part){
-              PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter_part);
-              if (pfcand){
-                if (HelperFunctions::checkListVariable(daughters_jet, daughter_part)){
-                  if (!HelperFunctions::checkListVariable(common_pfcands, pfcand)) common_pfcands.push_back(pfcand);
+            // Overlapping PF candidates are those in both the particle footprint and the jet constituent masks
+            auto const& footprint_part = pfcand_footprints.get(thePart);
+            if (footprint_part.mask.intersects(constituents_jet)){
+              for (auto const& pfcand:footprint_part.pfcands){
+                size_t const idx_pfcand = pfcand->getUniqueIdentifier();
+                if (constituents_jet.test(idx_pfcand)){
+                  if (!common_pfcands_mask.test(idx_pfcand)){
+                    common_pfcands_mask.set(idx_pfcand);
+                    common_pfcands.push_back(pfcand);
+                  }
                   p4_overlap -= pfcand->p4();
                 }
               }
@@ -834,7 +835,7 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           if (theFSR){
             if (HelperFunctions::checkListVariable(theFSR->extras.fsrMatch_ak8jet_index_list, jet->getUniqueIdentifier())){
               hasCorrections = true;
-              if (!oldjet) oldjet = new AK8JetObject(*jet);
+              if (!oldjet) oldjet = ak8jetArena.emplace(*jet);
               oldjet->addDaughter(theFSR);
               sump4_overlaps += theFSR->p4();
             }
@@ -860,17 +861,19 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           // If an overlap element is found, it means the particle overlaps with the jet.
           if (overlapElement){
             hasCorrections = true;
-            if (!oldjet) oldjet = new AK8JetObject(*jet);
+            if (!oldjet) oldjet = ak8jetArena.emplace(*jet);
             oldjet->addDaughter(thePart);
             ParticleObject::LorentzVector_t p4_overlap = overlapElement->p4_common();
-            std::vector<IvyParticle*> daughters_part;
-            thePart->getDeepDaughters(daughters_part, false);
-            auto const& daughters_jet = jet->getDaughters();
-            for (auto const& daughter_part:daughters_part){
-              PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter_part);
-              if (pfcand){
-                if (HelperFunctions::checkListVariable(daughters_jet, daughter_part)){
-                  if (!HelperFunctions::checkListVariable(common_pfcands, pfcand)) common_pfcands.push_back(pfcand);
+            // Overlapping PF candidates are those in both the particle footprint and the jet constituent masks
+            auto const& footprint_part = pfcand_footprints.get(thePart);
+            if (footprint_part.mask.intersects(constituents_jet)){
+              for (auto const& pfcand:footprint_part.pfcands){
+                size_t const idx_pfcand = pfcand->getUniqueIdentifier();
+                if (constituents_jet.test(idx_pfcand)){
+                  if (!common_pfcands_mask.test(idx_pfcand)){
+                    common_pfcands_mask.set(idx_pfcand);
+                    common_pfcands.push_back(pfcand);
+                  }
                   p4_overlap -= pfcand->p4();
                 }
               }
@@ -880,7 +883,7 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           if (theFSR){
             if (HelperFunctions::checkListVariable(theFSR->extras.fsrMatch_ak8jet_index_list, jet->getUniqueIdentifier())){
               hasCorrections = true;
-              if (!oldjet) oldjet = new AK8JetObject(*jet);
+              if (!oldjet) oldjet = ak8jetArena.emplace(*jet);
               oldjet->addDaughter(theFSR);
               sump4_overlaps += theFSR->p4();
             }
@@ -895,17 +898,19 @@ bool JetMETHandler::applyJetCleaning(bool usePFCandidates, JetMETHandler::METFix
           // If an overlap element is found, it means the particle overlaps with the jet.
           if (overlapElement){
             hasCorrections = true;
-            if (!oldjet) oldjet = new AK8JetObject(*jet);
+            if (!oldjet) oldjet = ak8jetArena.emplace(*jet);
             oldjet->addDaughter(part);
             ParticleObject::LorentzVector_t p4_overlap = overlapElement->p4_common();
-            std::vector<IvyParticle*> daughters_part;
-            part->getDeepDaughters(daughters_part, false);
-            auto const& daughters_jet = jet->getDaughters();
-            for (auto const& daughter_part:daughters_part){
-              PFCandidateObject* pfcand = dynamic_cast<PFCandidateObject*>(daughter_part);
-              if (pfcand){
-                if (HelperFunctions::checkListVariable(daughters_jet, daughter_part)){
-                  if (!HelperFunctions::checkListVariable(common_pfcands, pfcand)) common_pfcands.push_back(pfcand);
+            // Overlapping PF candidates are those in both the particle footprint and the jet constituent masks
+            auto const& footprint_part = pfcand_footprints.get(part);
+            if (footprint_part.mask.intersects(constituents_jet)){
+              for (auto const& pfcand:footprint_part.pfcands){
+                size_t const idx_pfcand = pfcand->getUniqueIdentifier();
+                if (constituents_jet.test(idx_pfcand)){
+                  if (!common_pfcands_mask.test(idx_pfcand)){
+                    common_pfcands_mask.set(idx_pfcand);
+                    common_pfcands.push_back(pfcand);
+                  }
                   p4_overlap -= pfcand->p4();
                 }
               }
@@ -1,8 +1,8 @@
 #include <cassert>
-#include "TRandom3.h"
 #include "HostHelpersCore.h"
 #include "SampleHelpersCore.h"
 #include "SamplesCore.h"
+#include "EventRandomHelpers.h"
 #include "METCorrectionHandler.h"
 #include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
 
@@ -267,11 +267,7 @@ void METCorrectionHandler::applyCorrections(
 
   double frac_x = -1;
   if (inputRndNum) frac_x = *inputRndNum;
-  else{
-    TRandom3 rand;
-    rand.SetSeed(static_cast<unsigned long long>(std::abs(std::sin(genMETPhi)*100000.)));
-    frac_x = rand.Uniform();
-  }
+  else frac_x = EventRandomHelpers::getUniform(EventRandomHelpers::kGenMETSmear, 0, 0, 0, EventRandomHelpers::getFloatBits(genMETPhi)); // Same as SimEventHandler
   ParticleObject::LorentzVector_t const genmet_p4(genMET*std::cos(genMETPhi), genMET*std::sin(genMETPhi), 0, 0);
 
   for (unsigned short iXY=0; iXY<2; iXY++){
@@ -37,7 +37,10 @@ METObject::METObject() :
   currentMETShift_p4Preserved_noJER(0, 0, 0, 0),
   currentMETShift_p4Preserved(0, 0, 0, 0),
   currentXYshift(0, 0, 0, 0),
-  particleMomentumCorrections(0, 0, 0, 0)
+  particleMomentumCorrections(0, 0, 0, 0),
+  validVariantBits(0),
+  variantPt(),
+  variantPhi()
 {}
 METObject::METObject(const METObject& other) :
   extras(other.extras),
@@ -49,7 +52,10 @@ METObject::METObject(const METObject& other) :
   currentXYshift(other.currentXYshift),
   particleMomentumCorrections(other.particleMomentumCorrections),
   currentMETCorrections(other.currentMETCorrections),
-  currentJetOverlapCorrections(other.currentJetOverlapCorrections)
+  currentJetOverlapCorrections(other.currentJetOverlapCorrections),
+  validVariantBits(other.validVariantBits),
+  variantPt(other.variantPt),
+  variantPhi(other.variantPhi)
 {}
 void METObject::swap(METObject& other){
   extras.swap(other.extras);
@@ -62,6 +68,9 @@ void METObject::swap(METObject& other){
   std::swap(particleMomentumCorrections, other.particleMomentumCorrections);
   std::swap(currentMETCorrections, other.currentMETCorrections);
   std::swap(currentJetOverlapCorrections, other.currentJetOverlapCorrections);
+  std::swap(validVariantBits, other.validVariantBits);
+  std::swap(variantPt, other.variantPt);
+  std::swap(variantPhi, other.variantPhi);
 }
 METObject& METObject::operator=(const METObject& other){
   METObject tmp(other);
@@ -73,6 +82,8 @@ METObject::~METObject(){}
 void METObject::setSystematic(SystematicsHelpers::SystematicVariationTypes const& syst){
   currentSyst = syst;
   this->setMETShifts();
+  // All variants depend on the systematic and on the values of the extras
+  validVariantBits = 0;
 }
 
 void METObject::setMETShifts(){
@@ -118,12 +129,20 @@ void METObject::setMETShifts(){
 
 void METObject::setMETCorrection(ParticleObject::LorentzVector_t const& corr, bool hasXYShifts, bool hasJERShifts, bool hasParticleShifts, bool preserveP4){
   if (currentMETCorrections.empty()) currentMETCorrections.assign(16, ParticleObject::LorentzVector_t(0, 0, 0, 0));
-  currentMETCorrections.at(8*preserveP4 + 4*hasParticleShifts + 2*hasJERShifts + 1*hasXYShifts) = corr;
+  unsigned short const ivar = getVariantIndex(hasXYShifts, hasJERShifts, hasParticleShifts, preserveP4);
+  currentMETCorrections.at(ivar) = corr;
+  invalidateVariants(1U << ivar);
 }
 
 void METObject::setJetOverlapCorrection(ParticleObject::LorentzVector_t const& corr, bool hasJERShifts, bool preserveP4){
   if (currentJetOverlapCorrections.empty()) currentJetOverlapCorrections.assign(4, ParticleObject::LorentzVector_t(0, 0, 0, 0));
   currentJetOverlapCorrections.at(2*preserveP4 + 1*hasJERShifts) = corr;
+  // Invalidate the variants with the same JER and p4 preservation flags, irrespective of XY and particle shifts
+  unsigned int variantBits = 0;
+  for (unsigned short ixy=0; ixy<2; ixy++){
+    for (unsigned short ipms=0; ipms<2; ipms++) variantBits |= (1U << getVariantIndex(ixy, hasJERShifts, ipms, preserveP4));
+  }
+  invalidateVariants(variantBits);
 }
 
 ParticleObject::LorentzVector_t const& METObject::getMETShift(bool addJERShifts, bool preserveP4) const{
@@ -139,6 +158,15 @@ ParticleObject::LorentzVector_t METObject::getJetOverlapCorrection(bool addJERSh
 }
 
 void METObject::getPtPhi(float& pt, float& phi, bool addXYShifts, bool addJERShifts, bool addParticleShifts, bool preserveP4) const{
+  unsigned short const ivar = getVariantIndex(addXYShifts, addJERShifts, addParticleShifts, preserveP4);
+  if (!((validVariantBits >> ivar) & 1U)){
+    computePtPhi(variantPt[ivar], variantPhi[ivar], addXYShifts, addJERShifts, addParticleShifts, preserveP4);
+    validVariantBits |= (1U << ivar);
+  }
+  pt = variantPt[ivar];
+  phi = variantPhi[ivar];
+}
+void METObject::computePtPhi(float& pt, float& phi, bool addXYShifts, bool addJERShifts, bool addParticleShifts, bool preserveP4) const{
   using namespace SystematicsHelpers;
 
   ParticleObject::LorentzVector_t tmp_p4;
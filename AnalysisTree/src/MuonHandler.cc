@@ -4,6 +4,7 @@
 
 #include "ParticleObjectHelpers.h"
 #include "MuonHandler.h"
+#include "PFCandidateAssociationHelpers.h"
 #include "MuonSelectionHelpers.h"
 #include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
 
@@ -53,15 +54,7 @@ bool MuonHandler::constructMuons(SystematicsHelpers::SystematicVariationTypes co
 bool MuonHandler::associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const{
   if (!pfcandidates) return true;
 
-  for (auto const& pfcand:(*pfcandidates)){
-    auto const& associated_particle_indices = pfcand->extras.matched_muon_index_list;
-    for (auto const& part:productList){
-      if (HelperFunctions::checkListVariable(associated_particle_indices, part->getUniqueIdentifier())){
-        part->addDaughter(pfcand);
-        pfcand->addMother(part);
-      }
-    }
-  }
+  PFCandidateAssociationHelpers::associatePFCandidates(*pfcandidates, productList, &PFCandidateVariables::matched_muon_index_list);
 
   return true;
 }
@@ -123,7 +116,7 @@ bool MuonHandler::constructMuonObjects(SystematicsHelpers::SystematicVariationTy
 
       ParticleObject::LorentzVector_t momentum;
       momentum = ParticleObject::PolarLorentzVector_t(*it_pt, *it_eta, *it_phi, *it_mass); // Yes you have to do this on a separate line because CMSSW...
-      productList.push_back(new MuonObject(-13*(*it_charge>0 ? 1 : -1), momentum));
+      productList.push_back(productArena.emplace(-13*(*it_charge>0 ? 1 : -1), momentum));
       MuonObject*& obj = productList.back();
 
       // Set extras
@@ -147,9 +140,6 @@ bool MuonHandler::constructMuonObjects(SystematicsHelpers::SystematicVariationTy
       // Replace momentum
       obj->makeFinalMomentum(syst);
 
-      // Set the selection bits
-      MuonSelectionHelpers::setSelectionBits(*obj);
-
       if (this->verbosity>=MiscUtils::DEBUG) IVYout << "\t- Success!" << endl;
 
       ip++;
@@ -172,6 +162,9 @@ bool MuonHandler::constructMuonObjects(SystematicsHelpers::SystematicVariationTy
   // Sort particles
   ParticleObjectHelpers::sortByGreaterPt(productList);
 
+  // Set the selection bits of the full collection at once, in the order of the sorted products
+  MuonSelectionHelpers::setSelectionBits(productList, &selectionArrays);
+
   return true;
 }
 
@@ -49,20 +49,6 @@ bool MuonScaleFactorHandler::setup(){
     ePUDn, ePUUp
   };
 
-  for (auto const& syst:allowedSysts){
-    ExtendedHistogram_2D_f tmphist;
-
-    syst_SF_id_map[syst] = tmphist;
-    syst_SF_iso_loose_map[syst] = tmphist;
-    syst_SF_iso_tight_map[syst] = tmphist;
-
-    if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)){
-      syst_eff_mc_id_map[syst] = tmphist;
-      syst_eff_mc_iso_loose_map[syst] = tmphist;
-      syst_eff_mc_iso_tight_map[syst] = tmphist;
-    }
-  }
-
   {
     TString cinput = cinput_main + "Efficiencies_mumu_id_looseIso_tightIso.root";
     if (!HostHelpers::FileReadable(cinput.Data())){
@@ -106,17 +92,17 @@ bool MuonScaleFactorHandler::setup(){
       TString str_SF_id = Form("SF_%s_passId", systname.Data());
       TString str_SF_iso_loose = Form("SF_%s_passId_passLooseIso", systname.Data());
       TString str_SF_iso_tight = Form("SF_%s_passId_passTightIso", systname.Data());
-      res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_SF_id_map[syst], finput, str_SF_id);
-      res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_SF_iso_loose_map[syst], finput, str_SF_iso_loose);
-      res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_SF_iso_tight_map[syst], finput, str_SF_iso_tight);
+      res &= getHistogramLayer<TH2D>(sftable, syst_SF_id_map[syst], finput, str_SF_id);
+      res &= getHistogramLayer<TH2D>(sftable, syst_SF_iso_loose_map[syst], finput, str_SF_iso_loose);
+      res &= getHistogramLayer<TH2D>(sftable, syst_SF_iso_tight_map[syst], finput, str_SF_iso_tight);
 
       if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)){
         TString str_eff_mc_id = Form("eff_MC_%s_passId", systname.Data());
         TString str_eff_mc_iso_loose = Form("eff_MC_%s_passId_passLooseIso", systname.Data());
         TString str_eff_mc_iso_tight = Form("eff_MC_%s_passId_passTightIso", systname.Data());
-        res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_eff_mc_id_map[syst], finput, str_eff_mc_id);
-        res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_eff_mc_iso_loose_map[syst], finput, str_eff_mc_iso_loose);
-        res &= getHistogram<TH2D, ExtendedHistogram_2D_f>(syst_eff_mc_iso_tight_map[syst], finput, str_eff_mc_iso_tight);
+        res &= getHistogramLayer<TH2D>(sftable, syst_eff_mc_id_map[syst], finput, str_eff_mc_id);
+        res &= getHistogramLayer<TH2D>(sftable, syst_eff_mc_iso_loose_map[syst], finput, str_eff_mc_iso_loose);
+        res &= getHistogramLayer<TH2D>(sftable, syst_eff_mc_iso_tight_map[syst], finput, str_eff_mc_iso_tight);
       }
     }
     ScaleFactorHandlerBase::closeFile(finput); curdir->cd();
@@ -125,6 +111,8 @@ bool MuonScaleFactorHandler::setup(){
   return res;
 }
 void MuonScaleFactorHandler::reset(){
+  sftable.reset();
+
   syst_eff_mc_id_map.clear();
   syst_eff_mc_iso_loose_map.clear();
   syst_eff_mc_iso_tight_map.clear();
@@ -134,42 +122,7 @@ void MuonScaleFactorHandler::reset(){
   syst_SF_iso_tight_map.clear();
 }
 
-void MuonScaleFactorHandler::evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const{
-  TH2F const* hh = hist.getHistogram();
-  if (!hh) return;
-
-  float const abs_eta = std::abs(eta);
-  float const& eta_to_use = (!useAbsEta ? eta : abs_eta);
-
-  int ix, iy;
-  int nbinsx = hh->GetNbinsX();
-  int nbinsy = hh->GetNbinsY();
-  if (!etaOnY){
-    ix = hh->GetXaxis()->FindBin(eta_to_use);
-    iy = hh->GetYaxis()->FindBin(pt);
-  }
-  else{
-    ix = hh->GetXaxis()->FindBin(pt);
-    iy = hh->GetYaxis()->FindBin(eta_to_use);
-  }
-
-  bool out_of_bounds = false;
-  if (ix==0){ ix=1; out_of_bounds=true; }
-  else if (ix==nbinsx+1){ ix=nbinsx; out_of_bounds=true; }
-  if (iy==0){ iy=1; out_of_bounds=true; }
-  else if (iy==nbinsy+1){ iy=nbinsy; out_of_bounds=true; }
-
-  float bc = hh->GetBinContent(ix, iy);
-  float be = hh->GetBinError(ix, iy);
-  if (bc!=0.f) be /= bc;
-  if (be<0.f) be=0;
-
-  if (out_of_bounds) be *= 1.5;
-
-  theSF *= bc; theSFRelErr = sqrt(pow(theSFRelErr, 2)+pow(be, 2));
-}
-
-void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const{
+void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& eta, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const{
   using namespace SystematicsHelpers;
 
   if (verbosity>=MiscUtils::DEBUG) IVYout
@@ -208,8 +161,8 @@ void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVari
   if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Active systematics: " << activeSysts << endl;
 
   // Obtain nominal histograms
-  std::vector<ExtendedHistogram_2D_f const*> hlist_eff_mc; hlist_eff_mc.reserve(n_ID_iso_types);
-  std::vector<ExtendedHistogram_2D_f const*> hlist_SF_nominal; hlist_SF_nominal.reserve(n_ID_iso_types);
+  std::vector<size_t const*> hlist_eff_mc; hlist_eff_mc.reserve(n_ID_iso_types);
+  std::vector<size_t const*> hlist_SF_nominal; hlist_SF_nominal.reserve(n_ID_iso_types);
   {
     auto it_syst_eff_mc_id_map = syst_eff_mc_id_map.find(activeSyst_eff_nominal);
     auto it_syst_eff_mc_iso_loose_map = syst_eff_mc_iso_loose_map.find(activeSyst_eff_nominal);
@@ -255,9 +208,9 @@ void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVari
       float SF_val = 1;
       if (*it_SF){
         float SF_err = 0;
-        evalScaleFactorFromHistogram(SF_val, SF_err, pt, eta, **it_SF, false, false);
+        sftable.evalScaleFactor(SF_val, SF_err, **it_SF, binlocs);
         float eff_err = 0;
-        evalScaleFactorFromHistogram(eff_nominal_unscaled_list.at(isel), eff_err, pt, eta, **it_eff_mc, false, false);
+        sftable.evalScaleFactor(eff_nominal_unscaled_list.at(isel), eff_err, **it_eff_mc, binlocs);
       }
 
       eff_nominal_unscaled_list.at(isel) = std::max(0.f, std::min(1.f, eff_nominal_unscaled_list.at(isel)));
@@ -332,7 +285,7 @@ void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVari
         std::vector<float>& eff_syst_scaled_list = eff_syst_scaled_lists.at(ias);
         std::vector<float>& eff_syst_scaled_complement_list = eff_syst_scaled_complement_lists.at(ias);
 
-        std::vector<ExtendedHistogram_2D_f const*> hlist_SF; hlist_SF.reserve(n_ID_iso_types);
+        std::vector<size_t const*> hlist_SF; hlist_SF.reserve(n_ID_iso_types);
         {
           auto it_syst_SF_id_map = syst_SF_id_map.find(asyst);
           auto it_syst_SF_iso_loose_map = syst_SF_iso_loose_map.find(asyst);
@@ -347,7 +300,7 @@ void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVari
         }
 
         // Get complementary syst
-        std::vector<ExtendedHistogram_2D_f const*> hlist_SF_cpl; hlist_SF_cpl.reserve(n_ID_iso_types);
+        std::vector<size_t const*> hlist_SF_cpl; hlist_SF_cpl.reserve(n_ID_iso_types);
         if (activeSysts.size() > 1){
           SystematicVariationTypes asyst_cpl = getSystComplement(asyst);
           auto it_syst_SF_id_map = syst_SF_id_map.find(asyst_cpl);
@@ -373,12 +326,12 @@ void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVari
             if (*it_SF){
               float SF_val = 1;
               float val_err = 0;
-              evalScaleFactorFromHistogram(SF_val, val_err, pt, eta, **it_SF, false, false);
+              sftable.evalScaleFactor(SF_val, val_err, **it_SF, binlocs);
               *it_eff_syst_scaled_val = std::max(0.f, std::min(1.f, SF_val * (*it_eff_nominal_unscaled_val)));
 
               if (verbosity>=MiscUtils::DEBUG) IVYout
                 << "\t\t- Evaluating SF for syst " << asyst << ". SF_syst = " << SF_val << ", eff = " << *it_eff_syst_scaled_val
-                << " from histogram " << (*it_SF)->getName() << endl;
+                << " from histogram " << sftable.getLayerName(**it_SF) << endl;
             }
             else *it_eff_syst_scaled_val = *it_eff_nominal_scaled_val;
 
@@ -386,12 +339,12 @@ void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVari
               if (*it_SF_cpl){
                 float SF_val = 1;
                 float val_err = 0;
-                evalScaleFactorFromHistogram(SF_val, val_err, pt, eta, **it_SF_cpl, false, false);
+                sftable.evalScaleFactor(SF_val, val_err, **it_SF_cpl, binlocs);
                 *it_eff_syst_scaled_cpl_val = std::max(0.f, std::min(1.f, SF_val * (*it_eff_nominal_unscaled_val)));
 
                 if (verbosity>=MiscUtils::DEBUG) IVYout
                   << "\t\t- Evaluating complementary SF for syst " << asyst << ". SF_syst = " << SF_val << ", eff = " << *it_eff_syst_scaled_cpl_val
-                  << " from histogram " << (*it_SF_cpl)->getName() << endl;
+                  << " from histogram " << sftable.getLayerName(**it_SF_cpl) << endl;
               }
               else *it_eff_syst_scaled_cpl_val = *it_eff_nominal_scaled_val;
 
@@ -461,21 +414,53 @@ void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVari
   val = SF_nominal_val + SF_err_val;
   if (effval) *effval = std::max(0.f, std::min(1.f, eff_nominal_unscaled_val*val));
 }
-void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, MuonObject const* obj, float& val, float* effval) const{
-  val = 1;
-  if (effval) *effval = 1;
-
-  if (!obj) return;
-  if (!obj->extras.is_genMatched_prompt) return;
-  if (verbosity>=MiscUtils::DEBUG) IVYout << "MuonScaleFactorHandler::getIdIsoSFAndEff: Electron gen matching flags: " << obj->extras.is_genMatched << ", " << obj->extras.is_genMatched_prompt << endl;
+void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, bool const& passId, bool const& passLooseIso, bool const& passTightIso, float& val, float* effval) const{
+  ScaleFactorTable::BinLocationList_t binlocs;
+  sftable.findBins(eta, pt, binlocs);
+  getIdIsoSFAndEff(syst, binlocs, pt, eta, passId, passLooseIso, passTightIso, val, effval);
+}
+bool MuonScaleFactorHandler::getIdIsoFlags(MuonObject const* obj, bool& passId, bool& passLooseIso, bool& passTightIso) const{
+  if (!obj) return false;
+  if (!obj->extras.is_genMatched_prompt) return false;
+  if (verbosity>=MiscUtils::DEBUG) IVYout << "MuonScaleFactorHandler::getIdIsoFlags: Muon gen matching flags: " << obj->extras.is_genMatched << ", " << obj->extras.is_genMatched_prompt << endl;
 
   bool passKin = obj->testSelectionBit(MuonSelectionHelpers::bit_preselectionTight_kin);
-  if (!passKin) return;
+  if (!passKin) return false;
 
-  bool passId = obj->testSelectionBit(MuonSelectionHelpers::bit_preselectionTight_id); // More id stuff => more flags
-  bool passLooseIso = passId && obj->testSelectionBit(MuonSelectionHelpers::kFakeableBaseIso);
-  bool passTightIso = passId && obj->testSelectionBit(MuonSelectionHelpers::bit_preselectionTight_iso);
+  passId = obj->testSelectionBit(MuonSelectionHelpers::bit_preselectionTight_id); // More id stuff => more flags
+  passLooseIso = passId && obj->testSelectionBit(MuonSelectionHelpers::kFakeableBaseIso);
+  passTightIso = passId && obj->testSelectionBit(MuonSelectionHelpers::bit_preselectionTight_iso);
   if (passTightIso) assert(passLooseIso);
 
+  return true;
+}
+void MuonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, MuonObject const* obj, float& val, float* effval) const{
+  val = 1;
+  if (effval) *effval = 1;
+
+  bool passId = false, passLooseIso = false, passTightIso = false;
+  if (!getIdIsoFlags(obj, passId, passLooseIso, passTightIso)) return;
+
   getIdIsoSFAndEff(syst, obj->pt(), obj->eta(), passId, passLooseIso, passTightIso, val, effval);
 }
+void MuonScaleFactorHandler::getIdIsoSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<MuonObject*> const& objs, std::vector<float>& vals, float const& minval) const{
+  vals.assign(systs.size(), 1);
+
+  ScaleFactorTable::BinLocationList_t binlocs;
+  for (auto const& obj:objs){
+    bool passId = false, passLooseIso = false, passTightIso = false;
+    if (!getIdIsoFlags(obj, passId, passLooseIso, passTightIso)) continue;
+
+    float const pt = obj->pt();
+    float const eta = obj->eta();
+    sftable.findBins(eta, pt, binlocs);
+
+    auto it_val = vals.begin();
+    for (auto const& syst:systs){
+      float theSF = 1;
+      getIdIsoSFAndEff(syst, binlocs, pt, eta, passId, passLooseIso, passTightIso, theSF, nullptr);
+      *it_val *= std::max(minval, theSF);
+      it_val++;
+    }
+  }
+}
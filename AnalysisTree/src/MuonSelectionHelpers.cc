@@ -16,41 +16,13 @@ namespace MuonSelectionHelpers{
   bool allowFakeableInLooseSelection = false;
   float isoThr_fakeable_trkIso = -1;
 
-  bool testPtEtaGen(MuonObject const& part);
-
-  bool testMuonSystemTime(MuonObject const& part);
-
-  bool testVetoId(MuonObject const& part);
-  bool testVetoIso(MuonObject const& part);
-  bool testVetoKin(MuonObject const& part);
-
-  bool testLooseId(MuonObject const& part);
-  bool testLooseIso(MuonObject const& part);
-  bool testLooseKin(MuonObject const& part);
-
-  bool testMediumId(MuonObject const& part);
-  bool testMediumIso(MuonObject const& part);
-  bool testMediumKin(MuonObject const& part);
-
-  bool testTightId(MuonObject const& part);
-  bool testTightIso(MuonObject const& part);
-  bool testTightKin(MuonObject const& part);
-
-  bool testSoftId(MuonObject const& part);
-  bool testSoftIso(MuonObject const& part);
-  bool testSoftKin(MuonObject const& part);
-
-  bool testProbeId(MuonObject const& part);
-  bool testProbeSTAId(MuonObject const& part);
-
-  bool testFakeableBaseIso(MuonObject const& part);
-  bool testFakeableBase(MuonObject const& part);
-  bool testFakeable(MuonObject const& part);
-
-  bool testPreselectionVeto(MuonObject const& part);
-  bool testPreselectionLoose_NoIso(MuonObject const& part);
-  bool testPreselectionLoose(MuonObject const& part);
-  bool testPreselectionTight(MuonObject const& part);
+  // Single definition of the muon selection cuts in terms of the plain per-muon inputs.
+  // Both setSelectionBits(MuonObject&) and SelectionArrays::evaluate go through this function.
+  ParticleObject::SelectionBitsType_t evaluateSelectionBits(
+    float const& pt, float const& abseta, float const& iso, float const& trkIso,
+    cms3_muon_pogselectorbits_t const& pogbits, cms3_muon_cutbasedbits_h4l_t const& h4lbits,
+    bool isProbe, bool isProbeSTA
+  );
 }
 
 
@@ -113,213 +85,178 @@ float MuonSelectionHelpers::computeIso(MuonObject const& part){
 #define ID_CUTBASED_LOOSE reco::Muon::CutBasedIdLoose
 #define ID_CUTBASED_MEDIUM reco::Muon::CutBasedIdMediumPrompt
 #define ID_CUTBASED_TIGHT reco::Muon::CutBasedIdTight
-bool MuonSelectionHelpers::testMuonSystemTime(MuonObject const& part){
-  return ((part.extras.POG_selector_bits & ID_CUTBASED_MUONTIME) == ID_CUTBASED_MUONTIME);
-}
-bool MuonSelectionHelpers::testVetoId(MuonObject const& part){
-  switch (idType_preselection){
-  case kCutBasedId_MuonPOG:
-    return ((part.extras.POG_selector_bits & ID_CUTBASED_VETO) == ID_CUTBASED_VETO);
-  case kCutBasedId_H4l:
-    return (
-      HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_Minimal) && HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_SIP3D)
-      &&
-      (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_PFID) || (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_HighPt) && part.pt()>200.f))
-      );
-  default:
-    IVYerr << "MuonSelectionHelpers::testVetoId: Id " << idType_preselection << " is not implemented!" << endl;
-    assert(0);
-    return false;
-  };
-}
-bool MuonSelectionHelpers::testLooseId(MuonObject const& part){
-  switch (idType_preselection){
-  case kCutBasedId_MuonPOG:
-    return ((part.extras.POG_selector_bits & ID_CUTBASED_LOOSE) == ID_CUTBASED_LOOSE);
-  case kCutBasedId_H4l:
-    return (
-      HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_Minimal) && HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_SIP3D)
-      &&
-      (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_PFID) || (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_HighPt) && part.pt()>200.f))
-      );
-  default:
-    IVYerr << "MuonSelectionHelpers::testLooseId: Id " << idType_preselection << " is not implemented!" << endl;
-    assert(0);
-    return false;
-  };
-}
-bool MuonSelectionHelpers::testMediumId(MuonObject const& part){
+inline ParticleObject::SelectionBitsType_t MuonSelectionHelpers::evaluateSelectionBits(
+  float const& pt, float const& abseta, float const& iso, float const& trkIso,
+  cms3_muon_pogselectorbits_t const& pogbits, cms3_muon_cutbasedbits_h4l_t const& h4lbits,
+  bool isProbe, bool isProbeSTA
+){
+  static_assert(std::numeric_limits<ParticleObject::SelectionBitsType_t>::digits >= nSelectionBits);
+  typedef ParticleObject::SelectionBitsType_t bits_t;
+
+  // Kinematics
+  bits_t res = (
+    (static_cast<bits_t>((pt>=ptThr_gen) & (abseta<etaThr_gen)) << kGenPtEta)
+    | (static_cast<bits_t>((pt>=ptThr_skim_veto) & (abseta<etaThr_skim_veto)) << kVetoKin)
+    | (static_cast<bits_t>((pt>=ptThr_skim_loose) & (abseta<etaThr_skim_loose)) << kLooseKin)
+    | (static_cast<bits_t>((pt>=ptThr_skim_medium) & (abseta<etaThr_skim_medium)) << kMediumKin)
+    | (static_cast<bits_t>((pt>=ptThr_skim_tight) & (abseta<etaThr_skim_tight)) << kTightKin)
+    | (static_cast<bits_t>((pt>=ptThr_skim_soft) & (abseta<etaThr_skim_soft)) << kSoftKin)
+    );
+
+  // Isolation
+  res |= (
+    (static_cast<bits_t>(iso<isoThr_veto) << kVetoIso)
+    | (static_cast<bits_t>(iso<isoThr_loose) << kLooseIso)
+    | (static_cast<bits_t>(iso<isoThr_medium) << kMediumIso)
+    | (static_cast<bits_t>(iso<isoThr_tight) << kTightIso)
+    | (static_cast<bits_t>(iso<isoThr_soft) << kSoftIso)
+    | (static_cast<bits_t>(iso<isoThr_fakeable) << kFakeableBaseIso)
+    );
+
+  // Ids
   switch (idType_preselection){
   case kCutBasedId_MuonPOG:
-    return ((part.extras.POG_selector_bits & ID_CUTBASED_MEDIUM) == ID_CUTBASED_MEDIUM);
-  case kCutBasedId_H4l:
-    return (
-      HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_Minimal) && HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_SIP3D)
-      &&
-      (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_PFID) || (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_HighPt) && part.pt()>200.f))
+    res |= (
+      (static_cast<bits_t>((pogbits & ID_CUTBASED_VETO) == ID_CUTBASED_VETO) << kVetoId)
+      | (static_cast<bits_t>((pogbits & ID_CUTBASED_LOOSE) == ID_CUTBASED_LOOSE) << kLooseId)
+      | (static_cast<bits_t>((pogbits & ID_CUTBASED_MEDIUM) == ID_CUTBASED_MEDIUM) << kMediumId)
+      | (static_cast<bits_t>((pogbits & ID_CUTBASED_TIGHT) == ID_CUTBASED_TIGHT) << kTightId)
       );
-  default:
-    IVYerr << "MuonSelectionHelpers::testMediumId: Id " << idType_preselection << " is not implemented!" << endl;
-    assert(0);
-    return false;
-  };
-}
-bool MuonSelectionHelpers::testTightId(MuonObject const& part){
-  switch (idType_preselection){
-  case kCutBasedId_MuonPOG:
-    return ((part.extras.POG_selector_bits & ID_CUTBASED_TIGHT) == ID_CUTBASED_TIGHT);
+    break;
   case kCutBasedId_H4l:
-    return (
-      HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_Minimal) && HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_SIP3D)
+  {
+    bits_t const idbit = static_cast<bits_t>(
+      HelperFunctions::test_bit(h4lbits, kH4lSelection_Minimal) && HelperFunctions::test_bit(h4lbits, kH4lSelection_SIP3D)
       &&
-      (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_PFID) || (HelperFunctions::test_bit(part.extras.id_cutBased_H4l_Bits, kH4lSelection_HighPt) && part.pt()>200.f))
+      (HelperFunctions::test_bit(h4lbits, kH4lSelection_PFID) || (HelperFunctions::test_bit(h4lbits, kH4lSelection_HighPt) && pt>200.f))
       );
+    res |= ((idbit << kVetoId) | (idbit << kLooseId) | (idbit << kMediumId) | (idbit << kTightId));
+    break;
+  }
   default:
-    IVYerr << "MuonSelectionHelpers::testTightId: Id " << idType_preselection << " is not implemented!" << endl;
+    IVYerr << "MuonSelectionHelpers::evaluateSelectionBits: Id " << idType_preselection << " is not implemented!" << endl;
     assert(0);
-    return false;
   };
+
+  // Timing, soft id and T&P probe flags
+  res |= (
+    (static_cast<bits_t>((pogbits & ID_CUTBASED_MUONTIME) == ID_CUTBASED_MUONTIME) << kValidMuonSystemTime)
+    | (static_cast<bits_t>((pogbits & Muon::SoftCutBasedId) == Muon::SoftCutBasedId) << kSoftId)
+    | (static_cast<bits_t>(isProbe) << kProbeId)
+    | (static_cast<bits_t>(isProbeSTA) << kProbeSTAId)
+    );
+
+  // Combinations of the bits set in the steps above
+  constexpr bits_t mask_time = (bit_preselection_time == kValidMuonSystemTime ? (static_cast<bits_t>(1) << kValidMuonSystemTime) : static_cast<bits_t>(0));
+  constexpr bits_t mask_fakeableBase = (
+    (static_cast<bits_t>(1) << bit_preselectionTight_id)
+    | (static_cast<bits_t>(1) << kFakeableBaseIso)
+    | (static_cast<bits_t>(1) << bit_preselectionTight_kin)
+    | mask_time
+    );
+  constexpr bits_t mask_preselectionVeto = (
+    (static_cast<bits_t>(1) << bit_preselectionVeto_id)
+    | (static_cast<bits_t>(1) << bit_preselectionVeto_iso)
+    | (static_cast<bits_t>(1) << bit_preselectionVeto_kin)
+    );
+  constexpr bits_t mask_preselectionLoose_NoIso = (
+    (static_cast<bits_t>(1) << bit_preselectionLoose_id)
+    | (static_cast<bits_t>(1) << bit_preselectionLoose_kin)
+    | mask_time
+    );
+  constexpr bits_t mask_preselectionLoose = (mask_preselectionLoose_NoIso | (static_cast<bits_t>(1) << bit_preselectionLoose_iso));
+  constexpr bits_t mask_preselectionTight = (
+    (static_cast<bits_t>(1) << bit_preselectionTight_id)
+    | (static_cast<bits_t>(1) << bit_preselectionTight_iso)
+    | (static_cast<bits_t>(1) << bit_preselectionTight_kin)
+    | mask_time
+    );
+  bool const isFakeableBase = ((res & mask_fakeableBase) == mask_fakeableBase);
+  bool const isFakeable = isFakeableBase & ((isoThr_fakeable_trkIso<0.f) | (trkIso<isoThr_fakeable_trkIso*pt));
+  bool const isLooseExtra = (allowFakeableInLooseSelection & isFakeable) | (allowProbeIdInLooseSelection & isProbe);
+  res |= (
+    (static_cast<bits_t>(isFakeableBase) << kFakeableBase)
+    | (static_cast<bits_t>(isFakeable) << kFakeable)
+    | (static_cast<bits_t>((res & mask_preselectionVeto) == mask_preselectionVeto) << kPreselectionVeto)
+    | (static_cast<bits_t>(((res & mask_preselectionLoose_NoIso) == mask_preselectionLoose_NoIso) | isLooseExtra) << kPreselectionLoose_NoIso)
+    | (static_cast<bits_t>(((res & mask_preselectionLoose) == mask_preselectionLoose) | isLooseExtra) << kPreselectionLoose)
+    | (static_cast<bits_t>((res & mask_preselectionTight) == mask_preselectionTight) << kPreselectionTight)
+    );
+
+  return res;
 }
-bool MuonSelectionHelpers::testSoftId(MuonObject const& part){ return ((part.extras.POG_selector_bits & Muon::SoftCutBasedId) == Muon::SoftCutBasedId); }
+#undef ID_CUTBASED_MUONTIME
 #undef ID_CUTBASED_VETO
 #undef ID_CUTBASED_LOOSE
 #undef ID_CUTBASED_MEDIUM
 #undef ID_CUTBASED_TIGHT
 
-bool MuonSelectionHelpers::testVetoIso(MuonObject const& part){ return (computeIso(part)<isoThr_veto); }
-bool MuonSelectionHelpers::testLooseIso(MuonObject const& part){ return (computeIso(part)<isoThr_loose); }
-bool MuonSelectionHelpers::testMediumIso(MuonObject const& part){ return (computeIso(part)<isoThr_medium); }
-bool MuonSelectionHelpers::testTightIso(MuonObject const& part){ return (computeIso(part)<isoThr_tight); }
-bool MuonSelectionHelpers::testSoftIso(MuonObject const& part){ return (computeIso(part)<isoThr_soft); }
-bool MuonSelectionHelpers::testFakeableBaseIso(MuonObject const& part){ return (computeIso(part)<isoThr_fakeable); }
-
-bool MuonSelectionHelpers::testVetoKin(MuonObject const& part){
-  return (part.pt()>=ptThr_skim_veto && std::abs(part.eta())<etaThr_skim_veto);
-}
-bool MuonSelectionHelpers::testLooseKin(MuonObject const& part){
-  return (part.pt()>=ptThr_skim_loose && std::abs(part.eta())<etaThr_skim_loose);
-}
-bool MuonSelectionHelpers::testMediumKin(MuonObject const& part){
-  return (part.pt()>=ptThr_skim_medium && std::abs(part.eta())<etaThr_skim_medium);
-}
-bool MuonSelectionHelpers::testTightKin(MuonObject const& part){
-  return (part.pt()>=ptThr_skim_tight && std::abs(part.eta())<etaThr_skim_tight);
+void MuonSelectionHelpers::setSelectionBits(MuonObject& part){
+  ParticleObject::SelectionBitsType_t const bits = evaluateSelectionBits(
+    part.pt(), std::abs(part.eta()), computeIso(part), part.extras.trkIso03_trackerSumPt,
+    part.extras.POG_selector_bits, part.extras.id_cutBased_H4l_Bits,
+    part.extras.is_probeForTnP, part.extras.is_probeForTnP_STA
+  );
+  for (unsigned int ibit=0; ibit<nSelectionBits; ibit++) part.setSelectionBit(ibit, HelperFunctions::test_bit(bits, ibit));
 }
-bool MuonSelectionHelpers::testSoftKin(MuonObject const& part){ return (part.pt()>=ptThr_skim_soft && std::abs(part.eta())<etaThr_skim_soft); }
-
-bool MuonSelectionHelpers::testProbeId(MuonObject const& part){ return part.extras.is_probeForTnP; }
-bool MuonSelectionHelpers::testProbeSTAId(MuonObject const& part){ return part.extras.is_probeForTnP_STA; }
 
-bool MuonSelectionHelpers::testPtEtaGen(MuonObject const& part){
-  return (part.pt()>=ptThr_gen && std::abs(part.eta())<etaThr_gen);
-}
-bool MuonSelectionHelpers::testFakeableBase(MuonObject const& part){
-  return (
-    part.testSelectionBit(bit_preselectionTight_id)
-    &&
-    part.testSelectionBit(kFakeableBaseIso)
-    &&
-    part.testSelectionBit(bit_preselectionTight_kin)
-    &&
-    (bit_preselection_time != kValidMuonSystemTime || part.testSelectionBit(bit_preselection_time))
-    );
-}
-bool MuonSelectionHelpers::testFakeable(MuonObject const& part){
-  return (
-    part.testSelectionBit(kFakeableBase)
-    &&
-    (isoThr_fakeable_trkIso<0.f || part.extras.trkIso03_trackerSumPt<isoThr_fakeable_trkIso*part.pt())
-    );
-}
-bool MuonSelectionHelpers::testPreselectionVeto(MuonObject const& part){
-  return (
-    part.testSelectionBit(bit_preselectionVeto_id)
-    &&
-    part.testSelectionBit(bit_preselectionVeto_iso)
-    &&
-    part.testSelectionBit(bit_preselectionVeto_kin)
-    );
+void MuonSelectionHelpers::SelectionArrays::fill(std::vector<MuonObject*> const& parts){
+  size_t const n = parts.size();
+  pt.resize(n);
+  abseta.resize(n);
+  iso.resize(n);
+  trkIso.resize(n);
+  POG_selector_bits.resize(n);
+  id_cutBased_H4l_Bits.resize(n);
+  is_probeForTnP.resize(n);
+  is_probeForTnP_STA.resize(n);
+  for (size_t i=0; i<n; i++){
+    MuonObject const& part = *(parts[i]);
+    pt[i] = part.pt();
+    abseta[i] = std::abs(part.eta());
+    iso[i] = computeIso(part);
+    trkIso[i] = part.extras.trkIso03_trackerSumPt;
+    POG_selector_bits[i] = part.extras.POG_selector_bits;
+    id_cutBased_H4l_Bits[i] = part.extras.id_cutBased_H4l_Bits;
+    is_probeForTnP[i] = part.extras.is_probeForTnP;
+    is_probeForTnP_STA[i] = part.extras.is_probeForTnP_STA;
+  }
 }
-bool MuonSelectionHelpers::testPreselectionLoose_NoIso(MuonObject const& part){
-  bool const isProbe = (!allowProbeIdInLooseSelection ? false : part.testSelectionBit(kProbeId));
-  bool const isFakeable = (!allowFakeableInLooseSelection ? false : part.testSelectionBit(kFakeable));
-  return (
-    part.testSelectionBit(bit_preselectionLoose_id)
-    &&
-    part.testSelectionBit(bit_preselectionLoose_kin)
-    &&
-    (bit_preselection_time != kValidMuonSystemTime || part.testSelectionBit(bit_preselection_time))
-    )
-    ||
-    isFakeable
-    ||
-    isProbe;
+void MuonSelectionHelpers::SelectionArrays::evaluate(){
+  size_t const n = pt.size();
+  selectionBits.resize(n);
+  for (size_t i=0; i<n; i++) selectionBits[i] = evaluateSelectionBits(
+    pt[i], abseta[i], iso[i], trkIso[i],
+    POG_selector_bits[i], id_cutBased_H4l_Bits[i],
+    is_probeForTnP[i]!=0, is_probeForTnP_STA[i]!=0
+  );
 }
-bool MuonSelectionHelpers::testPreselectionLoose(MuonObject const& part){
-  bool const isProbe = (!allowProbeIdInLooseSelection ? false : part.testSelectionBit(kProbeId));
-  bool const isFakeable = (!allowFakeableInLooseSelection ? false : part.testSelectionBit(kFakeable));
-  return (
-    part.testSelectionBit(bit_preselectionLoose_id)
-    &&
-    part.testSelectionBit(bit_preselectionLoose_iso)
-    &&
-    part.testSelectionBit(bit_preselectionLoose_kin)
-    &&
-    (bit_preselection_time != kValidMuonSystemTime || part.testSelectionBit(bit_preselection_time))
-    )
-    ||
-    isFakeable
-    ||
-    isProbe;
+void MuonSelectionHelpers::SelectionArrays::assign(std::vector<MuonObject*>& parts) const{
+  size_t const n = parts.size();
+  if (n!=selectionBits.size()){
+    IVYerr << "MuonSelectionHelpers::SelectionArrays::assign: The number of muons (" << n << ") is not the same as the number of evaluated bit masks (" << selectionBits.size() << ")." << endl;
+    assert(0);
+  }
+  for (size_t i=0; i<n; i++){
+    ParticleObject::SelectionBitsType_t const& bits = selectionBits[i];
+    for (unsigned int ibit=0; ibit<nSelectionBits; ibit++) parts[i]->setSelectionBit(ibit, HelperFunctions::test_bit(bits, ibit));
+  }
 }
-bool MuonSelectionHelpers::testPreselectionTight(MuonObject const& part){
-  return (
-    part.testSelectionBit(bit_preselectionTight_id)
-    &&
-    part.testSelectionBit(bit_preselectionTight_iso)
-    &&
-    part.testSelectionBit(bit_preselectionTight_kin)
-    &&
-    (bit_preselection_time != kValidMuonSystemTime || part.testSelectionBit(bit_preselection_time))
-    );
+void MuonSelectionHelpers::SelectionArrays::clear(){
+  pt.clear();
+  abseta.clear();
+  iso.clear();
+  trkIso.clear();
+  POG_selector_bits.clear();
+  id_cutBased_H4l_Bits.clear();
+  is_probeForTnP.clear();
+  is_probeForTnP_STA.clear();
+  selectionBits.clear();
 }
-void MuonSelectionHelpers::setSelectionBits(MuonObject& part){
-  static_assert(std::numeric_limits<ParticleObject::SelectionBitsType_t>::digits >= nSelectionBits);
-
-  part.setSelectionBit(kGenPtEta, testPtEtaGen(part));
-
-  part.setSelectionBit(kValidMuonSystemTime, testMuonSystemTime(part));
-
-  part.setSelectionBit(kVetoId, testVetoId(part));
-  part.setSelectionBit(kVetoIso, testVetoIso(part));
-  part.setSelectionBit(kVetoKin, testVetoKin(part));
-
-  part.setSelectionBit(kLooseId, testLooseId(part));
-  part.setSelectionBit(kLooseIso, testLooseIso(part));
-  part.setSelectionBit(kLooseKin, testLooseKin(part));
-
-  part.setSelectionBit(kMediumId, testMediumId(part));
-  part.setSelectionBit(kMediumIso, testMediumIso(part));
-  part.setSelectionBit(kMediumKin, testMediumKin(part));
-
-  part.setSelectionBit(kTightId, testTightId(part));
-  part.setSelectionBit(kTightIso, testTightIso(part));
-  part.setSelectionBit(kTightKin, testTightKin(part));
-
-  part.setSelectionBit(kSoftId, testSoftId(part));
-  part.setSelectionBit(kSoftIso, testSoftIso(part));
-  part.setSelectionBit(kSoftKin, testSoftKin(part));
-
-  part.setSelectionBit(kProbeId, testProbeId(part));
-  part.setSelectionBit(kProbeSTAId, testProbeSTAId(part));
-
-  part.setSelectionBit(kFakeableBaseIso, testFakeableBaseIso(part));
-
-  // The functions below test the bits set in the steps above.
-  part.setSelectionBit(kFakeableBase, testFakeableBase(part));
-  part.setSelectionBit(kFakeable, testFakeable(part));
-  part.setSelectionBit(kPreselectionVeto, testPreselectionVeto(part));
-  part.setSelectionBit(kPreselectionLoose_NoIso, testPreselectionLoose_NoIso(part));
-  part.setSelectionBit(kPreselectionLoose, testPreselectionLoose(part));
-  part.setSelectionBit(kPreselectionTight, testPreselectionTight(part));
+void MuonSelectionHelpers::setSelectionBits(std::vector<MuonObject*>& parts, MuonSelectionHelpers::SelectionArrays* arrays){
+  SelectionArrays tmp_arrays;
+  SelectionArrays& sel_arrays = (arrays ? *arrays : tmp_arrays);
+  sel_arrays.fill(parts);
+  sel_arrays.evaluate();
+  sel_arrays.assign(parts);
 }
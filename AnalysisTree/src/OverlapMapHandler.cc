@@ -12,7 +12,9 @@ using namespace IvyStreamHelpers;
 
 template<> const std::string OverlapMapHandler<MuonObject, AK4JetObject>::colName = GlobalCollectionNames::colName_overlapMap + "_" + GlobalCollectionNames::colName_muons + "_" + GlobalCollectionNames::colName_ak4jets;
 template<> OverlapMapHandler<MuonObject, AK4JetObject>::OverlapMapHandler() :
-  IvyBase()
+  IvyBase(),
+  nIndices_first(0),
+  nIndices_second(0)
 {
 #define OVERLAPMAP_VARIABLE(TYPE, NAME, DEFVAL) this->addConsumed<std::vector<TYPE>*>(this->colName + "_" + #NAME);
   OVERLAPMAP_MUONS_JETS_VARIABLES;
@@ -75,13 +77,17 @@ template<> bool OverlapMapHandler<MuonObject, AK4JetObject>::constructOverlapMap
     }
   }
 
+  buildProductIndexTable();
+
   this->cacheEvent();
   return true;
 }
 
 template<> const std::string OverlapMapHandler<MuonObject, AK8JetObject>::colName = GlobalCollectionNames::colName_overlapMap + "_" + GlobalCollectionNames::colName_muons + "_" + GlobalCollectionNames::colName_ak8jets;
 template<> OverlapMapHandler<MuonObject, AK8JetObject>::OverlapMapHandler() :
-  IvyBase()
+  IvyBase(),
+  nIndices_first(0),
+  nIndices_second(0)
 {
 #define OVERLAPMAP_VARIABLE(TYPE, NAME, DEFVAL) this->addConsumed<std::vector<TYPE>*>(this->colName + "_" + #NAME);
   OVERLAPMAP_MUONS_JETS_VARIABLES;
@@ -144,13 +150,17 @@ template<> bool OverlapMapHandler<MuonObject, AK8JetObject>::constructOverlapMap
     }
   }
 
+  buildProductIndexTable();
+
   this->cacheEvent();
   return true;
 }
 
 template<> const std::string OverlapMapHandler<ElectronObject, AK4JetObject>::colName = GlobalCollectionNames::colName_overlapMap + "_" + GlobalCollectionNames::colName_electrons + "_" + GlobalCollectionNames::colName_ak4jets;
 template<> OverlapMapHandler<ElectronObject, AK4JetObject>::OverlapMapHandler() :
-  IvyBase()
+  IvyBase(),
+  nIndices_first(0),
+  nIndices_second(0)
 {
 #define OVERLAPMAP_VARIABLE(TYPE, NAME, DEFVAL) this->addConsumed<std::vector<TYPE>*>(this->colName + "_" + #NAME);
   OVERLAPMAP_ELECTRONS_AK4JETS_VARIABLES;
@@ -213,13 +223,17 @@ template<> bool OverlapMapHandler<ElectronObject, AK4JetObject>::constructOverla
     }
   }
 
+  buildProductIndexTable();
+
   this->cacheEvent();
   return true;
 }
 
 template<> const std::string OverlapMapHandler<ElectronObject, AK8JetObject>::colName = GlobalCollectionNames::colName_overlapMap + "_" + GlobalCollectionNames::colName_electrons + "_" + GlobalCollectionNames::colName_ak8jets;
 template<> OverlapMapHandler<ElectronObject, AK8JetObject>::OverlapMapHandler() :
-  IvyBase()
+  IvyBase(),
+  nIndices_first(0),
+  nIndices_second(0)
 {
 #define OVERLAPMAP_VARIABLE(TYPE, NAME, DEFVAL) this->addConsumed<std::vector<TYPE>*>(this->colName + "_" + #NAME);
   OVERLAPMAP_ELECTRONS_AK8JETS_VARIABLES;
@@ -282,13 +296,17 @@ template<> bool OverlapMapHandler<ElectronObject, AK8JetObject>::constructOverla
     }
   }
 
+  buildProductIndexTable();
+
   this->cacheEvent();
   return true;
 }
 
 template<> const std::string OverlapMapHandler<PhotonObject, AK4JetObject>::colName = GlobalCollectionNames::colName_overlapMap + "_" + GlobalCollectionNames::colName_photons + "_" + GlobalCollectionNames::colName_ak4jets;
 template<> OverlapMapHandler<PhotonObject, AK4JetObject>::OverlapMapHandler() :
-  IvyBase()
+  IvyBase(),
+  nIndices_first(0),
+  nIndices_second(0)
 {
 #define OVERLAPMAP_VARIABLE(TYPE, NAME, DEFVAL) this->addConsumed<std::vector<TYPE>*>(this->colName + "_" + #NAME);
   OVERLAPMAP_PHOTONS_AK4JETS_VARIABLES;
@@ -351,13 +369,17 @@ template<> bool OverlapMapHandler<PhotonObject, AK4JetObject>::constructOverlapM
     }
   }
 
+  buildProductIndexTable();
+
   this->cacheEvent();
   return true;
 }
 
 template<> const std::string OverlapMapHandler<PhotonObject, AK8JetObject>::colName = GlobalCollectionNames::colName_overlapMap + "_" + GlobalCollectionNames::colName_photons + "_" + GlobalCollectionNames::colName_ak8jets;
 template<> OverlapMapHandler<PhotonObject, AK8JetObject>::OverlapMapHandler() :
-  IvyBase()
+  IvyBase(),
+  nIndices_first(0),
+  nIndices_second(0)
 {
 #define OVERLAPMAP_VARIABLE(TYPE, NAME, DEFVAL) this->addConsumed<std::vector<TYPE>*>(this->colName + "_" + #NAME);
   OVERLAPMAP_PHOTONS_AK8JETS_VARIABLES;
@@ -420,6 +442,8 @@ template<> bool OverlapMapHandler<PhotonObject, AK8JetObject>::constructOverlapM
     }
   }
 
+  buildProductIndexTable();
+
   this->cacheEvent();
   return true;
 }
@@ -55,8 +55,11 @@ bool PUJetIdScaleFactorHandler::setup(){
     ePUDn, ePUUp
   };
 
+  // Histograms that are not acquired point to an empty layer
+  size_t const ilayer_empty = sftable.addLayer(ExtendedHistogram_2D_f());
+
   for (auto const& syst:allowedSysts){
-    std::vector<ExtendedHistogram_2D_f> tmplist(pujetidwpnames.size(), ExtendedHistogram_2D_f());
+    std::vector<size_t> tmplist(pujetidwpnames.size(), ilayer_empty);
 
     syst_pujetidwp_effs_map_mistagged[syst] = tmplist;
     syst_pujetidwp_effs_map_matched[syst] = tmplist;
@@ -79,9 +82,9 @@ bool PUJetIdScaleFactorHandler::setup(){
       for (auto const& pujetidwpname:pujetidwpnames){
         TString hname;
         hname = Form("%s_%s_%s", pujetidwpname.Data(), strmatches.front().Data(), systname.Data());
-        res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_pujetidwp_effs_map_mistagged[syst].at(iwp), finput, hname);
+        res &= getHistogramLayer<TH2F>(sftable, syst_pujetidwp_effs_map_mistagged[syst].at(iwp), finput, hname);
         hname = Form("%s_%s_%s", pujetidwpname.Data(), strmatches.back().Data(), systname.Data());
-        res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_pujetidwp_effs_map_matched[syst].at(iwp), finput, hname);
+        res &= getHistogramLayer<TH2F>(sftable, syst_pujetidwp_effs_map_matched[syst].at(iwp), finput, hname);
         iwp++;
       }
     }
@@ -103,8 +106,8 @@ bool PUJetIdScaleFactorHandler::setup(){
         HelperFunctions::replaceString<TString, const char*>(pujetidwpsfname, "<YEAR>", (const char*) Form("%i", SampleHelpers::getDataYear()));
         TString strmistagged = pujetidwpsfname; HelperFunctions::replaceString<TString, const char*>(strmistagged, "<EFFMISTAG>", "mistag");
         TString strmatched = pujetidwpsfname; HelperFunctions::replaceString<TString, const char*>(strmatched, "<EFFMISTAG>", "eff");
-        res &= getHistogramWithUncertainy<TH2F, ExtendedHistogram_2D_f>(pujetidwp_SFs_map_mistagged.at(iwp), finput, strmistagged, strmistagged+"_Systuncty");
-        res &= getHistogramWithUncertainy<TH2F, ExtendedHistogram_2D_f>(pujetidwp_SFs_map_matched.at(iwp), finput, strmatched, strmatched+"_Systuncty");
+        res &= getHistogramWithUncertainyLayer<TH2F>(sftable, pujetidwp_SFs_map_mistagged.at(iwp), finput, strmistagged, strmistagged+"_Systuncty");
+        res &= getHistogramWithUncertainyLayer<TH2F>(sftable, pujetidwp_SFs_map_matched.at(iwp), finput, strmatched, strmatched+"_Systuncty");
         iwp++;
       }
     }
@@ -114,6 +117,8 @@ bool PUJetIdScaleFactorHandler::setup(){
   return res;
 }
 void PUJetIdScaleFactorHandler::reset(){
+  sftable.reset();
+
   syst_pujetidwp_effs_map_mistagged.clear();
   syst_pujetidwp_effs_map_matched.clear();
 
@@ -121,42 +126,7 @@ void PUJetIdScaleFactorHandler::reset(){
   pujetidwp_SFs_map_matched.clear();
 }
 
-void PUJetIdScaleFactorHandler::evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const{
-  TH2F const* hh = hist.getHistogram();
-  if (!hh) return;
-
-  float const abs_eta = std::abs(eta);
-  float const& eta_to_use = (!useAbsEta ? eta : abs_eta);
-
-  int ix, iy;
-  int nbinsx = hh->GetNbinsX();
-  int nbinsy = hh->GetNbinsY();
-  if (!etaOnY){
-    ix = hh->GetXaxis()->FindBin(eta_to_use);
-    iy = hh->GetYaxis()->FindBin(pt);
-  }
-  else{
-    ix = hh->GetXaxis()->FindBin(pt);
-    iy = hh->GetYaxis()->FindBin(eta_to_use);
-  }
-
-  bool out_of_bounds = false;
-  if (ix==0){ ix=1; out_of_bounds=true; }
-  else if (ix==nbinsx+1){ ix=nbinsx; out_of_bounds=true; }
-  if (iy==0){ iy=1; out_of_bounds=true; }
-  else if (iy==nbinsy+1){ iy=nbinsy; out_of_bounds=true; }
-
-  float bc = hh->GetBinContent(ix, iy);
-  float be = hh->GetBinError(ix, iy);
-  if (bc!=0.f) be /= bc;
-  if (be<0.f) be=0;
-
-  if (out_of_bounds) be *= 1.5;
-
-  theSF *= bc; theSFRelErr = sqrt(pow(theSFRelErr, 2)+pow(be, 2));
-}
-
-void PUJetIdScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, bool const& isMatched, bool const& isLoose, bool const& isMedium, bool const& isTight, float& val, float* effval) const{
+void PUJetIdScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, float const& pt, float const& eta, bool const& isMatched, bool const& isLoose, bool const& isMedium, bool const& isTight, float& val, float* effval) const{
   using namespace SystematicsHelpers;
 
   if (verbosity>=MiscUtils::DEBUG) IVYout
@@ -183,8 +153,8 @@ void PUJetIdScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariat
   if (HelperFunctions::checkListVariable(allowedSysts, syst)) activeSyst = syst;
   if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Active systematic: " << activeSyst << endl;
 
-  std::vector<ExtendedHistogram_2D_f> const& hlist_eff_MC = (isMatched ? syst_pujetidwp_effs_map_matched.find(activeSyst)->second : syst_pujetidwp_effs_map_mistagged.find(activeSyst)->second);
-  std::vector<ExtendedHistogram_2D_f> const& hlist_SF = (isMatched ? pujetidwp_SFs_map_matched : pujetidwp_SFs_map_mistagged);
+  std::vector<size_t> const& hlist_eff_MC = (isMatched ? syst_pujetidwp_effs_map_matched.find(activeSyst)->second : syst_pujetidwp_effs_map_mistagged.find(activeSyst)->second);
+  std::vector<size_t> const& hlist_SF = (isMatched ? pujetidwp_SFs_map_matched : pujetidwp_SFs_map_mistagged);
 
   std::vector<float> eff_vals_uncorrected(hlist_eff_MC.size(), 1);
   std::vector<float> SF_vals(hlist_SF.size(), 1);
@@ -197,8 +167,8 @@ void PUJetIdScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariat
       float eff_err = 0;
       float SF_err = 0;
 
-      evalScaleFactorFromHistogram(*it_eff_val, eff_err, pt, eta, *it_eff_hist, true, false);
-      evalScaleFactorFromHistogram(*it_SF_val, SF_err, pt, eta, *it_SF_hist, true, false);
+      sftable.evalScaleFactor(*it_eff_val, eff_err, *it_eff_hist, binlocs);
+      sftable.evalScaleFactor(*it_SF_val, SF_err, *it_SF_hist, binlocs);
       if (syst==ePUJetIdEffUp) *it_SF_val += SF_err;
       else if (syst==ePUJetIdEffDn) *it_SF_val -= SF_err;
 
@@ -258,17 +228,49 @@ void PUJetIdScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariat
     IVYout << "\t- Calculated final SF: " << val << endl;
   }
 }
+void PUJetIdScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& eta, bool const& isMatched, bool const& isLoose, bool const& isMedium, bool const& isTight, float& val, float* effval) const{
+  ScaleFactorTable::BinLocationList_t binlocs;
+  sftable.findBins(pt, eta, binlocs);
+  getSFAndEff(syst, binlocs, pt, eta, isMatched, isLoose, isMedium, isTight, val, effval);
+}
+bool PUJetIdScaleFactorHandler::getPUJetIdFlags(AK4JetObject const* obj, bool& isMatched, bool& isLoose, bool& isMedium, bool& isTight){
+  if (!obj) return false;
+  if (!ParticleSelectionHelpers::isJetForPUJetIdSF(obj)) return false;
+
+  isMatched = obj->extras.is_genMatched_fullCone;
+  isLoose = obj->testSelectionBit(AK4JetSelectionHelpers::kLoosePUJetId);
+  isMedium = obj->testSelectionBit(AK4JetSelectionHelpers::kMediumPUJetId);
+  isTight = obj->testSelectionBit(AK4JetSelectionHelpers::kTightPUJetId);
+
+  return true;
+}
 void PUJetIdScaleFactorHandler::getSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, AK4JetObject const* obj, float& val, float* effval) const{
   val = 1;
   if (effval) *effval = 1;
 
-  if (!obj) return;
-  if (!ParticleSelectionHelpers::isJetForPUJetIdSF(obj)) return;
-
-  bool isMatched = obj->extras.is_genMatched_fullCone;
-  bool isLoose = obj->testSelectionBit(AK4JetSelectionHelpers::kLoosePUJetId);
-  bool isMedium = obj->testSelectionBit(AK4JetSelectionHelpers::kMediumPUJetId);
-  bool isTight = obj->testSelectionBit(AK4JetSelectionHelpers::kTightPUJetId);
+  bool isMatched = false, isLoose = false, isMedium = false, isTight = false;
+  if (!getPUJetIdFlags(obj, isMatched, isLoose, isMedium, isTight)) return;
 
   getSFAndEff(syst, obj->pt(), obj->eta(), isMatched, isLoose, isMedium, isTight, val, effval);
 }
+void PUJetIdScaleFactorHandler::getSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<AK4JetObject*> const& objs, std::vector<float>& vals, float const& minval) const{
+  vals.assign(systs.size(), 1);
+
+  ScaleFactorTable::BinLocationList_t binlocs;
+  for (auto const& obj:objs){
+    bool isMatched = false, isLoose = false, isMedium = false, isTight = false;
+    if (!getPUJetIdFlags(obj, isMatched, isLoose, isMedium, isTight)) continue;
+
+    float const pt = obj->pt();
+    float const eta = obj->eta();
+    sftable.findBins(pt, eta, binlocs);
+
+    auto it_val = vals.begin();
+    for (auto const& syst:systs){
+      float theSF = 1;
+      getSFAndEff(syst, binlocs, pt, eta, isMatched, isLoose, isMedium, isTight, theSF, nullptr);
+      *it_val *= std::max(minval, theSF);
+      it_val++;
+    }
+  }
+}
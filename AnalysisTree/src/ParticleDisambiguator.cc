@@ -108,7 +108,8 @@ void ParticleDisambiguator::disambiguateParticles(
   std::vector<ElectronObject*>* electrons = (electronHandle ? &(electronHandle->productList) : nullptr);
   std::vector<PhotonObject*>* photons = (photonHandle ? &(photonHandle->productList) : nullptr);
 
-  disambiguateParticles(muons, electrons, photons, true);
+  // Objects are owned by the arenas of the handlers, so they are not deleted here.
+  disambiguateParticles(muons, electrons, photons, false);
 }
 
 
@@ -4,6 +4,7 @@
 
 #include "ParticleObjectHelpers.h"
 #include "PhotonHandler.h"
+#include "PFCandidateAssociationHelpers.h"
 #include "PhotonSelectionHelpers.h"
 #include "ParticleSelectionHelpers.h"
 #include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
@@ -51,15 +52,7 @@ bool PhotonHandler::constructPhotons(SystematicsHelpers::SystematicVariationType
 bool PhotonHandler::associatePFCandidates(std::vector<PFCandidateObject*> const* pfcandidates) const{
   if (!pfcandidates) return true;
 
-  for (auto const& pfcand:(*pfcandidates)){
-    auto const& associated_particle_indices = pfcand->extras.matched_photon_index_list;
-    for (auto const& part:productList){
-      if (HelperFunctions::checkListVariable(associated_particle_indices, part->getUniqueIdentifier())){
-        part->addDaughter(pfcand);
-        pfcand->addMother(part);
-      }
-    }
-  }
+  PFCandidateAssociationHelpers::associatePFCandidates(*pfcandidates, productList, &PFCandidateVariables::matched_photon_index_list);
 
   return true;
 }
@@ -114,7 +107,7 @@ bool PhotonHandler::constructPhotonObjects(SystematicsHelpers::SystematicVariati
 
       ParticleObject::LorentzVector_t momentum;
       momentum = ParticleObject::PolarLorentzVector_t(*it_pt, *it_eta, *it_phi, *it_mass); // Yes you have to do this on a separate line because CMSSW...
-      productList.push_back(new ProductType_t(momentum));
+      productList.push_back(productArena.emplace(momentum));
       PhotonObject*& obj = productList.back();
 
       // Set extras
@@ -80,79 +80,48 @@ bool PhotonScaleFactorHandler::setup(){
   // Get tampon SFs
   {
     TFile* finput = TFile::Open(getScaleFactorFileName(bit_SFTampon_id, SampleHelpers::getDataYear()), "read"); uppermostdir->cd();
-    res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(h_eff_mc_tampon, finput, "EGamma_EffMC2D");
-    res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(h_SF_tampon, finput, "EGamma_SF2D");
+    res &= getHistogramLayer<TH2F>(sftable, ilayer_eff_mc_tampon, finput, "EGamma_EffMC2D");
+    res &= getHistogramLayer<TH2F>(sftable, ilayer_SF_tampon, finput, "EGamma_SF2D");
     ScaleFactorHandlerBase::closeFile(finput); curdir->cd();
   }
   // Get tight SFs
   {
     TFile* finput = TFile::Open(getScaleFactorFileName(bit_preselectionTight_id, SampleHelpers::getDataYear()), "read"); uppermostdir->cd();
-    res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(h_eff_mc_tight, finput, "EGamma_EffMC2D");
-    res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(h_SF_tight, finput, "EGamma_SF2D");
+    res &= getHistogramLayer<TH2F>(sftable, ilayer_eff_mc_tight, finput, "EGamma_EffMC2D");
+    res &= getHistogramLayer<TH2F>(sftable, ilayer_SF_tight, finput, "EGamma_SF2D");
     ScaleFactorHandlerBase::closeFile(finput); curdir->cd();
   }
 
   return res;
 }
 void PhotonScaleFactorHandler::reset(){
-  h_eff_mc_tampon.reset();
-  h_SF_tampon.reset();
+  sftable.reset();
 
-  h_eff_mc_tight.reset();
-  h_SF_tight.reset();
+  ilayer_eff_mc_tampon = ilayer_SF_tampon = 0;
+  ilayer_eff_mc_tight = ilayer_SF_tight = 0;
 }
 
-void PhotonScaleFactorHandler::evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, float const& pt, float const& etaSC, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const{
-  TH2F const* hh = hist.getHistogram();
-  if (!hh){
+void PhotonScaleFactorHandler::evalScaleFactorFromHistogram(float& theSF, float& theSFRelErr, size_t const& ilayer, ScaleFactorTable::BinLocationList_t const& binlocs) const{
+  if (sftable.isEmptyLayer(ilayer)){
     IVYerr << "PhotonScaleFactorHandler::evalScaleFactorFromHistogram: Histogram is null." << endl;
     return;
   }
-
-  float const abs_eta = std::abs(etaSC);
-  float const& eta_to_use = (!useAbsEta ? etaSC : abs_eta);
-
-  int ix, iy;
-  int nbinsx = hh->GetNbinsX();
-  int nbinsy = hh->GetNbinsY();
-  if (!etaOnY){
-    ix = hh->GetXaxis()->FindBin(eta_to_use);
-    iy = hh->GetYaxis()->FindBin(pt);
-  }
-  else{
-    ix = hh->GetXaxis()->FindBin(pt);
-    iy = hh->GetYaxis()->FindBin(eta_to_use);
-  }
-
-  bool out_of_bounds = false;
-  if (ix==0){ ix=1; out_of_bounds=true; }
-  else if (ix==nbinsx+1){ ix=nbinsx; out_of_bounds=true; }
-  if (iy==0){ iy=1; out_of_bounds=true; }
-  else if (iy==nbinsy+1){ iy=nbinsy; out_of_bounds=true; }
-
-  float bc = hh->GetBinContent(ix, iy);
-  float be = hh->GetBinError(ix, iy);
-  if (bc!=0.f) be /= bc;
-  if (be<0.f) be=0;
-
-  if (out_of_bounds) be *= 1.5;
-
-  theSF *= bc; theSFRelErr = sqrt(pow(theSFRelErr, 2)+pow(be, 2));
+  sftable.evalScaleFactor(theSF, theSFRelErr, ilayer, binlocs);
 }
 
-void PhotonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& etaSC, bool const& isTight, bool const& isTampon, float& val, float* effval) const{
+void PhotonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, ScaleFactorTable::BinLocationList_t const& binlocs, bool const& isTight, bool const& isTampon, float& val, float* effval) const{
   val = 1;
 
   float eff_tight=1, eff_relerr_tight=0;
-  evalScaleFactorFromHistogram(eff_tight, eff_relerr_tight, pt, etaSC, h_eff_mc_tight, false, false);
+  evalScaleFactorFromHistogram(eff_tight, eff_relerr_tight, ilayer_eff_mc_tight, binlocs);
   float eff_tampon=1, eff_relerr_tampon=0;
-  evalScaleFactorFromHistogram(eff_tampon, eff_relerr_tampon, pt, etaSC, h_eff_mc_tampon, false, false);
+  evalScaleFactorFromHistogram(eff_tampon, eff_relerr_tampon, ilayer_eff_mc_tampon, binlocs);
   float eff_nonid = std::max(0.f, 1.f - eff_tampon);
 
   float SF_tight=1, SF_relerr_tight=0;
-  evalScaleFactorFromHistogram(SF_tight, SF_relerr_tight, pt, etaSC, h_SF_tight, false, false);
+  evalScaleFactorFromHistogram(SF_tight, SF_relerr_tight, ilayer_SF_tight, binlocs);
   float SF_tampon=1, SF_relerr_tampon=0;
-  evalScaleFactorFromHistogram(SF_tampon, SF_relerr_tampon, pt, etaSC, h_SF_tampon, false, false);
+  evalScaleFactorFromHistogram(SF_tampon, SF_relerr_tampon, ilayer_SF_tampon, binlocs);
 
   if (syst == SystematicsHelpers::ePhoEffDn){
     SF_tight *= (1.f - SF_relerr_tight);
@@ -197,21 +166,51 @@ void PhotonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVa
   }
 }
 
-void PhotonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, PhotonObject const* obj, float& val, float* effval) const{
-  val = 1;
-  if (effval) *effval = 1;
-
-  if (!obj) return;
-  if (!obj->extras.is_genMatched_prompt) return;
+void PhotonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, float const& pt, float const& etaSC, bool const& isTight, bool const& isTampon, float& val, float* effval) const{
+  ScaleFactorTable::BinLocationList_t binlocs;
+  sftable.findBins(etaSC, pt, binlocs);
+  getIdIsoSFAndEff(syst, binlocs, isTight, isTampon, val, effval);
+}
+bool PhotonScaleFactorHandler::getIdIsoFlags(PhotonObject const* obj, bool& isTight, bool& isTampon) const{
+  if (!obj) return false;
+  if (!obj->extras.is_genMatched_prompt) return false;
 
-  bool const isTight = (
+  isTight = (
     obj->testSelectionBit(bit_preselectionTight_id)
     &&
     obj->testSelectionBit(bit_preselectionTight_iso)
     &&
     obj->testSelectionBit(bit_preselectionTight_kin)
     );
-  bool const isTampon = obj->testSelectionBit(kSFTampon);
+  isTampon = obj->testSelectionBit(kSFTampon);
+
+  return true;
+}
+void PhotonScaleFactorHandler::getIdIsoSFAndEff(SystematicsHelpers::SystematicVariationTypes const& syst, PhotonObject const* obj, float& val, float* effval) const{
+  val = 1;
+  if (effval) *effval = 1;
+
+  bool isTight = false, isTampon = false;
+  if (!getIdIsoFlags(obj, isTight, isTampon)) return;
 
   getIdIsoSFAndEff(syst, obj->pt(), obj->etaSC(), isTight, isTampon, val, effval);
 }
+void PhotonScaleFactorHandler::getIdIsoSFAndEff(std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs, std::vector<PhotonObject*> const& objs, std::vector<float>& vals, float const& minval) const{
+  vals.assign(systs.size(), 1);
+
+  ScaleFactorTable::BinLocationList_t binlocs;
+  for (auto const& obj:objs){
+    bool isTight = false, isTampon = false;
+    if (!getIdIsoFlags(obj, isTight, isTampon)) continue;
+
+    sftable.findBins(obj->etaSC(), obj->pt(), binlocs);
+
+    auto it_val = vals.begin();
+    for (auto const& syst:systs){
+      float theSF = 1;
+      getIdIsoSFAndEff(syst, binlocs, isTight, isTampon, theSF, nullptr);
+      *it_val *= std::max(minval, theSF);
+      it_val++;
+    }
+  }
+}
@@ -0,0 +1,19 @@
+#include "ProductRecord.h"
+#include "HelperFunctions.h"
+
+
+void ProductRecord::bind(TTree* tree, std::vector<TString> const* excludedColumns){
+  if (!tree || HelperFunctions::checkListVariable(boundTrees, tree)) return;
+  for (auto& column:columns){
+    if (excludedColumns && HelperFunctions::checkListVariable(*excludedColumns, column->name)) continue;
+    column->bind(tree);
+  }
+  boundTrees.push_back(tree);
+}
+
+void ProductRecord::exportTo(SimpleEntry& entry, std::vector<TString> const* excludedColumns) const{
+  for (auto const& column:columns){
+    if (excludedColumns && HelperFunctions::checkListVariable(*excludedColumns, column->name)) continue;
+    column->exportTo(entry);
+  }
+}
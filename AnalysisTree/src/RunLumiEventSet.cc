@@ -0,0 +1,94 @@
+#include "RunLumiEventSet.h"
+
+
+size_t RunLumiEventSet::getHash(unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber){
+  // Mix the packed run and lumi. section with the event number (splitmix64 finalizer)
+  unsigned long long h = EventNumber ^ ((static_cast<unsigned long long>(RunNumber) << 32 | static_cast<unsigned long long>(LuminosityBlock)) * 0x9e3779b97f4a7c15ULL);
+  h ^= (h >> 30); h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= (h >> 27); h *= 0x94d049bb133111ebULL;
+  h ^= (h >> 31);
+  return static_cast<size_t>(h);
+}
+
+void RunLumiEventSet::rehash(size_t const& capacity){
+  std::vector<Entry> old_entries(capacity, Entry{ emptyEventNumber, emptyRunNumber, emptyLuminosityBlock });
+  std::swap(entries, old_entries);
+  size_t const mask = capacity-1;
+  for (auto const& entry:old_entries){
+    if (entry.isEmpty()) continue;
+    size_t pos = getHash(entry.RunNumber, entry.LuminosityBlock, entry.EventNumber) & mask;
+    while (!entries[pos].isEmpty()) pos = (pos+1) & mask;
+    entries[pos] = entry;
+  }
+}
+
+bool RunLumiEventSet::insert(unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber){
+  if (EventNumber==emptyEventNumber && RunNumber==emptyRunNumber && LuminosityBlock==emptyLuminosityBlock){
+    if (hasEmptyKey) return false;
+    hasEmptyKey = true;
+    nentries++;
+    return true;
+  }
+
+  // Keep the load factor at or below 1/2
+  if (2*(nentries+1)>entries.size()) rehash(entries.empty() ? 1024 : 2*entries.size());
+
+  size_t const mask = entries.size()-1;
+  size_t pos = getHash(RunNumber, LuminosityBlock, EventNumber) & mask;
+  while (!entries[pos].isEmpty()){
+    Entry const& entry = entries[pos];
+    if (entry.EventNumber==EventNumber && entry.RunNumber==RunNumber && entry.LuminosityBlock==LuminosityBlock) return false;
+    pos = (pos+1) & mask;
+  }
+  entries[pos] = Entry{ EventNumber, RunNumber, LuminosityBlock };
+  nentries++;
+  return true;
+}
+
+bool RunLumiEventSet::contains(unsigned int const& RunNumber, unsigned int const& LuminosityBlock, unsigned long long const& EventNumber) const{
+  if (EventNumber==emptyEventNumber && RunNumber==emptyRunNumber && LuminosityBlock==emptyLuminosityBlock) return hasEmptyKey;
+  if (entries.empty()) return false;
+
+  size_t const mask = entries.size()-1;
+  size_t pos = getHash(RunNumber, LuminosityBlock, EventNumber) & mask;
+  while (!entries[pos].isEmpty()){
+    Entry const& entry = entries[pos];
+    if (entry.EventNumber==EventNumber && entry.RunNumber==RunNumber && entry.LuminosityBlock==LuminosityBlock) return true;
+    pos = (pos+1) & mask;
+  }
+  return false;
+}
+
+bool RunLumiEventSet::write(std::ostream& out) const{
+  unsigned long long const n = nentries;
+  out.write(reinterpret_cast<char const*>(&n), sizeof(n));
+  if (hasEmptyKey){
+    Entry const entry{ emptyEventNumber, emptyRunNumber, emptyLuminosityBlock };
+    out.write(reinterpret_cast<char const*>(&entry), sizeof(Entry));
+  }
+  for (auto const& entry:entries){
+    if (!entry.isEmpty()) out.write(reinterpret_cast<char const*>(&entry), sizeof(Entry));
+  }
+  return out.good();
+}
+
+bool RunLumiEventSet::read(std::istream& in){
+  clear();
+  unsigned long long n = 0;
+  in.read(reinterpret_cast<char*>(&n), sizeof(n));
+  if (!in.good()) return false;
+  // Reserve once so that the insertions below do not rehash
+  size_t capacity = 1024;
+  while (capacity<2*n) capacity *= 2;
+  rehash(capacity);
+  for (unsigned long long i=0; i<n; i++){
+    Entry entry;
+    in.read(reinterpret_cast<char*>(&entry), sizeof(Entry));
+    if (!in.good()){
+      clear();
+      return false;
+    }
+    insert(entry.RunNumber, entry.LuminosityBlock, entry.EventNumber);
+  }
+  return true;
+}
@@ -1,13 +1,13 @@
 #include <cassert>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
 #include <unordered_map>
 #include "HostHelpersCore.h"
 #include "HelperFunctions.h"
 #include "SamplesCore.h"
 #include "SamplesCore.hpp"
 #include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
-#include "TRandom3.h"
 
 
 namespace SampleHelpers{
@@ -18,6 +18,8 @@ namespace SampleHelpers{
   std::vector< std::pair< std::pair<unsigned int, unsigned int>, TString > > const runRange_dataPeriod_pair_list = define_runRange_dataPeriod_pair_list();
   std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > const dataPeriod_runNumber_lumi_pairs_map = define_dataPeriod_runNumber_lumi_pairs_map();
   std::unordered_map< TString, double > const dataPeriod_lumi_map = define_dataPeriod_lumi_map();
+  std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > > const dataPeriod_runNumber_cumulativeLumi_pairs_map = define_dataPeriod_runNumber_cumulativeLumi_pairs_map();
+  std::unordered_map< int, std::vector< std::pair<TString, double> > > const dataYear_dataPeriod_cumulativeLumiFraction_pairs_map = define_dataYear_dataPeriod_cumulativeLumiFraction_pairs_map();
 
 }
 
@@ -106,24 +108,36 @@ int SampleHelpers::getDataYearFromPeriod(TString const& period){
   return try_year;
 }
 
-std::vector<TString> SampleHelpers::getValidDataPeriods(){
+std::vector<TString> SampleHelpers::getValidDataPeriods(){ return getValidDataPeriods(theDataYear); }
+std::vector<TString> SampleHelpers::getValidDataPeriods(int const& year){
   std::vector<TString> res;
-  if (theDataYear == 2016) res = std::vector<TString>{ "2016B", "2016C", "2016D", "2016E", "2016F", "2016G", "2016H" };
-  else if (theDataYear == 2017) res = std::vector<TString>{ "2017B", "2017C", "2017D", "2017E", "2017F" };
-  else if (theDataYear == 2018) res = std::vector<TString>{ "2018A", "2018B", "2018C", "2018D" };
+  if (year == 2016) res = std::vector<TString>{ "2016B", "2016C", "2016D", "2016E", "2016F", "2016G", "2016H" };
+  else if (year == 2017) res = std::vector<TString>{ "2017B", "2017C", "2017D", "2017E", "2017F" };
+  else if (year == 2018) res = std::vector<TString>{ "2018A", "2018B", "2018C", "2018D" };
   else{
-    IVYerr << "SampleHelpers::getValidDataPeriods: Data periods for year " << theDataYear << " are undefined." << endl;
+    IVYerr << "SampleHelpers::getValidDataPeriods: Data periods for year " << year << " are undefined." << endl;
     assert(0);
   }
   return res;
 }
+std::vector< std::pair<TString, double> > const& SampleHelpers::getValidDataPeriodCumulativeLumiFractions(){
+  auto it = dataYear_dataPeriod_cumulativeLumiFraction_pairs_map.find(theDataYear);
+  if (it==dataYear_dataPeriod_cumulativeLumiFraction_pairs_map.cend()){
+    IVYerr << "SampleHelpers::getValidDataPeriodCumulativeLumiFractions: Data periods for year " << theDataYear << " are undefined." << endl;
+    assert(0);
+  }
+  return it->second;
+}
 TString SampleHelpers::getDataPeriodFromRunNumber(unsigned int run){
   TString res;
-  for (auto const& rr_dp:runRange_dataPeriod_pair_list){
-    if (run>=rr_dp.first.first && run<=rr_dp.first.second){
-      res = rr_dp.second;
-      break;
-    }
+  // The run ranges are ordered and do not overlap, so the only candidate is the last range that starts at or before the run.
+  auto it_rr_dp = std::upper_bound(
+    runRange_dataPeriod_pair_list.cbegin(), runRange_dataPeriod_pair_list.cend(), run,
+    [] (unsigned int const& val, std::pair< std::pair<unsigned int, unsigned int>, TString > const& rr_dp){ return val<rr_dp.first.first; }
+  );
+  if (it_rr_dp!=runRange_dataPeriod_pair_list.cbegin()){
+    it_rr_dp--;
+    if (run<=it_rr_dp->first.second) res = it_rr_dp->second;
   }
   if (res==""){
     IVYerr << "SampleHelpers::getDataPeriodFromRunNumber: Run " << run << " is not defined in any range. Please check the implementation of SampleHelpers::define_runRange_dataPeriod_pair_list!" << endl;
@@ -200,54 +214,47 @@ bool SampleHelpers::checkSampleIsData(TString const& strid, TString* theSampleDa
 bool SampleHelpers::checkSampleIs80X(TString const& strid){ return strid.Contains("Summer16MiniAODv2"); }
 bool SampleHelpers::checkSampleIsFastSim(TString const& strid){ return false; }
 
-TString SampleHelpers::getRandomDataPeriod(unsigned long long const& iseed, double* rndnum_global, double* rndnum_local){
+TString SampleHelpers::getRandomDataPeriod(double const& rndnum, double* rndnum_global, double* rndnum_local){
   if (rndnum_global) *rndnum_global = -1;
   if (rndnum_local) *rndnum_local = -1;
-  std::vector<TString> const valid_periods = getValidDataPeriods();
-  if (std::find(valid_periods.cbegin(), valid_periods.cend(), theDataPeriod)==valid_periods.cend()){
-    std::vector<double> lumilist; lumilist.reserve(valid_periods.size());
-    for (TString const& period:valid_periods) lumilist.push_back(getIntegratedLuminosity(period));
-    for (size_t il=1; il<lumilist.size(); il++) lumilist.at(il) += lumilist.at(il-1);
-    for (size_t il=0; il<lumilist.size(); il++) lumilist.at(il) /= lumilist.back();
-    TRandom3 rand;
-    rand.SetSeed(iseed);
-    char i_era = -1;
-    double era_x = rand.Uniform();
-    if (rndnum_global) *rndnum_global = era_x;
-    for (auto const& lumi_era:lumilist){
-      i_era++;
-      if (era_x<=lumi_era) break;
-    }
-    if (rndnum_local){
-      double era_x0 = 0;
-      if (i_era>0) era_x0 = lumilist.at(i_era-1);
-      *rndnum_local = (era_x - era_x0)/(lumilist.at(i_era) - era_x0);
-    }
-    return valid_periods.at(i_era);
+  std::vector< std::pair<TString, double> > const& dp_cumlumifrac_pairs = getValidDataPeriodCumulativeLumiFractions();
+  for (auto const& dp_cumlumifrac_pair:dp_cumlumifrac_pairs){
+    if (dp_cumlumifrac_pair.first == theDataPeriod) return theDataPeriod;
+  }
+
+  // Choose the first period with rndnum <= its cumulative luminosity fraction
+  auto it_era = std::lower_bound(
+    dp_cumlumifrac_pairs.cbegin(), dp_cumlumifrac_pairs.cend(), rndnum,
+    [] (std::pair<TString, double> const& dp_cumlumifrac_pair, double const& val){ return dp_cumlumifrac_pair.second<val; }
+  );
+  if (it_era==dp_cumlumifrac_pairs.cend()) it_era--;
+  if (rndnum_global) *rndnum_global = rndnum;
+  if (rndnum_local){
+    double era_x0 = 0;
+    if (it_era!=dp_cumlumifrac_pairs.cbegin()) era_x0 = (it_era-1)->second;
+    *rndnum_local = (rndnum - era_x0)/(it_era->second - era_x0);
   }
-  else return theDataPeriod;
+  return it_era->first;
 }
 
 int SampleHelpers::translateRandomNumberToRunNumber(TString const& period, double const& rndnum){
-  int res = -1;
   std::unordered_map< TString, std::vector< std::pair<unsigned int, double> > >::const_iterator it;
-  if (!HelperFunctions::getUnorderedMapIterator(period, dataPeriod_runNumber_lumi_pairs_map, it)){
+  if (!HelperFunctions::getUnorderedMapIterator(period, dataPeriod_runNumber_cumulativeLumi_pairs_map, it)){
     IVYerr << "SampleHelpers::translateRandomNumberToRunNumber: Period " << period << " is not found in the dataPeriod_runNumber_lumi_pairs_map. Please revise the implementation." << endl;
     assert(0);
   }
 
-  double lumi_rnd = getIntegratedLuminosity(period)*rndnum;
-  double lumi_total = 0;
-  for (auto const& rn_lumi_pair:it->second){
-    lumi_total += rn_lumi_pair.second;
-    if (lumi_rnd<=lumi_total){
-      res = rn_lumi_pair.first;
-      break;
-    }
-  }
-  if (res==-1) res = it->second.back().first;
+  // The last cumulative luminosity is the same as getIntegratedLuminosity(period).
+  // Choose the first run with lumi_rnd <= its cumulative luminosity, or the last run if rounding leaves none.
+  auto const& rn_cumlumi_pairs = it->second;
+  double const lumi_rnd = rn_cumlumi_pairs.back().second*rndnum;
+  auto it_run = std::lower_bound(
+    rn_cumlumi_pairs.cbegin(), rn_cumlumi_pairs.cend(), lumi_rnd,
+    [] (std::pair<unsigned int, double> const& rn_cumlumi_pair, double const& val){ return rn_cumlumi_pair.second<val; }
+  );
+  if (it_run==rn_cumlumi_pairs.cend()) it_run--;
 
-  return res;
+  return it_run->first;
 }
 
 bool SampleHelpers::checkRunOnCondor(){ return HostHelpers::FileExists("RUNNING_ON_CONDOR"); }
@@ -0,0 +1,110 @@
+#include <cmath>
+#include <algorithm>
+#include "ScaleFactorTable.h"
+#include "TH2F.h"
+
+
+int ScaleFactorTable::Binning::findBin(std::vector<double> const& edges, double const& val){
+  // Number of edges <= val, which is 0 for underflows and nbins+1 for overflows
+  return static_cast<int>(std::upper_bound(edges.cbegin(), edges.cend(), val) - edges.cbegin());
+}
+
+void ScaleFactorTable::reset(){
+  binnings.clear();
+  layers.clear();
+  contents.clear();
+  errors.clear();
+}
+
+size_t ScaleFactorTable::addLayer(ExtendedHistogram_2D_f const& hist){
+  Layer layer;
+  layer.name = hist.getName();
+  layer.ibinning = -1;
+  layer.offset = contents.size();
+
+  TH2F const* hh = hist.getHistogram();
+  if (hh){
+    Binning binning;
+    TAxis const* xaxis = hh->GetXaxis();
+    TAxis const* yaxis = hh->GetYaxis();
+    int const nbinsx = xaxis->GetNbins();
+    int const nbinsy = yaxis->GetNbins();
+    binning.xedges.reserve(nbinsx+1);
+    binning.yedges.reserve(nbinsy+1);
+    for (int ix=1; ix<=nbinsx+1; ix++) binning.xedges.push_back(xaxis->GetBinLowEdge(ix));
+    for (int iy=1; iy<=nbinsy+1; iy++) binning.yedges.push_back(yaxis->GetBinLowEdge(iy));
+
+    for (size_t ib=0; ib<binnings.size(); ib++){
+      if (binnings.at(ib).xedges==binning.xedges && binnings.at(ib).yedges==binning.yedges){
+        layer.ibinning = ib;
+        break;
+      }
+    }
+    if (layer.ibinning<0){
+      layer.ibinning = binnings.size();
+      binnings.push_back(binning);
+    }
+
+    size_t const nbins = (nbinsx+2)*(nbinsy+2);
+    contents.reserve(contents.size()+nbins);
+    errors.reserve(errors.size()+nbins);
+    for (int iy=0; iy<=nbinsy+1; iy++){
+      for (int ix=0; ix<=nbinsx+1; ix++){
+        contents.push_back(hh->GetBinContent(ix, iy));
+        errors.push_back(hh->GetBinError(ix, iy));
+      }
+    }
+  }
+
+  layers.push_back(layer);
+  return layers.size()-1;
+}
+
+void ScaleFactorTable::findBins(float const& x, float const& y, BinLocationList_t& locs) const{
+  locs.resize(binnings.size());
+  auto it_loc = locs.begin();
+  for (auto const& binning:binnings){
+    it_loc->ix = Binning::findBin(binning.xedges, x);
+    it_loc->iy = Binning::findBin(binning.yedges, y);
+    it_loc++;
+  }
+}
+
+void ScaleFactorTable::evalScaleFactor(float& theSF, float& theSFRelErr, size_t const& ilayer, BinLocationList_t const& locs) const{
+  Layer const& layer = layers[ilayer];
+  if (layer.ibinning<0) return;
+
+  Binning const& binning = binnings[layer.ibinning];
+  BinLocation const& loc = locs[layer.ibinning];
+  int ix = loc.ix;
+  int iy = loc.iy;
+  int const nbinsx = binning.getNbinsX();
+  int const nbinsy = binning.getNbinsY();
+
+  bool out_of_bounds = false;
+  if (ix==0){ ix=1; out_of_bounds=true; }
+  else if (ix==nbinsx+1){ ix=nbinsx; out_of_bounds=true; }
+  if (iy==0){ iy=1; out_of_bounds=true; }
+  else if (iy==nbinsy+1){ iy=nbinsy; out_of_bounds=true; }
+
+  size_t const ibin = getGlobalBin(layer, ix, iy);
+  float bc = contents[ibin];
+  float be = errors[ibin];
+  if (bc!=0.f) be /= bc;
+  if (be<0.f) be=0;
+
+  if (out_of_bounds) be *= 1.5;
+
+  theSF *= bc; theSFRelErr = std::sqrt(std::pow(theSFRelErr, 2)+std::pow(be, 2));
+}
+void ScaleFactorTable::evalScaleFactor(float& theSF, size_t const& ilayer, BinLocationList_t const& locs) const{
+  Layer const& layer = layers[ilayer];
+  if (layer.ibinning<0) return;
+
+  Binning const& binning = binnings[layer.ibinning];
+  BinLocation const& loc = locs[layer.ibinning];
+  int const ix = std::max(1, std::min(loc.ix, binning.getNbinsX()));
+  int const iy = std::max(1, std::min(loc.iy, binning.getNbinsY()));
+
+  theSF *= contents[getGlobalBin(layer, ix, iy)];
+}
@@ -1,7 +1,7 @@
 #include <cassert>
-#include "TRandom3.h"
 
 #include "SimEventHandler.h"
+#include "EventRandomHelpers.h"
 #include "SampleHelpersCore.h"
 #include "SamplesCore.h"
 #include "SampleExceptions.h"
@@ -250,40 +250,34 @@ bool SimEventHandler::constructRandomNumbers(){
   }
   if (this->verbosity>=MiscUtils::DEBUG) IVYout << "SimEventHandler::constructRandomNumbers: All variables are set up!" << endl;
 
-  // Get random number seeds first
-  unsigned long long const rndDataPeriod = static_cast<unsigned long long>(std::abs((*genmet_met)*1000.f)) + ((*EventNumber) % 1000000);
-  product_rnds[kDataPeriod_global] = product_rnds[kDataPeriod_local] = rndDataPeriod; // Seeds are supposed to be the same because the random numbers just translate between each other.
-  unsigned long long const rndGenMETSmear = static_cast<unsigned long long>(std::abs(std::sin(*genmet_metPhi))*100000.);
+  // Get random number salts first.
+  // The data period random number is keyed by the event identifiers, and the gen. MET is used to separate samples that share the same identifiers.
+  // The MET smearing random number depends only on the gen. MET phi in order to stay the same as the fallback in METCorrectionHandler::applyCorrections.
+  unsigned long long const rndDataPeriod = EventRandomHelpers::getFloatBits(*genmet_met);
+  product_rnds[kDataPeriod_global] = product_rnds[kDataPeriod_local] = rndDataPeriod; // Salts are supposed to be the same because the random numbers just translate between each other.
+  unsigned long long const rndGenMETSmear = EventRandomHelpers::getFloatBits(*genmet_metPhi);
   product_rnds[kGenMETSmear] = rndGenMETSmear;
 
-  // Set the random number generator
-  TRandom3 rand;
-
   // Determine the MET smearing random number
-  rand.SetSeed(rndGenMETSmear);
-  product_rndnums[kGenMETSmear] = rand.Uniform();
+  product_rndnums[kGenMETSmear] = EventRandomHelpers::getUniform(EventRandomHelpers::kGenMETSmear, 0, 0, 0, static_cast<uint32_t>(rndGenMETSmear));
 
   // Determine the chosen data period, and the global and local version of the data period random number
+  double const rndnum_dataPeriod = EventRandomHelpers::getUniform(EventRandomHelpers::kDataPeriod, *RunNumber, *LuminosityBlock, *EventNumber, static_cast<uint32_t>(rndDataPeriod));
   double rndnum_dataPeriod_global = -1;
   double rndnum_dataPeriod_local = -1;
-  theChosenDataPeriod = SampleHelpers::getRandomDataPeriod(rndDataPeriod, &rndnum_dataPeriod_global, &rndnum_dataPeriod_local);
+  theChosenDataPeriod = SampleHelpers::getRandomDataPeriod(rndnum_dataPeriod, &rndnum_dataPeriod_global, &rndnum_dataPeriod_local);
   // Determine if SampleHelpers ignored the random number assignment because theDataPeriod is a specific period instead of the year.
-  // If so, get the random number here.
+  // If so, use the random number as the local one.
   bool isSelfRandomEra = (rndnum_dataPeriod_local<0.);
   if (isSelfRandomEra){
-    rand.SetSeed(rndDataPeriod);
-    rndnum_dataPeriod_local = rand.Uniform();
+    rndnum_dataPeriod_local = rndnum_dataPeriod;
 
     // Calculate the global random number from luminosity fractions
-    std::vector<TString> const valid_periods = SampleHelpers::getValidDataPeriods();
-    std::vector<double> lumilist; lumilist.reserve(valid_periods.size());
-    for (TString const& period:valid_periods) lumilist.push_back(SampleHelpers::getIntegratedLuminosity(period));
-    for (size_t il=1; il<lumilist.size(); il++) lumilist.at(il) += lumilist.at(il-1);
-    for (size_t il=0; il<lumilist.size(); il++) lumilist.at(il) /= lumilist.back();
-    for (unsigned char i_era=0; i_era<valid_periods.size(); i_era++){
-      if (theChosenDataPeriod == valid_periods.at(i_era)){
-        rndnum_dataPeriod_global = rndnum_dataPeriod_local*lumilist.at(i_era);
-        if (i_era>0) rndnum_dataPeriod_global += lumilist.at(i_era-1);
+    std::vector< std::pair<TString, double> > const& dp_cumlumifrac_pairs = SampleHelpers::getValidDataPeriodCumulativeLumiFractions();
+    for (unsigned char i_era=0; i_era<dp_cumlumifrac_pairs.size(); i_era++){
+      if (theChosenDataPeriod == dp_cumlumifrac_pairs.at(i_era).first){
+        rndnum_dataPeriod_global = rndnum_dataPeriod_local*dp_cumlumifrac_pairs.at(i_era).second;
+        if (i_era>0) rndnum_dataPeriod_global += dp_cumlumifrac_pairs.at(i_era-1).second;
         break;
       }
     }
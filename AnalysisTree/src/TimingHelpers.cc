@@ -0,0 +1,67 @@
+#include <algorithm>
+#include "TimingHelpers.h"
+#include <CMS3/Dictionaries/interface/CMS3StreamHelpers.h>
+
+
+using namespace std;
+using namespace IvyStreamHelpers;
+
+
+size_t TimingHelpers::TimingRegistry::getSectionIndex(TString const& name){
+  for (size_t isec=0; isec<sections.size(); isec++){
+    if (sections.at(isec).name==name) return isec;
+  }
+  sections.emplace_back(name);
+  return sections.size()-1;
+}
+void TimingHelpers::TimingRegistry::reset(){
+  for (auto& section:sections){
+    section.duration = Clock_t::duration::zero();
+    section.ncalls = 0;
+  }
+}
+void TimingHelpers::TimingRegistry::print(TString const& title, Clock_t::duration const& walltime, unsigned long long const& nevents) const{
+  double const walltime_s = std::chrono::duration<double>(walltime).count();
+  IVYout << title << ": " << nevents << " events in " << walltime_s << " s (" << (walltime_s>0. ? static_cast<double>(nevents)/walltime_s : 0.) << " events/s)" << endl;
+
+  // Sort the sections by decreasing time
+  std::vector<SectionInfo const*> sorted_sections; sorted_sections.reserve(sections.size());
+  for (auto const& section:sections){ if (section.ncalls>0) sorted_sections.push_back(&section); }
+  std::stable_sort(sorted_sections.begin(), sorted_sections.end(), [] (SectionInfo const* a, SectionInfo const* b){ return a->duration>b->duration; });
+  for (auto const& section:sorted_sections){
+    double const duration_s = std::chrono::duration<double>(section->duration).count();
+    IVYout
+      << "\t- " << section->name << ": " << duration_s << " s"
+      << " (" << (walltime_s>0. ? duration_s/walltime_s*100. : 0.) << "%)"
+      << " in " << section->ncalls << " calls"
+      << endl;
+  }
+}
+
+TimingHelpers::TimingRegistry& TimingHelpers::getTimingRegistry(){
+  static thread_local TimingRegistry registry;
+  return registry;
+}
+
+TimingHelpers::ProgressMeter::ProgressMeter(double const& interval_seconds, std::mutex* outputMutex_) :
+  interval(std::chrono::duration_cast<Clock_t::duration>(std::chrono::duration<double>(interval_seconds))),
+  outputMutex(outputMutex_)
+{
+  start();
+}
+void TimingHelpers::ProgressMeter::start(){
+  time_begin = Clock_t::now();
+  time_last = time_begin;
+}
+void TimingHelpers::ProgressMeter::report(TString const& title, long long const& ev, long long const& nevents, Clock_t::time_point const& time_now) const{
+  double const elapsed_s = std::chrono::duration<double>(time_now - time_begin).count();
+  double const rate = (elapsed_s>0. ? static_cast<double>(ev+1)/elapsed_s : 0.);
+  std::unique_lock<std::mutex> lock;
+  if (outputMutex) lock = std::unique_lock<std::mutex>(*outputMutex);
+  IVYout
+    << title << ": " << ev+1 << " / " << nevents
+    << " (" << (nevents>0 ? static_cast<double>(ev+1)/static_cast<double>(nevents)*100. : 100.) << "%)"
+    << ", " << rate << " events/s"
+    << ", " << (rate>0. ? static_cast<double>(nevents-ev-1)/rate : 0.) << " s remaining"
+    << endl;
+}
@@ -41,6 +41,10 @@ bool TriggerScaleFactorHandler::setup(){
   std::vector<SystematicVariationTypes> const allowedSysts={ sNominal, eTriggerEffDn, eTriggerEffUp, ePUDn, ePUUp };
   std::vector<SystematicVariationTypes> const allowedSysts_eff={ sNominal, ePUDn, ePUUp };
 
+  // Histograms that are not acquired point to an empty layer
+  size_t const ilayer_empty_Dilepton = sftable_Dilepton.addLayer(ExtendedHistogram_2D_f());
+  size_t const ilayer_empty_SingleLepton = sftable_SingleLepton.addLayer(ExtendedHistogram_2D_f());
+
   {
     TString cinput = cinput_main + "trigger_efficiencies_leptons.root";
     if (!HostHelpers::FileReadable(cinput.Data())){
@@ -70,19 +74,19 @@ bool TriggerScaleFactorHandler::setup(){
       }
 
       uppermostdir->cd();
-      std::vector<ExtendedHistogram_2D_f> tmpvec(4, ExtendedHistogram_2D_f());
+      std::vector<size_t> tmpvec(4, ilayer_empty_Dilepton);
       syst_SF_Dilepton_SingleLepton_mumu_map[syst] = tmpvec;
       syst_SF_Dilepton_SingleLepton_ee_map[syst] = tmpvec;
       syst_SF_Dilepton_SingleLepton_mue_map[syst] = tmpvec;
-      syst_SF_SingleMuon_map[syst] = tmpvec.front();
-      syst_SF_SingleElectron_map[syst] = tmpvec.front();
+      syst_SF_SingleMuon_map[syst] = ilayer_empty_SingleLepton;
+      syst_SF_SingleElectron_map[syst] = ilayer_empty_SingleLepton;
 
       if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)){
         syst_eff_mc_Dilepton_SingleLepton_mumu_map[syst] = tmpvec;
         syst_eff_mc_Dilepton_SingleLepton_ee_map[syst] = tmpvec;
         syst_eff_mc_Dilepton_SingleLepton_mue_map[syst] = tmpvec;
-        syst_eff_mc_SingleMuon_map[syst] = tmpvec.front();
-        syst_eff_mc_SingleElectron_map[syst] = tmpvec.front();
+        syst_eff_mc_SingleMuon_map[syst] = ilayer_empty_SingleLepton;
+        syst_eff_mc_SingleElectron_map[syst] = ilayer_empty_SingleLepton;
       }
 
       // Combined dilepton trigger efficiencies
@@ -93,23 +97,23 @@ bool TriggerScaleFactorHandler::setup(){
           TString hname;
 
           hname = Form("h_Combined_SF_pt25avg_%s_wcuts_mumu_%s_%s_%s", systname.Data(), benames.at(ibe).Data(), benames.at(jbe).Data(), strSyst.Data());
-          res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_SF_Dilepton_SingleLepton_mumu_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
+          res &= getHistogramLayer<TH2F>(sftable_Dilepton, syst_SF_Dilepton_SingleLepton_mumu_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
           uppermostdir->cd();
           hname = Form("h_Combined_SF_pt25avg_%s_wcuts_ee_%s_%s_%s", systname.Data(), benames.at(ibe).Data(), benames.at(jbe).Data(), strSyst.Data());
-          res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_SF_Dilepton_SingleLepton_ee_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
+          res &= getHistogramLayer<TH2F>(sftable_Dilepton, syst_SF_Dilepton_SingleLepton_ee_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
           uppermostdir->cd();
           hname = Form("h_Combined_SF_pt25avg_%s_wcuts_mue_%s_%s_%s", systname.Data(), benames.at(ibe).Data(), benames.at(jbe).Data(), strSyst.Data());
-          res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_SF_Dilepton_SingleLepton_mue_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
+          res &= getHistogramLayer<TH2F>(sftable_Dilepton, syst_SF_Dilepton_SingleLepton_mue_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
           uppermostdir->cd();
           if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)){
             hname = Form("h_Combined_eff_%s_wcuts_mumu_%s_%s_MC_%s", systname.Data(), benames.at(ibe).Data(), benames.at(jbe).Data(), strSyst.Data());
-            res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_eff_mc_Dilepton_SingleLepton_mumu_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
+            res &= getHistogramLayer<TH2F>(sftable_Dilepton, syst_eff_mc_Dilepton_SingleLepton_mumu_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
             uppermostdir->cd();
             hname = Form("h_Combined_eff_%s_wcuts_ee_%s_%s_MC_%s", systname.Data(), benames.at(ibe).Data(), benames.at(jbe).Data(), strSyst.Data());
-            res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_eff_mc_Dilepton_SingleLepton_ee_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
+            res &= getHistogramLayer<TH2F>(sftable_Dilepton, syst_eff_mc_Dilepton_SingleLepton_ee_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
             uppermostdir->cd();
             hname = Form("h_Combined_eff_%s_wcuts_mue_%s_%s_MC_%s", systname.Data(), benames.at(ibe).Data(), benames.at(jbe).Data(), strSyst.Data());
-            res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_eff_mc_Dilepton_SingleLepton_mue_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
+            res &= getHistogramLayer<TH2F>(sftable_Dilepton, syst_eff_mc_Dilepton_SingleLepton_mue_map[syst].at(idx_hist), dir_Dilepton_Combined, hname);
             uppermostdir->cd();
           }
         }
@@ -119,17 +123,17 @@ bool TriggerScaleFactorHandler::setup(){
         TString hname;
 
         hname = Form("h_SingleMuon_SF_%s_%s", systname.Data(), strSyst.Data());
-        res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_SF_SingleMuon_map[syst], dir_SingleLepton_Combined, hname);
+        res &= getHistogramLayer<TH2F>(sftable_SingleLepton, syst_SF_SingleMuon_map[syst], dir_SingleLepton_Combined, hname);
         uppermostdir->cd();
         hname = Form("h_SingleElectron_SF_%s_%s", systname.Data(), strSyst.Data());
-        res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_SF_SingleElectron_map[syst], dir_SingleLepton_Combined, hname);
+        res &= getHistogramLayer<TH2F>(sftable_SingleLepton, syst_SF_SingleElectron_map[syst], dir_SingleLepton_Combined, hname);
         uppermostdir->cd();
         if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)){
           hname = Form("h_SingleMuon_eff_%s_MC_%s", systname.Data(), strSyst.Data());
-          res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_eff_mc_SingleMuon_map[syst], dir_SingleLepton_Combined, hname);
+          res &= getHistogramLayer<TH2F>(sftable_SingleLepton, syst_eff_mc_SingleMuon_map[syst], dir_SingleLepton_Combined, hname);
           uppermostdir->cd();
           hname = Form("h_SingleElectron_eff_%s_MC_%s", systname.Data(), strSyst.Data());
-          res &= getHistogram<TH2F, ExtendedHistogram_2D_f>(syst_eff_mc_SingleElectron_map[syst], dir_SingleLepton_Combined, hname);
+          res &= getHistogramLayer<TH2F>(sftable_SingleLepton, syst_eff_mc_SingleElectron_map[syst], dir_SingleLepton_Combined, hname);
           uppermostdir->cd();
         }
       }
@@ -141,6 +145,9 @@ bool TriggerScaleFactorHandler::setup(){
   return res;
 }
 void TriggerScaleFactorHandler::reset(){
+  sftable_Dilepton.reset();
+  sftable_SingleLepton.reset();
+
   syst_eff_mc_Dilepton_SingleLepton_mumu_map.clear();
   syst_eff_mc_Dilepton_SingleLepton_ee_map.clear();
   syst_eff_mc_Dilepton_SingleLepton_mue_map.clear();
@@ -154,49 +161,12 @@ void TriggerScaleFactorHandler::reset(){
   syst_SF_SingleElectron_map.clear();
 }
 
-void TriggerScaleFactorHandler::evalScaleFactorFromHistogram_PtEta(float& theSF, float const& pt, float const& eta, ExtendedHistogram_2D_f const& hist, bool etaOnY, bool useAbsEta) const{
-  TH2F const* hh = hist.getHistogram();
-  if (!hh) return;
-
-  float const abs_eta = std::abs(eta);
-  float const& eta_to_use = (!useAbsEta ? eta : abs_eta);
-
-  int ix, iy;
-  int nbinsx = hh->GetNbinsX();
-  int nbinsy = hh->GetNbinsY();
-  if (!etaOnY){
-    ix = hh->GetXaxis()->FindBin(eta_to_use);
-    iy = hh->GetYaxis()->FindBin(pt);
+void TriggerScaleFactorHandler::evalScaleFactorFromHistogram_PtPt(float& theSF, size_t const& ilayer, ScaleFactorTable::BinLocationList_t const& binlocs) const{
+  if (sftable_Dilepton.isEmptyLayer(ilayer)){
+    IVYerr << "TriggerScaleFactorHandler::evalScaleFactorFromHistogram_PtPt: Histogram is null." << endl;
+    return;
   }
-  else{
-    ix = hh->GetXaxis()->FindBin(pt);
-    iy = hh->GetYaxis()->FindBin(eta_to_use);
-  }
-
-  if (ix==0) ix=1;
-  else if (ix==nbinsx+1) ix=nbinsx;
-  if (iy==0) iy=1;
-  else if (iy==nbinsy+1) iy=nbinsy;
-
-  theSF *= hh->GetBinContent(ix, iy);
-}
-void TriggerScaleFactorHandler::evalScaleFactorFromHistogram_PtPt(float& theSF, float const& pt1, float const& pt2, ExtendedHistogram_2D_f const& hist) const{
-  TH2F const* hh = hist.getHistogram();
-  if (!hh) IVYerr << "Histogram is NULL!" << endl;
-  if (!hh) return;
-
-  int ix, iy;
-  int nbinsx = hh->GetNbinsX();
-  int nbinsy = hh->GetNbinsY();
-  ix = hh->GetXaxis()->FindBin(pt1);
-  iy = hh->GetYaxis()->FindBin(pt2);
-
-  if (ix==0) ix=1;
-  else if (ix==nbinsx+1) ix=nbinsx;
-  if (iy==0) iy=1;
-  else if (iy==nbinsy+1) iy=nbinsy;
-
-  theSF *= hh->GetBinContent(ix, iy);
+  sftable_Dilepton.evalScaleFactor(theSF, ilayer, binlocs);
 }
 
 
@@ -206,30 +176,44 @@ void TriggerScaleFactorHandler::getCombinedDileptonSFAndEff(
   float pt2, float eta2, cms3_id_t id2,
   bool passTrigger,
   float& val, float* effval
+) const{
+  // Scratch buffers so that evaluating a single systematic does not allocate on every call
+  static thread_local std::vector<SystematicsHelpers::SystematicVariationTypes> systs(1);
+  static thread_local std::vector<float> vals, effvals;
+  systs.front() = syst;
+  getCombinedDileptonSFAndEff(
+    systs,
+    pt1, eta1, id1,
+    pt2, eta2, id2,
+    passTrigger,
+    vals, (effval ? &effvals : nullptr)
+  );
+  val = vals.front();
+  if (effval) *effval = effvals.front();
+}
+void TriggerScaleFactorHandler::getCombinedDileptonSFAndEff(
+  std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+  float pt1, float eta1, cms3_id_t id1,
+  float pt2, float eta2, cms3_id_t id2,
+  bool passTrigger,
+  std::vector<float>& vals, std::vector<float>* effvals
 ) const{
   using namespace SystematicsHelpers;
 
   if (verbosity>=MiscUtils::DEBUG) IVYout
-    << "TriggerScaleFactorHandler::getCombinedDileptonSFAndEff: Evaluating " << (effval ? "SFs and efficiencies" : "SFs")
+    << "TriggerScaleFactorHandler::getCombinedDileptonSFAndEff: Evaluating " << (effvals ? "SFs and efficiencies" : "SFs")
     << " for pT1, pT2 = " << pt1 << ", " << pt2
     << "; eta1, eta2 = " << eta1 << ", " << eta2
     << "; id1, id2 = " << id1 << ", " << id2
     << "; passTrigger ?= " << passTrigger
     << endl;
 
-  val = 1;
-  if (effval) *effval = 1;
+  vals.assign(systs.size(), 1);
+  if (effvals) effvals->assign(systs.size(), 1);
 
   std::vector<SystematicVariationTypes> const allowedSysts={ sNominal, eTriggerEffDn, eTriggerEffUp, ePUDn, ePUUp };
   std::vector<SystematicVariationTypes> const allowedSysts_eff={ sNominal, ePUDn, ePUUp };
 
-  SystematicVariationTypes activeSyst_eff_nominal = sNominal;
-  if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)) activeSyst_eff_nominal = syst;
-
-  SystematicVariationTypes activeSyst = sNominal;
-  if (HelperFunctions::checkListVariable(allowedSysts, syst)) activeSyst = syst;
-  if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Active systematics: " << activeSyst << " / " << activeSyst_eff_nominal << endl;
-
   // Order objects 1, 2
   cms3_id_t dilepton_id = id1*id2;
   bool is_mue = false;
@@ -256,43 +240,60 @@ void TriggerScaleFactorHandler::getCombinedDileptonSFAndEff(
   bool const isBarrel2 = std::abs(eta2)<(std::abs(id2)==13 ? 1.2 : 1.479);
   unsigned short idx_BE = (isBarrel1 ? 0 : 2) + (isBarrel2 ? 0 : 1);
 
-  // Obtain histograms
-  ExtendedHistogram_2D_f const* h_eff_mc = nullptr;
-  ExtendedHistogram_2D_f const* h_SF = nullptr;
+  // Obtain histogram maps
+  std::unordered_map<SystematicVariationTypes, std::vector<size_t>> const* syst_eff_mc_map = nullptr;
+  std::unordered_map<SystematicVariationTypes, std::vector<size_t>> const* syst_SF_map = nullptr;
   if (is_mue){
-    h_eff_mc = &(syst_eff_mc_Dilepton_SingleLepton_mue_map.find(activeSyst_eff_nominal)->second.at(idx_BE));
-    h_SF = &(syst_SF_Dilepton_SingleLepton_mue_map.find(activeSyst)->second.at(idx_BE));
+    syst_eff_mc_map = &syst_eff_mc_Dilepton_SingleLepton_mue_map;
+    syst_SF_map = &syst_SF_Dilepton_SingleLepton_mue_map;
   }
   else if (is_mumu){
-    h_eff_mc = &(syst_eff_mc_Dilepton_SingleLepton_mumu_map.find(activeSyst_eff_nominal)->second.at(idx_BE));
-    h_SF = &(syst_SF_Dilepton_SingleLepton_mumu_map.find(activeSyst)->second.at(idx_BE));
+    syst_eff_mc_map = &syst_eff_mc_Dilepton_SingleLepton_mumu_map;
+    syst_SF_map = &syst_SF_Dilepton_SingleLepton_mumu_map;
   }
   else{
-    h_eff_mc = &(syst_eff_mc_Dilepton_SingleLepton_ee_map.find(activeSyst_eff_nominal)->second.at(idx_BE));
-    h_SF = &(syst_SF_Dilepton_SingleLepton_ee_map.find(activeSyst)->second.at(idx_BE));
+    syst_eff_mc_map = &syst_eff_mc_Dilepton_SingleLepton_ee_map;
+    syst_SF_map = &syst_SF_Dilepton_SingleLepton_ee_map;
   }
 
-  float eff_nominal_unscaled=1, eff_scaled=1;
-  evalScaleFactorFromHistogram_PtPt(eff_nominal_unscaled, pt1, pt2, *h_eff_mc);
+  static thread_local ScaleFactorTable::BinLocationList_t binlocs;
+  sftable_Dilepton.findBins(pt1, pt2, binlocs);
 
-  float SF_val = 1;
-  evalScaleFactorFromHistogram_PtPt(SF_val, pt1, pt2, *h_SF);
-  eff_scaled = std::min(1.f, std::max(0.f, eff_nominal_unscaled * SF_val));
-  if (passTrigger){
-    val = SF_val;
-    if (effval) *effval = eff_scaled;
-  }
-  else{
-    eff_scaled = 1.f - eff_scaled;
-    eff_nominal_unscaled = 1.f - eff_nominal_unscaled;
+  for (size_t isyst=0; isyst<systs.size(); isyst++){
+    SystematicVariationTypes const& syst = systs.at(isyst);
+
+    SystematicVariationTypes activeSyst_eff_nominal = sNominal;
+    if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)) activeSyst_eff_nominal = syst;
+
+    SystematicVariationTypes activeSyst = sNominal;
+    if (HelperFunctions::checkListVariable(allowedSysts, syst)) activeSyst = syst;
+    if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Active systematics: " << activeSyst << " / " << activeSyst_eff_nominal << endl;
 
-    if (eff_nominal_unscaled>0.f){
-      val = eff_scaled / eff_nominal_unscaled;
+    float eff_nominal_unscaled=1;
+    evalScaleFactorFromHistogram_PtPt(eff_nominal_unscaled, syst_eff_mc_map->find(activeSyst_eff_nominal)->second.at(idx_BE), binlocs);
+
+    float SF_val = 1;
+    evalScaleFactorFromHistogram_PtPt(SF_val, syst_SF_map->find(activeSyst)->second.at(idx_BE), binlocs);
+
+    float& val = vals.at(isyst);
+    float* effval = (effvals ? &(effvals->at(isyst)) : nullptr);
+    float eff_scaled = std::min(1.f, std::max(0.f, eff_nominal_unscaled * SF_val));
+    if (passTrigger){
+      val = SF_val;
       if (effval) *effval = eff_scaled;
     }
     else{
-      val = 0;
-      if (effval) *effval = 0;
+      eff_scaled = 1.f - eff_scaled;
+      eff_nominal_unscaled = 1.f - eff_nominal_unscaled;
+
+      if (eff_nominal_unscaled>0.f){
+        val = eff_scaled / eff_nominal_unscaled;
+        if (effval) *effval = eff_scaled;
+      }
+      else{
+        val = 0;
+        if (effval) *effval = 0;
+      }
     }
   }
 }
@@ -301,63 +302,91 @@ void TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff(
   float const& pt, float const& eta, cms3_id_t const& partId,
   bool passTrigger,
   float& val, float* effval
+) const{
+  static thread_local std::vector<SystematicsHelpers::SystematicVariationTypes> systs(1);
+  static thread_local std::vector<float> vals, effvals;
+  systs.front() = syst;
+  getCombinedSingleLeptonSFAndEff(
+    systs,
+    pt, eta, partId,
+    passTrigger,
+    vals, (effval ? &effvals : nullptr)
+  );
+  val = vals.front();
+  if (effval) *effval = effvals.front();
+}
+void TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff(
+  std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+  float const& pt, float const& eta, cms3_id_t const& partId,
+  bool passTrigger,
+  std::vector<float>& vals, std::vector<float>* effvals
 ) const{
   using namespace SystematicsHelpers;
 
   if (verbosity>=MiscUtils::DEBUG) IVYout
-    << "TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff: Evaluating " << (effval ? "SFs and efficiencies" : "SFs")
+    << "TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff: Evaluating " << (effvals ? "SFs and efficiencies" : "SFs")
     << " for pT, eta, id = " << pt << ", " << eta << ", " << partId
     << ", passTrigger ?= " << passTrigger
     << endl;
 
-  val = 1;
-  if (effval) *effval = 1;
+  vals.assign(systs.size(), 1);
+  if (effvals) effvals->assign(systs.size(), 1);
 
   std::vector<SystematicVariationTypes> const allowedSysts={ sNominal, eTriggerEffDn, eTriggerEffUp, ePUDn, ePUUp };
   std::vector<SystematicVariationTypes> const allowedSysts_eff={ sNominal, ePUDn, ePUUp };
 
-  SystematicVariationTypes activeSyst_eff_nominal = sNominal;
-  if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)) activeSyst_eff_nominal = syst;
-
-  SystematicVariationTypes activeSyst = sNominal;
-  if (HelperFunctions::checkListVariable(allowedSysts, syst)) activeSyst = syst;
-  if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Active systematics: " << activeSyst << " / " << activeSyst_eff_nominal << endl;
-
   bool is_mu = std::abs(partId)==13;
 
-  // Obtain histograms
-  ExtendedHistogram_2D_f const* h_eff_mc = nullptr;
-  ExtendedHistogram_2D_f const* h_SF = nullptr;
+  // Obtain histogram maps
+  std::unordered_map<SystematicVariationTypes, size_t> const* syst_eff_mc_map = nullptr;
+  std::unordered_map<SystematicVariationTypes, size_t> const* syst_SF_map = nullptr;
   if (is_mu){
-    h_eff_mc = &(syst_eff_mc_SingleMuon_map.find(activeSyst_eff_nominal)->second);
-    h_SF = &(syst_SF_SingleMuon_map.find(activeSyst)->second);
+    syst_eff_mc_map = &syst_eff_mc_SingleMuon_map;
+    syst_SF_map = &syst_SF_SingleMuon_map;
   }
   else{
-    h_eff_mc = &(syst_eff_mc_SingleElectron_map.find(activeSyst_eff_nominal)->second);
-    h_SF = &(syst_SF_SingleElectron_map.find(activeSyst)->second);
+    syst_eff_mc_map = &syst_eff_mc_SingleElectron_map;
+    syst_SF_map = &syst_SF_SingleElectron_map;
   }
 
-  float eff_nominal_unscaled=1, eff_scaled=1;
-  evalScaleFactorFromHistogram_PtEta(eff_nominal_unscaled, pt, eta, *h_eff_mc, false, true);
+  static thread_local ScaleFactorTable::BinLocationList_t binlocs;
+  sftable_SingleLepton.findBins(std::abs(eta), pt, binlocs);
 
-  float SF_val = 1;
-  evalScaleFactorFromHistogram_PtEta(SF_val, pt, eta, *h_SF, false, true);
-  eff_scaled = std::min(1.f, std::max(0.f, eff_nominal_unscaled * SF_val));
-  if (passTrigger){
-    val = SF_val;
-    if (effval) *effval = eff_scaled;
-  }
-  else{
-    eff_scaled = 1.f - eff_scaled;
-    eff_nominal_unscaled = 1.f - eff_nominal_unscaled;
+  for (size_t isyst=0; isyst<systs.size(); isyst++){
+    SystematicVariationTypes const& syst = systs.at(isyst);
+
+    SystematicVariationTypes activeSyst_eff_nominal = sNominal;
+    if (HelperFunctions::checkListVariable(allowedSysts_eff, syst)) activeSyst_eff_nominal = syst;
+
+    SystematicVariationTypes activeSyst = sNominal;
+    if (HelperFunctions::checkListVariable(allowedSysts, syst)) activeSyst = syst;
+    if (verbosity>=MiscUtils::DEBUG) IVYout << "\t- Active systematics: " << activeSyst << " / " << activeSyst_eff_nominal << endl;
+
+    float eff_nominal_unscaled=1;
+    sftable_SingleLepton.evalScaleFactor(eff_nominal_unscaled, syst_eff_mc_map->find(activeSyst_eff_nominal)->second, binlocs);
 
-    if (eff_nominal_unscaled>0.f){
-      val = eff_scaled / eff_nominal_unscaled;
+    float SF_val = 1;
+    sftable_SingleLepton.evalScaleFactor(SF_val, syst_SF_map->find(activeSyst)->second, binlocs);
+
+    float& val = vals.at(isyst);
+    float* effval = (effvals ? &(effvals->at(isyst)) : nullptr);
+    float eff_scaled = std::min(1.f, std::max(0.f, eff_nominal_unscaled * SF_val));
+    if (passTrigger){
+      val = SF_val;
       if (effval) *effval = eff_scaled;
     }
     else{
-      val = 0;
-      if (effval) *effval = 0;
+      eff_scaled = 1.f - eff_scaled;
+      eff_nominal_unscaled = 1.f - eff_nominal_unscaled;
+
+      if (eff_nominal_unscaled>0.f){
+        val = eff_scaled / eff_nominal_unscaled;
+        if (effval) *effval = eff_scaled;
+      }
+      else{
+        val = 0;
+        if (effval) *effval = 0;
+      }
     }
   }
 }
@@ -368,8 +397,26 @@ void TriggerScaleFactorHandler::getCombinedDileptonSFAndEff(
   bool passTrigger,
   float& val, float* effval
 ) const{
-  val = 1;
-  if (effval) *effval = 1;
+  static thread_local std::vector<SystematicsHelpers::SystematicVariationTypes> systs(1);
+  static thread_local std::vector<float> vals, effvals;
+  systs.front() = syst;
+  getCombinedDileptonSFAndEff(
+    systs,
+    obj1, obj2,
+    passTrigger,
+    vals, (effval ? &effvals : nullptr)
+  );
+  val = vals.front();
+  if (effval) *effval = effvals.front();
+}
+void TriggerScaleFactorHandler::getCombinedDileptonSFAndEff(
+  std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+  ParticleObject const* obj1, ParticleObject const* obj2,
+  bool passTrigger,
+  std::vector<float>& vals, std::vector<float>* effvals
+) const{
+  vals.assign(systs.size(), 1);
+  if (effvals) effvals->assign(systs.size(), 1);
 
   if (!obj1 || !ParticleSelectionHelpers::isParticleForTriggerChecking(obj1)) return;
   if (!obj2 || !ParticleSelectionHelpers::isParticleForTriggerChecking(obj2)) return;
@@ -384,11 +431,11 @@ void TriggerScaleFactorHandler::getCombinedDileptonSFAndEff(
   if (std::abs(id2)==11) eta2 = dynamic_cast<ElectronObject const*>(obj2)->etaSC();
   else eta2 = obj2->eta();
   getCombinedDileptonSFAndEff(
-    syst,
+    systs,
     pt1, eta1, id1,
     pt2, eta2, id2,
     passTrigger,
-    val, effval
+    vals, effvals
   );
 }
 void TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff(
@@ -397,8 +444,26 @@ void TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff(
   bool passTrigger,
   float& val, float* effval
 ) const{
-  val = 1;
-  if (effval) *effval = 1;
+  static thread_local std::vector<SystematicsHelpers::SystematicVariationTypes> systs(1);
+  static thread_local std::vector<float> vals, effvals;
+  systs.front() = syst;
+  getCombinedSingleLeptonSFAndEff(
+    systs,
+    obj,
+    passTrigger,
+    vals, (effval ? &effvals : nullptr)
+  );
+  val = vals.front();
+  if (effval) *effval = effvals.front();
+}
+void TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff(
+  std::vector<SystematicsHelpers::SystematicVariationTypes> const& systs,
+  ParticleObject const* obj,
+  bool passTrigger,
+  std::vector<float>& vals, std::vector<float>* effvals
+) const{
+  vals.assign(systs.size(), 1);
+  if (effvals) effvals->assign(systs.size(), 1);
 
   if (!obj || !ParticleSelectionHelpers::isParticleForTriggerChecking(obj)) return;
 
@@ -408,9 +473,9 @@ void TriggerScaleFactorHandler::getCombinedSingleLeptonSFAndEff(
   if (std::abs(partId)==11) eta = dynamic_cast<ElectronObject const*>(obj)->etaSC();
   else eta = obj->eta();
   getCombinedSingleLeptonSFAndEff(
-    syst,
+    systs,
     pt, eta, partId,
     passTrigger,
-    val, effval
+    vals, effvals
   );
 }
@@ -44,7 +44,7 @@ void VHProdDecACGsDiscriminant::eval(const std::vector<float>& vars, const float
     float pVHdecSM = (pZHSM + pWHSM)*vars[iDecSM];
     float pVHdecBSM = (pZHBSM + pWHBSM)*vars[iDecBSM];
 
-    float gCommon = pow((theG.at(iGVH).second->Eval(valReco))*(theG.at(iGDec).second->Eval(valReco))*gscale, 2);
+    float gCommon = pow((evalG(iGVH, valReco))*(evalG(iGDec, valReco))*gscale, 2);
 
     val = pVHdecSM / (pVHdecSM + gCommon*pVHdecBSM);
   }
@@ -0,0 +1,98 @@
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include "common_includes.h"
+
+
+using namespace std;
+
+
+// Compare BTagCalibrationReader::eval against a linear search for the first matching entry, evaluated through a TF1,
+// over all b-tagging WP calibrations of the data period.
+// The points are taken on and right next to the boundaries of each entry, so the interval index is checked together with the formulas.
+void checkBTagCalibrationFormulas(TString period, double tolerance=1e-5){
+  SampleHelpers::setDataPeriod(period);
+
+  std::vector<BtagHelpers::BtagWPType> const calibtypes{ BtagHelpers::kDeepCSV_Loose, BtagHelpers::kDeepFlav_Loose };
+  std::vector<BTagEntry::OperatingPoint> const opPoints{ BTagEntry::OP_LOOSE, BTagEntry::OP_MEDIUM, BTagEntry::OP_TIGHT };
+  std::vector<std::string> const sysTypes{ "central", "down", "up" };
+  std::vector< std::pair<BTagEntry::JetFlavor, std::string> > const flavpairs{ { BTagEntry::FLAV_B, "comb" }, { BTagEntry::FLAV_C, "comb" }, { BTagEntry::FLAV_UDSG, "incl" } };
+
+  unsigned long long npoints_total=0, nmismatches_total=0;
+  for (auto const& calibtype:calibtypes){
+    TString const fname = BtagHelpers::getBtagSFFileName(calibtype);
+    IVYout << "checkBTagCalibrationFormulas: Checking " << fname << "..." << endl;
+    BTagCalibration calibration("", fname.Data());
+
+    for (auto const& opPoint:opPoints){
+      for (auto const& sysType:sysTypes){
+        for (auto const& flavpair:flavpairs){
+          BTagEntry::JetFlavor const& jf = flavpair.first;
+
+          std::vector<BTagEntry> entries;
+          BTagCalibrationReader reader(opPoint, sysType);
+          try{
+            for (auto const& be:calibration.getEntries(BTagEntry::Parameters(opPoint, flavpair.second, sysType))){
+              if (be.params.jetFlavor==jf) entries.push_back(be);
+            }
+            reader.load(calibration, jf, flavpair.second);
+          }
+          catch (std::exception const&){
+            continue;
+          }
+          if (entries.empty()) continue;
+
+          // Reference evaluation as in the original reader
+          bool useAbsEta = true;
+          std::vector<TF1> funcs; funcs.reserve(entries.size());
+          for (auto const& be:entries){
+            funcs.emplace_back("", be.formula.data(), be.params.ptMin, be.params.ptMax);
+            if (be.params.etaMin<0.f) useAbsEta = false;
+          }
+          auto evalReference = [&] (float eta, float const& pt){
+            if (useAbsEta && eta<0.f) eta = -eta;
+            for (size_t ie=0; ie<entries.size(); ie++){
+              BTagEntry::Parameters const& par = entries.at(ie).params;
+              if (par.etaMin<=eta && eta<par.etaMax && par.ptMin<pt && pt<=par.ptMax) return funcs.at(ie).Eval(pt);
+            }
+            return 0.;
+          };
+
+          unsigned long long npoints=0, nmismatches=0;
+          for (auto const& be:entries){
+            BTagEntry::Parameters const& par = be.params;
+            std::vector<float> const etavals{
+              par.etaMin, std::nextafter(par.etaMin, par.etaMax), (par.etaMin+par.etaMax)/2.f,
+              std::nextafter(par.etaMax, par.etaMin), par.etaMax
+            };
+            std::vector<float> const ptvals{
+              par.ptMin, std::nextafter(par.ptMin, par.ptMax), (par.ptMin+par.ptMax)/2.f,
+              std::nextafter(par.ptMax, par.ptMin), par.ptMax, std::nextafter(par.ptMax, std::numeric_limits<float>::max())
+            };
+            for (auto const& eta_abs:etavals){
+              for (auto const& eta:std::vector<float>{ eta_abs, -eta_abs }){
+                for (auto const& pt:ptvals){
+                  double const val_ref = evalReference(eta, pt);
+                  double const val = reader.eval(jf, eta, pt);
+                  npoints++;
+                  if (std::abs(val - val_ref)>tolerance*std::max(1., std::abs(val_ref))){
+                    if (nmismatches<10) IVYerr
+                      << "\t- Mismatch for OP " << opPoint << ", " << sysType << ", flavor " << jf
+                      << " at (eta, pt) = (" << eta << ", " << pt << "): " << val << " != " << val_ref
+                      << " (formula: " << be.formula << ")" << endl;
+                    nmismatches++;
+                  }
+                }
+              }
+            }
+          }
+          IVYout << "\t- OP " << opPoint << ", " << sysType << ", flavor " << jf << ": " << nmismatches << " / " << npoints << " points differ." << endl;
+          npoints_total += npoints;
+          nmismatches_total += nmismatches;
+        }
+      }
+    }
+  }
+
+  IVYout << "checkBTagCalibrationFormulas: " << nmismatches_total << " / " << npoints_total << " points differ in total." << endl;
+}
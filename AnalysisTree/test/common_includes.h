@@ -1,4 +1,8 @@
 #include <cassert>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <sstream>
 
 #include "VerbosityLevel.h"
 
@@ -47,6 +51,7 @@
 #include "PhysicsProcessHelpers.h"
 
 #include "BaseTreeLooper.h"
+#include "TimingHelpers.h"
 
 #include "HostHelpersCore.h"
 #include "HelperFunctions.h"
@@ -62,8 +67,10 @@
 #include "TH2D.h"
 #include "TH3D.h"
 #include "TMath.h"
+#include "TROOT.h"
 
 #include "splitFileAndAddForTransfer.h"
+#include "processSamplesConcurrently.h"
 
 
 using namespace std;
@@ -0,0 +1,86 @@
+// No includes, should be added at the end of common_includes.h
+
+// Mutex for the state shared by the samples processed in processSamplesConcurrently, e.g. the condor transfer list
+std::mutex& getSampleProcessingMutex(){
+  static std::mutex mtx;
+  return mtx;
+}
+
+// Messages of a single sample.
+// When samples are processed concurrently, the messages are kept in a buffer and written out together under the sample processing mutex
+// once the sample is done, so that the messages of different samples do not interleave. Otherwise, they are written out right away.
+class SampleProcessingLog{
+protected:
+  bool const isBuffered;
+  std::stringstream buffer;
+
+public:
+  SampleProcessingLog(bool isBuffered_) : isBuffered(isBuffered_){}
+  SampleProcessingLog(SampleProcessingLog const&) = delete;
+  ~SampleProcessingLog(){ flush(); }
+
+  template<typename T> SampleProcessingLog& operator<<(T const& val){
+    if (isBuffered) buffer << val;
+    else IvyStreamHelpers::IVYout << val;
+    return *this;
+  }
+  SampleProcessingLog& operator<<(std::ostream& (*manip)(std::ostream&)){
+    if (isBuffered) buffer << manip;
+    else IvyStreamHelpers::IVYout << manip;
+    return *this;
+  }
+
+  void flush(){
+    if (!isBuffered) return;
+    std::string const strlog = buffer.str();
+    if (strlog.empty()) return;
+    {
+      std::lock_guard<std::mutex> lock(getSampleProcessingMutex());
+      IvyStreamHelpers::IVYout << strlog << std::flush;
+    }
+    buffer.str("");
+  }
+};
+
+// Call fcn(strSample, log) for each sample in sampleList, processing up to nthreads samples at the same time.
+// 'log' is a SampleProcessingLog for the messages of the sample, and progress reports should pass getSampleProcessingMutex() to their ProgressMeter.
+// Each call should construct its own trees, handlers and output files,
+// and it should not change global configuration (e.g. the data period) while other samples are being processed.
+template<typename Fcn> void processSamplesConcurrently(std::vector<TString> const& sampleList, unsigned int nthreads, Fcn fcn){
+  using namespace std;
+  using namespace IvyStreamHelpers;
+
+  if (nthreads>sampleList.size()) nthreads = sampleList.size();
+  if (nthreads<=1){
+    for (auto const& strSample:sampleList){
+      if (SampleHelpers::doSignalInterrupt==1) break;
+      SampleProcessingLog log(false);
+      fcn(strSample, log);
+    }
+    return;
+  }
+
+  IVYout << "processSamplesConcurrently: Processing " << sampleList.size() << " samples with " << nthreads << " threads..." << endl;
+  ROOT::EnableThreadSafety();
+  // Histograms should not attach to the current directory of another thread
+  bool const addDirectoryStatus = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(false);
+
+  std::atomic<size_t> isample_next(0);
+  std::vector<std::thread> workers; workers.reserve(nthreads);
+  for (unsigned int ithread=0; ithread<nthreads; ithread++){
+    workers.emplace_back(
+      [&] (){
+        while (SampleHelpers::doSignalInterrupt!=1){
+          size_t const isample = isample_next++;
+          if (isample>=sampleList.size()) break;
+          SampleProcessingLog log(true);
+          fcn(sampleList.at(isample), log);
+        }
+      }
+    );
+  }
+  for (auto& worker:workers) worker.join();
+
+  TH1::AddDirectory(addDirectoryStatus);
+}
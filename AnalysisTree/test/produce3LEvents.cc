@@ -48,9 +48,6 @@ namespace LooperFunctionHelpers{
   bool keepLHEGenPartInfo = false;
   void setKeepLHEGenPartInfo(bool keepLHEGenPartInfo_);
 
-  std::vector<std::pair<TString, std::chrono::microseconds>> type_accTime_pairs;
-  void addTimeDuration(TString const& strname, std::chrono::microseconds const& dur);
-
 }
 bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
   // Define handlers
@@ -1066,16 +1063,6 @@ void LooperFunctionHelpers::setKeepGenAK4JetInfo(bool keepGenAK4JetInfo_){ keepG
 
 void LooperFunctionHelpers::setKeepLHEGenPartInfo(bool keepLHEGenPartInfo_){ keepLHEGenPartInfo = keepLHEGenPartInfo_; }
 
-void LooperFunctionHelpers::addTimeDuration(TString const& strname, std::chrono::microseconds const& dur){
-  for (auto& pp:type_accTime_pairs){
-    if (pp.first==strname){
-      pp.second = std::chrono::duration_cast<std::chrono::microseconds>(pp.second + dur);
-      return;
-    }
-  }
-  type_accTime_pairs.emplace_back(strname, dur);
-}
-
 void LooperFunctionHelpers::setApplyFakeableId(bool applyFakeables){
   MuonSelectionHelpers::setAllowFakeableInLooseSelection(applyFakeables);
   MuonSelectionHelpers::doRequireTrackerIsolationInFakeable(-1); // Set rel. trk. iso. to -1 so that we can test it separately.
@@ -1557,8 +1544,6 @@ void getTrees(
   // Loop over all events
   theLooper.loop(true);
 
-  for (auto const& pp:LooperFunctionHelpers::type_accTime_pairs) IVYout << pp.first << " duration: " << pp.second.count() << endl;
-
   // No need for the inputs
   for (auto& ss:sample_trees) delete ss;
 
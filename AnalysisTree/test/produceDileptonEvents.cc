@@ -4,6 +4,47 @@
 #include "OffshellCutflow.h"
 #include <IvyFramework/IvyAutoMELA/interface/IvyMELAHelpers.h>
 #include "TStyle.h"
+#include "TFileMerger.h"
+
+
+// Define handlers
+#define OBJECT_HANDLER_COMMON_DIRECTIVES \
+  HANDLER_DIRECTIVE(EventFilterHandler, eventFilter) \
+  HANDLER_DIRECTIVE(PFCandidateHandler, pfcandidateHandler) \
+  HANDLER_DIRECTIVE(MuonHandler, muonHandler) \
+  HANDLER_DIRECTIVE(ElectronHandler, electronHandler) \
+  HANDLER_DIRECTIVE(PhotonHandler, photonHandler) \
+  /*HANDLER_DIRECTIVE(SuperclusterHandler, superclusterHandler)*/ \
+  /*HANDLER_DIRECTIVE(FSRHandler, fsrHandler)*/ \
+  HANDLER_DIRECTIVE(JetMETHandler, jetHandler) \
+  HANDLER_DIRECTIVE(IsotrackHandler, isotrackHandler) \
+  HANDLER_DIRECTIVE(VertexHandler, vertexHandler)
+#define OBJECT_HANDLER_SIM_DIRECTIVES \
+  HANDLER_DIRECTIVE(SimEventHandler, simEventHandler) \
+  HANDLER_DIRECTIVE(GenInfoHandler, genInfoHandler)
+#define OBJECT_HANDLER_DIRECTIVES \
+  OBJECT_HANDLER_COMMON_DIRECTIVES \
+  OBJECT_HANDLER_SIM_DIRECTIVES
+#define SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
+  HANDLER_DIRECTIVE(MuonScaleFactorHandler, muonSFHandler) \
+  HANDLER_DIRECTIVE(ElectronScaleFactorHandler, electronSFHandler)
+#define SCALEFACTOR_HANDLER_SIM_DIRECTIVES \
+  HANDLER_DIRECTIVE(PhotonScaleFactorHandler, photonSFHandler) \
+  HANDLER_DIRECTIVE(PUJetIdScaleFactorHandler, pujetidSFHandler) \
+  HANDLER_DIRECTIVE(BtagScaleFactorHandler, btagSFHandler) \
+  HANDLER_DIRECTIVE(METCorrectionHandler, metCorrectionHandler)
+#define SCALEFACTOR_HANDLER_DIRECTIVES \
+  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
+  SCALEFACTOR_HANDLER_SIM_DIRECTIVES
+
+// Define HLT menus
+#define HLTMENU_DIRECTIVES \
+  HLTMENU_DIRECTIVE(SingleLepton) \
+  HLTMENU_DIRECTIVE(Dilepton_DF) \
+  HLTMENU_DIRECTIVE(Dilepton_DF_Extra) \
+  HLTMENU_DIRECTIVE(Dilepton_SF) \
+  HLTMENU_DIRECTIVE(PFHT_Control) \
+  HLTMENU_DIRECTIVE(PFMET_MHT_Control)
 
 
 namespace LooperFunctionHelpers{
@@ -11,7 +52,22 @@ namespace LooperFunctionHelpers{
   using namespace IvyStreamHelpers;
   using namespace OffshellCutflow;
 
+  bool looperSetup(BaseTreeLooper*);
   bool looperRule(BaseTreeLooper*, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const&, SimpleEntry&);
+  bool looperPreselection(BaseTreeLooper*);
+
+  // Handlers and HLT menus bound once per input tree by looperSetup
+#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* NAME = nullptr;
+  OBJECT_HANDLER_DIRECTIVES;
+  SCALEFACTOR_HANDLER_DIRECTIVES;
+#undef HANDLER_DIRECTIVE
+  bool hasSimpleHLTMenus = false;
+  bool hasHLTMenuProperties = false;
+#define HLTMENU_DIRECTIVE(NAME) \
+  std::vector< std::string > const* hltMenuSimple_##NAME = nullptr; \
+  std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const* hltMenuProps_##NAME = nullptr;
+  HLTMENU_DIRECTIVES;
+#undef HLTMENU_DIRECTIVE
 
 
   // Helper options for MET
@@ -49,152 +105,54 @@ namespace LooperFunctionHelpers{
   bool keepHardProcessParticles = false;
   void setKeepHardProcessParticles(bool keepHardProcessParticles_);
 
-  // Helpers to keep track of elapsed time
-  std::vector<std::pair<TString, std::chrono::microseconds>> type_accTime_pairs;
-  void addTimeDuration(TString const& strname, std::chrono::microseconds const& dur);
+  // Output columns, and their slots in the order of the recorded variables
+  ProductRecord productRecord;
+  std::vector<void*> productRecordSlots;
+  // Columns recorded only for the nominal systematic
+  std::vector<TString> productRecordNominalOnlyColumns;
+  void bookProductRecord();
 
 }
-bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
-  // Define handlers
-#define OBJECT_HANDLER_COMMON_DIRECTIVES \
-  HANDLER_DIRECTIVE(EventFilterHandler, eventFilter) \
-  HANDLER_DIRECTIVE(PFCandidateHandler, pfcandidateHandler) \
-  HANDLER_DIRECTIVE(MuonHandler, muonHandler) \
-  HANDLER_DIRECTIVE(ElectronHandler, electronHandler) \
-  HANDLER_DIRECTIVE(PhotonHandler, photonHandler) \
-  /*HANDLER_DIRECTIVE(SuperclusterHandler, superclusterHandler)*/ \
-  /*HANDLER_DIRECTIVE(FSRHandler, fsrHandler)*/ \
-  HANDLER_DIRECTIVE(JetMETHandler, jetHandler) \
-  HANDLER_DIRECTIVE(IsotrackHandler, isotrackHandler) \
-  HANDLER_DIRECTIVE(VertexHandler, vertexHandler)
-#define OBJECT_HANDLER_SIM_DIRECTIVES \
-  HANDLER_DIRECTIVE(SimEventHandler, simEventHandler) \
-  HANDLER_DIRECTIVE(GenInfoHandler, genInfoHandler)
-#define OBJECT_HANDLER_DIRECTIVES \
-  OBJECT_HANDLER_COMMON_DIRECTIVES \
-  OBJECT_HANDLER_SIM_DIRECTIVES
-#define SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
-  HANDLER_DIRECTIVE(MuonScaleFactorHandler, muonSFHandler) \
-  HANDLER_DIRECTIVE(ElectronScaleFactorHandler, electronSFHandler)
-#define SCALEFACTOR_HANDLER_SIM_DIRECTIVES \
-  HANDLER_DIRECTIVE(PhotonScaleFactorHandler, photonSFHandler) \
-  HANDLER_DIRECTIVE(PUJetIdScaleFactorHandler, pujetidSFHandler) \
-  HANDLER_DIRECTIVE(BtagScaleFactorHandler, btagSFHandler) \
-  HANDLER_DIRECTIVE(METCorrectionHandler, metCorrectionHandler)
-#define SCALEFACTOR_HANDLER_DIRECTIVES \
-  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
-  SCALEFACTOR_HANDLER_SIM_DIRECTIVES
-
-  // Get the current tree
-  BaseTree* currentTree = theLooper->getWrappedTree();
-  if (!currentTree) return false;
-
-  // Acquire global variables
-  SystematicsHelpers::SystematicVariationTypes const& theGlobalSyst = theLooper->getSystematic();
-  ParticleDisambiguator& particleDisambiguator = theLooper->getParticleDisambiguator();
-  DileptonHandler& dileptonHandler = theLooper->getDileptonHandler();
-  IvyMELAHelpers::GMECBlock& MEblock = theLooper->getMEblock();
-
-  // Acquire sample flags
+bool LooperFunctionHelpers::looperSetup(BaseTreeLooper* theLooper){
   bool const& isData = theLooper->getCurrentTreeFlag_IsData();
-  bool const& isQCD = theLooper->getCurrentTreeFlag_QCDException();
-  bool const& isGJets_HT = theLooper->getCurrentTreeFlag_GJetsHTException();
-  float pTG_true_exception_range[2]={ -1, -1 };
-  bool hasPTGExceptionRange = theLooper->getPTGExceptionRange(pTG_true_exception_range[0], pTG_true_exception_range[1]);
-  bool needGenParticleChecks = isQCD || isGJets_HT || hasPTGExceptionRange;
 
   // Acquire triggers
-  auto const& triggerCheckListMap = theLooper->getHLTMenus();
-  auto const& triggerPropsCheckListMap = theLooper->getHLTMenuProperties();
-  bool hasSimpleHLTMenus = theLooper->hasSimpleHLTMenus();
-  bool hasHLTMenuProperties = theLooper->hasHLTMenuProperties();
+  hasSimpleHLTMenus = theLooper->hasSimpleHLTMenus();
+  hasHLTMenuProperties = theLooper->hasHLTMenuProperties();
   if (hasSimpleHLTMenus && hasHLTMenuProperties){
-    IVYerr << "LooperFunctionHelpers::looperRule: Defining both simple HLT menus and menus with properties is not allowed. Choose only one!" << endl;
-    assert(0);
-  }
-  auto it_HLTMenuSimple_SingleLepton = triggerCheckListMap.find("SingleLepton");
-  auto it_HLTMenuProps_SingleLepton = triggerPropsCheckListMap.find("SingleLepton");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_SingleLepton == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_SingleLepton == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'SingleLepton' has to be defined in this looper rule!" << endl;
-    assert(0);
-  }
-  auto it_HLTMenuSimple_Dilepton_DF = triggerCheckListMap.find("Dilepton_DF");
-  auto it_HLTMenuProps_Dilepton_DF = triggerPropsCheckListMap.find("Dilepton_DF");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_Dilepton_DF == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_Dilepton_DF == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'Dilepton_DF' has to be defined in this looper rule!" << endl;
-    assert(0);
-  }
-  auto it_HLTMenuSimple_Dilepton_DF_Extra = triggerCheckListMap.find("Dilepton_DF_Extra");
-  auto it_HLTMenuProps_Dilepton_DF_Extra = triggerPropsCheckListMap.find("Dilepton_DF_Extra");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_Dilepton_DF_Extra == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_Dilepton_DF_Extra == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'Dilepton_DF_Extra' has to be defined in this looper rule!" << endl;
-    assert(0);
-  }
-  auto it_HLTMenuSimple_Dilepton_SF = triggerCheckListMap.find("Dilepton_SF");
-  auto it_HLTMenuProps_Dilepton_SF = triggerPropsCheckListMap.find("Dilepton_SF");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_Dilepton_SF == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_Dilepton_SF == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'Dilepton_SF' has to be defined in this looper rule!" << endl;
+    IVYerr << "LooperFunctionHelpers::looperSetup: Defining both simple HLT menus and menus with properties is not allowed. Choose only one!" << endl;
     assert(0);
   }
-  auto it_HLTMenuSimple_PFHT_Control = triggerCheckListMap.find("PFHT_Control");
-  auto it_HLTMenuProps_PFHT_Control = triggerPropsCheckListMap.find("PFHT_Control");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_PFHT_Control == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_PFHT_Control == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'PFHT_Control' has to be defined in this looper rule!" << endl;
-    assert(0);
-  }
-  auto it_HLTMenuSimple_PFMET_MHT_Control = triggerCheckListMap.find("PFMET_MHT_Control");
-  auto it_HLTMenuProps_PFMET_MHT_Control = triggerPropsCheckListMap.find("PFMET_MHT_Control");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_PFMET_MHT_Control == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_PFMET_MHT_Control == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'PFMET_MHT_Control' has to be defined in this looper rule!" << endl;
-    assert(0);
+#define HLTMENU_DIRECTIVE(NAME) \
+  hltMenuSimple_##NAME = theLooper->getHLTMenu(#NAME); \
+  hltMenuProps_##NAME = theLooper->getHLTMenuProperties(#NAME); \
+  if ((hasSimpleHLTMenus && !hltMenuSimple_##NAME) || (hasHLTMenuProperties && !hltMenuProps_##NAME)){ \
+    IVYerr << "LooperFunctionHelpers::looperSetup: The trigger type '" << #NAME << "' has to be defined in this looper rule!" << endl; \
+    assert(0); \
   }
+  HLTMENU_DIRECTIVES;
+#undef HLTMENU_DIRECTIVE
 
   // Acquire all handlers
-#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* NAME = nullptr;
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = nullptr;
   OBJECT_HANDLER_DIRECTIVES;
   SCALEFACTOR_HANDLER_DIRECTIVES;
 #undef HANDLER_DIRECTIVE
-#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* tmp_##NAME = dynamic_cast<TYPE*>(handler); if (tmp_##NAME){ NAME = tmp_##NAME; continue; }
-  for (auto const& handler:theLooper->getObjectHandlers()){
-    OBJECT_HANDLER_COMMON_DIRECTIVES;
-    if (!isData){
-      OBJECT_HANDLER_SIM_DIRECTIVES;
-    }
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = theLooper->getObjectHandler<TYPE>();
+  OBJECT_HANDLER_COMMON_DIRECTIVES;
+  if (!isData){
+    OBJECT_HANDLER_SIM_DIRECTIVES;
   }
-  for (auto const& handler:theLooper->getSFHandlers()){
-    SCALEFACTOR_HANDLER_COMMON_DIRECTIVES;
-    if (!isData){
-      SCALEFACTOR_HANDLER_SIM_DIRECTIVES;
-    }
+#undef HANDLER_DIRECTIVE
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = theLooper->getSFHandler<TYPE>();
+  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES;
+  if (!isData){
+    SCALEFACTOR_HANDLER_SIM_DIRECTIVES;
   }
 #undef HANDLER_DIRECTIVE
 #define HANDLER_DIRECTIVE(TYPE, NAME) \
   if (!NAME){ \
-    IVYerr << "LooperFunctionHelpers::looperRule: " << #TYPE << " " << #NAME << " is not registered. Please register and re-run." << endl; \
+    IVYerr << "LooperFunctionHelpers::looperSetup: " << #TYPE << " " << #NAME << " is not registered. Please register and re-run." << endl; \
     assert(0); \
   }
   OBJECT_HANDLER_COMMON_DIRECTIVES;
@@ -205,6 +163,41 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   }
 #undef HANDLER_DIRECTIVE
 
+  return true;
+}
+// The dilepton selection needs at least two muons or electrons before any of their quality requirements.
+// Only the pT branches of these collections are read for this check, so events with fewer leptons skip the rest of the input.
+bool LooperFunctionHelpers::looperPreselection(BaseTreeLooper* theLooper){
+  std::vector<float>* const* muons_pt = nullptr;
+  std::vector<float>* const* electrons_pt = nullptr;
+  if (
+    !theLooper->getPreselectionValue(MuonHandler::colName + "_pt", muons_pt) || !muons_pt || !(*muons_pt)
+    ||
+    !theLooper->getPreselectionValue(ElectronHandler::colName + "_pt", electrons_pt) || !electrons_pt || !(*electrons_pt)
+    ) return true; // Do not reject the event if the branches are missing
+  return ((*muons_pt)->size() + (*electrons_pt)->size() >= 2);
+}
+bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
+  // Get the current tree
+  BaseTree* currentTree = theLooper->getWrappedTree();
+  if (!currentTree) return false;
+
+  // Acquire global variables
+  SystematicsHelpers::SystematicVariationTypes const& theGlobalSyst = theLooper->getSystematic();
+  ParticleDisambiguator& particleDisambiguator = theLooper->getParticleDisambiguator();
+  DileptonHandler& dileptonHandler = theLooper->getDileptonHandler();
+  IvyMELAHelpers::GMECBlock& MEblock = theLooper->getMEblock();
+
+  // Acquire sample flags
+  bool const& isData = theLooper->getCurrentTreeFlag_IsData();
+  bool const& isQCD = theLooper->getCurrentTreeFlag_QCDException();
+  bool const& isGJets_HT = theLooper->getCurrentTreeFlag_GJetsHTException();
+  float pTG_true_exception_range[2]={ -1, -1 };
+  bool hasPTGExceptionRange = theLooper->getPTGExceptionRange(pTG_true_exception_range[0], pTG_true_exception_range[1]);
+  bool needGenParticleChecks = isQCD || isGJets_HT || hasPTGExceptionRange;
+
+  // Handlers and HLT menus are bound in looperSetup
+
   /************************/
   /* EVENT INTERPRETATION */
   /************************/
@@ -475,13 +468,19 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   theLooper->incrementSelection("MET filters");
   event_pass_tightMETFilters = eventFilter->passMETFilters(EventFilterHandler::kMETFilters_Tight);
 
-  pfcandidateHandler->constructPFCandidates(theGlobalSyst);
+  {
+    TIMINGHELPERS_SCOPED_TIMER(timer_pfcandidates, "looperRule::constructPFCandidates");
+    pfcandidateHandler->constructPFCandidates(theGlobalSyst);
+  }
   auto const& pfcandidates = pfcandidateHandler->getProducts();
 
-  muonHandler->constructMuons(theGlobalSyst, &pfcandidates);
-  electronHandler->constructElectrons(theGlobalSyst, &pfcandidates);
-  photonHandler->constructPhotons(theGlobalSyst, &pfcandidates);
-  particleDisambiguator.disambiguateParticles(muonHandler, electronHandler, photonHandler);
+  {
+    TIMINGHELPERS_SCOPED_TIMER(timer_leptonsPhotons, "looperRule::constructLeptonsPhotons");
+    muonHandler->constructMuons(theGlobalSyst, &pfcandidates);
+    electronHandler->constructElectrons(theGlobalSyst, &pfcandidates);
+    photonHandler->constructPhotons(theGlobalSyst, &pfcandidates);
+    particleDisambiguator.disambiguateParticles(muonHandler, electronHandler, photonHandler);
+  }
 
   std::unordered_map<ParticleObject const*, float> lepton_eff_map;
   std::unordered_map<ParticleObject const*, float> lepton_eff_StatDn_map;
@@ -622,7 +621,10 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   if (theChosenDilepton->getDaughter_leadingPt()->pt()<25.f || theChosenDilepton->getDaughter_subleadingPt()->pt()<25.f) return false;
   theLooper->incrementSelection("Trigger efficiency plateau veto");
 
-  jetHandler->constructJetMET(simEventHandler, theGlobalSyst, &muons, &electrons, &photons, &pfcandidates);
+  {
+    TIMINGHELPERS_SCOPED_TIMER(timer_jetMET, "looperRule::constructJetMET");
+    jetHandler->constructJetMET(simEventHandler, theGlobalSyst, &muons, &electrons, &photons, &pfcandidates);
+  }
   auto const& ak4jets = jetHandler->getAK4Jets();
   auto const& ak8jets = jetHandler->getAK8Jets();
   auto const& eventmet = (use_MET_Puppi ? jetHandler->getPFPUPPIMET() : jetHandler->getPFMET());
@@ -638,32 +640,32 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
 
   std::vector<ParticleObject const*> leptons_TOmatched_SingleLepton;
   if (hasSimpleHLTMenus){
-    event_wgt_triggers_SingleLepton = eventFilter->getTriggerWeight(it_HLTMenuSimple_SingleLepton->second);
-    event_wgt_triggers_Dilepton = eventFilter->getTriggerWeight((dilepton_is_SF ? it_HLTMenuSimple_Dilepton_SF : it_HLTMenuSimple_Dilepton_DF)->second);
-    if (!dilepton_is_SF) event_wgt_triggers_Dilepton_DF_Extra = eventFilter->getTriggerWeight(it_HLTMenuSimple_Dilepton_DF_Extra->second);
-    event_wgt_triggers_PFHT_Control = eventFilter->getTriggerWeight(it_HLTMenuSimple_PFHT_Control->second);
-    event_wgt_triggers_PFMET_MHT_Control = eventFilter->getTriggerWeight(it_HLTMenuSimple_PFMET_MHT_Control->second);
+    event_wgt_triggers_SingleLepton = eventFilter->getTriggerWeight(*hltMenuSimple_SingleLepton);
+    event_wgt_triggers_Dilepton = eventFilter->getTriggerWeight(*(dilepton_is_SF ? hltMenuSimple_Dilepton_SF : hltMenuSimple_Dilepton_DF));
+    if (!dilepton_is_SF) event_wgt_triggers_Dilepton_DF_Extra = eventFilter->getTriggerWeight(*hltMenuSimple_Dilepton_DF_Extra);
+    event_wgt_triggers_PFHT_Control = eventFilter->getTriggerWeight(*hltMenuSimple_PFHT_Control);
+    event_wgt_triggers_PFMET_MHT_Control = eventFilter->getTriggerWeight(*hltMenuSimple_PFMET_MHT_Control);
   }
   else if (hasHLTMenuProperties){
     event_wgt_triggers_SingleLepton = eventFilter->getTriggerWeight(
-      it_HLTMenuProps_SingleLepton->second,
+      *hltMenuProps_SingleLepton,
       &muons, &electrons, nullptr, nullptr, nullptr, nullptr,
       nullptr, &leptons_TOmatched_SingleLepton
     );
     event_wgt_triggers_Dilepton = eventFilter->getTriggerWeight(
-      (dilepton_is_SF ? it_HLTMenuProps_Dilepton_SF : it_HLTMenuProps_Dilepton_DF)->second,
+      *(dilepton_is_SF ? hltMenuProps_Dilepton_SF : hltMenuProps_Dilepton_DF),
       &muons, &electrons, nullptr, nullptr, nullptr, nullptr
     );
     if (!dilepton_is_SF) event_wgt_triggers_Dilepton_DF_Extra = eventFilter->getTriggerWeight(
-      it_HLTMenuProps_Dilepton_DF_Extra->second,
+      *hltMenuProps_Dilepton_DF_Extra,
       &muons, &electrons, nullptr, nullptr, nullptr, nullptr
     );
     event_wgt_triggers_PFHT_Control = eventFilter->getTriggerWeight(
-      it_HLTMenuProps_PFHT_Control->second,
+      *hltMenuProps_PFHT_Control,
       nullptr, nullptr, nullptr, &ak4jets, nullptr, nullptr
     );
     event_wgt_triggers_PFMET_MHT_Control = eventFilter->getTriggerWeight(
-      it_HLTMenuProps_PFMET_MHT_Control->second,
+      *hltMenuProps_PFMET_MHT_Control,
       nullptr, nullptr, nullptr, &ak4jets, nullptr, eventmet
     );
   }
@@ -879,23 +881,16 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   // Compute MEs
   bool computeMEs = theLooper->hasRecoMEs() && pass_SRSel_Nminus1;
   if (computeMEs){
+    TIMINGHELPERS_SCOPED_TIMER(timer_MEs, "looperRule::computeMEs");
     SimpleParticleCollection_t daughters;
     daughters.push_back(SimpleParticle_t(25, ParticleObjectHelpers::convertCMSLorentzVectorToTLorentzVector(p4_ZZ_approx)));
 
     SimpleParticleCollection_t associated;
     for (auto const& jet:ak4jets_tight) associated.push_back(SimpleParticle_t(0, ParticleObjectHelpers::convertCMSLorentzVectorToTLorentzVector(jet->p4())));
 
-    IvyMELAHelpers::melaHandle->setCandidateDecayMode(TVar::CandidateDecay_Stable);
-    IvyMELAHelpers::melaHandle->setInputEvent(&daughters, &associated, nullptr, false);
-    MEblock.computeMELABranches();
-    MEblock.pushMELABranches();
-
-    IvyMELAHelpers::melaHandle->resetInputEvent();
-  }
-  else{
-    MEblock.computeMELABranches();
-    MEblock.pushMELABranches();
+    theLooper->computeMEs(TVar::CandidateDecay_Stable, &daughters, &associated, nullptr, false);
   }
+  else theLooper->computeMEs(TVar::CandidateDecay_Stable, nullptr);
   // Insert the ME values into commonEntry only when the productTreeList collection is empty.
   // Otherwise, the branches are already made.
   if (!theLooper->hasLinkedOutputTrees()){
@@ -904,7 +899,7 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
     for (auto const& it:ME_values) commonEntry.setNamedVal(it.first, it.second);
   }
 
-  if (!isData && keepGenAK4JetInfo){
+  if (!isData && keepGenAK4JetInfo && theGlobalSyst==SystematicsHelpers::sNominal){
     auto const& genak4jets = genInfoHandler->getGenAK4Jets();
     std::vector<float> genak4jets_pt; genak4jets_pt.reserve(genak4jets.size());
     std::vector<float> genak4jets_eta; genak4jets_eta.reserve(genak4jets.size());
@@ -926,7 +921,7 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
     commonEntry.setNamedVal("genak4jets_mass", genak4jets_mass);
   }
   if (!isData){
-    if (keepLHEGenPartInfo){
+    if (keepLHEGenPartInfo && theGlobalSyst==SystematicsHelpers::sNominal){
       auto const& lheparticles = genInfoHandler->getLHEParticles();
       for (auto const& part:lheparticles){
         if (PDGHelpers::isAHiggs(part->pdgId())){
@@ -981,15 +976,45 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   /*********************/
   /* RECORD THE OUTPUT */
   /*********************/
+  if (theLooper->getProductRecord()==&productRecord){
+    size_t islot = 0;
+#define BRANCH_COMMAND(TYPE, NAME) *static_cast<TYPE*>(productRecordSlots.at(islot++)) = NAME;
+    BRANCH_SCALAR_COMMANDS;
+#undef BRANCH_COMMAND
+#define BRANCH_COMMAND(TYPE, NAME) std::swap(*static_cast<std::vector<TYPE>*>(productRecordSlots.at(islot++)), NAME);
+    BRANCH_VECTOR_COMMANDS;
+#undef BRANCH_COMMAND
+  }
+  else{
 #define BRANCH_COMMAND(TYPE, NAME) if (!HelperFunctions::checkListVariable<TString>(bnames_exclude, #NAME)) commonEntry.setNamedVal(#NAME, NAME);
-  BRANCH_COMMANDS;
+    BRANCH_COMMANDS;
 #undef BRANCH_COMMAND
+  }
 
   return true;
+}
+
+void LooperFunctionHelpers::bookProductRecord(){
+  // All columns are booked so that the same record serves every systematic of the job.
+  // The variations are written only for the nominal systematic, as in looperRule.
+  auto isNominalOnly = [] (TString const& strname){ return (strname.EndsWith("Up") || strname.EndsWith("Dn")); };
+  productRecordSlots.clear();
+  productRecordNominalOnlyColumns.clear();
+#define BRANCH_COMMAND(TYPE, NAME) productRecordSlots.push_back(&(productRecord.addColumn<TYPE>(#NAME, 0))); if (isNominalOnly(#NAME)) productRecordNominalOnlyColumns.emplace_back(#NAME);
+  BRANCH_SCALAR_COMMANDS;
+#undef BRANCH_COMMAND
+#define BRANCH_COMMAND(TYPE, NAME) productRecordSlots.push_back(&(productRecord.addColumn<std::vector<TYPE>>(#NAME))); if (isNominalOnly(#NAME)) productRecordNominalOnlyColumns.emplace_back(#NAME);
+  BRANCH_VECTOR_COMMANDS;
+#undef BRANCH_COMMAND
+}
 
+#undef HLTMENU_DIRECTIVES
 #undef SCALEFACTOR_HANDLER_DIRECTIVES
+#undef SCALEFACTOR_HANDLER_SIM_DIRECTIVES
+#undef SCALEFACTOR_HANDLER_COMMON_DIRECTIVES
 #undef OBJECT_HANDLER_DIRECTIVES
-}
+#undef OBJECT_HANDLER_SIM_DIRECTIVES
+#undef OBJECT_HANDLER_COMMON_DIRECTIVES
 
 void LooperFunctionHelpers::setMETOptions(bool use_MET_Puppi_, bool use_MET_XYCorr_, bool use_MET_JERCorr_, bool use_MET_ParticleMomCorr_, bool use_MET_p4Preservation_, bool use_MET_corrections_){
   use_MET_Puppi = use_MET_Puppi_;
@@ -1018,16 +1043,6 @@ void LooperFunctionHelpers::setKeepLHEGenPartInfo(bool keepLHEGenPartInfo_){ kee
 
 void LooperFunctionHelpers::setKeepHardProcessParticles(bool keepHardProcessParticles_){ keepHardProcessParticles = keepHardProcessParticles_; }
 
-void LooperFunctionHelpers::addTimeDuration(TString const& strname, std::chrono::microseconds const& dur){
-  for (auto& pp:type_accTime_pairs){
-    if (pp.first==strname){
-      pp.second = std::chrono::duration_cast<std::chrono::microseconds>(pp.second + dur);
-      return;
-    }
-  }
-  type_accTime_pairs.emplace_back(strname, dur);
-}
-
 
 using namespace SystematicsHelpers;
 void getTrees(
@@ -1041,10 +1056,26 @@ void getTrees(
   bool applyPUIdToAK4Jets=true, bool applyTightLeptonVetoIdToAK4Jets=false,
   // MET options
   bool use_MET_Puppi=false,
-  bool use_MET_XYCorr=true, bool use_MET_JERCorr=false, bool use_MET_ParticleMomCorr=true, bool use_MET_p4Preservation=true, bool use_MET_corrections=true
+  bool use_MET_XYCorr=true, bool use_MET_JERCorr=false, bool use_MET_ParticleMomCorr=true, bool use_MET_p4Preservation=true, bool use_MET_corrections=true,
+  // Additional systematics evaluated over the same events, separated by commas with the names from SystematicsHelpers::getSystName (e.g. "JECDn,JECUp").
+  // Each of them is written into its own output file.
+  TString strExtraSysts="",
+  // Input reading options: TTreeCache size in MB (negative values leave the ROOT defaults), and whether to prefetch the next input tree on a separate thread
+  int inputTreeCacheSizeMB=32, bool prefetchNextTree=false,
+  // Skip events with fewer than two muons and electrons after reading only their pT branches.
+  // The output is the same, but the event counts of the cutflow before the dilepton selection only include the preselected events.
+  bool applyLeptonPreselection=false,
+  // Directory to store the outcomes of the lepton preselection so that later passes over the same chunk only read the accepted events
+  TString strPreselectionIndexDir="",
+  // Chunk balancing options: Processing time summaries of earlier jobs (comma-separated) to balance the chunks of simulation samples,
+  // and whether to record the processing times of this job into a summary next to the output files.
+  TString strChunkCostSummaryInputs="", bool recordChunkCostSummary=false
 ){
   if (!SampleHelpers::checkRunOnCondor()) std::signal(SIGINT, SampleHelpers::setSignalInterrupt);
 
+  // Prefetching reads the next input tree on a separate thread, so ROOT has to be made thread-safe before any input is opened.
+  if (prefetchNextTree) ROOT::EnableThreadSafety();
+
   constexpr bool useJetOverlapStripping = false; // Keep overlap removal turned off
 
   if (nchunks==1){ nchunks = 0; ichunk=0; }
@@ -1075,6 +1106,28 @@ void getTrees(
     return;
   }
 
+  // Systematics evaluated in this job
+  std::vector<SystematicsHelpers::SystematicVariationTypes> systList{ theGlobalSyst };
+  if (strExtraSysts!=""){
+    std::vector<TString> strExtraSystList;
+    HelperFunctions::splitOptionRecursive(strExtraSysts, strExtraSystList, ',');
+    for (auto const& strsyst:strExtraSystList){
+      SystematicsHelpers::SystematicVariationTypes syst = SystematicsHelpers::nSystematicVariations;
+      for (int isyst=0; isyst<(int) SystematicsHelpers::nSystematicVariations; isyst++){
+        if (strsyst==SystematicsHelpers::getSystName((SystematicsHelpers::SystematicVariationTypes) isyst).data()){
+          syst = (SystematicsHelpers::SystematicVariationTypes) isyst;
+          break;
+        }
+      }
+      if (syst==SystematicsHelpers::nSystematicVariations){
+        IVYerr << "Systematic type " << strsyst << " is not recognized." << endl;
+        assert(0);
+      }
+      if (HelperFunctions::checkListVariable(disallowedSysts, syst)) IVYout << "Systematic type " << strsyst << " is not allowed because the set of weights already cover it. It is skipped." << endl;
+      else if (!HelperFunctions::checkListVariable(systList, syst)) systList.push_back(syst);
+    }
+  }
+
   gStyle->SetOptStat(0);
 
   if (strdate=="") strdate = HelperFunctions::todaysdate();
@@ -1142,6 +1195,18 @@ void getTrees(
   if (sampledirs.empty()) return;
   bool isData = SampleHelpers::checkSampleIsData(sampledirs.front());
   if (isData && theGlobalSyst!=sNominal) return;
+  if (isData) systList.resize(1);
+  // Systematics that change the samples cannot share the same pass over the events.
+  for (auto it_syst=systList.begin()+1; it_syst!=systList.end();){
+    std::vector<TString> sampledirs_syst;
+    SampleHelpers::constructSamplesList(strSampleSet, *it_syst, sampledirs_syst);
+    if (sampledirs_syst!=sampledirs){
+      IVYout << "Systematic type " << SystematicsHelpers::getSystName(*it_syst) << " uses different samples. It is skipped and should be run in a separate job." << endl;
+      it_syst = systList.erase(it_syst);
+    }
+    else it_syst++;
+  }
+  bool const hasNominalSyst = HelperFunctions::checkListVariable(systList, sNominal);
 
   // Set flags for ak4jet tight id
   AK4JetSelectionHelpers::setPUIdWP(applyPUIdToAK4Jets ? AK4JetSelectionHelpers::kTightPUJetId : AK4JetSelectionHelpers::nSelectionBits); // Default is 'tight'
@@ -1172,18 +1237,49 @@ void getTrees(
 
   curdir->cd();
 
-  // Create the output file
+  // Create the output files, one for each systematic
   TString coutput = SampleHelpers::getSampleIdentifier(strSampleSet);
   HelperFunctions::replaceString(coutput, "_MINIAODSIM", "");
   HelperFunctions::replaceString(coutput, "_MINIAOD", "");
-  TString stroutput = Form("%s/%s", coutput_main.Data(), coutput.Data());
-  stroutput += Form("_%s", systName.data());
-  if (nchunks>0) stroutput = stroutput + Form("_%i_of_%i", ichunk, nchunks);
-  stroutput += ".root";
-  TFile* foutput = TFile::Open(stroutput, "recreate");
-  foutput->cd();
-  BaseTree* tout = new BaseTree("SkimTree");
-  IVYout << "Created output file " << stroutput << "..." << endl;
+  std::vector<TString> stroutputs; stroutputs.reserve(systList.size());
+  for (auto const& syst:systList){
+    TString stroutput = Form("%s/%s", coutput_main.Data(), coutput.Data());
+    stroutput += Form("_%s", SystematicsHelpers::getSystName(syst).data());
+    if (nchunks>0) stroutput = stroutput + Form("_%i_of_%i", ichunk, nchunks);
+    stroutput += ".root";
+    stroutputs.push_back(stroutput);
+  }
+  // The checkpoint is named after the output of the main systematic.
+  // If the job resumes from it, keep the outputs of the earlier attempts as parts to be merged at the end.
+  TString stroutput_checkpoint = stroutputs.front();
+  HelperFunctions::replaceString<TString, TString const>(stroutput_checkpoint, ".root", "_checkpoint.txt");
+  std::vector<std::vector<TString>> stroutput_parts_list(stroutputs.size(), std::vector<TString>());
+  auto getOutputPartName = [] (TString const& stroutput, size_t const& ipart){
+    TString res = stroutput;
+    HelperFunctions::replaceString<TString, TString const>(res, ".root", Form("_part%zu.root", ipart));
+    return res;
+  };
+  bool const resumeFromCheckpoint = HostHelpers::FileReadable(stroutput_checkpoint.Data());
+  if (resumeFromCheckpoint) IVYout << "Resuming from the checkpoint " << stroutput_checkpoint << "..." << endl;
+  std::vector<TFile*> foutputs; foutputs.reserve(stroutputs.size());
+  std::vector<BaseTree*> touts; touts.reserve(stroutputs.size());
+  for (size_t isyst=0; isyst<stroutputs.size(); isyst++){
+    TString const& stroutput = stroutputs.at(isyst);
+    std::vector<TString>& stroutput_parts = stroutput_parts_list.at(isyst);
+    if (resumeFromCheckpoint){
+      while (HostHelpers::FileExists(getOutputPartName(stroutput, stroutput_parts.size()).Data())) stroutput_parts.push_back(getOutputPartName(stroutput, stroutput_parts.size()));
+      if (HostHelpers::FileExists(stroutput.Data())){
+        TString const strpart = getOutputPartName(stroutput, stroutput_parts.size());
+        std::rename(stroutput.Data(), strpart.Data());
+        stroutput_parts.push_back(strpart);
+      }
+      IVYout << "\t- Found " << stroutput_parts.size() << " partial outputs for " << stroutput << endl;
+    }
+    TFile* foutput = TFile::Open(stroutput, "recreate"); foutputs.push_back(foutput);
+    foutput->cd();
+    BaseTree* tout = new BaseTree("SkimTree"); touts.push_back(tout);
+    IVYout << "Created output file " << stroutput << "..." << endl;
+  }
   curdir->cd();
 
   // Declare handlers
@@ -1252,10 +1348,47 @@ void getTrees(
     theLooper.setEventIndexRangeBySampleChunks(true);
     theLooper.setEventIndexRange(ichunk, nchunks);
   }
-  // Set systematic
-  theLooper.setSystematic(theGlobalSyst);
+  // Set checkpoints
+  theLooper.setCheckpoint(stroutput_checkpoint, 50000);
+  // Set chunk balancing options
+  if (nchunks>0 && strChunkCostSummaryInputs!=""){
+    std::vector<TString> strChunkCostSummaryInputList;
+    HelperFunctions::splitOptionRecursive(strChunkCostSummaryInputs, strChunkCostSummaryInputList, ',');
+    for (auto const& fname:strChunkCostSummaryInputList) theLooper.addChunkCostSummary(fname);
+  }
+  TString stroutput_chunkcosts;
+  if (recordChunkCostSummary){
+    stroutput_chunkcosts = stroutputs.front();
+    HelperFunctions::replaceString<TString, TString const>(stroutput_chunkcosts, ".root", "_ChunkCosts.txt");
+    theLooper.setChunkCostSummaryOutput(stroutput_chunkcosts);
+  }
+  // Set input reading options
+  theLooper.setInputTreeCacheSize((inputTreeCacheSizeMB<0 ? -1 : static_cast<Long64_t>(inputTreeCacheSizeMB)*1024*1024));
+  theLooper.setPrefetchNextTree(prefetchNextTree);
+  // Set systematics.
+  // Additional systematics are evaluated over the same events, and each of them is written into its own output tree.
+  if (systList.size()==1) theLooper.setSystematic(theGlobalSyst);
+  else theLooper.setSystematics(systList);
+  // Set the output columns
+  LooperFunctionHelpers::bookProductRecord();
+  theLooper.setProductRecord(&LooperFunctionHelpers::productRecord);
+  for (auto const& syst:systList){
+    if (syst!=sNominal) theLooper.setProductRecordExclusions(syst, LooperFunctionHelpers::productRecordNominalOnlyColumns);
+  }
   // Set looper function
   theLooper.setLooperFunction(LooperFunctionHelpers::looperRule);
+  theLooper.setLooperSetupFunction(LooperFunctionHelpers::looperSetup);
+  if (applyLeptonPreselection){
+    theLooper.setLooperPreselectionFunction(LooperFunctionHelpers::looperPreselection);
+    theLooper.addPreselectionBranch<std::vector<float>*>(MuonHandler::colName + "_pt");
+    theLooper.addPreselectionBranch<std::vector<float>*>(ElectronHandler::colName + "_pt");
+    if (strPreselectionIndexDir!=""){
+      gSystem->mkdir(strPreselectionIndexDir, true);
+      // The identifier has to change whenever looperPreselection or its branches change.
+      theLooper.setPreselectionIndex(strPreselectionIndexDir, "DileptonEvents_NLeptonsGeq2");
+    }
+  }
+  else if (strPreselectionIndexDir!="") IVYerr << "The preselection index directory " << strPreselectionIndexDir << " is ignored because the lepton preselection is not applied." << endl;
   // Set object handlers
   theLooper.addObjectHandler(&simEventHandler);
   theLooper.addObjectHandler(&genInfoHandler);
@@ -1285,8 +1418,11 @@ void getTrees(
   theLooper.addSFHandler(&pujetidSFHandler);
   theLooper.addSFHandler(&btagSFHandler);
   theLooper.addSFHandler(&metCorrectionHandler);
-  // Set output tree
-  theLooper.addOutputTree(tout);
+  // Set output trees
+  if (systList.size()==1) theLooper.addOutputTree(touts.front());
+  else{
+    for (size_t isyst=0; isyst<systList.size(); isyst++) theLooper.addOutputTree(systList.at(isyst), touts.at(isyst));
+  }
   // Register the HLT menus
   theLooper.addHLTMenu("SingleLepton", triggerPropsCheckList_SingleLepton);
   theLooper.addHLTMenu("Dilepton_DF", triggerPropsCheckList_Dilepton_DF);
@@ -1304,6 +1440,9 @@ void getTrees(
 
   curdir->cd();
 
+  // The samples of the set are chained into the same looper and output rather than processed through processSamplesConcurrently:
+  // The looper functions keep their options, handlers and MELA state in LooperFunctionHelpers namespace globals,
+  // and each job already processes only one sample set, or a chunk of it.
   std::vector<BaseTree*> sample_trees; sample_trees.reserve(sampledirs.size());
   for (auto const& sname:sampledirs){
     TString strdsetfname = SampleHelpers::getDatasetFileName(sname);
@@ -1441,16 +1580,18 @@ void getTrees(
       genInfoHandler.setAcquireLHEMEWeights(has_lheMEweights);
       genInfoHandler.setAcquireLHEParticles(has_lheparticles);
       genInfoHandler.setAcquireGenParticles(has_genparticles);
-      genInfoHandler.setAcquireGenAK4Jets(has_genak4jets && theGlobalSyst==sNominal);
-      genInfoHandler.setDoGenJetsVDecayCleaning(has_genak4jets && theGlobalSyst==sNominal);
+      genInfoHandler.setAcquireGenAK4Jets(has_genak4jets && hasNominalSyst);
+      genInfoHandler.setDoGenJetsVDecayCleaning(has_genak4jets && hasNominalSyst);
       genInfoHandler.bookBranches(sample_tree);
 
-      LooperFunctionHelpers::setKeepGenAK4JetInfo(theGlobalSyst==sNominal);
-      LooperFunctionHelpers::setKeepLHEGenPartInfo(theGlobalSyst==sNominal);
+      LooperFunctionHelpers::setKeepGenAK4JetInfo(hasNominalSyst);
+      LooperFunctionHelpers::setKeepLHEGenPartInfo(hasNominalSyst);
       LooperFunctionHelpers::setKeepHardProcessParticles(has_genparticles && recordHardProcessParticles);
     }
     std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> globalWeights;
     double globalWeight = xsec * xsec_scale * BR_scale * (isData ? 1.f : lumi) / sum_wgts; globalWeights[theGlobalSyst] = globalWeight;
+    // The systematics allowed in this job do not change the sum of weights, so the additional ones share the normalization.
+    for (auto const& syst:systList) globalWeights[syst] = globalWeight;
     double globalWeight_PUDn = xsec * xsec_scale * BR_scale * (isData ? 1.f : lumi) / sum_wgts_PUDn; globalWeights[SystematicsHelpers::ePUDn] = globalWeight_PUDn;
     double globalWeight_PUUp = xsec * xsec_scale * BR_scale * (isData ? 1.f : lumi) / sum_wgts_PUUp; globalWeights[SystematicsHelpers::ePUUp] = globalWeight_PUUp;
     IVYout << "Sample " << sample_tree->sampleIdentifier << " has a gen. weight sum of " << sum_wgts << " (PU dn: " << sum_wgts_PUDn << ", PU up: " << sum_wgts_PUUp << ")." << endl;
@@ -1501,18 +1642,43 @@ void getTrees(
   // Loop over all events
   theLooper.loop(true);
 
-  for (auto const& pp:LooperFunctionHelpers::type_accTime_pairs) IVYout << pp.first << " duration: " << pp.second.count() << endl;
-
   // No need for the inputs
   for (auto& ss:sample_trees) delete ss;
 
   // Write output
-  foutput->cd();
-  tout->writeToFile(foutput);
-  delete tout;
-  foutput->Close();
+  for (size_t isyst=0; isyst<stroutputs.size(); isyst++){
+    TFile* const& foutput = foutputs.at(isyst);
+    BaseTree* const& tout = touts.at(isyst);
+    foutput->cd();
+    tout->writeToFile(foutput);
+    delete tout;
+    foutput->Close();
+  }
 
   curdir->cd();
 
-  splitFileAndAddForTransfer(stroutput);
+  // Merge the outputs of the earlier attempts with the current one in the order they were produced
+  for (size_t isyst=0; isyst<stroutputs.size(); isyst++){
+    TString const& stroutput = stroutputs.at(isyst);
+    std::vector<TString>& stroutput_parts = stroutput_parts_list.at(isyst);
+    if (stroutput_parts.empty()) continue;
+
+    TString const strpart = getOutputPartName(stroutput, stroutput_parts.size());
+    std::rename(stroutput.Data(), strpart.Data());
+    stroutput_parts.push_back(strpart);
+
+    TFileMerger merger(false);
+    merger.OutputFile(stroutput, "recreate");
+    for (auto const& strpart:stroutput_parts) merger.AddFile(strpart);
+    if (!merger.Merge()){
+      IVYerr << "Merging the partial outputs into " << stroutput << " failed." << endl;
+      assert(0);
+    }
+    for (auto const& strpart:stroutput_parts) std::remove(strpart.Data());
+    curdir->cd();
+  }
+  theLooper.clearCheckpoint();
+
+  for (auto const& stroutput:stroutputs) splitFileAndAddForTransfer(stroutput);
+  if (recordChunkCostSummary && HostHelpers::FileReadable(stroutput_chunkcosts.Data())) SampleHelpers::addToCondorTransferList(stroutput_chunkcosts);
 }
@@ -438,14 +438,10 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
     SimpleParticleCollection_t associated;
     for (auto const& jet:ak4jets_tight) associated.push_back(SimpleParticle_t(0, ParticleObjectHelpers::convertCMSLorentzVectorToTLorentzVector(jet->p4())));
 
-    IvyMELAHelpers::melaHandle->setCandidateDecayMode(TVar::CandidateDecay_Stable);
-    IvyMELAHelpers::melaHandle->setInputEvent(&daughters, &associated, nullptr, false);
-    MEblock.computeMELABranches();
-    MEblock.pushMELABranches();
+    theLooper->computeMEs(TVar::CandidateDecay_Stable, &daughters, &associated, nullptr, false);
 
     std::unordered_map<std::string, float> ME_values;
     MEblock.getBranchValues(ME_values);
-    IvyMELAHelpers::melaHandle->resetInputEvent();
 
     // Insert the ME values into commonEntry only when the productTreeList collection is empty.
     // Otherwise, the branches are already made.
@@ -12,10 +12,6 @@ namespace LooperFunctionHelpers{
 
   bool looperRule(BaseTreeLooper*, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const&, SimpleEntry&);
 
-  // Helpers to keep track of elapsed time
-  std::vector<std::pair<TString, std::chrono::microseconds>> type_accTime_pairs;
-  void addTimeDuration(TString const& strname, std::chrono::microseconds const& dur);
-
 }
 bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
   // Define handlers
@@ -235,15 +231,6 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
 #undef OBJECT_HANDLER_DIRECTIVES
 }
 
-void LooperFunctionHelpers::addTimeDuration(TString const& strname, std::chrono::microseconds const& dur){
-  for (auto& pp:type_accTime_pairs){
-    if (pp.first==strname){
-      pp.second = std::chrono::duration_cast<std::chrono::microseconds>(pp.second + dur);
-      return;
-    }
-  }
-  type_accTime_pairs.emplace_back(strname, dur);
-}
 
 
 using namespace SystematicsHelpers;
@@ -464,8 +451,6 @@ void getTrees(
   // Loop over all events
   theLooper.loop(true);
 
-  for (auto const& pp:LooperFunctionHelpers::type_accTime_pairs) IVYout << pp.first << " duration: " << pp.second.count() << endl;
-
   // No need for the inputs
   for (auto& ss:sample_trees) delete ss;
 
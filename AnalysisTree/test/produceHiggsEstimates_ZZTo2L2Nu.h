@@ -448,6 +448,11 @@ void produceHiggsEstimates_ZZTo2L2Nu(
 #undef BRANCH_COMMAND
     IVYout << "\t- Setting up references to ME and K factor variables..." << endl;
     for (auto& it:ME_Kfactor_values) tin->getValRef(it.first, it.second);
+    for (auto& KDspec:KDlist){
+      std::vector<float const*> KDinputs; KDinputs.reserve(KDspec.KDvars.size());
+      for (auto const& strKDvar:KDspec.KDvars) KDinputs.push_back(ME_Kfactor_values[strKDvar]);
+      KDspec.KD->bindInputs(KDinputs);
+    }
 
     {
       IVYout << "\t- Setting up references to custom. systematics evaluation variables..." << endl;
@@ -747,11 +752,7 @@ void produceHiggsEstimates_ZZTo2L2Nu(
       }
 
       // Update discriminants
-      for (auto& KDspec:KDlist){
-        std::vector<float> KDvars; KDvars.reserve(KDspec.KDvars.size());
-        for (auto const& strKDvar:KDspec.KDvars) KDvars.push_back(*(ME_Kfactor_values[strKDvar]));
-        KDspec.KD->update(KDvars, event_mZZ); // Use mZZ!
-      }
+      for (auto& KDspec:KDlist) KDspec.KD->update(event_mZZ); // Use mZZ!
 
       // Record the event to the output trees
       {
@@ -5,13 +5,64 @@
 #include "TStyle.h"
 
 
+// Define handlers
+#define OBJECT_HANDLER_COMMON_DIRECTIVES \
+  HANDLER_DIRECTIVE(EventFilterHandler, eventFilter) \
+  HANDLER_DIRECTIVE(PFCandidateHandler, pfcandidateHandler) \
+  HANDLER_DIRECTIVE(MuonHandler, muonHandler) \
+  HANDLER_DIRECTIVE(ElectronHandler, electronHandler) \
+  HANDLER_DIRECTIVE(PhotonHandler, photonHandler) \
+  /*HANDLER_DIRECTIVE(SuperclusterHandler, superclusterHandler)*/ \
+  /*HANDLER_DIRECTIVE(FSRHandler, fsrHandler)*/ \
+  HANDLER_DIRECTIVE(JetMETHandler, jetHandler) \
+  HANDLER_DIRECTIVE(IsotrackHandler, isotrackHandler) \
+  HANDLER_DIRECTIVE(VertexHandler, vertexHandler)
+#define OBJECT_HANDLER_SIM_DIRECTIVES \
+  HANDLER_DIRECTIVE(SimEventHandler, simEventHandler) \
+  HANDLER_DIRECTIVE(GenInfoHandler, genInfoHandler)
+#define OBJECT_HANDLER_DIRECTIVES \
+  OBJECT_HANDLER_COMMON_DIRECTIVES \
+  OBJECT_HANDLER_SIM_DIRECTIVES
+#define SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
+  HANDLER_DIRECTIVE(MuonScaleFactorHandler, muonSFHandler) \
+  HANDLER_DIRECTIVE(ElectronScaleFactorHandler, electronSFHandler)
+#define SCALEFACTOR_HANDLER_SIM_DIRECTIVES \
+  HANDLER_DIRECTIVE(PhotonScaleFactorHandler, photonSFHandler) \
+  HANDLER_DIRECTIVE(PUJetIdScaleFactorHandler, pujetidSFHandler) \
+  HANDLER_DIRECTIVE(BtagScaleFactorHandler, btagSFHandler) \
+  HANDLER_DIRECTIVE(METCorrectionHandler, metCorrectionHandler)
+#define SCALEFACTOR_HANDLER_DIRECTIVES \
+  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
+  SCALEFACTOR_HANDLER_SIM_DIRECTIVES
+
+// Define HLT menus
+#define HLTMENU_DIRECTIVES \
+  HLTMENU_DIRECTIVE(SingleLepton) \
+  HLTMENU_DIRECTIVE(Dilepton) \
+  HLTMENU_DIRECTIVE(SinglePhoton)
+
+
 namespace LooperFunctionHelpers{
   using namespace std;
   using namespace IvyStreamHelpers;
   using namespace OffshellCutflow;
 
+  bool looperSetup(BaseTreeLooper*);
   bool looperRule(BaseTreeLooper*, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const&, SimpleEntry&);
 
+  // Handlers and HLT menus bound once per input tree by looperSetup
+#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* NAME = nullptr;
+  OBJECT_HANDLER_DIRECTIVES;
+  SCALEFACTOR_HANDLER_DIRECTIVES;
+#undef HANDLER_DIRECTIVE
+  bool hasSimpleHLTMenus = false;
+  bool hasHLTMenuProperties = false;
+#define HLTMENU_DIRECTIVE(NAME) \
+  std::vector< std::string > const* hltMenuSimple_##NAME = nullptr; \
+  std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const* hltMenuProps_##NAME = nullptr;
+  HLTMENU_DIRECTIVES;
+#undef HLTMENU_DIRECTIVE
+
 
   // Helper options for MET
   bool use_MET_Puppi = false;
@@ -49,117 +100,46 @@ namespace LooperFunctionHelpers{
   void setKeepLHEGenPartInfo(bool keepLHEGenPartInfo_);
 
 }
-bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
-  // Define handlers
-#define OBJECT_HANDLER_COMMON_DIRECTIVES \
-  HANDLER_DIRECTIVE(EventFilterHandler, eventFilter) \
-  HANDLER_DIRECTIVE(PFCandidateHandler, pfcandidateHandler) \
-  HANDLER_DIRECTIVE(MuonHandler, muonHandler) \
-  HANDLER_DIRECTIVE(ElectronHandler, electronHandler) \
-  HANDLER_DIRECTIVE(PhotonHandler, photonHandler) \
-  /*HANDLER_DIRECTIVE(SuperclusterHandler, superclusterHandler)*/ \
-  /*HANDLER_DIRECTIVE(FSRHandler, fsrHandler)*/ \
-  HANDLER_DIRECTIVE(JetMETHandler, jetHandler) \
-  HANDLER_DIRECTIVE(IsotrackHandler, isotrackHandler) \
-  HANDLER_DIRECTIVE(VertexHandler, vertexHandler)
-#define OBJECT_HANDLER_SIM_DIRECTIVES \
-  HANDLER_DIRECTIVE(SimEventHandler, simEventHandler) \
-  HANDLER_DIRECTIVE(GenInfoHandler, genInfoHandler)
-#define OBJECT_HANDLER_DIRECTIVES \
-  OBJECT_HANDLER_COMMON_DIRECTIVES \
-  OBJECT_HANDLER_SIM_DIRECTIVES
-#define SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
-  HANDLER_DIRECTIVE(MuonScaleFactorHandler, muonSFHandler) \
-  HANDLER_DIRECTIVE(ElectronScaleFactorHandler, electronSFHandler)
-#define SCALEFACTOR_HANDLER_SIM_DIRECTIVES \
-  HANDLER_DIRECTIVE(PhotonScaleFactorHandler, photonSFHandler) \
-  HANDLER_DIRECTIVE(PUJetIdScaleFactorHandler, pujetidSFHandler) \
-  HANDLER_DIRECTIVE(BtagScaleFactorHandler, btagSFHandler) \
-  HANDLER_DIRECTIVE(METCorrectionHandler, metCorrectionHandler)
-#define SCALEFACTOR_HANDLER_DIRECTIVES \
-  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
-  SCALEFACTOR_HANDLER_SIM_DIRECTIVES
-
-  // Get the current tree
-  BaseTree* currentTree = theLooper->getWrappedTree();
-  if (!currentTree) return false;
-
-  // Acquire global variables
-  SystematicsHelpers::SystematicVariationTypes const& theGlobalSyst = theLooper->getSystematic();
-  ParticleDisambiguator& particleDisambiguator = theLooper->getParticleDisambiguator();
-  DileptonHandler& dileptonHandler = theLooper->getDileptonHandler();
-  IvyMELAHelpers::GMECBlock& MEblock = theLooper->getMEblock();
-
-  // Acquire sample flags
+bool LooperFunctionHelpers::looperSetup(BaseTreeLooper* theLooper){
   bool const& isData = theLooper->getCurrentTreeFlag_IsData();
-  bool const& isQCD = theLooper->getCurrentTreeFlag_QCDException();
-  bool const& isGJets_HT = theLooper->getCurrentTreeFlag_GJetsHTException();
-  float pTG_true_exception_range[2]={ -1, -1 };
-  bool hasPTGExceptionRange = theLooper->getPTGExceptionRange(pTG_true_exception_range[0], pTG_true_exception_range[1]);
-  bool needGenParticleChecks = isQCD || isGJets_HT || hasPTGExceptionRange;
 
   // Acquire triggers
-  auto const& triggerCheckListMap = theLooper->getHLTMenus();
-  auto const& triggerPropsCheckListMap = theLooper->getHLTMenuProperties();
-  bool hasSimpleHLTMenus = theLooper->hasSimpleHLTMenus();
-  bool hasHLTMenuProperties = theLooper->hasHLTMenuProperties();
+  hasSimpleHLTMenus = theLooper->hasSimpleHLTMenus();
+  hasHLTMenuProperties = theLooper->hasHLTMenuProperties();
   if (hasSimpleHLTMenus && hasHLTMenuProperties){
-    IVYerr << "LooperFunctionHelpers::looperRule: Defining both simple HLT menus and menus with properties is not allowed. Choose only one!" << endl;
-    assert(0);
-  }
-  auto it_HLTMenuSimple_SingleLepton = triggerCheckListMap.find("SingleLepton");
-  auto it_HLTMenuProps_SingleLepton = triggerPropsCheckListMap.find("SingleLepton");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_SingleLepton == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_SingleLepton == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'SingleLepton' has to be defined in this looper rule!" << endl;
-    assert(0);
-  }
-  auto it_HLTMenuSimple_Dilepton = triggerCheckListMap.find("Dilepton");
-  auto it_HLTMenuProps_Dilepton = triggerPropsCheckListMap.find("Dilepton");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_Dilepton == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_Dilepton == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'Dilepton' has to be defined in this looper rule!" << endl;
+    IVYerr << "LooperFunctionHelpers::looperSetup: Defining both simple HLT menus and menus with properties is not allowed. Choose only one!" << endl;
     assert(0);
   }
-  auto it_HLTMenuSimple_SinglePhoton = triggerCheckListMap.find("SinglePhoton");
-  auto it_HLTMenuProps_SinglePhoton = triggerPropsCheckListMap.find("SinglePhoton");
-  if (
-    (hasSimpleHLTMenus && it_HLTMenuSimple_SinglePhoton == triggerCheckListMap.cend())
-    ||
-    (hasHLTMenuProperties && it_HLTMenuProps_SinglePhoton == triggerPropsCheckListMap.cend())
-    ){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'Dilepton_SinglePhoton' has to be defined in this looper rule!" << endl;
-    assert(0);
+#define HLTMENU_DIRECTIVE(NAME) \
+  hltMenuSimple_##NAME = theLooper->getHLTMenu(#NAME); \
+  hltMenuProps_##NAME = theLooper->getHLTMenuProperties(#NAME); \
+  if ((hasSimpleHLTMenus && !hltMenuSimple_##NAME) || (hasHLTMenuProperties && !hltMenuProps_##NAME)){ \
+    IVYerr << "LooperFunctionHelpers::looperSetup: The trigger type '" << #NAME << "' has to be defined in this looper rule!" << endl; \
+    assert(0); \
   }
+  HLTMENU_DIRECTIVES;
+#undef HLTMENU_DIRECTIVE
 
   // Acquire all handlers
-#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* NAME = nullptr;
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = nullptr;
   OBJECT_HANDLER_DIRECTIVES;
   SCALEFACTOR_HANDLER_DIRECTIVES;
 #undef HANDLER_DIRECTIVE
-#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* tmp_##NAME = dynamic_cast<TYPE*>(handler); if (tmp_##NAME){ NAME = tmp_##NAME; continue; }
-  for (auto const& handler:theLooper->getObjectHandlers()){
-    OBJECT_HANDLER_COMMON_DIRECTIVES;
-    if (!isData){
-      OBJECT_HANDLER_SIM_DIRECTIVES;
-    }
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = theLooper->getObjectHandler<TYPE>();
+  OBJECT_HANDLER_COMMON_DIRECTIVES;
+  if (!isData){
+    OBJECT_HANDLER_SIM_DIRECTIVES;
   }
-  for (auto const& handler:theLooper->getSFHandlers()){
-    SCALEFACTOR_HANDLER_COMMON_DIRECTIVES;
-    if (!isData){
-      SCALEFACTOR_HANDLER_SIM_DIRECTIVES;
-    }
+#undef HANDLER_DIRECTIVE
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = theLooper->getSFHandler<TYPE>();
+  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES;
+  if (!isData){
+    SCALEFACTOR_HANDLER_SIM_DIRECTIVES;
   }
 #undef HANDLER_DIRECTIVE
 #define HANDLER_DIRECTIVE(TYPE, NAME) \
   if (!NAME){ \
-    IVYerr << "LooperFunctionHelpers::looperRule: " << #TYPE << " " << #NAME << " is not registered. Please register and re-run." << endl; \
+    IVYerr << "LooperFunctionHelpers::looperSetup: " << #TYPE << " " << #NAME << " is not registered. Please register and re-run." << endl; \
     assert(0); \
   }
   OBJECT_HANDLER_COMMON_DIRECTIVES;
@@ -170,6 +150,29 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   }
 #undef HANDLER_DIRECTIVE
 
+  return true;
+}
+bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
+  // Get the current tree
+  BaseTree* currentTree = theLooper->getWrappedTree();
+  if (!currentTree) return false;
+
+  // Acquire global variables
+  SystematicsHelpers::SystematicVariationTypes const& theGlobalSyst = theLooper->getSystematic();
+  ParticleDisambiguator& particleDisambiguator = theLooper->getParticleDisambiguator();
+  DileptonHandler& dileptonHandler = theLooper->getDileptonHandler();
+  IvyMELAHelpers::GMECBlock& MEblock = theLooper->getMEblock();
+
+  // Acquire sample flags
+  bool const& isData = theLooper->getCurrentTreeFlag_IsData();
+  bool const& isQCD = theLooper->getCurrentTreeFlag_QCDException();
+  bool const& isGJets_HT = theLooper->getCurrentTreeFlag_GJetsHTException();
+  float pTG_true_exception_range[2]={ -1, -1 };
+  bool hasPTGExceptionRange = theLooper->getPTGExceptionRange(pTG_true_exception_range[0], pTG_true_exception_range[1]);
+  bool needGenParticleChecks = isQCD || isGJets_HT || hasPTGExceptionRange;
+
+  // Handlers and HLT menus are bound in looperSetup
+
   /************************/
   /* EVENT INTERPRETATION */
   /************************/
@@ -621,22 +624,22 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
 
   std::vector<ParticleObject const*> leptons_TOmatched_SingleLepton;
   if (hasSimpleHLTMenus){
-    event_wgt_triggers_SingleLepton = eventFilter->getTriggerWeight(it_HLTMenuSimple_SingleLepton->second);
-    event_wgt_triggers_Dilepton = eventFilter->getTriggerWeight(it_HLTMenuSimple_Dilepton->second);
-    event_wgt_triggers_SinglePhoton = eventFilter->getTriggerWeight(it_HLTMenuSimple_SinglePhoton->second);
+    event_wgt_triggers_SingleLepton = eventFilter->getTriggerWeight(*hltMenuSimple_SingleLepton);
+    event_wgt_triggers_Dilepton = eventFilter->getTriggerWeight(*hltMenuSimple_Dilepton);
+    event_wgt_triggers_SinglePhoton = eventFilter->getTriggerWeight(*hltMenuSimple_SinglePhoton);
   }
   else if (hasHLTMenuProperties){
     event_wgt_triggers_SingleLepton = eventFilter->getTriggerWeight(
-      it_HLTMenuProps_SingleLepton->second,
+      *hltMenuProps_SingleLepton,
       &muons, &electrons, nullptr, nullptr, nullptr, nullptr,
       nullptr, &leptons_TOmatched_SingleLepton
     );
     event_wgt_triggers_Dilepton = eventFilter->getTriggerWeight(
-      it_HLTMenuProps_Dilepton->second,
+      *hltMenuProps_Dilepton,
       &muons, &electrons, nullptr, nullptr, nullptr, nullptr
     );
     event_wgt_triggers_SinglePhoton = eventFilter->getTriggerWeight(
-      it_HLTMenuProps_SinglePhoton->second,
+      *hltMenuProps_SinglePhoton,
       nullptr, nullptr, &photons, nullptr, nullptr, nullptr
     );
   }
@@ -851,17 +854,9 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
     SimpleParticleCollection_t associated;
     for (auto const& jet:ak4jets_tight) associated.push_back(SimpleParticle_t(0, ParticleObjectHelpers::convertCMSLorentzVectorToTLorentzVector(jet->p4())));
 
-    IvyMELAHelpers::melaHandle->setCandidateDecayMode(TVar::CandidateDecay_Stable);
-    IvyMELAHelpers::melaHandle->setInputEvent(&daughters, &associated, nullptr, false);
-    MEblock.computeMELABranches();
-    MEblock.pushMELABranches();
-
-    IvyMELAHelpers::melaHandle->resetInputEvent();
-  }
-  else{
-    MEblock.computeMELABranches();
-    MEblock.pushMELABranches();
+    theLooper->computeMEs(TVar::CandidateDecay_Stable, &daughters, &associated, nullptr, false);
   }
+  else theLooper->computeMEs(TVar::CandidateDecay_Stable, nullptr);
   // Insert the ME values into commonEntry only when the productTreeList collection is empty.
   // Otherwise, the branches are already made.
   if (!theLooper->hasLinkedOutputTrees()){
@@ -925,10 +920,15 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
 #undef BRANCH_COMMAND
 
   return true;
+}
 
+#undef HLTMENU_DIRECTIVES
 #undef SCALEFACTOR_HANDLER_DIRECTIVES
+#undef SCALEFACTOR_HANDLER_SIM_DIRECTIVES
+#undef SCALEFACTOR_HANDLER_COMMON_DIRECTIVES
 #undef OBJECT_HANDLER_DIRECTIVES
-}
+#undef OBJECT_HANDLER_SIM_DIRECTIVES
+#undef OBJECT_HANDLER_COMMON_DIRECTIVES
 
 void LooperFunctionHelpers::setApplyLowDileptonMassReq(bool applyLowDileptonMassReq_){ applyLowDileptonMassReq = applyLowDileptonMassReq_; }
 
@@ -1175,6 +1175,7 @@ void getTrees(
   theLooper.setSystematic(theGlobalSyst);
   // Set looper function
   theLooper.setLooperFunction(LooperFunctionHelpers::looperRule);
+  theLooper.setLooperSetupFunction(LooperFunctionHelpers::looperSetup);
   // Set object handlers
   theLooper.addObjectHandler(&simEventHandler);
   theLooper.addObjectHandler(&genInfoHandler);
@@ -6,7 +6,7 @@
 using namespace std;
 
 
-void producePUExceptions(TString strSampleSet, TString period, TString prodVersion, TString strdate=""){
+void producePUExceptions(TString strSampleSet, TString period, TString prodVersion, TString strdate="", unsigned int nthreads=1){
   if (strdate=="") strdate = HelperFunctions::todaysdate();
 
   SampleHelpers::configure(period, "store:"+prodVersion);
@@ -22,44 +22,53 @@ void producePUExceptions(TString strSampleSet, TString period, TString prodVersi
   TString const stroutputcore = Form("output/PUExceptions/%s", strdate.Data());
 
   IVYout << "List of samples to process: " << sampleList << endl;
-  for (auto const& strSample:sampleList){
-    bool const isData = SampleHelpers::checkSampleIsData(strSample);
-    if (isData) return;
-
-    TString const cinputcore = SampleHelpers::getDatasetDirectoryName(strSample);
-    TString const cinput = SampleHelpers::getDatasetFileName(strSample);
-    IVYout << "Extracting input " << cinput << endl;
-
-    BaseTree sample_tree(cinput, EVENTS_TREE_NAME, "", "");
-    sample_tree.sampleIdentifier = SampleHelpers::getSampleIdentifier(strSample);
-    sample_tree.bookBranch<float>("n_true_int", 0.f);
-    float* n_true_int=nullptr;
-    sample_tree.getValRef("n_true_int", n_true_int);
-    sample_tree.silenceUnused();
-
-    // Create output
-    TString stroutput = stroutputcore;
-    gSystem->Exec(Form("mkdir -p %s", stroutput.Data()));
-    stroutput += "/" + sample_tree.sampleIdentifier + ".root";
-    IVYout << "Creating output file " << stroutput << "..." << endl;
-    TFile* foutput = TFile::Open(stroutput, "recreate");
-    TH1F hpu("pileup", sample_tree.sampleIdentifier, 100, 0, 100);
-
-    const int nEntries = sample_tree.getSelectedNEvents();
-    int ev_start = 0;
-    int ev_end = nEntries;
-    IVYout << "Looping over " << nEntries << " events, starting from " << ev_start << " and ending at " << ev_end << "..." << endl;
-
-    for (int ev=ev_start; ev<ev_end; ev++){
-      HelperFunctions::progressbar(ev, nEntries);
-      sample_tree.getSelectedEvent(ev);
-
-      if (HelperFunctions::checkVarNanInf(*n_true_int) && (*n_true_int)>=0) hpu.Fill(*n_true_int);
+  processSamplesConcurrently(
+    sampleList, nthreads,
+    [&] (TString const& strSample, SampleProcessingLog& log){
+      bool const isData = SampleHelpers::checkSampleIsData(strSample);
+      if (isData) return; // Skip data samples
+
+      TString const cinputcore = SampleHelpers::getDatasetDirectoryName(strSample);
+      TString const cinput = SampleHelpers::getDatasetFileName(strSample);
+      log << "Extracting input " << cinput << endl;
+
+      BaseTree sample_tree(cinput, EVENTS_TREE_NAME, "", "");
+      sample_tree.sampleIdentifier = SampleHelpers::getSampleIdentifier(strSample);
+      sample_tree.bookBranch<float>("n_true_int", 0.f);
+      float* n_true_int=nullptr;
+      sample_tree.getValRef("n_true_int", n_true_int);
+      sample_tree.silenceUnused();
+
+      // Create output
+      TString stroutput = stroutputcore;
+      gSystem->Exec(Form("mkdir -p %s", stroutput.Data()));
+      stroutput += "/" + sample_tree.sampleIdentifier + ".root";
+      log << "Creating output file " << stroutput << "..." << endl;
+      TFile* foutput = TFile::Open(stroutput, "recreate");
+      TH1F hpu("pileup", sample_tree.sampleIdentifier, 100, 0, 100);
+
+      const int nEntries = sample_tree.getSelectedNEvents();
+      int ev_start = 0;
+      int ev_end = nEntries;
+      log << "Looping over " << nEntries << " events, starting from " << ev_start << " and ending at " << ev_end << "..." << endl;
+      // Flush before the loop so that the progress reports follow the messages above
+      log.flush();
+
+      TimingHelpers::ProgressMeter progressMeter(30, &getSampleProcessingMutex());
+      for (int ev=ev_start; ev<ev_end; ev++){
+        progressMeter.update(sample_tree.sampleIdentifier, ev, nEntries);
+        sample_tree.getSelectedEvent(ev);
+
+        if (HelperFunctions::checkVarNanInf(*n_true_int) && (*n_true_int)>=0) hpu.Fill(*n_true_int);
+      }
+
+      foutput->WriteTObject(&hpu);
+      foutput->Close();
+
+      {
+        std::lock_guard<std::mutex> lock(getSampleProcessingMutex());
+        SampleHelpers::addToCondorTransferList(stroutput);
+      }
     }
-
-    foutput->WriteTObject(&hpu);
-    foutput->Close();
-
-    SampleHelpers::addToCondorTransferList(stroutput);
-  }
+  );
 }
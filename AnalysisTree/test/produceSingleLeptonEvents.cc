@@ -16,13 +16,55 @@ CONTROL_TRIGGER_COMMAND(PFMET_MHT_Control) \
 CONTROL_TRIGGER_COMMAND(PFHT_PFMET_MHT_Control)
 
 
+// Define handlers
+#define OBJECT_HANDLER_COMMON_DIRECTIVES \
+  HANDLER_DIRECTIVE(EventFilterHandler, eventFilter) \
+  HANDLER_DIRECTIVE(PFCandidateHandler, pfcandidateHandler) \
+  HANDLER_DIRECTIVE(MuonHandler, muonHandler) \
+  HANDLER_DIRECTIVE(ElectronHandler, electronHandler) \
+  HANDLER_DIRECTIVE(PhotonHandler, photonHandler) \
+  /*HANDLER_DIRECTIVE(SuperclusterHandler, superclusterHandler)*/ \
+  /*HANDLER_DIRECTIVE(FSRHandler, fsrHandler)*/ \
+  HANDLER_DIRECTIVE(JetMETHandler, jetHandler) \
+  HANDLER_DIRECTIVE(IsotrackHandler, isotrackHandler) \
+  HANDLER_DIRECTIVE(VertexHandler, vertexHandler)
+#define OBJECT_HANDLER_SIM_DIRECTIVES \
+  HANDLER_DIRECTIVE(SimEventHandler, simEventHandler) \
+  HANDLER_DIRECTIVE(GenInfoHandler, genInfoHandler)
+#define OBJECT_HANDLER_DIRECTIVES \
+  OBJECT_HANDLER_COMMON_DIRECTIVES \
+  OBJECT_HANDLER_SIM_DIRECTIVES
+#define SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
+  HANDLER_DIRECTIVE(MuonScaleFactorHandler, muonSFHandler) \
+  HANDLER_DIRECTIVE(ElectronScaleFactorHandler, electronSFHandler)
+#define SCALEFACTOR_HANDLER_SIM_DIRECTIVES \
+  HANDLER_DIRECTIVE(PhotonScaleFactorHandler, photonSFHandler) \
+  HANDLER_DIRECTIVE(PUJetIdScaleFactorHandler, pujetidSFHandler) \
+  HANDLER_DIRECTIVE(BtagScaleFactorHandler, btagSFHandler) \
+  HANDLER_DIRECTIVE(METCorrectionHandler, metCorrectionHandler)
+#define SCALEFACTOR_HANDLER_DIRECTIVES \
+  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
+  SCALEFACTOR_HANDLER_SIM_DIRECTIVES
+
+
 namespace LooperFunctionHelpers{
   using namespace std;
   using namespace IvyStreamHelpers;
   using namespace OffshellCutflow;
 
+  bool looperSetup(BaseTreeLooper*);
   bool looperRule(BaseTreeLooper*, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const&, SimpleEntry&);
 
+  // Handlers and HLT menus bound once per input tree by looperSetup
+#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* NAME = nullptr;
+  OBJECT_HANDLER_DIRECTIVES;
+  SCALEFACTOR_HANDLER_DIRECTIVES;
+#undef HANDLER_DIRECTIVE
+  std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const* hltMenuProps_SingleLepton = nullptr;
+#define CONTROL_TRIGGER_COMMAND(TYPE) std::vector< std::pair<TriggerHelpers::TriggerType, HLTTriggerPathProperties const*> > const* hltMenuProps_##TYPE = nullptr;
+  CONTROL_TRIGGER_COMMANDS;
+#undef CONTROL_TRIGGER_COMMAND
+
 
   // Helper options for MET
   bool use_MET_Puppi = false;
@@ -60,73 +102,25 @@ namespace LooperFunctionHelpers{
   void setApplyFakeableId(bool applyFakeables_);
 
 }
-bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
-  // Define handlers
-#define OBJECT_HANDLER_COMMON_DIRECTIVES \
-  HANDLER_DIRECTIVE(EventFilterHandler, eventFilter) \
-  HANDLER_DIRECTIVE(PFCandidateHandler, pfcandidateHandler) \
-  HANDLER_DIRECTIVE(MuonHandler, muonHandler) \
-  HANDLER_DIRECTIVE(ElectronHandler, electronHandler) \
-  HANDLER_DIRECTIVE(PhotonHandler, photonHandler) \
-  /*HANDLER_DIRECTIVE(SuperclusterHandler, superclusterHandler)*/ \
-  /*HANDLER_DIRECTIVE(FSRHandler, fsrHandler)*/ \
-  HANDLER_DIRECTIVE(JetMETHandler, jetHandler) \
-  HANDLER_DIRECTIVE(IsotrackHandler, isotrackHandler) \
-  HANDLER_DIRECTIVE(VertexHandler, vertexHandler)
-#define OBJECT_HANDLER_SIM_DIRECTIVES \
-  HANDLER_DIRECTIVE(SimEventHandler, simEventHandler) \
-  HANDLER_DIRECTIVE(GenInfoHandler, genInfoHandler)
-#define OBJECT_HANDLER_DIRECTIVES \
-  OBJECT_HANDLER_COMMON_DIRECTIVES \
-  OBJECT_HANDLER_SIM_DIRECTIVES
-#define SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
-  HANDLER_DIRECTIVE(MuonScaleFactorHandler, muonSFHandler) \
-  HANDLER_DIRECTIVE(ElectronScaleFactorHandler, electronSFHandler)
-#define SCALEFACTOR_HANDLER_SIM_DIRECTIVES \
-  HANDLER_DIRECTIVE(PhotonScaleFactorHandler, photonSFHandler) \
-  HANDLER_DIRECTIVE(PUJetIdScaleFactorHandler, pujetidSFHandler) \
-  HANDLER_DIRECTIVE(BtagScaleFactorHandler, btagSFHandler) \
-  HANDLER_DIRECTIVE(METCorrectionHandler, metCorrectionHandler)
-#define SCALEFACTOR_HANDLER_DIRECTIVES \
-  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES \
-  SCALEFACTOR_HANDLER_SIM_DIRECTIVES
-
-  // Get the current tree
-  BaseTree* currentTree = theLooper->getWrappedTree();
-  if (!currentTree) return false;
-
-  // Acquire global variables
-  SystematicsHelpers::SystematicVariationTypes const& theGlobalSyst = theLooper->getSystematic();
-  ParticleDisambiguator& particleDisambiguator = theLooper->getParticleDisambiguator();
-  DileptonHandler& dileptonHandler = theLooper->getDileptonHandler();
-  IvyMELAHelpers::GMECBlock& MEblock = theLooper->getMEblock();
-
-  // Acquire sample flags
+bool LooperFunctionHelpers::looperSetup(BaseTreeLooper* theLooper){
   bool const& isData = theLooper->getCurrentTreeFlag_IsData();
-  bool const& isQCD = theLooper->getCurrentTreeFlag_QCDException();
-  bool const& isGJets_HT = theLooper->getCurrentTreeFlag_GJetsHTException();
-  float pTG_true_exception_range[2]={ -1, -1 };
-  bool hasPTGExceptionRange = theLooper->getPTGExceptionRange(pTG_true_exception_range[0], pTG_true_exception_range[1]);
-  bool needGenParticleChecks = isQCD || isGJets_HT || hasPTGExceptionRange;
 
   // Acquire triggers
-  auto const& triggerPropsCheckListMap = theLooper->getHLTMenuProperties();
-  bool hasHLTMenuProperties = theLooper->hasHLTMenuProperties();
-  if (!hasHLTMenuProperties){
-    IVYerr << "LooperFunctionHelpers::looperRule: There must be HLT menus with properties." << endl;
+  if (!theLooper->hasHLTMenuProperties()){
+    IVYerr << "LooperFunctionHelpers::looperSetup: There must be HLT menus with properties." << endl;
     assert(0);
   }
-  auto it_HLTMenuProps = triggerPropsCheckListMap.find("SingleLepton");
-  if (it_HLTMenuProps == triggerPropsCheckListMap.cend()){
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type 'SingleLepton' has to be defined in this looper rule!" << endl;
+  hltMenuProps_SingleLepton = theLooper->getHLTMenuProperties("SingleLepton");
+  if (!hltMenuProps_SingleLepton){
+    IVYerr << "LooperFunctionHelpers::looperSetup: The trigger type 'SingleLepton' has to be defined in this looper rule!" << endl;
     assert(0);
   }
-#define CONTROL_TRIGGER_COMMAND(TYPE) auto it_HLTMenuProps_##TYPE = triggerPropsCheckListMap.find(#TYPE);
+#define CONTROL_TRIGGER_COMMAND(TYPE) hltMenuProps_##TYPE = theLooper->getHLTMenuProperties(#TYPE);
   CONTROL_TRIGGER_COMMANDS;
 #undef CONTROL_TRIGGER_COMMAND
 #define CONTROL_TRIGGER_COMMAND(TYPE) \
-  if (it_HLTMenuProps_##TYPE == triggerPropsCheckListMap.cend()){ \
-    IVYerr << "LooperFunctionHelpers::looperRule: The trigger type '" << #TYPE << "' has to be defined in this looper rule!" << endl; \
+  if (!hltMenuProps_##TYPE){ \
+    IVYerr << "LooperFunctionHelpers::looperSetup: The trigger type '" << #TYPE << "' has to be defined in this looper rule!" << endl; \
     assert(0); \
   }
   if (applyFakeables){
@@ -135,27 +129,25 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
 #undef CONTROL_TRIGGER_COMMAND
 
   // Acquire all handlers
-#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* NAME = nullptr;
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = nullptr;
   OBJECT_HANDLER_DIRECTIVES;
   SCALEFACTOR_HANDLER_DIRECTIVES;
 #undef HANDLER_DIRECTIVE
-#define HANDLER_DIRECTIVE(TYPE, NAME) TYPE* tmp_##NAME = dynamic_cast<TYPE*>(handler); if (tmp_##NAME){ NAME = tmp_##NAME; continue; }
-  for (auto const& handler:theLooper->getObjectHandlers()){
-    OBJECT_HANDLER_COMMON_DIRECTIVES;
-    if (!isData){
-      OBJECT_HANDLER_SIM_DIRECTIVES;
-    }
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = theLooper->getObjectHandler<TYPE>();
+  OBJECT_HANDLER_COMMON_DIRECTIVES;
+  if (!isData){
+    OBJECT_HANDLER_SIM_DIRECTIVES;
   }
-  for (auto const& handler:theLooper->getSFHandlers()){
-    SCALEFACTOR_HANDLER_COMMON_DIRECTIVES;
-    if (!isData){
-      SCALEFACTOR_HANDLER_SIM_DIRECTIVES;
-    }
+#undef HANDLER_DIRECTIVE
+#define HANDLER_DIRECTIVE(TYPE, NAME) NAME = theLooper->getSFHandler<TYPE>();
+  SCALEFACTOR_HANDLER_COMMON_DIRECTIVES;
+  if (!isData){
+    SCALEFACTOR_HANDLER_SIM_DIRECTIVES;
   }
 #undef HANDLER_DIRECTIVE
 #define HANDLER_DIRECTIVE(TYPE, NAME) \
   if (!NAME){ \
-    IVYerr << "LooperFunctionHelpers::looperRule: " << #TYPE << " " << #NAME << " is not registered. Please register and re-run." << endl; \
+    IVYerr << "LooperFunctionHelpers::looperSetup: " << #TYPE << " " << #NAME << " is not registered. Please register and re-run." << endl; \
     assert(0); \
   }
   OBJECT_HANDLER_COMMON_DIRECTIVES;
@@ -165,6 +157,29 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   }
 #undef HANDLER_DIRECTIVE
 
+  return true;
+}
+bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered_map<SystematicsHelpers::SystematicVariationTypes, double> const& extWgt, SimpleEntry& commonEntry){
+  // Get the current tree
+  BaseTree* currentTree = theLooper->getWrappedTree();
+  if (!currentTree) return false;
+
+  // Acquire global variables
+  SystematicsHelpers::SystematicVariationTypes const& theGlobalSyst = theLooper->getSystematic();
+  ParticleDisambiguator& particleDisambiguator = theLooper->getParticleDisambiguator();
+  DileptonHandler& dileptonHandler = theLooper->getDileptonHandler();
+  IvyMELAHelpers::GMECBlock& MEblock = theLooper->getMEblock();
+
+  // Acquire sample flags
+  bool const& isData = theLooper->getCurrentTreeFlag_IsData();
+  bool const& isQCD = theLooper->getCurrentTreeFlag_QCDException();
+  bool const& isGJets_HT = theLooper->getCurrentTreeFlag_GJetsHTException();
+  float pTG_true_exception_range[2]={ -1, -1 };
+  bool hasPTGExceptionRange = theLooper->getPTGExceptionRange(pTG_true_exception_range[0], pTG_true_exception_range[1]);
+  bool needGenParticleChecks = isQCD || isGJets_HT || hasPTGExceptionRange;
+
+  // Handlers and HLT menus are bound in looperSetup
+
   /************************/
   /* EVENT INTERPRETATION */
   /************************/
@@ -434,18 +449,21 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   float SF_muons_SystUp = 1;
   float SF_muons_AltMCDn = 1;
   float SF_muons_AltMCUp = 1;
+  if (!isData){
+    std::vector<float> SFs;
+    muonSFHandler->getIdIsoSFAndEff(
+      { theGlobalSyst, SystematicsHelpers::eMuEffStatDn, SystematicsHelpers::eMuEffStatUp, SystematicsHelpers::eMuEffSystDn, SystematicsHelpers::eMuEffSystUp, SystematicsHelpers::eMuEffAltMCDn, SystematicsHelpers::eMuEffAltMCUp },
+      muons, SFs, 1e-5f
+    );
+    SF_muons = SFs.at(0);
+    SF_muons_StatDn = SFs.at(1);
+    SF_muons_StatUp = SFs.at(2);
+    SF_muons_SystDn = SFs.at(3);
+    SF_muons_SystUp = SFs.at(4);
+    SF_muons_AltMCDn = SFs.at(5);
+    SF_muons_AltMCUp = SFs.at(6);
+  }
   for (auto const& part:muons){
-    float theSF = 1;
-    if (!isData){
-      theSF = 1; muonSFHandler->getIdIsoSFAndEff(theGlobalSyst, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_muons *= theSF;
-      theSF = 1; muonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eMuEffStatDn, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_muons_StatDn *= theSF;
-      theSF = 1; muonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eMuEffStatUp, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_muons_StatUp *= theSF;
-      theSF = 1; muonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eMuEffSystDn, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_muons_SystDn *= theSF;
-      theSF = 1; muonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eMuEffSystUp, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_muons_SystUp *= theSF;
-      theSF = 1; muonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eMuEffAltMCDn, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_muons_AltMCDn *= theSF;
-      theSF = 1; muonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eMuEffAltMCUp, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_muons_AltMCUp *= theSF;
-    }
-
     if ((!applyFakeables && ParticleSelectionHelpers::isTightParticle(part)) || (applyFakeables && ParticleSelectionHelpers::isLooseParticle(part))){
       theChosenLepton = part;
       n_leptons_tight++;
@@ -469,18 +487,21 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   float SF_electrons_SystUp = 1;
   float SF_electrons_AltMCDn = 1;
   float SF_electrons_AltMCUp = 1;
+  if (!isData){
+    std::vector<float> SFs;
+    electronSFHandler->getIdIsoSFAndEff(
+      { theGlobalSyst, SystematicsHelpers::eEleEffStatDn, SystematicsHelpers::eEleEffStatUp, SystematicsHelpers::eEleEffSystDn, SystematicsHelpers::eEleEffSystUp, SystematicsHelpers::eEleEffAltMCDn, SystematicsHelpers::eEleEffAltMCUp },
+      electrons, SFs, 1e-5f
+    );
+    SF_electrons = SFs.at(0);
+    SF_electrons_StatDn = SFs.at(1);
+    SF_electrons_StatUp = SFs.at(2);
+    SF_electrons_SystDn = SFs.at(3);
+    SF_electrons_SystUp = SFs.at(4);
+    SF_electrons_AltMCDn = SFs.at(5);
+    SF_electrons_AltMCUp = SFs.at(6);
+  }
   for (auto const& part:electrons){
-    float theSF = 1;
-    if (!isData){
-      theSF = 1; electronSFHandler->getIdIsoSFAndEff(theGlobalSyst, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_electrons *= theSF;
-      theSF = 1; electronSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eEleEffStatDn, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_electrons_StatDn *= theSF;
-      theSF = 1; electronSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eEleEffStatUp, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_electrons_StatUp *= theSF;
-      theSF = 1; electronSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eEleEffSystDn, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_electrons_SystDn *= theSF;
-      theSF = 1; electronSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eEleEffSystUp, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_electrons_SystUp *= theSF;
-      theSF = 1; electronSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eEleEffAltMCDn, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_electrons_AltMCDn *= theSF;
-      theSF = 1; electronSFHandler->getIdIsoSFAndEff(SystematicsHelpers::eEleEffAltMCUp, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_electrons_AltMCUp *= theSF;
-    }
-
     if ((!applyFakeables && ParticleSelectionHelpers::isTightParticle(part)) || (applyFakeables && ParticleSelectionHelpers::isLooseParticle(part))){
       theChosenLepton = part;
       n_leptons_tight++;
@@ -504,14 +525,14 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   float SF_photons = 1;
   float SF_photons_EffDn = 1;
   float SF_photons_EffUp = 1;
+  if (!isData){
+    std::vector<float> SFs;
+    photonSFHandler->getIdIsoSFAndEff({ theGlobalSyst, SystematicsHelpers::ePhoEffDn, SystematicsHelpers::ePhoEffUp }, photons, SFs, 1e-5f);
+    SF_photons = SFs.at(0);
+    SF_photons_EffDn = SFs.at(1);
+    SF_photons_EffUp = SFs.at(2);
+  }
   for (auto const& part:photons){
-    if (!isData){
-      float theSF = 1;
-      photonSFHandler->getIdIsoSFAndEff(theGlobalSyst, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_photons *= theSF;
-      theSF = 1; photonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::ePhoEffDn, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_photons_EffDn *= theSF;
-      theSF = 1; photonSFHandler->getIdIsoSFAndEff(SystematicsHelpers::ePhoEffUp, part, theSF, nullptr); theSF = std::max(1e-5f, theSF); SF_photons_EffUp *= theSF;
-    }
-
     if (ParticleSelectionHelpers::isVetoParticle(part)) n_photons_veto++;
   }
   event_wgt_SFs_photons = SF_photons;
@@ -578,24 +599,18 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   float SF_btagging = 1;
   float SF_btagging_EffDn = 1;
   float SF_btagging_EffUp = 1;
+  if (!isData){
+    std::vector<float> SFs;
+    pujetidSFHandler->getSFAndEff({ theGlobalSyst, SystematicsHelpers::ePUJetIdEffDn, SystematicsHelpers::ePUJetIdEffUp }, ak4jets, SFs, 1e-5f);
+    SF_PUJetId = SFs.at(0);
+    SF_PUJetId_EffDn = SFs.at(1);
+    SF_PUJetId_EffUp = SFs.at(2);
+    btagSFHandler->getSFAndEff({ theGlobalSyst, SystematicsHelpers::eBTagSFDn, SystematicsHelpers::eBTagSFUp }, ak4jets, SFs, 1e-5f);
+    SF_btagging = SFs.at(0);
+    SF_btagging_EffDn = SFs.at(1);
+    SF_btagging_EffUp = SFs.at(2);
+  }
   for (auto const& jet:ak4jets){
-    if (!isData){
-      float theSF_PUJetId = 1;
-      float theSF_btag = 1;
-      pujetidSFHandler->getSFAndEff(theGlobalSyst, jet, theSF_PUJetId, nullptr); theSF_PUJetId = std::max(theSF_PUJetId, 1e-5f); SF_PUJetId *= theSF_PUJetId;
-      btagSFHandler->getSFAndEff(theGlobalSyst, jet, theSF_btag, nullptr); theSF_btag = std::max(theSF_btag, 1e-5f); SF_btagging *= theSF_btag;
-
-      theSF_PUJetId = 1;
-      theSF_btag = 1;
-      pujetidSFHandler->getSFAndEff(SystematicsHelpers::ePUJetIdEffDn, jet, theSF_PUJetId, nullptr); theSF_PUJetId = std::max(theSF_PUJetId, 1e-5f); SF_PUJetId_EffDn *= theSF_PUJetId;
-      btagSFHandler->getSFAndEff(SystematicsHelpers::eBTagSFDn, jet, theSF_btag, nullptr); theSF_btag = std::max(theSF_btag, 1e-5f); SF_btagging_EffDn *= theSF_btag;
-
-      theSF_PUJetId = 1;
-      theSF_btag = 1;
-      pujetidSFHandler->getSFAndEff(SystematicsHelpers::ePUJetIdEffUp, jet, theSF_PUJetId, nullptr); theSF_PUJetId = std::max(theSF_PUJetId, 1e-5f); SF_PUJetId_EffUp *= theSF_PUJetId;
-      btagSFHandler->getSFAndEff(SystematicsHelpers::eBTagSFUp, jet, theSF_btag, nullptr); theSF_btag = std::max(theSF_btag, 1e-5f); SF_btagging_EffUp *= theSF_btag;
-    }
-
     if (ParticleSelectionHelpers::isTightJet(jet)){
       ak4jets_tight.push_back(jet);
       if (jet->getBtagValue()>=btag_thr_loose) event_n_ak4jets_pt30_btagged_loose++;
@@ -730,13 +745,13 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
   theLooper->incrementSelection("HEM15/16 and noisy jet vetos");
 
   if (!applyFakeables) event_wgt_triggers = eventFilter->getTriggerWeight(
-    it_HLTMenuProps->second,
+    *hltMenuProps_SingleLepton,
     &muons, &electrons, nullptr, nullptr, nullptr, nullptr
   );
   else{
 #define CONTROL_TRIGGER_COMMAND(TYPE) \
     event_wgt_triggers_##TYPE = eventFilter->getTriggerWeight( \
-      it_HLTMenuProps_##TYPE->second, \
+      *hltMenuProps_##TYPE, \
       nullptr, nullptr, nullptr, &ak4jets, &ak8jets, eventmet \
     ); \
     if (event_wgt_triggers_##TYPE != 0.f) event_wgt_triggers = (event_wgt_triggers==0.f ? event_wgt_triggers_##TYPE : std::min(event_wgt_triggers_##TYPE, event_wgt_triggers));
@@ -748,7 +763,7 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
     auto const& hltpaths = eventFilter->getHLTPaths();
     std::vector<ParticleObject*> triggerjet_candidates; // In order to match to single lepton triggers manually
     for (auto const& jet:ak4jets_tight) triggerjet_candidates.push_back(jet);
-    for (auto const& enumType_props_pair:it_HLTMenuProps->second){
+    for (auto const& enumType_props_pair:*hltMenuProps_SingleLepton){
       if (event_wgt_triggers_SingleLepton_jetMatched==1.f) break;
 
       auto const& trigger_type = enumType_props_pair.first;
@@ -825,17 +840,9 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
     SimpleParticleCollection_t associated;
     for (auto const& jet:ak4jets_tight) associated.push_back(SimpleParticle_t(0, ParticleObjectHelpers::convertCMSLorentzVectorToTLorentzVector(jet->p4())));
 
-    IvyMELAHelpers::melaHandle->setCandidateDecayMode(TVar::CandidateDecay_Stable);
-    IvyMELAHelpers::melaHandle->setInputEvent(&daughters, &associated, nullptr, false);
-    MEblock.computeMELABranches();
-    MEblock.pushMELABranches();
-
-    IvyMELAHelpers::melaHandle->resetInputEvent();
-  }
-  else{
-    MEblock.computeMELABranches();
-    MEblock.pushMELABranches();
+    theLooper->computeMEs(TVar::CandidateDecay_Stable, &daughters, &associated, nullptr, false);
   }
+  else theLooper->computeMEs(TVar::CandidateDecay_Stable, nullptr);
   // Insert the ME values into commonEntry only when the productTreeList collection is empty.
   // Otherwise, the branches are already made.
   if (!theLooper->hasLinkedOutputTrees()){
@@ -985,10 +992,14 @@ bool LooperFunctionHelpers::looperRule(BaseTreeLooper* theLooper, std::unordered
 #undef CONTROL_TRIGGER_COMMAND
 
   return true;
+}
 
 #undef SCALEFACTOR_HANDLER_DIRECTIVES
+#undef SCALEFACTOR_HANDLER_SIM_DIRECTIVES
+#undef SCALEFACTOR_HANDLER_COMMON_DIRECTIVES
 #undef OBJECT_HANDLER_DIRECTIVES
-}
+#undef OBJECT_HANDLER_SIM_DIRECTIVES
+#undef OBJECT_HANDLER_COMMON_DIRECTIVES
 
 void LooperFunctionHelpers::setMETOptions(bool use_MET_Puppi_, bool use_MET_XYCorr_, bool use_MET_JERCorr_, bool use_MET_ParticleMomCorr_, bool use_MET_p4Preservation_, bool use_MET_corrections_){
   use_MET_Puppi = use_MET_Puppi_;
@@ -1249,6 +1260,7 @@ void getTrees(
   theLooper.setSystematic(theGlobalSyst);
   // Set looper function
   theLooper.setLooperFunction(LooperFunctionHelpers::looperRule);
+  theLooper.setLooperSetupFunction(LooperFunctionHelpers::looperSetup);
   // Set object handlers
   theLooper.addObjectHandler(&simEventHandler);
   theLooper.addObjectHandler(&genInfoHandler);
@@ -120,6 +120,9 @@ void produceSkims(
   TString const stroutputcore = Form("output/Skims/%s", strdate.Data());
 
   IVYout << "List of samples to process: " << sampleList << endl;
+  // The samples are kept sequential instead of going through processSamplesConcurrently:
+  // The sums of weights switch the global data period through SampleHelpers::setDataPeriod in every event,
+  // and the handlers above are shared by all samples.
   for (auto const& strSample:sampleList){
     if (SampleHelpers::doSignalInterrupt==1) break;
 
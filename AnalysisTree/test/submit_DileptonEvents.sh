@@ -12,6 +12,13 @@ declare -i doZPrimeSim=1
 declare -i doData=1
 declare -i doAllSysts=0 # Do all systematics
 declare -i doImpSysts=0 # Only do important systematics
+declare -i doSinglePassSysts=0 # Evaluate the systematics in the same job as the nominal one
+declare -i inputTreeCacheSizeMB=32 # TTreeCache size of the input trees in MB (negative values leave the ROOT defaults)
+prefetchNextTree=false # Prefetch the next input tree on a separate thread
+applyLeptonPreselection=false # Skip events with fewer than two leptons before reading them completely
+preselectionIndexDir="" # Directory to keep the outcomes of the lepton preselection for later submissions
+chunkCostSummaryInputs="" # Comma-separated processing time summaries of earlier jobs to balance the chunks of simulation samples
+recordChunkCostSummary=false # Record the processing times of each job next to its output
 for arg in "$@"; do
   if [[ "$arg" == "only_data" ]]; then
     doSim=0
@@ -47,6 +54,20 @@ for arg in "$@"; do
     doAllSysts=1
   elif [[ "$arg" == "all_imp_systs" ]]; then
     doImpSysts=1
+  elif [[ "$arg" == "single_pass_systs" ]]; then
+    doSinglePassSysts=1
+  elif [[ "$arg" == "prefetch_next_tree" ]]; then
+    prefetchNextTree=true
+  elif [[ "$arg" == "lepton_preselection" ]]; then
+    applyLeptonPreselection=true
+  elif [[ "$arg" == "preselection_index_dir="* ]]; then
+    preselectionIndexDir=${arg#*=}
+  elif [[ "$arg" == "chunk_cost_summaries="* ]]; then
+    chunkCostSummaryInputs=${arg#*=}
+  elif [[ "$arg" == "record_chunk_costs" ]]; then
+    recordChunkCostSummary=true
+  elif [[ "$arg" == "inputTreeCacheSizeMB="* ]]; then
+    inputTreeCacheSizeMB=${arg#*=}
   elif [[ "$arg" == "useMETJERCorr="* ]]; then
     useMETJERCorr=${arg#*=}
   fi
@@ -58,7 +79,7 @@ fi
 script=produceDileptonEvents.cc
 function=getTrees
 jobdate="${date}_DileptonEvents"
-arguments='"<strSampleSet>","<period>","<prodVersion>","<strdate>",<ichunk>,<nchunks>,<theGlobalSyst>,<computeMEs>,<applyPUIdToAK4Jets>,<applyTightLeptonVetoIdToAK4Jets>,<use_MET_Puppi>,<use_MET_XYCorr>,<use_MET_JERCorr>,<use_MET_ParticleMomCorr>,<use_MET_p4Preservation>,<use_MET_corrections>'
+arguments='"<strSampleSet>","<period>","<prodVersion>","<strdate>",<ichunk>,<nchunks>,<theGlobalSyst>,<computeMEs>,<applyPUIdToAK4Jets>,<applyTightLeptonVetoIdToAK4Jets>,<use_MET_Puppi>,<use_MET_XYCorr>,<use_MET_JERCorr>,<use_MET_ParticleMomCorr>,<use_MET_p4Preservation>,<use_MET_corrections>,"<strExtraSysts>",<inputTreeCacheSizeMB>,<prefetchNextTree>,<applyLeptonPreselection>,"<strPreselectionIndexDir>","<strChunkCostSummaryInputs>",<recordChunkCostSummary>'
 arguments="${arguments/<strdate>/$date}"
 arguments="${arguments/<prodVersion>/$prodVersion}"
 arguments="${arguments/<computeMEs>/true}"
@@ -70,11 +91,19 @@ arguments="${arguments/<use_MET_JERCorr>/$useMETJERCorr}"
 arguments="${arguments/<use_MET_ParticleMomCorr>/true}"
 arguments="${arguments/<use_MET_p4Preservation>/true}"
 arguments="${arguments/<use_MET_corrections>/true}"
+arguments="${arguments/<inputTreeCacheSizeMB>/$inputTreeCacheSizeMB}"
+arguments="${arguments/<prefetchNextTree>/$prefetchNextTree}"
+arguments="${arguments/<applyLeptonPreselection>/$applyLeptonPreselection}"
+arguments="${arguments/<strPreselectionIndexDir>/$preselectionIndexDir}"
+arguments="${arguments/<strChunkCostSummaryInputs>/$chunkCostSummaryInputs}"
+arguments="${arguments/<recordChunkCostSummary>/$recordChunkCostSummary}"
 
 declare -a dataPeriods=( $period )
 declare -a DataSampleList=( )
 declare -a MCDataPeriods=( $period )
 declare -a MCSysts=( sNominal )
+# Names of the same systematics as returned by SystematicsHelpers::getSystName, to be evaluated together with sNominal
+declare -a MCExtraSystNames=( )
 if [[ $doAllSysts -eq 1 ]]; then
   MCSysts+=( \
     eEleScaleDn eEleScaleUp \
@@ -87,12 +116,33 @@ if [[ $doAllSysts -eq 1 ]]; then
     eJECDn eJECUp \
     eJERDn eJERUp \
   )
+  MCExtraSystNames+=( \
+    ElectronScaleDn ElectronScaleUp \
+    ElectronResDn ElectronResUp \
+    MuonScaleDn MuonScaleUp \
+    MuonResDn MuonResUp \
+    PhotonScaleDn PhotonScaleUp \
+    PhotonResDn PhotonResUp \
+    METDn METUp \
+    JECDn JECUp \
+    JERDn JERUp \
+  )
 elif [[ $doImpSysts -eq 1 ]]; then
   MCSysts+=( \
     eMETDn eMETUp \
     eJECDn eJECUp \
     eJERDn eJERUp \
   )
+  MCExtraSystNames+=( \
+    METDn METUp \
+    JECDn JECUp \
+    JERDn JERUp \
+  )
+fi
+strExtraSysts=""
+if [[ $doSinglePassSysts -eq 1 ]]; then
+  MCSysts=( sNominal )
+  strExtraSysts=$(IFS=,; echo "${MCExtraSystNames[*]}")
 fi
 declare -i dataYear
 
@@ -199,6 +249,7 @@ for sample in "${SimSamples[@]}"; do
         strargs="${strargs/<nchunks>/${nchunks}}"
         strargs="${strargs/<theGlobalSyst>/${syst}}"
         strargs="${strargs/<period>/$dataperiod}"
+        strargs="${strargs/<strExtraSysts>/${strExtraSysts}}"
 
 
         submitCMS3AnalysisProduction.sh script="${script}" function="${function}" arguments="${strargs}" date="${jobdate}"
@@ -242,6 +293,7 @@ for spl in "${DataSampleList[@]}"; do
       strargs="${strargs/<nchunks>/${nchunks}}"
       strargs="${strargs/<theGlobalSyst>/sNominal}"
       strargs="${strargs/<period>/$dataperiod}"
+      strargs="${strargs/<strExtraSysts>/}"
 
       submitCMS3AnalysisProduction.sh script="${script}" function="${function}" arguments="${strargs}" date="${jobdate}" memory="${REQMEM}" job_flavor="${JOBFLAV}"
 